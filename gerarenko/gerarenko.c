@@ -1,4 +1,7 @@
-//g++-11 -std=c++17 gerarenko.c -lboost_system -lpthread
+//g++-11 -std=c++17 gerarenko.c -lboost_system -lpthread -lzstd
+#if !defined(_WIN32) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE   // fopencookie (cedro_zst.h), quando compilado como C
+#endif
 #ifdef __cplusplus
 #include <cstdio>
 #include <cstdlib>
@@ -25,6 +28,28 @@ using namespace std;
 #include <ctype.h>
 #include <dirent.h>
 
+// Dia já arquivado pelo leitorwebsocket --archive fica só em _raw_data.txt.zst;
+// cz_fopen lê os dois (o .zst descomprimindo em threads). Com o coletor em
+// --writer mmap o _raw_data.txt do dia tem zeros pré-alocados depois dos dados:
+// cz_fopen abre pelo cmt_fopen (cedro_mmap_tail.h) e o fgets para no tail
+// publicado, em vez de andar pelos zeros e perder o que for gravado ali depois.
+#ifndef _WIN32
+#include "../parsers/cedro_zst.h"
+#include "../parsers/cedro_tail.h"   // tempo real acorda por inotify quando o arquivo cresce
+#define raw_fopen cz_fopen
+#else
+#define raw_fopen fopen
+#endif
+
+// Dentro do cedro_engine o builder roda numa thread do engine e o "arquivo" é
+// a fila de renko dele: as linhas B:/V: de um dia, sem o prefixo do coletor
+#ifdef CEDRO_ENGINE
+#include "../parsers/cedro_engine.h"
+#undef raw_fopen
+#define raw_fopen ce_renko_fopen
+#define main gerarenko_main
+#endif
+
 #define MAX_LINE_LENGTH 1024
 #define MAX_RENKO_SIZES 10
 #define MAX_SYMBOLS 3
@@ -43,6 +68,13 @@ typedef struct {
     int sizes[MAX_RENKO_SIZES];
 } RenkoConfig;
 
+// Configure Renko settings for multiple symbols
+static const RenkoConfig renko_configs[MAX_SYMBOLS] = {
+    {.asset = "DI", .factor = 0.1, .num_sizes = 2, .sizes = {3, 5} },
+    {.asset = "WDO", .factor = 0.5, .num_sizes = 3, .sizes = {5, 7, 10} },
+    {.asset = "WIN", .factor = 5.0, .num_sizes = 3, .sizes = {10, 20, 30} }
+};
+
 // Add new structure to hold trade data
 typedef struct {
     char asset[16];
@@ -167,7 +199,7 @@ int is_market_hours() {
 // Function to process the raw data file
 // Inside the process_raw_data function, add tracking for the last processed trade ID
 void process_raw_data(const char* raw_file, const RenkoConfig* configs, int num_configs, const char* day, int is_historical) {
-    FILE* input_file = fopen(raw_file, "r");
+    FILE* input_file = raw_fopen(raw_file, "r");
     if (!input_file) {
         printf("Error opening file: %s\n", raw_file);
         return;
@@ -213,7 +245,17 @@ void process_raw_data(const char* raw_file, const RenkoConfig* configs, int num_
     char line[MAX_LINE_LENGTH];
     char current_time_str[20];
     long last_position = 0;
+#ifdef _WIN32
     int eof_count = 0;
+#else
+    CtlWatch cw;
+    memset(&cw, 0, sizeof(cw));
+    cw.fd = -1;
+    if (!is_historical) {
+        ctl_init(&cw);
+        ctl_follow(&cw, raw_file);
+    }
+#endif
     
     // Add variables to track the last processed trade IDs for each symbol and brick size
     int last_trade_ids[MAX_SYMBOLS][MAX_RENKO_SIZES];
@@ -235,8 +277,15 @@ void process_raw_data(const char* raw_file, const RenkoConfig* configs, int num_
         // Salvar posição atual no arquivo
         last_position = ftell(input_file);
 
-        if (fgets(line, sizeof(line), input_file)) {
+        char* got = fgets(line, sizeof(line), input_file);
+#ifndef _WIN32
+        // Linha ainda sendo gravada: o else volta para last_position e espera o resto
+        if (got && !is_historical && ctl_partial_line(input_file, line, strlen(line))) got = NULL;
+#endif
+        if (got) {
+#ifdef _WIN32
             eof_count = 0; // Resetar contador de EOF quando há dados
+#endif
 
             // Process booking data
             if (strncmp(line, "B:", 2) == 0) {
@@ -497,13 +546,14 @@ void process_raw_data(const char* raw_file, const RenkoConfig* configs, int num_
                 break;
             }
             
+#ifdef _WIN32
             // Modo tempo real: tentar reabrir arquivo e aguardar novos dados
             eof_count++;
 
             if (eof_count >= 10) { // Após algumas tentativas
                 // Reabrir o arquivo para pegar novos dados
                 fclose(input_file);
-                input_file = fopen(raw_file, "r");
+                input_file = raw_fopen(raw_file, "r");
                 if (!input_file) {
                     printf("Error reopening file\n");
                     break;
@@ -515,13 +565,19 @@ void process_raw_data(const char* raw_file, const RenkoConfig* configs, int num_
             }
 
             // Aguardar antes de tentar ler novamente
-#ifdef _WIN32
             Sleep(SLEEP_INTERVAL_MS);
 #else
-            usleep(SLEEP_INTERVAL_MS * 1000);
+            // Modo tempo real: sem reabrir, limpa o EOF do stdio e dorme até o
+            // arquivo crescer
+            clearerr(input_file);
+            fseek(input_file, last_position, SEEK_SET);
+            ctl_wait(&cw, SLEEP_INTERVAL_MS);
 #endif
         }
     }
+#ifndef _WIN32
+    ctl_close(&cw);
+#endif
 
     // Close all files
     fclose(input_file);
@@ -609,8 +665,9 @@ void process_historical_files(const RenkoConfig* configs, int num_configs) {
     
     // Ler todos os arquivos do diretório
     while ((entry = readdir(dir)) != NULL) {
-        // Verificar se é um arquivo regular e se tem extensão .txt
-        if (entry->d_type == DT_REG && strstr(entry->d_name, ".txt") != NULL) {
+        // Verificar se é um arquivo regular e se tem extensão .txt (ou .txt.zst, dia arquivado)
+        const char* ext = strstr(entry->d_name, ".txt");
+        if (entry->d_type == DT_REG && ext != NULL && (strcmp(ext, ".txt") == 0 || strcmp(ext, ".txt.zst") == 0)) {
             char full_path[512];
             sprintf(full_path, "%s/%s", directory_path, entry->d_name);
             
@@ -660,12 +717,7 @@ int main(int argc, char* argv[]) {
     // Set Brazil timezone
     set_brazil_timezone();
     
-    // Configure Renko settings for multiple symbols
-    RenkoConfig configs[MAX_SYMBOLS] = {
-        {.asset = "DI", .factor = 0.1, .num_sizes = 2, .sizes = {3, 5} },
-        {.asset = "WDO", .factor = 0.5, .num_sizes = 3, .sizes = {5, 7, 10} },
-        {.asset = "WIN", .factor = 5.0, .num_sizes = 3, .sizes = {10, 20, 30} }
-    };
+    const RenkoConfig* configs = renko_configs;
     
     // Verificar argumentos de linha de comando
     int realtime_mode = 1;
@@ -743,3 +795,13 @@ int main(int argc, char* argv[]) {
     return 0;
 }
 
+#ifdef CEDRO_ENGINE
+// cedro_engine: um process_raw_data por dia do feed, em modo histórico (a
+// fila espera o dado novo e só dá EOF na virada do dia ou no fim da entrada)
+void gerarenko_engine_run(void) {
+    char day[9];
+    while (ce_renko_next_day(day)) {
+        process_raw_data("engine", renko_configs, MAX_SYMBOLS, day, 1);
+    }
+}
+#endif
@@ -0,0 +1,56 @@
+#!/bin/bash
+# bench_collector.sh - mede o coletor de ponta a ponta com um dia gravado.
+#
+# Sobe o feed_replay_server com o _raw_data.txt, roda o leitorwebsocket
+# (connect_and_listen() inteiro: login, assinaturas, leitura, gravação) com
+# --once --stats contra ele e imprime vazão, latência leitura->gravação por
+# tipo (p50/p99/p99.9), CPU e pico de RSS. Por padrão reproduz a abertura
+# (09:00:00-09:05:00) o mais rápido possível, que é o pior caso do dia.
+#
+# Uso: ./bench_collector.sh <YYYYMMDD_raw_data.txt> [--from HH:MM:SS] [--to HH:MM:SS]
+#                           [--speed original|max|N] [--port N] [-- opções extras do coletor]
+# Ex.: ./bench_collector.sh /home/grao/dados/cedro_files/20260108_raw_data.txt -- --writer mmap
+#
+# Os binários e os arquivos gravados ficam num diretório temporário (CXX=g++-11 etc. para trocar
+# o compilador). Para comparar mudanças, rode antes e depois com os mesmos argumentos.
+set -e
+
+if [ $# -lt 1 ]; then
+    sed -n '11,13p' "$0"
+    exit 2
+fi
+DAY=$1; shift
+FROM=09:00:00
+TO=09:05:00
+SPEED=max
+PORT=8181
+while [ $# -gt 0 ]; do
+    case "$1" in
+        --from) FROM=$2; shift 2 ;;
+        --to) TO=$2; shift 2 ;;
+        --speed) SPEED=$2; shift 2 ;;
+        --port) PORT=$2; shift 2 ;;
+        --) shift; break ;;
+        *) echo "Argumento invalido: $1"; exit 2 ;;
+    esac
+done
+
+SRC=$(cd "$(dirname "$0")" && pwd)
+WORK=$(mktemp -d /tmp/bench_collector.XXXXXX)
+trap 'kill $SRV 2>/dev/null || true; rm -rf "$WORK"' EXIT
+
+CXX=${CXX:-g++}
+$CXX -std=c++17 -O2 -I"$SRC/../parsers" "$SRC/leitorwebsocket.cpp" -o "$WORK/leitorwebsocket" -lboost_system -lpthread -lzstd
+$CXX -std=c++17 -O2 "$SRC/feed_replay_server.cpp" -o "$WORK/feed_replay_server" -lboost_system -lpthread
+
+"$WORK/feed_replay_server" "$DAY" --port "$PORT" --speed "$SPEED" --from "$FROM" --to "$TO" > "$WORK/server.log" 2>&1 &
+SRV=$!
+sleep 0.5
+
+"$WORK/leitorwebsocket" --host 127.0.0.1 --port "$PORT" --once --stats --ignore-hours \
+    --out-dir "$WORK/out" "$@" > "$WORK/collector.log" 2>&1 || true
+wait $SRV 2>/dev/null || true
+
+echo "dia=$(basename "$DAY") janela=$FROM-$TO speed=$SPEED coletor: $*"
+grep -a "fim do arquivo\|queda" "$WORK/server.log" || true
+grep -a "^\[stats\]" "$WORK/collector.log" || { echo "coletor não imprimiu estatísticas:"; tail -20 "$WORK/collector.log"; exit 1; }
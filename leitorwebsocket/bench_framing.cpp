@@ -0,0 +1,200 @@
+// bench_framing.cpp - compara o enquadramento/formatação antigo do coletor com o
+// caminho sem alocação de record_format.h, em linhas por segundo.
+//
+// Build: g++ -std=c++17 -O2 bench_framing.cpp -o bench_framing -lboost_system -lpthread
+// Uso:   ./bench_framing /home/grao/dados/cedro_files/20260108_raw_data.txt [--chunk 4096] [--iters 5]
+//
+// O payload de cada linha do _raw_data.txt é remontado como o fluxo do socket
+// ("payload\r\n"), fatiado em blocos de --chunk bytes e passado pelos dois
+// caminhos. Nenhum dos dois grava em disco: os lotes são descartados a cada
+// 10 linhas, como no flush do coletor, para medir só CPU.
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "record_format.h"
+
+static std::string legacy_datetime_str() {
+    std::time_t t = std::time(nullptr);
+    t -= 3 * 3600;
+    std::tm local_tm;
+    gmtime_r(&t, &local_tm);
+    char buffer[20];
+    std::strftime(buffer, sizeof(buffer), "%Y%m%d_%H%M%S", &local_tm);
+    return std::string(buffer);
+}
+
+struct Batches {
+    std::string raw, b, v, t, z;
+    int count = 0;
+    unsigned long long bytes = 0;
+    unsigned long long lines = 0;
+
+    void drop_if_full() {
+        if (count < 10) return;
+        bytes += raw.size() + b.size() + v.size() + t.size() + z.size();
+        raw.clear(); b.clear(); v.clear(); t.clear(); z.clear();
+        count = 0;
+    }
+};
+
+// Cópia do laço interno do connect_and_listen() antes do record_format.h
+static void run_legacy(const std::vector<std::string>& chunks, Batches& out) {
+    std::string rx_buffer;
+    rx_buffer.reserve(131072);
+    std::chrono::steady_clock::time_point last_record_tp;
+    bool has_last_record = false;
+
+    for (const std::string& chunk : chunks) {
+        boost::asio::streambuf reply_buf;
+        size_t reply_length = chunk.size();
+        auto dst = reply_buf.prepare(65536);
+        std::memcpy(dst.data(), chunk.data(), reply_length);
+        reply_buf.commit(reply_length);
+        rx_buffer.append(
+            boost::asio::buffers_begin(reply_buf.data()),
+            boost::asio::buffers_begin(reply_buf.data()) + reply_length
+        );
+        reply_buf.consume(reply_length);
+
+        size_t start = 0;
+        while (true) {
+            size_t nl = rx_buffer.find('\n', start);
+            if (nl == std::string::npos) break;
+
+            std::string line = rx_buffer.substr(start, nl - start);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            start = nl + 1;
+            if (line.empty()) continue;
+
+            const std::string ts = legacy_datetime_str();
+            auto now_line = std::chrono::steady_clock::now();
+            long long delta_ms = has_last_record ? std::chrono::duration_cast<std::chrono::milliseconds>(now_line - last_record_tp).count() : 0;
+            last_record_tp = now_line;
+            has_last_record = true;
+            out.raw += ts + "," + std::to_string(reply_length) + "," + std::to_string(delta_ms) + "," + line + "\n";
+            out.count++;
+            out.lines++;
+
+            if (line.rfind("B:", 0) == 0) {
+                out.b += ts + "," + std::to_string(reply_length) + "," + std::to_string(delta_ms) + "," + line + "\n";
+            } else if (line.rfind("V:", 0) == 0) {
+                out.v += ts + "," + std::to_string(reply_length) + "," + std::to_string(delta_ms) + "," + line + "\n";
+            } else if (line.rfind("T:", 0) == 0) {
+                out.t += ts + "," + std::to_string(reply_length) + "," + std::to_string(delta_ms) + "," + line + "\n";
+            } else if (line.rfind("Z:", 0) == 0) {
+                out.z += ts + "," + std::to_string(reply_length) + "," + std::to_string(delta_ms) + "," + line + "\n";
+            }
+            out.drop_if_full();
+        }
+
+        if (start > 0) rx_buffer.erase(0, start);
+        if (rx_buffer.size() > 1048576) rx_buffer.erase(0, rx_buffer.size() - 65536);
+    }
+}
+
+// Mesmo caminho da FeedWriter::handle_data()
+static void run_zero_copy(const std::vector<std::string>& chunks, Batches& out) {
+    LineFramer framer;
+    TsPrefixCache ts_cache;
+    std::chrono::steady_clock::time_point last_record_tp;
+    bool has_last_record = false;
+
+    for (const std::string& chunk : chunks) {
+        const size_t reply_length = chunk.size();
+        framer.feed(chunk.data(), chunk.size(), [&](std::string_view line) {
+            const std::string_view ts = ts_cache.get();
+            auto now_line = std::chrono::steady_clock::now();
+            long long delta_ms = has_last_record ? std::chrono::duration_cast<std::chrono::milliseconds>(now_line - last_record_tp).count() : 0;
+            last_record_tp = now_line;
+            has_last_record = true;
+
+            const size_t rec_start = out.raw.size();
+            append_record(out.raw, ts, reply_length, delta_ms, line);
+            out.count++;
+            out.lines++;
+
+            std::string* typed = nullptr;
+            switch (record_type(line)) {
+                case 'B': typed = &out.b; break;
+                case 'V': typed = &out.v; break;
+                case 'T': typed = &out.t; break;
+                case 'Z': typed = &out.z; break;
+            }
+            if (typed) typed->append(out.raw, rec_start, std::string::npos);
+            out.drop_if_full();
+        });
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Uso: " << argv[0] << " <YYYYMMDD_raw_data.txt> [--chunk N] [--iters N]" << std::endl;
+        return 2;
+    }
+    std::string path = argv[1];
+    size_t chunk_size = 4096;
+    int iters = 5;
+    for (int i = 2; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "--chunk" && i + 1 < argc) chunk_size = std::strtoul(argv[++i], nullptr, 10);
+        else if (a == "--iters" && i + 1 < argc) iters = std::atoi(argv[++i]);
+        else { std::cerr << "Argumento invalido: " << a << std::endl; return 2; }
+    }
+    if (chunk_size < 64) chunk_size = 64;
+    if (chunk_size > 65536) chunk_size = 65536;
+    if (iters < 1) iters = 1;
+
+    // Remonta o fluxo do socket a partir do payload gravado
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        std::cerr << "Erro: nao foi possivel abrir " << path << std::endl;
+        return 1;
+    }
+    std::string stream;
+    std::string line;
+    unsigned long long n_lines = 0;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        size_t p1 = line.find(',');
+        size_t p2 = (p1 == std::string::npos) ? p1 : line.find(',', p1 + 1);
+        size_t p3 = (p2 == std::string::npos) ? p2 : line.find(',', p2 + 1);
+        if (p3 == std::string::npos) continue;
+        stream.append(line, p3 + 1, std::string::npos);
+        stream += "\r\n";
+        n_lines++;
+    }
+    std::vector<std::string> chunks;
+    for (size_t off = 0; off < stream.size(); off += chunk_size) {
+        chunks.emplace_back(stream, off, chunk_size);
+    }
+    std::cout << "linhas=" << n_lines << " bytes=" << stream.size()
+              << " blocos=" << chunks.size() << " (chunk=" << chunk_size << ")" << std::endl;
+
+    auto bench = [&](const char* name, void (*fn)(const std::vector<std::string>&, Batches&)) {
+        double best = 1e30;
+        unsigned long long lines = 0, bytes = 0;
+        for (int it = 0; it < iters; it++) {
+            Batches b;
+            auto t0 = std::chrono::steady_clock::now();
+            fn(chunks, b);
+            auto t1 = std::chrono::steady_clock::now();
+            double s = std::chrono::duration<double>(t1 - t0).count();
+            if (s < best) best = s;
+            lines = b.lines;
+            bytes = b.bytes;
+        }
+        std::printf("%-8s %12.0f linhas/s  %8.1f MB/s saida  (%.3f s, %llu linhas)\n",
+                    name, lines / best, bytes / best / 1e6, best, lines);
+        return lines / best;
+    };
+
+    double before = bench("antes", run_legacy);
+    double after = bench("depois", run_zero_copy);
+    std::printf("ganho    %.2fx\n", after / before);
+    return 0;
+}
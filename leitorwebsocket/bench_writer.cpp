@@ -0,0 +1,206 @@
+// bench_writer.cpp - compara os backends de gravação do coletor (output_file.h)
+// num dia reproduzido: latência de cada flush (p50/p99/p99.9) e CPU por milhão
+// de linhas (getrusage user+sys, inclui as threads io-wq do io_uring).
+//
+// Build: make bench_writer
+//        (ou g++ -std=c++17 -O2 -I../parsers bench_writer.cpp -o bench_writer)
+// Uso:   ./bench_writer /home/grao/dados/cedro_files/20260108_raw_data.txt [--dir /tmp/bench_writer]
+//                       [--iters 3] [--backends ofstream,mmap,uring]
+//
+// O payload de cada linha é remontado como o fluxo do socket, passa pelo
+// LineFramer/append_record como na FeedWriter e é gravado em raw + B/V/T/Z,
+// com flush a cada 10 linhas. Um flush é: append nos 5 arquivos e, no uring,
+// o submit() da janela. Os arquivos ficam em --dir e são apagados a cada rodada.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include "output_file.h"
+#include "record_format.h"
+
+struct Result {
+    std::vector<double> flush_us;
+    double cpu_s = 0;
+    double wall_s = 0;
+    unsigned long long lines = 0;
+};
+
+static double cpu_seconds() {
+    rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static void remove_outputs(const std::string& prefix) {
+    static const char* suffixes[] = {"_raw_data.txt", "_B.txt", "_V.txt", "_T.txt", "_Z.txt"};
+    for (const char* s : suffixes) {
+        std::string p = prefix + s;
+        std::remove(p.c_str());
+        std::remove((p + CMT_SUFFIX).c_str());
+    }
+}
+
+static Result run(WriterBackend backend, const std::string& prefix, const std::vector<std::string>& chunks) {
+    Result res;
+    remove_outputs(prefix);
+
+    std::unique_ptr<UringContext> uring;
+    if (backend == WriterBackend::URING) {
+        uring.reset(new UringContext(256 * 1024));
+        if (!uring->init()) uring.reset();
+    }
+    struct Stream {
+        std::unique_ptr<OutputFile> file;
+        std::string batch;
+    };
+    Stream raw, b, v, t, z;
+    Stream* all[] = {&raw, &b, &v, &t, &z};
+    const char* suffixes[] = {"_raw_data.txt", "_B.txt", "_V.txt", "_T.txt", "_Z.txt"};
+    for (int i = 0; i < 5; i++) {
+        all[i]->file = make_output_file(backend, 64u << 20, uring.get());
+        all[i]->file->open(prefix + suffixes[i]);
+        all[i]->batch.reserve(65536);
+    }
+
+    LineFramer framer;
+    TsPrefixCache ts_cache;
+    std::chrono::steady_clock::time_point last_record_tp;
+    bool has_last_record = false;
+    int count = 0;
+    res.flush_us.reserve(chunks.size() * 4);
+
+    auto flush = [&]() {
+        auto t0 = std::chrono::steady_clock::now();
+        for (Stream* s : all) {
+            if (s->batch.empty()) continue;
+            if (s->file->append(s->batch.data(), s->batch.size())) s->batch.clear();
+        }
+        if (uring) uring->submit();
+        auto t1 = std::chrono::steady_clock::now();
+        res.flush_us.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+        count = 0;
+    };
+
+    const double cpu0 = cpu_seconds();
+    const auto w0 = std::chrono::steady_clock::now();
+    auto last_sync = w0;
+    for (const std::string& chunk : chunks) {
+        const size_t reply_length = chunk.size();
+        framer.feed(chunk.data(), chunk.size(), [&](std::string_view line) {
+            const std::string_view ts = ts_cache.get();
+            auto now_line = std::chrono::steady_clock::now();
+            long long delta_ms = has_last_record ? std::chrono::duration_cast<std::chrono::milliseconds>(now_line - last_record_tp).count() : 0;
+            last_record_tp = now_line;
+            has_last_record = true;
+
+            const size_t rec_start = raw.batch.size();
+            append_record(raw.batch, ts, reply_length, delta_ms, line);
+            Stream* typed = nullptr;
+            switch (record_type(line)) {
+                case 'B': typed = &b; break;
+                case 'V': typed = &v; break;
+                case 'T': typed = &t; break;
+                case 'Z': typed = &z; break;
+            }
+            if (typed) typed->batch.append(raw.batch, rec_start, std::string::npos);
+            res.lines++;
+            if (++count >= 10) flush();
+        });
+        // Mesma cadência de sync da FeedWriter (msync no mmap)
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_sync >= std::chrono::seconds(1)) {
+            for (Stream* s : all) s->file->sync();
+            last_sync = now;
+        }
+    }
+    if (count > 0) flush();
+    for (Stream* s : all) s->file->close();
+    uring.reset();
+    res.wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - w0).count();
+    res.cpu_s = cpu_seconds() - cpu0;
+    return res;
+}
+
+static double pct(std::vector<double>& v, double p) {
+    if (v.empty()) return 0;
+    size_t k = static_cast<size_t>(p * (v.size() - 1));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Uso: " << argv[0] << " <YYYYMMDD_raw_data.txt> [--dir D] [--iters N] [--backends ofstream,mmap,uring]" << std::endl;
+        return 2;
+    }
+    std::string path = argv[1];
+    std::string dir = "/tmp/bench_writer";
+    std::string backends = "ofstream,mmap,uring";
+    int iters = 3;
+    for (int i = 2; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "--dir" && i + 1 < argc) dir = argv[++i];
+        else if (a == "--iters" && i + 1 < argc) iters = std::atoi(argv[++i]);
+        else if (a == "--backends" && i + 1 < argc) backends = argv[++i];
+        else { std::cerr << "Argumento invalido: " << a << std::endl; return 2; }
+    }
+    if (iters < 1) iters = 1;
+    mkdir(dir.c_str(), 0755);
+
+    // Remonta o fluxo do socket a partir do payload gravado (blocos de 4 KB)
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        std::cerr << "Erro: nao foi possivel abrir " << path << std::endl;
+        return 1;
+    }
+    std::string stream;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        size_t p1 = line.find(',');
+        size_t p2 = (p1 == std::string::npos) ? p1 : line.find(',', p1 + 1);
+        size_t p3 = (p2 == std::string::npos) ? p2 : line.find(',', p2 + 1);
+        if (p3 == std::string::npos) continue;
+        stream.append(line, p3 + 1, std::string::npos);
+        stream += "\r\n";
+    }
+    std::vector<std::string> chunks;
+    for (size_t off = 0; off < stream.size(); off += 4096) chunks.emplace_back(stream, off, 4096);
+
+    std::printf("%-9s %10s %10s %10s %12s %10s\n", "backend", "p50 us", "p99 us", "p99.9 us", "CPU s/Mlin", "wall s");
+    size_t pos = 0;
+    while (pos <= backends.size()) {
+        size_t comma = backends.find(',', pos);
+        if (comma == std::string::npos) comma = backends.size();
+        std::string name = backends.substr(pos, comma - pos);
+        pos = comma + 1;
+        if (name.empty()) continue;
+
+        WriterBackend backend;
+        if (name == "ofstream") backend = WriterBackend::OFSTREAM;
+        else if (name == "mmap") backend = WriterBackend::MMAP;
+        else if (name == "uring") backend = WriterBackend::URING;
+        else { std::cerr << "Backend desconhecido: " << name << std::endl; return 2; }
+
+        // Melhor rodada por CPU; percentis da mesma rodada
+        Result best;
+        for (int it = 0; it < iters; it++) {
+            Result r = run(backend, dir + "/" + name, chunks);
+            if (it == 0 || r.cpu_s < best.cpu_s) best = std::move(r);
+        }
+        const double mlines = best.lines / 1e6;
+        std::printf("%-9s %10.1f %10.1f %10.1f %12.3f %10.3f\n", name.c_str(),
+                    pct(best.flush_us, 0.50), pct(best.flush_us, 0.99), pct(best.flush_us, 0.999),
+                    mlines > 0 ? best.cpu_s / mlines : 0.0, best.wall_s);
+        remove_outputs(dir + "/" + name);
+    }
+    return 0;
+}
@@ -0,0 +1,169 @@
+// collector_stats.h - medição do coletor para o leitorwebsocket --stats.
+//
+// Para cada registro, a latência vai do read_some() que trouxe o bloco
+// (RxChunk::mono_ns) até o fim do flush_all() que entregou o lote ao kernel
+// (write/memcpy/submit, conforme o backend). Os valores vão para histogramas
+// log-lineares por tipo (B, V, T, Z, outros), sem alocar por registro.
+// No fim da sessão, report() imprime linhas/s, MB/s, p50/p99/p99.9,
+// CPU (user+sys do processo) e o pico de RSS.
+#ifndef COLLECTOR_STATS_H
+#define COLLECTOR_STATS_H
+
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <vector>
+
+#include <sys/resource.h>
+
+// Histograma log-linear: 32 sub-faixas por potência de 2 (erro < 3,2%)
+class LatencyHistogram {
+public:
+    static const int kSubBits = 5;
+    static const int kSub = 1 << kSubBits;
+    static const int kBuckets = 64 * kSub;
+
+    void add(uint64_t v) {
+        counts_[index(v)]++;
+        total_++;
+        if (v > max_) max_ = v;
+    }
+
+    uint64_t count() const { return total_; }
+    uint64_t max() const { return max_; }
+
+    // Valor (ponto médio da faixa) no percentil p (0..1)
+    uint64_t percentile(double p) const {
+        if (total_ == 0) return 0;
+        uint64_t want = static_cast<uint64_t>(p * static_cast<double>(total_ - 1)) + 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; i++) {
+            seen += counts_[i];
+            if (seen >= want) return midpoint(i) < max_ ? midpoint(i) : max_;
+        }
+        return max_;
+    }
+
+private:
+    static int index(uint64_t v) {
+        if (v < static_cast<uint64_t>(kSub)) return static_cast<int>(v);
+        const int msb = 63 - __builtin_clzll(v);
+        const int shift = msb - kSubBits;
+        return (shift + 1) * kSub + static_cast<int>((v >> shift) & (kSub - 1));
+    }
+
+    static uint64_t midpoint(int i) {
+        if (i < kSub) return static_cast<uint64_t>(i);
+        const int shift = i / kSub - 1;
+        const uint64_t lo = (static_cast<uint64_t>(kSub + i % kSub)) << shift;
+        return lo + ((1ull << shift) >> 1);
+    }
+
+    uint64_t counts_[kBuckets] = {};
+    uint64_t total_ = 0;
+    uint64_t max_ = 0;
+};
+
+class CollectorStats {
+public:
+    enum { B, V, T, Z, OTHER, NTYPES };
+
+    static int type_index(char type) {
+        switch (type) {
+            case 'B': return B;
+            case 'V': return V;
+            case 'T': return T;
+            case 'Z': return Z;
+            default: return OTHER;
+        }
+    }
+
+    CollectorStats() { pending_.reserve(4096); }
+
+    // Bytes lidos do socket
+    void on_read(uint64_t bytes, uint64_t mono_ns) {
+        rx_bytes_ += bytes;
+        if (first_ns_ == 0) first_ns_ = mono_ns;
+    }
+
+    // Registro formatado no lote (ainda não gravado)
+    void on_record(char type, uint64_t read_mono_ns, size_t out_bytes) {
+        const int t = type_index(type);
+        types_[t].lines++;
+        types_[t].bytes += out_bytes;
+        pending_.push_back(Pending{read_mono_ns, t});
+    }
+
+    // Fim de um flush_all: todos os registros pendentes foram entregues
+    void on_flush(uint64_t now_mono_ns) {
+        for (const Pending& p : pending_) {
+            const uint64_t lat = now_mono_ns > p.read_ns ? now_mono_ns - p.read_ns : 0;
+            types_[p.type].latency.add(lat);
+            all_.add(lat);
+        }
+        if (!pending_.empty()) last_ns_ = now_mono_ns;
+        pending_.clear();
+    }
+
+    void report(std::ostream& os) const {
+        const double secs = last_ns_ > first_ns_ ? (last_ns_ - first_ns_) / 1e9 : 0.0;
+        uint64_t lines = 0, bytes = 0;
+        for (const TypeStats& t : types_) {
+            lines += t.lines;
+            bytes += t.bytes;
+        }
+        rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+        const double cpu = ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+
+        char buf[256];
+        std::snprintf(buf, sizeof(buf),
+                      "[stats] janela=%.3fs linhas=%llu (%.0f linhas/s) socket=%.2f MB (%.2f MB/s) saida=%.2f MB (%.2f MB/s)\n",
+                      secs, static_cast<unsigned long long>(lines), secs > 0 ? lines / secs : 0.0,
+                      rx_bytes_ / 1e6, secs > 0 ? rx_bytes_ / 1e6 / secs : 0.0,
+                      bytes / 1e6, secs > 0 ? bytes / 1e6 / secs : 0.0);
+        os << buf;
+        std::snprintf(buf, sizeof(buf), "[stats] cpu=%.3fs (user %.3f sys %.3f) cpu/Mlinhas=%.3fs rss_pico=%ld KB\n",
+                      cpu, ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6, ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6,
+                      lines ? cpu / (lines / 1e6) : 0.0, ru.ru_maxrss);
+        os << buf;
+        std::snprintf(buf, sizeof(buf), "[stats] %-5s %10s %10s %10s %10s %10s %10s\n",
+                      "tipo", "linhas", "MB", "p50 us", "p99 us", "p99.9 us", "max us");
+        os << buf;
+        static const char* names[NTYPES] = {"B", "V", "T", "Z", "outro"};
+        for (int i = 0; i < NTYPES; i++) {
+            if (types_[i].lines == 0) continue;
+            row(os, names[i], types_[i].lines, types_[i].bytes, types_[i].latency);
+        }
+        row(os, "todos", lines, bytes, all_);
+    }
+
+private:
+    struct TypeStats {
+        uint64_t lines = 0;
+        uint64_t bytes = 0;
+        LatencyHistogram latency;
+    };
+
+    struct Pending {
+        uint64_t read_ns;
+        int type;
+    };
+
+    static void row(std::ostream& os, const char* name, uint64_t lines, uint64_t bytes, const LatencyHistogram& h) {
+        char buf[160];
+        std::snprintf(buf, sizeof(buf), "[stats] %-5s %10llu %10.2f %10.1f %10.1f %10.1f %10.1f\n",
+                      name, static_cast<unsigned long long>(lines), bytes / 1e6,
+                      h.percentile(0.50) / 1e3, h.percentile(0.99) / 1e3, h.percentile(0.999) / 1e3, h.max() / 1e3);
+        os << buf;
+    }
+
+    TypeStats types_[NTYPES];
+    LatencyHistogram all_;
+    std::vector<Pending> pending_;
+    uint64_t rx_bytes_ = 0;
+    uint64_t first_ns_ = 0;
+    uint64_t last_ns_ = 0;
+};
+
+#endif
@@ -0,0 +1,177 @@
+// day_archiver.h - leitorwebsocket --archive: comprime os dias fechados em segundo plano.
+//
+// Quando o gravador vira a data, os arquivos do dia que fechou (_raw_data.txt,
+// _B/_V/_T/_Z.txt, _raw.cj) entram na fila de uma thread própria, que grava
+// "<arquivo>.zst" (frames independentes + tabela, parsers/cedro_zst.h) e só
+// então apaga o original e o sidecar .tail do --writer mmap. No começo de cada
+// sessão (connect_and_listen), os dias anteriores que ainda estão em texto
+// também entram na fila: é o caminho normal de um coletor que fica no ar,
+// porque a sessão termina às 19:00 e a seguinte já abre o dia novo.
+//
+// A thread roda com SCHED_IDLE e prioridade de I/O idle: só usa CPU e disco
+// que a coleta não está usando. O destrutor termina a fila antes de sair.
+//
+// Os parsers leem o .zst no lugar do texto sem mudar nada (cz_fopen).
+#ifndef DAY_ARCHIVER_H
+#define DAY_ARCHIVER_H
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "cedro_mmap_tail.h"
+#include "cedro_zst.h"
+
+class DayArchiver {
+public:
+    static const int kDefaultLevel = 9;
+
+    DayArchiver(std::string dir, int level) : dir_(std::move(dir)), level_(level) {
+        thread_ = std::thread([this]() { loop(); });
+    }
+
+    ~DayArchiver() {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            done_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+    // Arquivos de um dia (YYYYMMDD) que fechou
+    void enqueue_day(const std::string& date) {
+        enqueue_if([&](const std::string& d) { return d == date; });
+    }
+
+    // Dias anteriores a today ainda sem comprimir
+    void enqueue_before(const std::string& today) {
+        enqueue_if([&](const std::string& d) { return d < today; });
+    }
+
+    // Comprime path para path.zst e apaga o original; false se falhou
+    // (o original fica). Também usado pelo --compress.
+    static bool compress(const std::string& path, int level) {
+        char side[4096];
+        const bool has_side = cmt_sidecar_path(path.c_str(), side, sizeof(side)) && access(side, F_OK) == 0;
+        if (has_side) {
+            // Gravado pelo --writer mmap sem fechar (coletor caiu): só vale até tail
+            CmtTail t;
+            if (cmt_attach(&t, path.c_str())) {
+                const long long tail = cmt_committed(&t);
+                struct stat st;
+                if (tail >= 0 && stat(path.c_str(), &st) == 0 && st.st_size > tail) {
+                    if (truncate(path.c_str(), static_cast<off_t>(tail)) != 0) {
+                        std::cerr << "[archive] truncate " << path << ": " << std::strerror(errno) << std::endl;
+                    }
+                }
+                cmt_detach(&t);
+            }
+        }
+
+        const auto t0 = std::chrono::steady_clock::now();
+        uint64_t in = 0, out = 0;
+        const std::string dst = path + ".zst";
+        if (cz_compress_file(path.c_str(), dst.c_str(), level, &in, &out) != 0) {
+            std::cerr << "[archive] falha ao comprimir " << path << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        ::unlink(path.c_str());
+        if (has_side) ::unlink(side);
+        const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        char buf[512];
+        std::snprintf(buf, sizeof(buf), "[archive] %s: %.1f MB -> %.1f MB (%.1fx) em %.1fs", dst.c_str(), in / 1e6,
+                      out / 1e6, out ? static_cast<double>(in) / out : 0.0, secs);
+        std::cout << buf << std::endl;
+        return true;
+    }
+
+private:
+    static bool is_day_file(const std::string& name, std::string& date) {
+        static const char* suffix[] = {"_raw_data.txt", "_B.txt", "_V.txt", "_T.txt", "_Z.txt", "_raw.cj"};
+        if (name.size() < 9 || name[8] != '_') return false;
+        for (int i = 0; i < 8; i++) {
+            if (name[i] < '0' || name[i] > '9') return false;
+        }
+        for (const char* s : suffix) {
+            if (name.compare(8, std::string::npos, s) == 0) {
+                date = name.substr(0, 8);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <class Pred>
+    void enqueue_if(Pred want) {
+        DIR* d = opendir(dir_.c_str());
+        if (!d) return;
+        std::vector<std::string> found;
+        while (struct dirent* e = readdir(d)) {
+            std::string date;
+            if (is_day_file(e->d_name, date) && want(date)) found.push_back(dir_ + e->d_name);
+        }
+        closedir(d);
+        std::sort(found.begin(), found.end());
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            for (const std::string& p : found) {
+                if (std::find(queue_.begin(), queue_.end(), p) == queue_.end()) queue_.push_back(p);
+            }
+        }
+        cv_.notify_all();
+    }
+
+    // Só CPU e disco ociosos
+    static void lower_priority() {
+        struct sched_param sp;
+        std::memset(&sp, 0, sizeof(sp));
+        if (sched_setscheduler(0, SCHED_IDLE, &sp) != 0) {
+            std::cerr << "[archive] SCHED_IDLE: " << std::strerror(errno) << std::endl;
+        }
+#ifdef SYS_ioprio_set
+        const int kWhoProcess = 1, kClassIdle = 3, kClassShift = 13;
+        syscall(SYS_ioprio_set, kWhoProcess, static_cast<int>(syscall(SYS_gettid)), kClassIdle << kClassShift);
+#endif
+    }
+
+    void loop() {
+        lower_priority();
+        for (;;) {
+            std::string path;
+            {
+                std::unique_lock<std::mutex> lock(mu_);
+                cv_.wait(lock, [this]() { return done_ || !queue_.empty(); });
+                if (queue_.empty()) return;
+                path = queue_.front();
+                queue_.pop_front();
+            }
+            if (access(path.c_str(), F_OK) == 0) compress(path, level_);
+        }
+    }
+
+    std::string dir_;
+    int level_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<std::string> queue_;
+    bool done_ = false;
+    std::thread thread_;
+};
+
+#endif
@@ -0,0 +1,166 @@
+// feed_arbiter.h - arbitragem linha a linha entre duas conexões redundantes.
+//
+// Com --host2 o coletor mantém duas sessões (pernas A e B) com as mesmas
+// assinaturas. Cada linha recebida passa por on_line(): a primeira cópia a
+// chegar é gravada e a cópia da outra perna é descartada.
+//
+// O casamento é por fluxo (tipo + símbolo, ex. "B:WING26"): dentro de um fluxo
+// as duas pernas entregam as mesmas linhas na mesma ordem. Cada perna guarda
+// uma janela com o hash das linhas que gravou e a outra ainda não entregou.
+// A linha que chega casa com a janela da outra perna (quase sempre a frente da
+// fila): é duplicata, e a diferença de chegada é a vantagem de quem venceu.
+// Linhas repetidas de verdade (mesmo payload duas vezes) casam uma a uma.
+//
+// Perna que reconecta recebe o snapshot do servidor, que a outra já passou.
+// Enquanto o fluxo dela não casar uma linha com a outra perna viva, as linhas
+// sem par são descartadas em vez de gravadas de novo. Se a outra cair antes
+// disso (synced() falso), o coletor trata como lacuna e reconecta essa perna.
+#ifndef FEED_ARBITER_H
+#define FEED_ARBITER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "collector_stats.h"
+
+class FeedArbiter {
+public:
+    enum Verdict { EMIT, DUPLICATE, DROP_SYNC };
+
+    explicit FeedArbiter(size_t window = 4096) : window_(window) {}
+
+    // Linha completa da perna leg (0 = A, 1 = B) recebida em mono_ns
+    Verdict on_line(int leg, std::string_view line, uint64_t mono_ns) {
+        const int other = 1 - leg;
+        up_[leg] = true;
+        Stream& s = stream(line);
+        const uint64_t h = hash(line);
+
+        std::deque<Entry>& theirs = s.pending[other];
+        for (size_t i = 0; i < theirs.size(); i++) {
+            if (theirs[i].hash != h) continue;
+            // As anteriores só a outra perna entregou
+            only_[other] += i;
+            const uint64_t lead = mono_ns > theirs[i].mono_ns ? mono_ns - theirs[i].mono_ns : 0;
+            wins_[other]++;
+            lead_[other].add(lead);
+            theirs.erase(theirs.begin(), theirs.begin() + static_cast<long>(i) + 1);
+            s.synced[leg] = true;
+            return DUPLICATE;
+        }
+
+        if (!s.synced[leg] && s.synced[other] && up_[other]) {
+            dropped_sync_[leg]++;
+            return DROP_SYNC;
+        }
+        s.synced[leg] = true;
+        emitted_[leg]++;
+        // Só espera a cópia se a outra perna está recebendo
+        if (up_[other]) {
+            std::deque<Entry>& mine = s.pending[leg];
+            mine.push_back(Entry{h, mono_ns});
+            if (mine.size() > window_) {
+                mine.pop_front();
+                only_[leg]++;
+            }
+        }
+        return EMIT;
+    }
+
+    // Perna caiu: volta a sincronizar do zero; o que a outra gravou esperando
+    // por ela não vai chegar mais (a reconexão começa do snapshot).
+    void leg_down(int leg) {
+        up_[leg] = false;
+        for (auto& kv : streams_) {
+            kv.second.synced[leg] = false;
+            only_[1 - leg] += kv.second.pending[1 - leg].size();
+            kv.second.pending[1 - leg].clear();
+        }
+    }
+
+    bool up(int leg) const { return up_[leg]; }
+
+    // A perna já casou com a outra em todos os fluxos que a outra entrega?
+    // Se não, ela não pode assumir sozinha sem duplicar ou pular linhas.
+    bool synced(int leg) const {
+        for (const auto& kv : streams_) {
+            if (kv.second.synced[1 - leg] && !kv.second.synced[leg]) return false;
+        }
+        return true;
+    }
+
+    void report(std::ostream& os) const {
+        static const char* names[2] = {"A", "B"};
+        const uint64_t total = wins_[0] + wins_[1];
+        char buf[256];
+        for (int leg = 0; leg < 2; leg++) {
+            const LatencyHistogram& h = lead_[leg];
+            std::snprintf(buf, sizeof(buf),
+                          "[arbitro] perna %s: gravadas=%llu venceu=%llu (%.1f%%) vantagem p50=%.3fms p99=%.3fms max=%.3fms"
+                          " so_ela=%llu descartadas_sync=%llu\n",
+                          names[leg], static_cast<unsigned long long>(emitted_[leg]),
+                          static_cast<unsigned long long>(wins_[leg]), total ? 100.0 * wins_[leg] / total : 0.0,
+                          h.percentile(0.50) / 1e6, h.percentile(0.99) / 1e6, h.max() / 1e6,
+                          static_cast<unsigned long long>(only_[leg]), static_cast<unsigned long long>(dropped_sync_[leg]));
+            os << buf;
+        }
+    }
+
+private:
+    struct Entry {
+        uint64_t hash;
+        uint64_t mono_ns;
+    };
+
+    struct Stream {
+        std::deque<Entry> pending[2];   // gravadas pela perna, esperando a cópia da outra
+        bool synced[2] = {false, false};
+    };
+
+    // Fluxo = prefixo "X:SIMBOLO" do payload
+    Stream& stream(std::string_view line) {
+        size_t n = line.size();
+        if (n > 2 && line[1] == ':') {
+            const void* colon = std::memchr(line.data() + 2, ':', n - 2);
+            if (colon) n = static_cast<size_t>(static_cast<const char*>(colon) - line.data());
+        }
+        if (n > 40) n = 40;
+        const std::string_view key = line.substr(0, n);
+        auto it = streams_.find(key);
+        if (it == streams_.end()) it = streams_.emplace(std::string(key), Stream()).first;
+        return it->second;
+    }
+
+    // Hash de 8 em 8 bytes (multiplica e mistura), bom o bastante para casar cópias
+    static uint64_t hash(std::string_view s) {
+        uint64_t h = 0x9E3779B97F4A7C15ull ^ s.size();
+        size_t i = 0;
+        for (; i + 8 <= s.size(); i += 8) {
+            uint64_t w;
+            std::memcpy(&w, s.data() + i, 8);
+            h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+            h ^= h >> 32;
+        }
+        uint64_t tail = 0;
+        std::memcpy(&tail, s.data() + i, s.size() - i);
+        h = (h ^ tail) * 0xC4CEB9FE1A85EC53ull;
+        return h ^ (h >> 29);
+    }
+
+    size_t window_;
+    std::map<std::string, Stream, std::less<>> streams_;
+    bool up_[2] = {false, false};
+    uint64_t emitted_[2] = {0, 0};
+    uint64_t wins_[2] = {0, 0};
+    uint64_t only_[2] = {0, 0};
+    uint64_t dropped_sync_[2] = {0, 0};
+    LatencyHistogram lead_[2];
+};
+
+#endif
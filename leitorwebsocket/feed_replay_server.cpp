@@ -0,0 +1,442 @@
+// feed_replay_server.cpp - servidor local no lugar do datafeed1.cedrotech.com:81
+//
+// Faz o mesmo login que o leitorwebsocket espera ("Username:", "Password:",
+// "You are connected"), aceita as assinaturas BQT/GQT/SQT/SAB e reproduz os
+// payloads B:/V:/T:/Z: de um _raw_data.txt (ou de um arquivo por tipo, mesmo
+// formato "ts,reply_length,delta_ms,payload") como "payload\r\n".
+//
+// Build: make feed_replay_server
+//        (ou g++ -std=c++17 -O2 feed_replay_server.cpp -o feed_replay_server -lboost_system -lpthread)
+// Uso:   ./feed_replay_server /home/grao/dados/cedro_files/20260108_raw_data.txt [opções]
+//        e no coletor: ./leitorwebsocket --host 127.0.0.1 --port 8181
+//
+// Opções:
+//   --bind ADDR            endereço de escuta (127.0.0.1)
+//   --port N               porta (8181)
+//   --speed original|max|N tempo original, o mais rápido possível, ou N vezes mais rápido (max)
+//   --match exact|root|all assinatura casa pelo símbolo exato, pela raiz (WIN, WDO, DI1...)
+//                          ou qualquer símbolo; o padrão é root, para reproduzir um dia
+//                          antigo com o contrato que o coletor calcula hoje
+//   --burst-every S        a cada S segundos manda as próximas --burst-lines linhas de uma vez
+//   --burst-lines N        tamanho da rajada (5000)
+//   --disconnect-every S   derruba a conexão depois de S segundos de replay
+//   --disconnect-lines N   derruba a conexão a cada N linhas enviadas
+//   --freeze-lines N       depois de N linhas a conexão fica calada e aberta até o
+//                          cliente desistir (testa a detecção de feed travado)
+//   --loop                 volta ao início do arquivo no fim
+//   --from HH:MM:SS        só linhas a partir desse horário (prefixo ts do arquivo)
+//   --to HH:MM:SS          só linhas antes desse horário (ex. --from 09:00:00 --to 09:05:00
+//                          para a abertura)
+//   --clients N            atende N conexões ao mesmo tempo (leitorwebsocket --sessions N)
+//
+// Uma conexão por vez. Depois de uma queda (--disconnect-*, --freeze-*), o próximo cliente
+// continua da linha seguinte; no fim do arquivo (sem --loop) o servidor fecha
+// a conexão e sai. Com --clients N, cada conexão tem a sua thread e a posição
+// no arquivo é por conjunto de assinaturas: a sessão que reconecta continua de
+// onde ela parou, e o servidor sai quando N conexões chegaram ao fim. Assinatura → tipo: BQT → B:, GQT → V:, SQT → T:, SAB → Z:.
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using boost::asio::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+#if BOOST_VERSION >= 106600
+using io_context_type = boost::asio::io_context;
+static boost::asio::ip::address parse_address(const std::string& s) { return boost::asio::ip::make_address(s); }
+#else
+using io_context_type = boost::asio::io_service;
+static boost::asio::ip::address parse_address(const std::string& s) { return boost::asio::ip::address::from_string(s); }
+#endif
+
+enum class MatchMode { EXACT, ROOT, ALL };
+
+struct ServerOptions {
+    std::string bind = "127.0.0.1";
+    unsigned short port = 8181;
+    double speed = 0;            // 0 = o mais rápido possível
+    MatchMode match = MatchMode::ROOT;
+    double burst_every = 0;
+    size_t burst_lines = 5000;
+    double disconnect_every = 0;
+    unsigned long long disconnect_lines = 0;
+    unsigned long long freeze_lines = 0;
+    bool loop = false;
+    int from_sec = -1;           // janela do dia em segundos desde a meia-noite
+    int to_sec = -1;
+    int clients = 1;
+};
+
+// Linha do arquivo já no formato do fio
+struct ReplayLine {
+    std::string wire;            // "payload\r\n"
+    long long at_ms;             // instante no dia original (ms, relativo à primeira linha)
+    char type;                   // 'B', 'V', 'T', 'Z'
+    std::string symbol;
+};
+
+static int parse_hms(const char* s) {
+    int h = 0, m = 0, sec = 0;
+    if (std::sscanf(s, "%d:%d:%d", &h, &m, &sec) < 2) return -1;
+    return h * 3600 + m * 60 + sec;
+}
+
+static bool load_day(const std::string& path, const ServerOptions& opt, std::vector<ReplayLine>& out) {
+    std::ifstream in(path);
+    if (!in.is_open()) return false;
+    std::string line;
+    long long clock_ms = 0;
+    long long first_sec = -1;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        size_t p1 = line.find(',');
+        size_t p2 = (p1 == std::string::npos) ? p1 : line.find(',', p1 + 1);
+        size_t p3 = (p2 == std::string::npos) ? p2 : line.find(',', p2 + 1);
+        if (p3 == std::string::npos || line.size() < p3 + 3 || line[p3 + 2] != ':') continue;
+
+        // Tempo: soma dos delta_ms, sem ficar atrás do segundo do prefixo
+        // (nos arquivos por tipo o delta é em relação à linha anterior do raw)
+        long long sec = -1;
+        if (p1 >= 15) {
+            int hh = std::atoi(line.substr(9, 2).c_str());
+            int mm = std::atoi(line.substr(11, 2).c_str());
+            int ss = std::atoi(line.substr(13, 2).c_str());
+            sec = hh * 3600 + mm * 60 + ss;
+        }
+        if (first_sec < 0 && sec >= 0) first_sec = sec;
+        clock_ms += std::max(0LL, std::atoll(line.c_str() + p2 + 1));
+        if (sec >= 0) clock_ms = std::max(clock_ms, (sec - first_sec) * 1000);
+        if (sec >= 0 && opt.from_sec >= 0 && sec < opt.from_sec) continue;
+        if (sec >= 0 && opt.to_sec >= 0 && sec >= opt.to_sec) break;
+
+        ReplayLine r;
+        r.type = line[p3 + 1];
+        r.at_ms = clock_ms;
+        size_t sym_end = line.find(':', p3 + 3);
+        r.symbol = line.substr(p3 + 3, sym_end == std::string::npos ? std::string::npos : sym_end - p3 - 3);
+        r.wire.assign(line, p3 + 1, std::string::npos);
+        r.wire += "\r\n";
+        out.push_back(std::move(r));
+    }
+    return true;
+}
+
+// Assinaturas do cliente: tipo + símbolo
+class Subscriptions {
+public:
+    explicit Subscriptions(MatchMode mode) : mode_(mode) {}
+
+    // "BQT WINZ26 ", "GQT WDOX26 S" ...
+    void command(const std::string& cmd) {
+        std::string verb, sym;
+        size_t a = cmd.find_first_not_of(" \t");
+        if (a == std::string::npos) return;
+        size_t b = cmd.find_first_of(" \t", a);
+        verb = cmd.substr(a, b == std::string::npos ? std::string::npos : b - a);
+        if (b != std::string::npos) {
+            size_t c = cmd.find_first_not_of(" \t", b);
+            size_t d = (c == std::string::npos) ? c : cmd.find_first_of(" \t", c);
+            if (c != std::string::npos) sym = cmd.substr(c, d == std::string::npos ? std::string::npos : d - c);
+        }
+        char type = 0;
+        if (verb == "BQT") type = 'B';
+        else if (verb == "GQT") type = 'V';
+        else if (verb == "SQT") type = 'T';
+        else if (verb == "SAB") type = 'Z';
+        if (!type || sym.empty()) return;
+        subs_.insert(std::string(1, type) + sym);
+        subs_.insert(std::string(1, type) + "#" + root(sym));
+        types_.insert(type);
+        std::cout << "[replay] assinatura " << verb << " " << sym << std::endl;
+    }
+
+    bool wants(const ReplayLine& l) const {
+        if (mode_ == MatchMode::ALL) return types_.count(l.type) > 0;
+        std::string key(1, l.type);
+        if (subs_.count(key + l.symbol)) return true;
+        return mode_ == MatchMode::ROOT && subs_.count(key + "#" + root(l.symbol));
+    }
+
+    bool empty() const { return subs_.empty(); }
+
+    // Identifica a sessão do coletor entre reconexões
+    std::string key() const {
+        std::string k;
+        for (const std::string& s : subs_) k += s + " ";
+        return k;
+    }
+
+private:
+    static std::string root(const std::string& sym) { return sym.substr(0, 3); }
+
+    MatchMode mode_;
+    std::set<std::string> subs_;
+    std::set<char> types_;
+};
+
+// Lê o que o cliente mandou sem bloquear e processa as linhas completas
+static void poll_commands(tcp::socket& socket, std::string& pending, Subscriptions& subs) {
+    boost::system::error_code ec;
+    size_t avail = socket.available(ec);
+    if (ec || avail == 0) return;
+    std::vector<char> buf(avail);
+    size_t n = socket.read_some(boost::asio::buffer(buf), ec);
+    if (ec) return;
+    pending.append(buf.data(), n);
+    size_t nl;
+    while ((nl = pending.find('\n')) != std::string::npos) {
+        std::string cmd = pending.substr(0, nl);
+        if (!cmd.empty() && cmd.back() == '\r') cmd.pop_back();
+        subs.command(cmd);
+        pending.erase(0, nl + 1);
+    }
+}
+
+static void read_line(tcp::socket& socket, boost::asio::streambuf& buf) {
+    size_t n = boost::asio::read_until(socket, buf, "\n");
+    buf.consume(n);
+}
+
+// Posição no arquivo de cada cliente (uma só sem --clients)
+class ReplayPositions {
+public:
+    explicit ReplayPositions(bool per_client) : per_client_(per_client) {}
+
+    size_t& at(const Subscriptions& subs) {
+        std::lock_guard<std::mutex> lock(mu_);
+        return pos_[per_client_ ? subs.key() : std::string()];
+    }
+
+private:
+    bool per_client_;
+    std::mutex mu_;
+    std::map<std::string, size_t> pos_;   // referências estáveis no std::map
+};
+
+// Atende um cliente a partir da posição dele. Retorna false quando o arquivo acabou.
+static bool serve(tcp::socket& socket, const std::vector<ReplayLine>& day, ReplayPositions& positions, const ServerOptions& opt) {
+    boost::asio::streambuf in;
+    // O coletor abre com "\r\n" antes do prompt
+    read_line(socket, in);
+    boost::asio::write(socket, boost::asio::buffer(std::string("Username:")));
+    read_line(socket, in);
+    boost::asio::write(socket, boost::asio::buffer(std::string("Password:")));
+    read_line(socket, in);
+    boost::asio::write(socket, boost::asio::buffer(std::string("You are connected\r\n")));
+
+    Subscriptions subs(opt.match);
+    std::string pending(static_cast<const char*>(in.data().data()), in.size());
+    in.consume(in.size());
+    // Espera o lote de assinaturas (até 300 ms de silêncio depois da primeira)
+    auto quiet_since = Clock::now();
+    const auto deadline = quiet_since + std::chrono::seconds(5);
+    while (Clock::now() < deadline) {
+        const bool had = subs.empty();
+        size_t before = pending.size();
+        poll_commands(socket, pending, subs);
+        if (pending.size() != before || had != subs.empty()) quiet_since = Clock::now();
+        if (!subs.empty() && Clock::now() - quiet_since > std::chrono::milliseconds(300)) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    size_t& pos = positions.at(subs);
+    const auto t0 = Clock::now();
+    const long long base_ms = pos < day.size() ? day[pos].at_ms : 0;
+    auto next_burst = t0 + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.burst_every));
+    size_t burst_left = 0;
+    unsigned long long sent_lines = 0, sent_bytes = 0, conn_lines = 0;
+    std::string out;
+    out.reserve(1 << 16);
+
+    auto flush = [&]() {
+        if (out.empty()) return;
+        boost::asio::write(socket, boost::asio::buffer(out));
+        sent_bytes += out.size();
+        out.clear();
+    };
+    auto report = [&](const char* why) {
+        double s = std::chrono::duration<double>(Clock::now() - t0).count();
+        std::cout << "[replay] " << why << ": linhas=" << sent_lines << " bytes=" << sent_bytes
+                  << " tempo=" << s << "s linhas/s=" << (s > 0 ? sent_lines / s : 0)
+                  << " posição=" << pos << "/" << day.size() << std::endl;
+    };
+
+    for (;;) {
+        if (pos >= day.size()) {
+            if (!opt.loop) {
+                flush();
+                report("fim do arquivo");
+                return false;
+            }
+            pos = 0;
+        }
+        poll_commands(socket, pending, subs);
+
+        const auto now = Clock::now();
+        if (opt.disconnect_every > 0 && now - t0 >= std::chrono::duration<double>(opt.disconnect_every)) {
+            flush();
+            report("queda simulada (tempo)");
+            return true;
+        }
+        if (opt.burst_every > 0 && now >= next_burst) {
+            burst_left = opt.burst_lines;
+            next_burst = now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.burst_every));
+        }
+
+        // Linha ainda não venceu: manda o que juntou e dorme até ela
+        const ReplayLine& l = day[pos];
+        if (opt.speed > 0 && burst_left == 0) {
+            auto due = t0 + std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double, std::milli>((l.at_ms - base_ms) / opt.speed));
+            if (due > now) {
+                flush();
+                auto wake = std::min(due, now + std::chrono::milliseconds(50));
+                if (opt.burst_every > 0) wake = std::min(wake, next_burst);
+                std::this_thread::sleep_until(wake);
+                continue;
+            }
+        }
+
+        pos++;
+        if (burst_left > 0) burst_left--;
+        if (!subs.wants(l)) continue;
+        out += l.wire;
+        sent_lines++;
+        conn_lines++;
+        if (out.size() >= (1 << 16)) flush();
+        if (opt.disconnect_lines > 0 && conn_lines >= opt.disconnect_lines) {
+            flush();
+            report("queda simulada (linhas)");
+            return true;
+        }
+        if (opt.freeze_lines > 0 && conn_lines >= opt.freeze_lines) {
+            flush();
+            report("feed congelado");
+            // Não manda mais nada; só espera o cliente fechar
+            char sink[4096];
+            boost::system::error_code ec;
+            while (!ec) socket.read_some(boost::asio::buffer(sink), ec);
+            report("cliente fechou o feed congelado");
+            return true;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Uso: " << argv[0] << " <YYYYMMDD_raw_data.txt|_X.txt> [--bind ADDR] [--port N]"
+                  << " [--speed original|max|N] [--match exact|root|all] [--burst-every S] [--burst-lines N]"
+                  << " [--disconnect-every S] [--disconnect-lines N] [--freeze-lines N] [--loop] [--from HH:MM:SS] [--to HH:MM:SS]"
+                  << " [--clients N]" << std::endl;
+        return 2;
+    }
+    std::string path = argv[1];
+    ServerOptions opt;
+    for (int i = 2; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "--bind" && i + 1 < argc) opt.bind = argv[++i];
+        else if (a == "--port" && i + 1 < argc) opt.port = static_cast<unsigned short>(std::atoi(argv[++i]));
+        else if (a == "--speed" && i + 1 < argc) {
+            std::string s = argv[++i];
+            if (s == "original") opt.speed = 1;
+            else if (s == "max") opt.speed = 0;
+            else opt.speed = std::atof(s.c_str());
+        }
+        else if (a == "--match" && i + 1 < argc) {
+            std::string m = argv[++i];
+            if (m == "exact") opt.match = MatchMode::EXACT;
+            else if (m == "root") opt.match = MatchMode::ROOT;
+            else if (m == "all") opt.match = MatchMode::ALL;
+            else { std::cerr << "--match deve ser exact, root ou all" << std::endl; return 2; }
+        }
+        else if (a == "--burst-every" && i + 1 < argc) opt.burst_every = std::atof(argv[++i]);
+        else if (a == "--burst-lines" && i + 1 < argc) opt.burst_lines = std::strtoul(argv[++i], nullptr, 10);
+        else if (a == "--disconnect-every" && i + 1 < argc) opt.disconnect_every = std::atof(argv[++i]);
+        else if (a == "--disconnect-lines" && i + 1 < argc) opt.disconnect_lines = std::strtoull(argv[++i], nullptr, 10);
+        else if (a == "--freeze-lines" && i + 1 < argc) opt.freeze_lines = std::strtoull(argv[++i], nullptr, 10);
+        else if (a == "--loop") opt.loop = true;
+        else if (a == "--from" && i + 1 < argc) opt.from_sec = parse_hms(argv[++i]);
+        else if (a == "--to" && i + 1 < argc) opt.to_sec = parse_hms(argv[++i]);
+        else if (a == "--clients" && i + 1 < argc) opt.clients = std::max(1, std::atoi(argv[++i]));
+        else { std::cerr << "Argumento invalido: " << a << std::endl; return 2; }
+    }
+
+    std::vector<ReplayLine> day;
+    if (!load_day(path, opt, day)) {
+        std::cerr << "Erro: nao foi possivel abrir " << path << std::endl;
+        return 1;
+    }
+    std::cout << "[replay] " << day.size() << " linhas de " << path << " ("
+              << (day.empty() ? 0 : (day.back().at_ms - day.front().at_ms) / 1000) << " s no original)" << std::endl;
+
+    try {
+        io_context_type io_context;
+        tcp::acceptor acceptor(io_context);
+        tcp::endpoint ep(parse_address(opt.bind), opt.port);
+        acceptor.open(ep.protocol());
+        acceptor.set_option(tcp::acceptor::reuse_address(true));
+        acceptor.bind(ep);
+        acceptor.listen();
+        std::cout << "[replay] escutando em " << opt.bind << ":" << opt.port << std::endl;
+
+        ReplayPositions positions(opt.clients > 1);
+        auto attend = [&](tcp::socket& socket) {
+            socket.set_option(tcp::no_delay(true));
+            std::cout << "[replay] cliente " << socket.remote_endpoint() << std::endl;
+            bool more = true;
+            try {
+                more = serve(socket, day, positions, opt);
+            } catch (const std::exception& e) {
+                std::cerr << "[replay] cliente caiu: " << e.what() << std::endl;
+            }
+            boost::system::error_code ec;
+            socket.shutdown(tcp::socket::shutdown_both, ec);
+            socket.close(ec);
+            return more;
+        };
+
+        if (opt.clients == 1) {
+            for (;;) {
+                tcp::socket socket(io_context);
+                acceptor.accept(socket);
+                if (!attend(socket)) break;
+            }
+        } else {
+            // accept sem bloquear para sair quando todos terminarem
+            std::atomic<int> finished{0};
+            std::vector<std::thread> threads;
+            acceptor.non_blocking(true);
+            while (finished.load() < opt.clients) {
+                auto socket = std::make_shared<tcp::socket>(io_context);
+                boost::system::error_code ec;
+                acceptor.accept(*socket, ec);
+                if (ec == boost::asio::error::would_block || ec == boost::asio::error::try_again) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                    continue;
+                }
+                if (ec) throw boost::system::system_error(ec);
+                socket->non_blocking(false);
+                threads.emplace_back([&, socket]() {
+                    if (!attend(*socket)) finished++;
+                });
+            }
+            for (std::thread& t : threads) t.join();
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[replay] erro: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,141 @@
+// feed_watchdog.h - detecção de feed parado e espera entre reconexões do coletor.
+//
+// StallWatchdog: a thread gravadora registra a chegada de cada mensagem por
+// símbolo e mantém uma média móvel do intervalo entre mensagens. Um símbolo
+// com ritmo já conhecido que fica calado bem além do seu intervalo típico (e
+// de um piso fixo) é um travamento do feed, mesmo com o socket aberto e outros
+// símbolos chegando. O silêncio total do socket é visto pela thread leitora,
+// e só conta depois que o watchdog aprendeu o ritmo de algum símbolo da
+// conexão (armed): sessão de símbolos parados não é feed travado.
+//
+// ReconnectBackoff: espera exponencial com jitter, começando em dezenas de ms,
+// para reconectar rápido numa queda isolada sem martelar o servidor em loop.
+#ifndef FEED_WATCHDOG_H
+#define FEED_WATCHDOG_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string_view>
+
+class StallWatchdog {
+public:
+    // Uma sessão do --universe pode ter centenas de símbolos: busca por hash
+    static const int kMaxSymbols = 1024;
+    static const int kTableSize = 2 * kMaxSymbols;
+
+    // floor_ns: silêncio mínimo para acusar travamento; factor: múltiplo do
+    // intervalo médio do símbolo; min_msgs: mensagens até o ritmo valer.
+    StallWatchdog(uint64_t floor_ns, double factor, uint32_t min_msgs = 100)
+        : floor_ns_(floor_ns), factor_(factor), min_msgs_(min_msgs) {}
+
+    void on_message(std::string_view symbol, uint64_t mono_ns) {
+        Sym* s = find(symbol);
+        if (!s) return;
+        if (s->count > 0 && mono_ns > s->last_ns) {
+            // Intervalos acima do piso (pausas longas) não entram na média
+            uint64_t gap = mono_ns - s->last_ns;
+            if (gap > floor_ns_) gap = floor_ns_;
+            s->ewma_ns = s->count == 1 ? static_cast<double>(gap) : s->ewma_ns + (static_cast<double>(gap) - s->ewma_ns) / 64.0;
+        }
+        if (mono_ns > s->last_ns) s->last_ns = mono_ns;
+        s->count++;
+    }
+
+    // Símbolo travado em now_ns? Preenche reason ("WINZ26 calado 5.2s, intervalo médio 40ms")
+    bool stalled(uint64_t now_ns, char* reason, size_t reason_sz) const {
+        for (int i = 0; i < n_; i++) {
+            const Sym& s = syms_[i];
+            if (s.count < min_msgs_ || now_ns <= s.last_ns) continue;
+            const uint64_t silent = now_ns - s.last_ns;
+            double limit = s.ewma_ns * factor_;
+            if (limit < static_cast<double>(floor_ns_)) limit = static_cast<double>(floor_ns_);
+            if (static_cast<double>(silent) > limit) {
+                std::snprintf(reason, reason_sz, "%s calado %.1fs, intervalo medio %.0fms",
+                              s.name, silent / 1e9, s.ewma_ns / 1e6);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Algum símbolo já tem ritmo conhecido (min_msgs mensagens)?
+    bool armed() const {
+        for (int i = 0; i < n_; i++) {
+            if (syms_[i].count >= min_msgs_) return true;
+        }
+        return false;
+    }
+
+    // Nova conexão: o ritmo volta a ser aprendido do zero
+    void reset() {
+        n_ = 0;
+        std::memset(table_, 0, sizeof(table_));
+    }
+
+private:
+    struct Sym {
+        char name[32];
+        uint8_t len;
+        uint64_t last_ns;
+        double ewma_ns;
+        uint32_t count;
+    };
+
+    // Tabela aberta com sondagem linear; table_[h] = índice em syms_ + 1 (0 = livre)
+    Sym* find(std::string_view symbol) {
+        if (symbol.empty() || symbol.size() >= sizeof(Sym::name)) return nullptr;
+        uint32_t h = 2166136261u;
+        for (char c : symbol) h = (h ^ static_cast<uint8_t>(c)) * 16777619u;
+        for (uint32_t i = h % kTableSize;; i = (i + 1) % kTableSize) {
+            const int slot = table_[i];
+            if (slot == 0) {
+                if (n_ >= kMaxSymbols) return nullptr;
+                table_[i] = static_cast<uint16_t>(n_ + 1);
+                Sym& s = syms_[n_++];
+                std::memcpy(s.name, symbol.data(), symbol.size());
+                s.name[symbol.size()] = '\0';
+                s.len = static_cast<uint8_t>(symbol.size());
+                s.last_ns = 0;
+                s.ewma_ns = 0;
+                s.count = 0;
+                return &s;
+            }
+            Sym& s = syms_[slot - 1];
+            if (s.len == symbol.size() && std::memcmp(s.name, symbol.data(), symbol.size()) == 0) return &s;
+        }
+    }
+
+    uint64_t floor_ns_;
+    double factor_;
+    uint32_t min_msgs_;
+    Sym syms_[kMaxSymbols];
+    uint16_t table_[kTableSize] = {};
+    int n_ = 0;
+};
+
+class ReconnectBackoff {
+public:
+    ReconnectBackoff(unsigned base_ms, unsigned max_ms)
+        : base_ms_(base_ms ? base_ms : 1), max_ms_(max_ms < base_ms ? base_ms : max_ms),
+          cur_ms_(base_ms_), rng_(std::random_device{}()) {}
+
+    // Próxima espera: sorteada em [cur/2, cur], e cur dobra até max
+    unsigned next_ms() {
+        std::uniform_int_distribution<unsigned> dist(cur_ms_ / 2, cur_ms_);
+        const unsigned d = dist(rng_);
+        cur_ms_ = cur_ms_ >= max_ms_ / 2 ? max_ms_ : cur_ms_ * 2;
+        return d;
+    }
+
+    void reset() { cur_ms_ = base_ms_; }
+
+private:
+    unsigned base_ms_;
+    unsigned max_ms_;
+    unsigned cur_ms_;
+    std::mt19937 rng_;
+};
+
+#endif
@@ -1,5 +1,5 @@
-// Para GCC < 8 (ex: 7.5): g++ -std=c++17 leitorwebsocket.cpp -lboost_system -lpthread -lstdc++fs
-// Para GCC >= 8: g++ -std=c++17 leitorwebsocket.cpp -lboost_system -lpthread
+// Para GCC < 8 (ex: 7.5): g++ -std=c++17 leitorwebsocket.cpp -I../parsers -lboost_system -lpthread -lzstd -lstdc++fs
+// Para GCC >= 8: g++ -std=c++17 leitorwebsocket.cpp -I../parsers -lboost_system -lpthread -lzstd
 #include <iostream>
 #include <boost/asio.hpp>
 #include <fstream>
@@ -16,6 +16,24 @@
 #include <iomanip>
 #include <map>
 #include <memory>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "cedro_gap.h"
+#include "cedro_index.h"
+#include "cedro_journal.h"
+#include "cedro_shm.h"
+#include "collector_stats.h"
+#include "day_archiver.h"
+#include "feed_arbiter.h"
+#include "feed_watchdog.h"
+#include "output_file.h"
+#include "raw_rebuild.h"
+#include "record_format.h"
+#include "spsc_ring.h"
+#include "symbol_universe.h"
 
 //#using boost::asio::ip::tcp;
 #if defined(__GNUC__) && (__GNUC__ < 8) && !defined(_WIN32)
@@ -50,8 +68,45 @@ void gmtime_r(const time_t *timep, struct tm *result) {
 #define _strdup strdup
 #endif
 
+// Opções de linha de comando do coletor
+struct CollectorOptions {
+    bool journal = false;   // grava também {data}_raw.cj (journal binário, ver cedro_journal.h)
+    WriterBackend writer = WriterBackend::OFSTREAM;
+    size_t prealloc_mb = 64; // --writer mmap: pré-alocação inicial de cada arquivo (dobra ao encher)
+    int msync_ms = 1000;     // --writer mmap: cadência do msync(MS_ASYNC)
+    std::string host = "datafeed1.cedrotech.com"; // --host/--port: ex. feed_replay_server local
+    std::string port = "81";
+    bool stats = false;        // mede vazão/latência por tipo e imprime no fim da sessão (collector_stats.h)
+    bool once = false;         // uma sessão só: sai quando a conexão fecha (benchmarks)
+    bool ignore_hours = false; // não para fora do horário de pregão
+    std::string out_dir;       // diretório de saída no lugar do padrão
+    bool kernel_ts = false;    // carimba cada bloco com a chegada no kernel (SO_TIMESTAMPNS + recvmsg)
+    int stall_ms = 10000;      // feed parado: socket ou símbolo calado além disso reconecta (0 = desliga)
+    int stall_from_sec = 9 * 3600;              // --stall-hours: a checagem só vale no pregão (UTC-3)
+    int stall_to_sec = 18 * 3600 + 20 * 60;
+    unsigned backoff_min_ms = 20;   // espera antes da 1a reconexão (dobra com jitter a cada falha)
+    unsigned backoff_max_ms = 5000;
+    std::string host2;         // --host2: segunda sessão redundante (perna B), arbitrada linha a linha
+    std::string port2;         // padrão: a mesma porta da perna A
+    std::string user2, pass2;  // login da perna B (padrão: o mesmo da A)
+    std::string shm;           // --shm: publica os registros no anel em memória compartilhada (cedro_shm.h)
+    unsigned raw_threads = 0;  // --raw --threads: threads da regeração (0 = uma por núcleo)
+    std::string universe;      // --universe: arquivo de assinaturas (symbol_universe.h); vazio = padrão
+    int sessions = 1;          // --sessions N: divide o universo em N conexões, cada uma com sua thread
+    std::vector<int> cpus;     // --cpus 2,3,4: núcleos das threads leitoras, na ordem das conexões
+    bool archive = false;      // --archive: comprime os dias fechados em segundo plano (day_archiver.h)
+    int zst_level = DayArchiver::kDefaultLevel;   // --zst-level: nível do zstd do --archive/--compress
+    bool index = true;         // "<arquivo>.idx" por minuto e símbolo ao lado de raw e B/V/T/Z (cedro_index.h)
+};
+
+static CollectorOptions g_opts;
+static std::unique_ptr<DayArchiver> g_archiver;   // só com --archive
+
 // Configurable output directory
 std::string get_output_dir() {
+    if (!g_opts.out_dir.empty()) {
+        return g_opts.out_dir.back() == '/' ? g_opts.out_dir : g_opts.out_dir + "/";
+    }
 #ifdef _WIN32
     return "c:/cedrob3/dados/cedro_files/";
 #else
@@ -61,6 +116,13 @@ std::string get_output_dir() {
 
 char current_time_str[20] = {0};
 
+// Relógio em ns (CLOCK_REALTIME ou CLOCK_MONOTONIC)
+static uint64_t clock_ns(clockid_t clk) {
+    struct timespec ts;
+    clock_gettime(clk, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
 std::string get_current_date() {
     std::time_t t = std::time(nullptr);
     
@@ -98,6 +160,7 @@ int get_local_seconds_of_day() {
 }
 
 bool is_time_to_stop() {
+    if (g_opts.ignore_hours) return false;
     auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
     
     // Ajustar para horário brasileiro (UTC-3)
@@ -110,6 +173,15 @@ bool is_time_to_stop() {
     return (local_tm.tm_hour >= 19 or local_tm.tm_hour < 9);
 }
 
+// Checagem de feed parado ligada agora? Fora do pregão (depois do fechamento,
+// até a parada das 19:00) o silêncio é normal; com --ignore-hours vale sempre.
+bool stall_hours() {
+    if (g_opts.stall_ms <= 0) return false;
+    if (g_opts.ignore_hours) return true;
+    const int s = get_local_seconds_of_day();
+    return s >= g_opts.stall_from_sec && s < g_opts.stall_to_sec;
+}
+
 void log_response(const std::string& response, const std::string& symbol) {
     std::string date = get_current_date();
     std::string type = (response.rfind("V:", 0) == 0) ? "quote" : "booking";
@@ -288,55 +360,717 @@ std::string get_wdo_contract() {
 
 
 using boost::asio::ip::tcp;
-void connect_and_listen() {
-    std::string date = get_current_date();
-    std::string raw_filename = get_output_dir() + date + "_raw_data.txt";
-    fs::create_directories(get_output_dir());
-    std::ofstream raw_file(raw_filename, std::ios::app);
-    // Arquivos separados por tipo de registro (B, V, T)
-    std::string b_filename = get_output_dir() + date + "_B.txt";
-    std::string v_filename = get_output_dir() + date + "_V.txt";
-    std::string t_filename = get_output_dir() + date + "_T.txt";
-    std::string z_filename = get_output_dir() + date + "_Z.txt";
-    std::ofstream b_file;
-    std::ofstream v_file;
-    std::ofstream t_file;
-    std::ofstream z_file;
-
-    if (!raw_file.is_open()) {
-        std::error_code ec;
-        fs::create_directories(get_output_dir(), ec);
-        raw_file.open(raw_filename, std::ios::app);
-        if (!raw_file.is_open()) {
-            std::cerr << "Erro crítico: arquivo raw não pôde ser aberto: " << raw_filename << std::endl;
+
+// Tamanho de cada bloco lido do socket (mesmo limite do read_some original)
+#define RX_CHUNK_BYTES 65536
+// Slots na fila leitor -> gravador; páginas só são tocadas quando usadas
+#define RX_RING_SLOTS 1024
+// Intervalo entre relatórios de ocupação da fila
+#define RING_REPORT_SEC 60
+
+// Bloco de bytes recebido do socket, passado da thread leitora para a gravadora
+struct RxChunk {
+    enum Kind : uint8_t { DATA = 0, RESET, STOP };
+    Kind kind = DATA;
+    size_t len = 0;
+    uint64_t realtime_ns = 0;   // instante em que o read_some retornou
+    uint64_t mono_ns = 0;
+    bool kernel_ts = false;     // --kernel-ts: os dois acima são a chegada no kernel
+    uint8_t leg = 0;            // perna que recebeu (preenchido pelo gravador)
+    char data[RX_CHUNK_BYTES];
+};
+
+typedef SpscRing<RxChunk> RxRing;
+
+// Espera um slot livre; se a gravação atrasar, o leitor para de drenar o
+// socket e a contrapressão fica no buffer do kernel.
+static RxChunk* acquire_chunk(RxRing& ring, unsigned long long& full_waits) {
+    RxChunk* slot = ring.try_acquire();
+    if (slot) return slot;
+    full_waits++;
+    while (!(slot = ring.try_acquire())) {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    return slot;
+}
+
+// RESET leva o motivo da queda em data (vai para o marcador GAP_START)
+static void push_control(RxRing& ring, RxChunk::Kind kind, unsigned long long& full_waits,
+                         const std::string& reason = std::string()) {
+    RxChunk* slot = acquire_chunk(ring, full_waits);
+    slot->kind = kind;
+    slot->len = std::min(reason.size(), static_cast<size_t>(256));
+    std::memcpy(slot->data, reason.data(), slot->len);
+    slot->realtime_ns = clock_ns(CLOCK_REALTIME);
+    slot->mono_ns = clock_ns(CLOCK_MONOTONIC);
+    slot->kernel_ts = false;
+    ring.publish();
+}
+
+// Arquivo de saída com o lote pendente
+struct OutStream {
+    std::string filename;
+    std::unique_ptr<OutputFile> file;
+    std::string batch;
+    uint64_t offset = 0;      // tamanho do arquivo com o lote (offset da próxima linha)
+    CiWriter idx{};           // só raw e B/V/T/Z; path vazio = sem índice
+
+    explicit OutStream(UringContext* uring = nullptr)
+        : file(make_output_file(g_opts.writer, g_opts.prealloc_mb << 20, uring)) {}
+};
+
+// --writer uring: anel do gravador (nullptr nos outros backends ou se o
+// kernel não aceitar; nesse caso os arquivos caem para ofstream)
+static std::unique_ptr<UringContext> make_uring_context() {
+    if (g_opts.writer != WriterBackend::URING) return nullptr;
+    std::unique_ptr<UringContext> ctx(new UringContext(256 * 1024));
+    if (!ctx->init()) {
+        std::cerr << "io_uring indisponível; gravando com ofstream" << std::endl;
+        return nullptr;
+    }
+    return ctx;
+}
+
+// Thread gravadora: separa as linhas, formata e grava raw + B/V/T/Z.
+// Consome as filas de todas as conexões em ordem de chegada (cada fila é SPSC,
+// então a junção não trava ninguém). Com --sessions N o universo de símbolos
+// se divide em N sessões; com --host2 cada sessão tem duas pernas e cada linha
+// passa pelo FeedArbiter da sessão antes de gravar.
+class FeedWriter {
+public:
+    // Conexão c = sessão c / legs, perna c % legs, com a fila rings[c]
+    FeedWriter(const std::vector<RxRing*>& rings, int legs, const std::vector<FeedPartition>& parts)
+        : rings_(rings), nlegs_(legs), conns_(new Conn[rings.size()]), sessions_(parts.size()) {
+        for (size_t c = 0; c < rings.size(); c++) {
+            conns_[c].session = static_cast<int>(c) / legs;
+            conns_[c].leg = static_cast<int>(c) % legs;
+        }
+        for (size_t i = 0; i < parts.size(); i++) {
+            Session& ss = sessions_[i];
+            if (legs > 1) ss.arbiter.reset(new FeedArbiter());
+            ss.symbols = parts[i].symbols.size();
+            // Com uma sessão só a lacuna vale para tudo, como sempre foi
+            if (parts.size() > 1) {
+                for (const std::string& sym : parts[i].symbols) ss.gap_scope += ";" + sym;
+            }
         }
+        if (!g_opts.shm.empty() && cshm_create(&shm_, g_opts.shm.c_str(), CSHM_DEFAULT_CHANNEL_BYTES) != 0) {
+            std::cerr << "Não foi possível criar a memória compartilhada " << g_opts.shm << ": " << std::strerror(errno) << std::endl;
+        }
+    }
+    ~FeedWriter() { cshm_close(&shm_); }
+    void run();
+
+    // Thread leitora: muda quando o watchdog acusa um símbolo travado na conexão
+    unsigned stall_generation(int conn) const { return conns_[conn].stall_gen.load(std::memory_order_acquire); }
+    std::string stall_reason(int conn) const { return conns_[conn].stall_reason; }
+    // Thread leitora: silêncio do socket só reconecta com o ritmo da conexão já aprendido
+    bool stall_armed(int conn) const { return conns_[conn].stall_armed.load(std::memory_order_acquire); }
+
+private:
+    void open_day(const std::string& date);
+    void flush_stream(OutStream& s);
+    void flush_all();
+    void sync_all();
+    void close_all();
+    void handle_data(const RxChunk& chunk, int conn);
+    OutStream* stream_for(std::string_view line);
+    void open_journal();
+    void append_journal(const RxChunk& chunk, char type, std::string_view line);
+    void append_gap(const RxChunk& chunk, std::string_view payload, long long delta_ms);
+    void publish_shm(const RxChunk& chunk, char type, std::string_view line);
+    void on_reset(const RxChunk& chunk, int conn);
+    void check_stall();
+    void report();
+
+    void report_conn(int conn, uint64_t now_ns);
+
+    // Estado de cada conexão
+    struct Conn {
+        int session = 0;
+        int leg = 0;                                          // 0 = A, 1 = B (--host2)
+        LineFramer framer;
+        StallWatchdog watchdog{static_cast<uint64_t>(g_opts.stall_ms) * 1000000ull, 50.0};
+        bool up = false;                                      // recebendo dados
+        bool resync = false;                                  // descartando até a reconexão pedida
+        bool stall_raised = false;                            // já acusado nesta conexão
+        std::atomic<unsigned> stall_gen{0};
+        std::atomic<bool> stall_armed{false};                 // watchdog.armed(), para a thread leitora
+        char stall_reason[160] = {0};
+        // Ritmo da conexão, para ver quando uma sessão sozinha satura
+        unsigned long long msgs = 0, bytes = 0, reads = 0, full_reads = 0;
+        uint64_t first_ns = 0;
+        uint64_t sec_start_ns = 0;                            // janela de 1 s corrente
+        unsigned long long sec_msgs = 0, peak_msgs = 0;       // mensagens na janela / maior janela
+    };
+
+    // Partição do universo de símbolos
+    struct Session {
+        std::unique_ptr<FeedArbiter> arbiter;                 // só com duas pernas
+        std::string gap_scope;                                // ";SIM1;SIM2" nos marcadores (vazio = todos)
+        size_t symbols = 0;
+        bool gap_open = false;                                // GAP_START gravado, esperando dados
+        uint64_t gap_start_ns = 0;
+    };
+
+    std::vector<RxRing*> rings_;
+    int nlegs_;
+    std::unique_ptr<Conn[]> conns_;
+    std::vector<Session> sessions_;
+    CshmWriter shm_{};                                        // --shm (base nulo se desligado)
+    std::string date_;
+    std::unique_ptr<UringContext> uring_ = make_uring_context(); // antes dos arquivos que o usam
+    OutStream raw_{uring_.get()}, b_{uring_.get()}, v_{uring_.get()}, t_{uring_.get()}, z_{uring_.get()};
+    OutStream cj_{uring_.get()};                              // journal binário (--journal)
+    std::map<std::string, uint16_t, std::less<>> cj_syms_;    // símbolo -> id no journal do dia
+    int batch_count_ = 0;
+    std::chrono::steady_clock::time_point last_flush_;
+    uint64_t last_record_ns_ = 0;                             // CLOCK_MONOTONIC do registro anterior
+    bool has_last_record_ = false;
+    TsPrefixCache ts_cache_;
+    unsigned long long lines_ = 0;
+    std::unique_ptr<CollectorStats> stats_{g_opts.stats ? new CollectorStats() : nullptr};
+};
+
+// Bytes já gravados num arquivo do dia (retomada no mesmo dia): o tail
+// publicado se foi gravado pelo --writer mmap, senão o tamanho
+static uint64_t existing_size(const std::string& path) {
+    CmtTail side;
+    if (cmt_attach(&side, path.c_str())) {
+        const long long tail = cmt_committed(&side);
+        cmt_detach(&side);
+        if (tail >= 0) return static_cast<uint64_t>(tail);
     }
+    std::error_code ec;
+    const auto size = fs::file_size(path, ec);
+    return ec ? 0 : static_cast<uint64_t>(size);
+}
 
-    if (is_time_to_stop()) {
-        std::cerr << "Fora do Horario - Aguardando próximo dia de operação..." << std::endl;
-        std::this_thread::sleep_for(std::chrono::seconds(60));
+void FeedWriter::open_day(const std::string& date) {
+    date_ = date;
+    raw_.filename = get_output_dir() + date + "_raw_data.txt";
+    b_.filename = get_output_dir() + date + "_B.txt";
+    v_.filename = get_output_dir() + date + "_V.txt";
+    t_.filename = get_output_dir() + date + "_T.txt";
+    z_.filename = get_output_dir() + date + "_Z.txt";
+    std::error_code ec;
+    fs::create_directories(get_output_dir(), ec);
+    for (OutStream* s : {&raw_, &b_, &v_, &t_, &z_}) {
+        s->offset = existing_size(s->filename);
+        ci_writer_open(&s->idx, g_opts.index ? s->filename.c_str() : nullptr);
+    }
+    raw_.file->open(raw_.filename);
+    if (!raw_.file->is_open()) {
+        std::cerr << "Erro crítico: arquivo raw não pôde ser aberto: " << raw_.filename << std::endl;
+    }
+    if (g_opts.journal) open_journal();
+}
+
+// Abre {data}_raw.cj. Se já existe (coletor reiniciado no mesmo dia), relê a
+// tabela de símbolos e corta um registro incompleto no fim antes de anexar.
+void FeedWriter::open_journal() {
+    cj_.filename = get_output_dir() + date_ + "_raw.cj";
+    cj_.batch.clear();
+    cj_syms_.clear();
+
+    std::error_code ec;
+    auto size = fs::exists(cj_.filename, ec) ? fs::file_size(cj_.filename, ec) : 0;
+    // Gravado pelo backend mmap: além do tail publicado só há pré-alocação
+    CmtTail side;
+    if (!ec && cmt_attach(&side, cj_.filename.c_str())) {
+        const long long committed = cmt_committed(&side);
+        if (committed >= 0 && static_cast<uintmax_t>(committed) < size) size = static_cast<uintmax_t>(committed);
+        cmt_detach(&side);
+    }
+    if (ec || size == 0) {
+        unsigned char hdr[CJ_FILE_HEADER_SIZE];
+        cj_file_header(hdr);
+        cj_.batch.append(reinterpret_cast<const char*>(hdr), sizeof(hdr));
+        return;
+    }
+
+    FILE* f = std::fopen(cj_.filename.c_str(), "rb");
+    if (!f) {
+        std::cerr << "Erro ao abrir journal: " << cj_.filename << std::endl;
         return;
     }
+    auto reader = std::make_unique<CjReader>();
+    cj_init(reader.get(), f);
+    CjRecord rec;
+    int r;
+    while ((r = cj_next(reader.get(), &rec)) > 0) {}
+    const long long good = reader->offset;
+    for (int id = 0; id < reader->nsyms; id++) {
+        cj_syms_.emplace(reader->syms[id], static_cast<uint16_t>(id));
+    }
+    cj_free(reader.get());
+    std::fclose(f);
+
+    if (r < 0) {
+        std::cerr << "Journal inválido, não será anexado: " << cj_.filename << std::endl;
+        cj_.filename.clear();
+        return;
+    }
+    if (good < static_cast<long long>(size)) {
+        std::cerr << "Journal com registro incompleto no fim; cortando em " << good << " bytes" << std::endl;
+        fs::resize_file(cj_.filename, static_cast<uintmax_t>(good), ec);
+    }
+}
+
+// Registro do journal: cabeçalho com os timestamps do bloco recebido + payload.
+// Símbolo novo ganha um registro 'S' antes do primeiro uso.
+void FeedWriter::append_journal(const RxChunk& chunk, char type, std::string_view line) {
+    if (cj_.filename.empty()) return;
+    CjRecordHeader h{};
+    h.realtime_ns = chunk.realtime_ns;
+    h.mono_ns = chunk.mono_ns;
+    if (chunk.kernel_ts) h.flags |= CJ_FLAG_KERNEL_TS;
+    if (chunk.leg == 1) h.flags |= CJ_FLAG_LEG_B;
+
+    const char* sym = nullptr;
+    const size_t sym_len = cj_payload_symbol(line.data(), line.size(), &sym);
+    if (sym_len == 0) h.symbol_id = 0xFFFF; // marcador de lacuna etc.: sem símbolo
+    if (sym_len > 0) {
+        const std::string_view key(sym, sym_len);
+        auto it = cj_syms_.find(key);
+        if (it == cj_syms_.end()) {
+            if (cj_syms_.size() >= CJ_MAX_SYMBOLS) {
+                it = cj_syms_.end();
+            } else {
+                it = cj_syms_.emplace(std::string(key), static_cast<uint16_t>(cj_syms_.size())).first;
+                CjRecordHeader sh = h;
+                sh.type = CJ_TYPE_SYMBOL;
+                sh.symbol_id = it->second;
+                sh.len = static_cast<uint32_t>(sym_len);
+                cj_.batch.append(reinterpret_cast<const char*>(&sh), sizeof(sh));
+                cj_.batch.append(sym, sym_len);
+            }
+        }
+        if (it != cj_syms_.end()) h.symbol_id = it->second;
+    }
+
+    h.type = static_cast<uint8_t>(type);
+    h.len = static_cast<uint32_t>(line.size());
+    cj_.batch.append(reinterpret_cast<const char*>(&h), sizeof(h));
+    cj_.batch.append(line.data(), line.size());
+}
+
+void FeedWriter::flush_stream(OutStream& s) {
+    if (s.batch.empty()) return;
+    if (!s.file->is_open()) s.file->open(s.filename);
+    if (s.file->is_open() && s.file->append(s.batch.data(), s.batch.size())) s.batch.clear();
+}
+
+void FeedWriter::flush_all() {
+    if (!raw_.batch.empty()) {
+        if (!raw_.file->is_open()) {
+            raw_.file->open(raw_.filename);
+            if (!raw_.file->is_open()) {
+                std::cerr << "Erro crítico: arquivo raw está fechado; descartando buffer." << std::endl;
+            }
+        }
+        if (raw_.file->is_open() && raw_.file->append(raw_.batch.data(), raw_.batch.size())) {
+            raw_.batch.clear();
+            batch_count_ = 0;
+            last_flush_ = std::chrono::steady_clock::now();
+        }
+    }
+    flush_stream(b_);
+    flush_stream(v_);
+    flush_stream(t_);
+    flush_stream(z_);
+    if (!cj_.filename.empty()) flush_stream(cj_);
+    // Uma io_uring_enter para todos os arquivos da janela
+    if (uring_) uring_->submit();
+    if (stats_) stats_->on_flush(clock_ns(CLOCK_MONOTONIC));
+}
+
+void FeedWriter::sync_all() {
+    raw_.file->sync();
+    b_.file->sync();
+    v_.file->sync();
+    t_.file->sync();
+    z_.file->sync();
+    cj_.file->sync();
+}
+
+void FeedWriter::close_all() {
+    for (OutStream* s : {&raw_, &b_, &v_, &t_, &z_}) ci_writer_flush(&s->idx);
+    raw_.file->close();
+    b_.file->close();
+    v_.file->close();
+    t_.file->close();
+    z_.file->close();
+    cj_.file->close();
+}
+
+OutStream* FeedWriter::stream_for(std::string_view line) {
+    switch (record_type(line)) {
+        case 'B': return &b_;
+        case 'V': return &v_;
+        case 'T': return &t_;
+        case 'Z': return &z_;
+        default: return nullptr;
+    }
+}
+
+static std::time_t chunk_sec(const RxChunk& chunk) {
+    return static_cast<std::time_t>(chunk.realtime_ns / 1000000000ull);
+}
+
+// Cada registro é formatado uma vez no lote raw e o mesmo trecho é copiado
+// para o lote do tipo; as linhas vêm como string_view sobre o bloco recebido.
+// O prefixo e o delta_ms vêm da chegada do bloco (RxChunk: no kernel com
+// --kernel-ts, senão na volta do read_some na thread de leitura), nunca da hora
+// de formatar: com o disco atrasando o gravador, a fila entre as threads
+// acumula e o relógio daqui mediria a gravação. A linha que atravessa dois
+// blocos fica com o carimbo do segundo.
+void FeedWriter::handle_data(const RxChunk& chunk, int conn) {
+    const size_t reply_length = chunk.len;
+    if (stats_) stats_->on_read(chunk.len, chunk.mono_ns);
+    Conn& l = conns_[conn];
+    Session& ss = sessions_[static_cast<size_t>(l.session)];
+    if (l.resync) return;
+    l.up = true;
+    l.reads++;
+    l.bytes += chunk.len;
+    if (chunk.len == RX_CHUNK_BYTES) l.full_reads++;   // havia mais no kernel: leitor atrás do socket
+    if (l.first_ns == 0) l.first_ns = chunk.mono_ns;
+    if (chunk.mono_ns - l.sec_start_ns >= 1000000000ull) {
+        if (l.sec_msgs > l.peak_msgs) l.peak_msgs = l.sec_msgs;
+        l.sec_msgs = 0;
+        l.sec_start_ns = chunk.mono_ns;
+    }
+    if (ss.gap_open) {
+        // Primeiros dados depois da queda: fecha a lacuna antes deles
+        const long long gap_ms = chunk.mono_ns > ss.gap_start_ns ? static_cast<long long>((chunk.mono_ns - ss.gap_start_ns) / 1000000ull) : 0;
+        char payload[64];
+        std::snprintf(payload, sizeof(payload), "%s:%lld", CEDRO_GAP_END, gap_ms);
+        append_gap(chunk, payload + ss.gap_scope, gap_ms);
+        ss.gap_open = false;
+        std::cerr << "[gravador] lacuna de " << gap_ms << " ms fechada";
+        if (sessions_.size() > 1) std::cerr << " (sessao " << l.session << ")";
+        std::cerr << std::endl;
+    }
+    l.framer.feed(chunk.data, chunk.len, [&](std::string_view line) {
+        l.msgs++;
+        l.sec_msgs++;
+        const char* sym = nullptr;
+        const size_t sym_len = cj_payload_symbol(line.data(), line.size(), &sym);
+        if (sym_len > 0) l.watchdog.on_message(std::string_view(sym, sym_len), chunk.mono_ns);
+        // Só a primeira cópia entre as pernas é gravada
+        if (ss.arbiter && ss.arbiter->on_line(l.leg, line, chunk.mono_ns) != FeedArbiter::EMIT) return;
+
+        const std::string_view ts = ts_cache_.get(chunk_sec(chunk));
+        const uint64_t t_line = chunk.mono_ns;
+        long long delta_ms = has_last_record_ && t_line > last_record_ns_
+            ? static_cast<long long>((t_line - last_record_ns_) / 1000000ull) : 0;
+        last_record_ns_ = t_line;
+        has_last_record_ = true;
+
+        const size_t rec_start = raw_.batch.size();
+        append_record(raw_.batch, ts, reply_length, delta_ms, line);
+        batch_count_++;
+        lines_++;
+
+        const char type = record_type(line);
+        const size_t rec_len = raw_.batch.size() - rec_start;
+        ci_writer_add(&raw_.idx, ts.data(), sym, sym_len, raw_.offset);
+        raw_.offset += rec_len;
+        if (OutStream* typed = stream_for(line)) {
+            typed->batch.append(raw_.batch, rec_start, std::string::npos);
+            ci_writer_add(&typed->idx, ts.data(), sym, sym_len, typed->offset);
+            typed->offset += rec_len;
+        }
+        if (g_opts.journal && type) append_journal(chunk, type, line);
+        if (shm_.base && type) publish_shm(chunk, type, line);
+        if (stats_) stats_->on_record(type, chunk.mono_ns, raw_.batch.size() - rec_start);
+
+        if (batch_count_ >= 10) flush_all();
+    });
+}
+
+// Marcador de lacuna (cedro_gap.h) em raw, B/V/T/Z e no journal
+void FeedWriter::append_gap(const RxChunk& chunk, std::string_view payload, long long delta_ms) {
+    const std::string_view ts = ts_cache_.get(chunk_sec(chunk));
+    const size_t rec_start = raw_.batch.size();
+    append_record(raw_.batch, ts, 0, delta_ms, payload);
+    const size_t rec_len = raw_.batch.size() - rec_start;
+    for (OutStream* s : {&raw_, &b_, &v_, &t_, &z_}) {
+        if (s != &raw_) s->batch.append(raw_.batch, rec_start, std::string::npos);
+        ci_writer_add(&s->idx, ts.data(), nullptr, 0, s->offset);
+        s->offset += rec_len;
+    }
+    if (g_opts.journal) append_journal(chunk, CJ_TYPE_GAP, payload);
+    if (shm_.base) publish_shm(chunk, CJ_TYPE_GAP, payload);
+    batch_count_++;
+}
+
+// Registro no anel do --shm já na hora do enquadramento, antes do flush dos arquivos
+void FeedWriter::publish_shm(const RxChunk& chunk, char type, std::string_view line) {
+    CjRecordHeader h{};
+    h.realtime_ns = chunk.realtime_ns;
+    h.mono_ns = chunk.mono_ns;
+    if (chunk.kernel_ts) h.flags |= CJ_FLAG_KERNEL_TS;
+    if (chunk.leg == 1) h.flags |= CJ_FLAG_LEG_B;
+    h.symbol_id = 0xFFFF;
+    h.type = static_cast<uint8_t>(type);
+    h.len = static_cast<uint32_t>(line.size());
+    cshm_publish(&shm_, &h, line.data());
+}
+
+// Conexão caiu: grava o pendente, descarta a linha parcial e abre a lacuna.
+// Falhas seguidas de reconexão ficam numa lacuna só; com duas pernas, só há
+// lacuna quando as duas estão fora. Com várias sessões, a lacuna lista só os
+// símbolos da sessão que caiu (cedro_gap_covers).
+void FeedWriter::on_reset(const RxChunk& chunk, int conn) {
+    flush_all();
+    Conn& l = conns_[conn];
+    Session& ss = sessions_[static_cast<size_t>(l.session)];
+    l.framer.reset();
+    l.watchdog.reset();
+    l.stall_raised = false;
+    l.stall_armed.store(false, std::memory_order_release);
+    l.up = false;
+    l.resync = false;
+    if (nlegs_ > 1) {
+        const int leg = l.leg;
+        Conn& other = conns_[conn ^ 1];
+        const bool other_synced = ss.arbiter->synced(1 - leg);
+        ss.arbiter->leg_down(leg);
+        if (other.up && other_synced) {
+            std::cerr << "[gravador] perna " << (leg ? 'B' : 'A') << " fora; seguindo com a outra" << std::endl;
+            return;
+        }
+        if (other.up) {
+            // A outra ainda estava no snapshot: reconecta para começar limpo
+            std::cerr << "[gravador] perna " << (leg ? 'B' : 'A') << " fora e a outra sem sincronia; reconectando a outra" << std::endl;
+            other.up = false;
+            other.resync = true;
+            std::snprintf(other.stall_reason, sizeof(other.stall_reason), "resync");
+            other.stall_gen.fetch_add(1, std::memory_order_release);
+            ss.arbiter->leg_down(1 - leg);
+        }
+    }
+    has_last_record_ = false;
+    if (!ss.gap_open) {
+        std::string reason(chunk.data, chunk.len);
+        for (char& c : reason) {
+            if (c == ',' || c == ':' || c == ';' || c == '\n' || c == '\r') c = ' ';
+        }
+        if (reason.empty()) reason = "desconexao";
+        if (sessions_.size() > 1) reason += " sessao " + std::to_string(l.session);
+        append_gap(chunk, std::string(CEDRO_GAP_START) + ":" + reason + ss.gap_scope, 0);
+        flush_all();
+        ss.gap_open = true;
+        ss.gap_start_ns = chunk.mono_ns;
+    }
+}
+
+// Chamado com as filas vazias (gravador em dia com os sockets), senão o atraso
+// da gravação pareceria silêncio do feed.
+void FeedWriter::check_stall() {
+    if (!stall_hours()) return;
+    const uint64_t now = clock_ns(CLOCK_MONOTONIC);
+    for (size_t c = 0; c < rings_.size(); c++) {
+        Conn& l = conns_[c];
+        if (l.stall_raised || !l.up) continue;
+        if (!l.stall_armed.load(std::memory_order_relaxed) && l.watchdog.armed()) {
+            l.stall_armed.store(true, std::memory_order_release);
+        }
+        if (l.watchdog.stalled(now, l.stall_reason, sizeof(l.stall_reason))) {
+            l.stall_raised = true;
+            l.stall_gen.fetch_add(1, std::memory_order_release);
+        }
+    }
+}
+
+// Uma linha por conexão: mensagens/s médio e pico de 1 s, socket em MB/s e a
+// fração de leituras que encheram o bloco (o kernel tinha mais: a sessão está
+// no limite). Fila cheia aponta o gravador como gargalo, não a conexão.
+void FeedWriter::report_conn(int conn, uint64_t now_ns) {
+    const Conn& l = conns_[conn];
+    const double secs = l.first_ns && now_ns > l.first_ns ? (now_ns - l.first_ns) / 1e9 : 0.0;
+    char buf[320];
+    std::snprintf(buf, sizeof(buf),
+                  "[sessao %d%s] simbolos=%zu msgs=%llu (%.0f/s, pico %llu/s) socket=%.2f MB (%.2f MB/s)"
+                  " leituras=%llu cheias=%.1f%% fila=%zu/%zu pico=%zu\n",
+                  l.session, nlegs_ > 1 ? (l.leg ? " B" : " A") : "", sessions_[static_cast<size_t>(l.session)].symbols,
+                  l.msgs, secs > 0 ? l.msgs / secs : 0.0, std::max(l.peak_msgs, l.sec_msgs),
+                  l.bytes / 1e6, secs > 0 ? l.bytes / 1e6 / secs : 0.0,
+                  l.reads, l.reads ? 100.0 * l.full_reads / l.reads : 0.0,
+                  rings_[static_cast<size_t>(conn)]->size(), rings_[static_cast<size_t>(conn)]->capacity(),
+                  rings_[static_cast<size_t>(conn)]->high_water());
+    std::cout << buf;
+}
+
+void FeedWriter::report() {
+    std::cout << "[gravador] linhas=" << lines_ << std::endl;
+    const uint64_t now = clock_ns(CLOCK_MONOTONIC);
+    for (size_t c = 0; c < rings_.size(); c++) report_conn(static_cast<int>(c), now);
+    for (size_t i = 0; i < sessions_.size(); i++) {
+        if (!sessions_[i].arbiter) continue;
+        if (sessions_.size() > 1) std::cout << "[arbitro] sessao " << i << ":" << std::endl;
+        sessions_[i].arbiter->report(std::cout);
+    }
+}
+
+void FeedWriter::run() {
+    ts_cache_.get();
+    open_day(std::string(ts_cache_.date()));
+    last_flush_ = std::chrono::steady_clock::now();
+    auto last_report = last_flush_;
+    auto last_sync = last_flush_;
+    auto last_stall_check = last_flush_;
+
+    for (;;) {
+        // Próximo bloco: o que chegou primeiro entre as conexões
+        int conn = 0;
+        RxChunk* chunk = rings_[0]->front();
+        for (size_t c = 1; c < rings_.size(); c++) {
+            RxChunk* other = rings_[c]->front();
+            if (other && (!chunk || other->mono_ns < chunk->mono_ns)) {
+                chunk = other;
+                conn = static_cast<int>(c);
+            }
+        }
+        auto now = std::chrono::steady_clock::now();
+
+        if (chunk) {
+            // Rotaciona arquivos quando muda a data (a da chegada do bloco; com duas
+            // conexões ela pode voltar uns ms na virada, daí o '>')
+            ts_cache_.get(chunk_sec(*chunk));
+            if (ts_cache_.date() > std::string_view(date_)) {
+                flush_all();
+                close_all();
+                const std::string closed = date_;
+                open_day(std::string(ts_cache_.date()));
+                if (g_archiver) g_archiver->enqueue_day(closed);
+            }
+
+            if (chunk->kind == RxChunk::STOP) {
+                rings_[conn]->pop();
+                break;
+            }
+            chunk->leg = static_cast<uint8_t>(conns_[conn].leg);
+            if (chunk->kind == RxChunk::RESET) {
+                on_reset(*chunk, conn);
+            } else {
+                handle_data(*chunk, conn);
+            }
+            rings_[conn]->pop();
+        }
+
+        if (std::chrono::duration_cast<std::chrono::seconds>(now - last_flush_).count() >= 5 && !raw_.batch.empty()) {
+            flush_all();
+        }
+        if (std::chrono::duration_cast<std::chrono::milliseconds>(now - last_sync).count() >= g_opts.msync_ms) {
+            sync_all();
+            last_sync = now;
+        }
+        if (std::chrono::duration_cast<std::chrono::seconds>(now - last_report).count() >= RING_REPORT_SEC) {
+            report();
+            last_report = now;
+        }
+        if (!chunk && now - last_stall_check >= std::chrono::milliseconds(100)) {
+            check_stall();
+            last_stall_check = now;
+        }
+        if (!chunk) std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    flush_all();
+    close_all();
+    report();
+    if (stats_) stats_->report(std::cout);
+}
+
+// recvmsg com o carimbo SCM_TIMESTAMPNS (CLOCK_REALTIME) do kernel. Em TCP o
+// carimbo é o do último segmento entregue nesta leitura; kernel_ns = 0 se não veio.
+static size_t recv_stamped(int fd, char* buf, size_t cap, uint64_t& kernel_ns, boost::system::error_code& ec) {
+    iovec iov;
+    iov.iov_base = buf;
+    iov.iov_len = cap;
+    alignas(cmsghdr) char ctrl[CMSG_SPACE(sizeof(timespec))];
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    kernel_ns = 0;
+    ssize_t n;
+    for (;;) {
+        msg.msg_control = ctrl;
+        msg.msg_controllen = sizeof(ctrl);
+        n = ::recvmsg(fd, &msg, 0);
+        if (n >= 0) break;
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            pollfd pfd{fd, POLLIN, 0};
+            ::poll(&pfd, 1, -1);
+            continue;
+        }
+        ec = boost::system::error_code(errno, boost::system::system_category());
+        return 0;
+    }
+    if (n == 0) {
+        ec = boost::asio::error::eof;
+        return 0;
+    }
+    for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+            timespec ts;
+            std::memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+            kernel_ns = static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+        }
+    }
+    ec = boost::system::error_code();
+    return static_cast<size_t>(n);
+}
+
+// Thread leitora: só conecta, faz login e drena o socket para a fila.
+// A gravação acontece na FeedWriter, em outra thread.
+// Uma conexão com o feed: perna A (ou B com --host2) de uma sessão
+struct FeedLeg {
+    int index;                 // conexão no FeedWriter (sessão * pernas + perna)
+    std::string tag;           // "[leitor]", "[leitor B]", "[leitor s2]" ...
+    std::string host, port;
+    std::string user, pass;    // vazios: login padrão
+    std::vector<tcp::endpoint> endpoints; // resolvidos; DNS só de novo se nenhum conectar
+    std::vector<std::string> commands;    // assinaturas da sessão ("BQT WINZ26" ...)
+};
+
+// Sessão de uma perna: conecta, faz login, assina e lê para a fila até o fim
+// do horário, reconectando com backoff. Termina com a fila sem STOP.
+static void run_leg(FeedLeg& leg, RxRing& ring, FeedWriter& writer) {
+    const std::string& tag = leg.tag;
+    unsigned long long full_waits = 0;
+    unsigned long long reads = 0;
+    unsigned long long bytes = 0;
+    auto last_report = std::chrono::steady_clock::now();
+    auto report = [&]() {
+        std::cout << tag << " leituras=" << reads << " bytes=" << bytes
+                  << " fila=" << ring.size() << "/" << ring.capacity()
+                  << " pico=" << ring.high_water()
+                  << " esperas_fila_cheia=" << full_waits << std::endl;
+    };
+
+    std::vector<tcp::endpoint>& endpoints = leg.endpoints;
+    ReconnectBackoff backoff(g_opts.backoff_min_ms, g_opts.backoff_max_ms);
 
     while (!is_time_to_stop()) {
-            // Buffer de escrita em lote
-            std::string batch_buffer;
-            int batch_count = 0;
-            // Buffers por tipo
-            std::string b_batch;
-            std::string v_batch;
-            std::string t_batch;
-            std::string z_batch;
-            auto last_flush = std::chrono::steady_clock::now();
-        std::chrono::steady_clock::time_point last_record_tp;
-        bool has_last_record = false;	
         try {
             io_context_type io_context;
-            tcp::resolver resolver(io_context);
-            tcp::resolver::query query("datafeed1.cedrotech.com", "81");
-            auto endpoints = resolver.resolve(query);
+            if (endpoints.empty()) {
+                tcp::resolver resolver(io_context);
+                tcp::resolver::query query(leg.host, leg.port);
+                for (auto it = resolver.resolve(query); it != tcp::resolver::iterator(); ++it) endpoints.push_back(it->endpoint());
+            }
             tcp::socket socket(io_context);
-            boost::asio::connect(socket, endpoints);
+            boost::system::error_code connect_error;
+            boost::asio::connect(socket, endpoints.begin(), endpoints.end(), connect_error);
+            if (connect_error) {
+                endpoints.clear();
+                throw boost::system::system_error(connect_error);
+            }
 
             socket.set_option(boost::asio::socket_base::keep_alive(true));
             // Reduz latência em envios pequenos
@@ -344,8 +1078,15 @@ void connect_and_listen() {
             // Buffers maiores para acelerar drenagem de backlog
             socket.set_option(boost::asio::socket_base::send_buffer_size(4096));
             socket.set_option(boost::asio::socket_base::receive_buffer_size(65536));
+            // Carimbo de chegada no kernel em cada recvmsg
+            bool kernel_ts = false;
+            if (g_opts.kernel_ts) {
+                int on = 1;
+                kernel_ts = setsockopt(socket.native_handle(), SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) == 0;
+                if (!kernel_ts) std::cerr << "SO_TIMESTAMPNS indisponível: " << std::strerror(errno) << std::endl;
+            }
 
-            std::cout << "Conectado ao servidor!" << std::endl;
+            std::cout << tag << " Conectado ao servidor " << leg.host << ":" << leg.port << std::endl;
             const char start[] = { '\r', '\n' };
             boost::asio::write(socket, boost::asio::buffer(start, sizeof(start)));
 
@@ -359,124 +1100,69 @@ void connect_and_listen() {
             std::cout << "Resposta inicial: " << initial_response << std::endl;
 
             const char username[] = { 'g', 'u', 's', 't', 'a', 'v', 'o', 'f', 'm', '\r', '\n' };
-            boost::asio::write(socket, boost::asio::buffer(username, sizeof(username)));
+            if (leg.user.empty()) boost::asio::write(socket, boost::asio::buffer(username, sizeof(username)));
+            else boost::asio::write(socket, boost::asio::buffer(leg.user + "\r\n"));
             size_t length2 = boost::asio::read_until(socket, response, "Password:");
             std::string resposta = std::string(boost::asio::buffers_begin(response.data()), boost::asio::buffers_begin(response.data()) + length2);
             response.consume(length2);
             std::cout << "Resposta: " << resposta << std::endl;
 
             const char password[] = { 'M', 'k', 'd', 't', '@', '3', '5', '1', '2', '5', '6', '\r', '\n' };
-            boost::asio::write(socket, boost::asio::buffer(password, sizeof(password)));
+            if (leg.pass.empty()) boost::asio::write(socket, boost::asio::buffer(password, sizeof(password)));
+            else boost::asio::write(socket, boost::asio::buffer(leg.pass + "\r\n"));
 
             size_t length3 = boost::asio::read_until(socket, response, "You are connected");
             std::string login_response = std::string(boost::asio::buffers_begin(response.data()), boost::asio::buffers_begin(response.data()) + length3);
             response.consume(length3);
             std::cout << "Resposta após senha: " << login_response << std::endl;
 
-            // Assina contratos atuais
-            std::string win_contract = get_win_contract();
-            std::string wdo_contract = get_wdo_contract();
-            // Envia comandos em batch com CRLF para evitar problemas de buffer
+            // Envia as assinaturas da sessão em batch com CRLF para evitar problemas de buffer
             std::string cmd_batch;
-            cmd_batch.reserve(256);
-            cmd_batch += "BQT " + win_contract + " \r\n";
-            cmd_batch += "BQT " + wdo_contract + " \r\n";
-            cmd_batch += "GQT " + win_contract + " S \r\n";
-            cmd_batch += "GQT " + wdo_contract + " S \r\n";
-            cmd_batch += "SQT " + win_contract + " \r\n";
-            cmd_batch += "SQT " + wdo_contract + " \r\n";
-            cmd_batch += "SAB " + win_contract + " \r\n";
-            cmd_batch += "SAB " + wdo_contract + " \r\n";
-	    
-            cmd_batch += "SQT DI1F27 \r\n";
-
-            std::cout << "Enviando comandos:\n" << cmd_batch << std::endl;
+            cmd_batch.reserve(32 * leg.commands.size());
+            for (const std::string& cmd : leg.commands) cmd_batch += cmd + " \r\n";
+
+            std::cout << tag << " Enviando comandos:\n" << cmd_batch << std::endl;
             // Primeiro tenta envio em batch
             boost::system::error_code write_ec;
             boost::asio::write(socket, boost::asio::buffer(cmd_batch), write_ec);
             if (write_ec) {
                 std::cerr << "Falha no envio em batch: " << write_ec.message() << ". Tentando envio linha a linha..." << std::endl;
                 // Fallback: enviar linha a linha
-                auto send_line = [&](const std::string& line){
-                    std::string l = line;
-                    if (l.empty() || l.back() != '\n') l += "\r\n";
-                    boost::asio::write(socket, boost::asio::buffer(l));
-                };
-                //send_line("BQT " + win_contract);
-		//
-		send_line("BQT " + win_contract );
-                //send_line("BQT " + wdo_contract);
-                send_line("GQT " + wdo_contract + " S");
-                send_line("GQT " + win_contract + " S");
-
-		send_line("SQT " + wdo_contract );
-                send_line("SQT " + win_contract );
-
-                send_line("SAB " + wdo_contract );
-                send_line("SAB " + win_contract );
-
-		
-
-                //send_line("BQT DI1F27");
-                send_line("SQT DI1F27");
+                for (const std::string& cmd : leg.commands) boost::asio::write(socket, boost::asio::buffer(cmd + "\r\n"));
             }
 
-            // Buffer de escrita em lote já definido fora do try
-
-            std::string rx_buffer;
-            rx_buffer.reserve(131072);
-
-            // Loop principal: lê e grava dados brutos
+            // Loop principal: lê direto para o slot da fila, sem formatar nada aqui.
+            // poll() com timeout curto para acusar feed parado com o socket aberto:
+            // silêncio total aqui, símbolo calado pelo watchdog do gravador. Só no
+            // pregão (stall_hours) e, o silêncio do socket, só depois que o gravador
+            // aprendeu o ritmo da conexão (stall_armed).
+            const auto connected_at = std::chrono::steady_clock::now();
+            auto last_data = connected_at;
+            bool backoff_cleared = false;
+            const unsigned stall_seen = writer.stall_generation(leg.index);
+            std::string gap_reason = "eof";
             while (!is_time_to_stop()) {
-                // Rotaciona arquivo quando muda a data
-                std::string current_date = get_current_date();
-                if (current_date != date) {
-                    date = current_date;
-                    // Flush pendente antes de trocar de arquivo
-                    if (!batch_buffer.empty() && raw_file.is_open()) {
-                        raw_file << batch_buffer;
-                        raw_file.flush();
-                        batch_buffer.clear();
-                        batch_count = 0;
-                    }
-                    // Flush pendente dos buffers por tipo
-                    if (!b_batch.empty()) {
-                        if (!b_file.is_open()) b_file.open(b_filename, std::ios::app);
-                        if (b_file.is_open()) { b_file << b_batch; b_file.flush(); b_batch.clear(); }
-                    }
-                    if (!v_batch.empty()) {
-                        if (!v_file.is_open()) v_file.open(v_filename, std::ios::app);
-                        if (v_file.is_open()) { v_file << v_batch; v_file.flush(); v_batch.clear(); }
-                    }
-                    if (!t_batch.empty()) {
-                        if (!t_file.is_open()) t_file.open(t_filename, std::ios::app);
-                        if (t_file.is_open()) { t_file << t_batch; t_file.flush(); t_batch.clear(); }
-                    }
-                    if (!z_batch.empty()) {
-                        if (!z_file.is_open()) z_file.open(z_filename, std::ios::app);
-                        if (z_file.is_open()) { z_file << z_batch; z_file.flush(); z_batch.clear(); }
+                pollfd pfd{socket.native_handle(), POLLIN, 0};
+                const int ready = ::poll(&pfd, 1, 100);
+                if (stall_hours()) {
+                    if (writer.stall_generation(leg.index) != stall_seen) {
+                        gap_reason = "stall " + writer.stall_reason(leg.index);
+                        break;
                     }
-                    if (raw_file.is_open()) raw_file.close();
-                    if (b_file.is_open()) b_file.close();
-                    if (v_file.is_open()) v_file.close();
-                    if (t_file.is_open()) t_file.close();
-                    if (z_file.is_open()) z_file.close();
-                    raw_filename = get_output_dir() + date + "_raw_data.txt";
-                    b_filename = get_output_dir() + date + "_B.txt";
-                    v_filename = get_output_dir() + date + "_V.txt";
-                    t_filename = get_output_dir() + date + "_T.txt";
-                    z_filename = get_output_dir() + date + "_Z.txt";
-                    std::error_code ec;
-                    fs::create_directories(get_output_dir(), ec);
-                    raw_file.open(raw_filename, std::ios::app);
-                    if (!raw_file.is_open()) {
-                        std::cerr << "Erro ao reabrir arquivo raw: " << raw_filename << std::endl;
+                    const auto silent_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - last_data).count();
+                    if (silent_ms > g_opts.stall_ms && writer.stall_armed(leg.index)) {
+                        gap_reason = "stall socket sem dados " + std::to_string(silent_ms) + "ms";
+                        break;
                     }
                 }
+                if (ready <= 0) continue;
 
-                boost::asio::streambuf reply_buf;
+                RxChunk* slot = acquire_chunk(ring, full_waits);
                 boost::system::error_code read_error;
-                size_t reply_length = socket.read_some(reply_buf.prepare(65536), read_error);
+                uint64_t arrival_ns = 0;
+                size_t reply_length = kernel_ts
+                    ? recv_stamped(socket.native_handle(), slot->data, RX_CHUNK_BYTES, arrival_ns, read_error)
+                    : socket.read_some(boost::asio::buffer(slot->data, RX_CHUNK_BYTES), read_error);
                 if (read_error) {
                     if (read_error == boost::asio::error::eof) {
                         std::cerr << "Connection closed by server" << std::endl;
@@ -484,184 +1170,149 @@ void connect_and_listen() {
                     }
                     throw boost::system::system_error(read_error);
                 }
-
-                reply_buf.commit(reply_length);
-                rx_buffer.append(
-                    boost::asio::buffers_begin(reply_buf.data()),
-                    boost::asio::buffers_begin(reply_buf.data()) + reply_length
-                );
-                reply_buf.consume(reply_length);
-
-                size_t start = 0;
-                while (true) {
-                    size_t nl = rx_buffer.find('\n', start);
-                    if (nl == std::string::npos) break;
-
-                    std::string line = rx_buffer.substr(start, nl - start);
-                    if (!line.empty() && line.back() == '\r') line.pop_back();
-                    start = nl + 1;
-                    if (line.empty()) continue;
-
-                    const std::string ts = get_current_datetime_str();
-                    auto now_line = std::chrono::steady_clock::now();
-                    long long delta_ms = has_last_record ? std::chrono::duration_cast<std::chrono::milliseconds>(now_line - last_record_tp).count() : 0;
-                    last_record_tp = now_line;
-                    has_last_record = true;
-                    batch_buffer += ts + "," + std::to_string(reply_length) + "," + std::to_string(delta_ms) + "," + line + "\n";
-                    batch_count++;
-
-                    if (line.rfind("B:", 0) == 0) {
-                        b_batch += ts + "," + std::to_string(reply_length) + "," + std::to_string(delta_ms) + "," + line + "\n";
-                    } else if (line.rfind("V:", 0) == 0) {
-                        v_batch += ts + "," + std::to_string(reply_length) + "," + std::to_string(delta_ms) + "," + line + "\n";
-                    } else if (line.rfind("T:", 0) == 0) {
-                        t_batch += ts + "," + std::to_string(reply_length) + "," + std::to_string(delta_ms) + "," + line + "\n";
-                    } else if (line.rfind("Z:", 0) == 0) {
-                        z_batch += ts + "," + std::to_string(reply_length) + "," + std::to_string(delta_ms) + "," + line + "\n";
-                    }
-
-                    if (batch_count >= 10) {
-                        if (!raw_file.is_open()) {
-                            raw_file.open(raw_filename, std::ios::app);
-                            if (!raw_file.is_open()) {
-                                std::cerr << "Erro crítico: arquivo raw está fechado; descartando buffer." << std::endl;
-                            }
-                        }
-                        if (raw_file.is_open()) {
-                            raw_file << batch_buffer;
-                            raw_file.flush();
-                            batch_buffer.clear();
-                            batch_count = 0;
-                            last_flush = std::chrono::steady_clock::now();
-                        }
-                        if (!b_batch.empty()) {
-                            if (!b_file.is_open()) b_file.open(b_filename, std::ios::app);
-                            if (b_file.is_open()) { b_file << b_batch; b_file.flush(); b_batch.clear(); }
-                        }
-                        if (!v_batch.empty()) {
-                            if (!v_file.is_open()) v_file.open(v_filename, std::ios::app);
-                            if (v_file.is_open()) { v_file << v_batch; v_file.flush(); v_batch.clear(); }
-                        }
-                        if (!t_batch.empty()) {
-                            if (!t_file.is_open()) t_file.open(t_filename, std::ios::app);
-                            if (t_file.is_open()) { t_file << t_batch; t_file.flush(); t_batch.clear(); }
-                        }
-                        if (!z_batch.empty()) {
-                            if (!z_file.is_open()) z_file.open(z_filename, std::ios::app);
-                            if (z_file.is_open()) { z_file << z_batch; z_file.flush(); z_batch.clear(); }
-                        }
-                    }
+                slot->kind = RxChunk::DATA;
+                slot->len = reply_length;
+                slot->realtime_ns = clock_ns(CLOCK_REALTIME);
+                slot->mono_ns = clock_ns(CLOCK_MONOTONIC);
+                slot->kernel_ts = arrival_ns != 0;
+                if (slot->kernel_ts) {
+                    // Chegada em CLOCK_MONOTONIC pelo mesmo atraso medido no REALTIME
+                    const uint64_t waited = slot->realtime_ns > arrival_ns ? slot->realtime_ns - arrival_ns : 0;
+                    slot->mono_ns -= std::min(waited, slot->mono_ns);
+                    slot->realtime_ns = arrival_ns;
                 }
+                ring.publish();
 
-                if (start > 0) rx_buffer.erase(0, start);
-                if (rx_buffer.size() > 1048576) rx_buffer.erase(0, rx_buffer.size() - 65536);
-
+                reads++;
+                bytes += reply_length;
                 auto now = std::chrono::steady_clock::now();
-                if (std::chrono::duration_cast<std::chrono::seconds>(now - last_flush).count() >= 5 && !batch_buffer.empty()) {
-                    if (!raw_file.is_open()) {
-                        raw_file.open(raw_filename, std::ios::app);
-                        if (!raw_file.is_open()) {
-                            std::cerr << "Erro crítico: arquivo raw está fechado; descartando buffer." << std::endl;
-                        }
-                    }
-                    if (raw_file.is_open()) {
-                        raw_file << batch_buffer;
-                        raw_file.flush();
-                        batch_buffer.clear();
-                        batch_count = 0;
-                        last_flush = now;
-                    }
-                    if (!b_batch.empty()) {
-                        if (!b_file.is_open()) b_file.open(b_filename, std::ios::app);
-                        if (b_file.is_open()) { b_file << b_batch; b_file.flush(); b_batch.clear(); }
-                    }
-                    if (!v_batch.empty()) {
-                        if (!v_file.is_open()) v_file.open(v_filename, std::ios::app);
-                        if (v_file.is_open()) { v_file << v_batch; v_file.flush(); v_batch.clear(); }
-                    }
-                    if (!t_batch.empty()) {
-                        if (!t_file.is_open()) t_file.open(t_filename, std::ios::app);
-                        if (t_file.is_open()) { t_file << t_batch; t_file.flush(); t_batch.clear(); }
-                    }
-                    if (!z_batch.empty()) {
-                        if (!z_file.is_open()) z_file.open(z_filename, std::ios::app);
-                        if (z_file.is_open()) { z_file << z_batch; z_file.flush(); z_batch.clear(); }
-                    }
+                last_data = now;
+                // Conexão estável: a próxima queda volta a reconectar rápido
+                if (!backoff_cleared && now - connected_at >= std::chrono::seconds(5)) {
+                    backoff.reset();
+                    backoff_cleared = true;
+                }
+                if (std::chrono::duration_cast<std::chrono::seconds>(now - last_report).count() >= RING_REPORT_SEC) {
+                    report();
+                    last_report = now;
                 }
             }
+            if (is_time_to_stop()) break;
+            if (gap_reason != "eof") std::cerr << tag << " Feed travado (" << gap_reason << "), reconectando" << std::endl;
+            // Linha parcial da conexão encerrada não pode se juntar à próxima
+            push_control(ring, RxChunk::RESET, full_waits, gap_reason);
+            if (g_opts.once) break;
         } catch (const std::exception& e) {
-            std::cerr << "Erro de conexão: " << e.what() << std::endl;
+            std::cerr << tag << " Erro de conexão: " << e.what() << std::endl;
 
-            // Não feche o arquivo se estiver aberto; mantenha pronto para reuso
-            if (!raw_file.is_open()) {
-                raw_file.open(raw_filename, std::ios::app);
-                if (!raw_file.is_open()) {
-                    std::cerr << "Erro ao manter arquivo raw aberto após exceção: " << raw_filename << std::endl;
-                }
-            }
-
-            // Flush pendente antes de reconectar
-            if (!batch_buffer.empty() && raw_file.is_open()) {
-                raw_file << batch_buffer;
-                raw_file.flush();
-                batch_buffer.clear();
-                batch_count = 0;
-            }
-            if (!b_batch.empty()) {
-                if (!b_file.is_open()) b_file.open(b_filename, std::ios::app);
-                if (b_file.is_open()) { b_file << b_batch; b_file.flush(); b_batch.clear(); }
-            }
-            if (!v_batch.empty()) {
-                if (!v_file.is_open()) v_file.open(v_filename, std::ios::app);
-                if (v_file.is_open()) { v_file << v_batch; v_file.flush(); v_batch.clear(); }
-            }
-            if (!t_batch.empty()) {
-                if (!t_file.is_open()) t_file.open(t_filename, std::ios::app);
-                if (t_file.is_open()) { t_file << t_batch; t_file.flush(); t_batch.clear(); }
-            }
-            if (!z_batch.empty()) {
-                if (!z_file.is_open()) z_file.open(z_filename, std::ios::app);
-                if (z_file.is_open()) { z_file << z_batch; z_file.flush(); z_batch.clear(); }
-            }
+            // Gravador grava o pendente e descarta a linha parcial antes de reconectar
+            push_control(ring, RxChunk::RESET, full_waits, std::string("erro ") + e.what());
+            if (g_opts.once) break;
 
             // Sai se estiver fora do horário
             if (is_time_to_stop()) {
                 std::cerr << "Fora do horário de operação. Aguardando próximo dia..." << std::endl;
-                return;
+                break;
             }
+        }
 
-            std::cerr << "Tentando reconectar em 5 segundos..." << std::endl;
-            std::this_thread::sleep_for(std::chrono::seconds(5));
+        const unsigned wait_ms = backoff.next_ms();
+        std::cerr << tag << " Tentando reconectar em " << wait_ms << " ms..." << std::endl;
+        std::this_thread::sleep_for(std::chrono::milliseconds(wait_ms));
+    }
 
-            // Garantir que arquivo permaneça aberto para continuar gravando
-            if (!raw_file.is_open()) {
-                raw_file.open(raw_filename, std::ios::app);
-                if (!raw_file.is_open()) {
-                    std::cerr << "Erro ao reabrir arquivo raw para reconexão: " << raw_filename << std::endl;
-                }
+    report();
+}
+
+// --cpus: fixa a thread leitora num núcleo
+static void pin_thread(std::thread& t, int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    const int rc = pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+    if (rc != 0) std::cerr << "Não foi possível fixar a thread na CPU " << cpu << ": " << std::strerror(rc) << std::endl;
+}
+
+void connect_and_listen() {
+    // A sessão (e o FeedWriter dela) termina às 19:00: o dia fechado entra na
+    // fila aqui, na primeira volta depois da meia-noite
+    if (g_archiver) g_archiver->enqueue_before(get_current_date());
+    if (is_time_to_stop()) {
+        std::cerr << "Fora do Horario - Aguardando próximo dia de operação..." << std::endl;
+        std::this_thread::sleep_for(std::chrono::seconds(60));
+        return;
+    }
+
+    // Universo dividido nas sessões (contratos do dia em {WIN}/{WDO})
+    SymbolUniverse universe = SymbolUniverse::builtin();
+    if (!g_opts.universe.empty()) {
+        std::string err;
+        if (!universe.load(g_opts.universe, err)) {
+            std::cerr << "Universo " << g_opts.universe << " inválido (" << err << "); usando as assinaturas padrão" << std::endl;
+            universe = SymbolUniverse::builtin();
+        }
+    }
+    const int nsessions = g_opts.sessions > 0 ? g_opts.sessions : 1;
+    const std::vector<FeedPartition> parts = universe.partition(nsessions, get_win_contract(), get_wdo_contract());
+    const bool dual = !g_opts.host2.empty();
+    const int nlegs = dual ? 2 : 1;
+
+    // Conexões mantêm os endereços resolvidos entre sessões
+    static std::vector<std::unique_ptr<FeedLeg>> legs;
+    if (legs.size() != static_cast<size_t>(nsessions * nlegs)) {
+        legs.clear();
+        for (int sess = 0; sess < nsessions; sess++) {
+            for (int l = 0; l < nlegs; l++) {
+                std::string tag = "[leitor";
+                if (nsessions > 1) tag += " s" + std::to_string(sess);
+                if (l) tag += " B";
+                tag += "]";
+                if (l == 0) legs.emplace_back(new FeedLeg{sess * nlegs, tag, g_opts.host, g_opts.port, "", "", {}, {}});
+                else legs.emplace_back(new FeedLeg{sess * nlegs + 1, tag, g_opts.host2, g_opts.port2.empty() ? g_opts.port : g_opts.port2,
+                                                   g_opts.user2, g_opts.pass2, {}, {}});
             }
-            continue;
         }
     }
-
-    // Fecha o arquivo ao sair
-    // Flush pendente antes de fechar
-    // Nota: variáveis batch_buffer/batch_count estão fora de escopo aqui;
-    // o flush final ocorre no catch e na rotação de data.
-    if (raw_file.is_open()) {
-        raw_file.close();
+    for (auto& leg : legs) leg->commands = parts[static_cast<size_t>(leg->index / nlegs)].commands;
+    if (nsessions > 1) {
+        for (int sess = 0; sess < nsessions; sess++) {
+            const FeedPartition& p = parts[static_cast<size_t>(sess)];
+            std::cout << "[universo] sessao " << sess << ": " << p.symbols.size() << " simbolos, "
+                      << p.commands.size() << " assinaturas, peso " << p.weight << std::endl;
+        }
     }
-    std::cout << "Sessão encerrada. Reiniciando em 5 segundos..." << std::endl;
-}
-void process_raw_file(const std::string& input_filepath) {
-    std::ifstream raw_file(input_filepath);
-    if (!raw_file.is_open()) {
-        std::cerr << "Erro: Nao foi possivel abrir o arquivo raw: " << input_filepath << std::endl;
-        return;
+
+    std::vector<std::unique_ptr<RxRing>> rings;
+    std::vector<RxRing*> ring_ptrs;
+    for (size_t c = 0; c < legs.size(); c++) {
+        rings.emplace_back(new RxRing(RX_RING_SLOTS));
+        ring_ptrs.push_back(rings.back().get());
     }
+    FeedWriter writer(ring_ptrs, nlegs, parts);
+    std::thread writer_thread([&writer]() {
+        try {
+            writer.run();
+        } catch (const std::exception& e) {
+            std::cerr << "Erro na thread gravadora: " << e.what() << std::endl;
+        }
+    });
 
-    std::cout << "Processando arquivo raw: " << input_filepath << "..." << std::endl;
+    // Uma thread leitora por conexão
+    std::vector<std::thread> readers;
+    for (size_t c = 0; c < legs.size(); c++) {
+        readers.emplace_back([&, c]() { run_leg(*legs[c], *rings[c], writer); });
+        if (!g_opts.cpus.empty()) pin_thread(readers.back(), g_opts.cpus[c % g_opts.cpus.size()]);
+    }
+    for (std::thread& t : readers) t.join();
 
+    // Gravador faz o flush final e fecha os arquivos
+    unsigned long long full_waits = 0;
+    push_control(*rings[0], RxChunk::STOP, full_waits);
+    writer_thread.join();
+    std::cout << "Sessão encerrada. Reiniciando em 5 segundos..." << std::endl;
+}
+// --raw: regera os arquivos por tipo dos dias dados (raw_rebuild.h)
+void process_raw_files(const std::vector<std::string>& inputs) {
     // Garantir que o diretório de saída existe
     std::error_code ec;
     fs::create_directories(get_output_dir(), ec);
@@ -669,74 +1320,157 @@ void process_raw_file(const std::string& input_filepath) {
         std::cerr << "Aviso: Nao foi possivel criar o diretorio de saida: " << ec.message() << std::endl;
     }
 
-    std::string line;
-    // Map to keep files open: filename -> ofstream
-    std::map<std::string, std::shared_ptr<std::ofstream>> open_files;
-    long long line_count = 0;
-
-    while (std::getline(raw_file, line)) {
-        if (line.empty()) continue;
-        if (line.back() == '\r') line.pop_back();
+    unsigned threads = g_opts.raw_threads ? g_opts.raw_threads : std::thread::hardware_concurrency();
+    RawRebuilder rebuilder(get_output_dir(), threads);
+    for (const std::string& path : inputs) {
+        if (rebuilder.add_input(path)) std::cout << "Processando arquivo raw: " << path << "..." << std::endl;
+    }
+    rebuilder.run();
+}
 
-        // Format: ts,len,delta,content
-        // Example: 20260108_094657,1428,0,B:WING26...
-        
-        size_t p1 = line.find(',');
-        if (p1 == std::string::npos) continue;
-        
-        std::string ts = line.substr(0, p1);
-        if (ts.length() < 8) continue;
-        std::string date = ts.substr(0, 8); // YYYYMMDD
-
-        size_t p2 = line.find(',', p1 + 1);
-        if (p2 == std::string::npos) continue;
-
-        size_t p3 = line.find(',', p2 + 1);
-        if (p3 == std::string::npos) continue;
-
-        std::string content = line.substr(p3 + 1);
-        std::string suffix = "";
-
-        if (content.rfind("B:", 0) == 0) suffix = "_B.txt";
-        else if (content.rfind("V:", 0) == 0) suffix = "_V.txt";
-        else if (content.rfind("T:", 0) == 0) suffix = "_T.txt";
-        else if (content.rfind("Z:", 0) == 0) suffix = "_Z.txt";
-
-        if (!suffix.empty()) {
-            std::string out_filename = get_output_dir() + date + suffix;
-            
-            if (open_files.find(out_filename) == open_files.end()) {
-                 // Open with trunc for the first time in this session to regenerate
-                 std::shared_ptr<std::ofstream> ofs = std::make_shared<std::ofstream>(out_filename, std::ios::trunc);
-                 if (ofs->is_open()) {
-                     open_files[out_filename] = ofs;
-                     std::cout << "Regerando arquivo: " << out_filename << std::endl;
-                 } else {
-                     std::cerr << "Erro ao criar arquivo: " << out_filename << std::endl;
-                     continue;
-                 }
-            }
+// --compress: comprime arquivos já fechados (.zst com índice de frames) e apaga os originais
+int compress_files(const std::vector<std::string>& inputs) {
+    const unsigned threads = std::max(1u, std::min<unsigned>(g_opts.raw_threads ? g_opts.raw_threads
+                                                                                : std::thread::hardware_concurrency(),
+                                                             static_cast<unsigned>(inputs.size())));
+    std::atomic<size_t> next{0};
+    std::atomic<int> failed{0};
+    auto work = [&]() {
+        for (size_t i; (i = next.fetch_add(1)) < inputs.size();) {
+            if (!DayArchiver::compress(inputs[i], g_opts.zst_level)) failed++;
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++) pool.emplace_back(work);
+    work();
+    for (auto& t : pool) t.join();
+    return failed ? 1 : 0;
+}
 
-            auto& ofs = open_files[out_filename];
-            *ofs << line << "\n";
+// --index: gera o .idx (cedro_index.h) de arquivos do dia gravados sem ele
+int index_files(const std::vector<std::string>& inputs) {
+    int failed = 0;
+    for (std::string path : inputs) {
+        FILE* in = cz_fopen(path.c_str(), "r");
+        if (!in) {
+            std::cerr << "Erro: Nao foi possivel abrir " << path << std::endl;
+            failed++;
+            continue;
         }
-        
-        line_count++;
-        if (line_count % 10000 == 0) {
-            std::cout << "Processadas " << line_count << " linhas..." << "\r";
-            std::cout.flush();
+        if (cz_has_suffix(path.c_str())) path.resize(path.size() - 4);   // X.txt.zst -> X.txt.idx
+        static CiWriter w;
+        ci_writer_open(&w, path.c_str());
+        std::remove(w.path);
+        char* line = nullptr;
+        size_t cap = 0;
+        ssize_t n;
+        uint64_t off = 0, lines = 0;
+        while ((n = getline(&line, &cap, in)) > 0) {
+            const char* payload = n > 15 && ci_line_sec(line) >= 0 ? cedro_gap_payload(line) : nullptr;
+            if (payload) {
+                const char* sym = nullptr;
+                const size_t sym_len = cj_payload_symbol(payload, std::strcspn(payload, "\r\n"), &sym);
+                ci_writer_add(&w, line, sym, sym_len, off);
+                lines++;
+            }
+            off += static_cast<uint64_t>(n);
         }
+        ci_writer_flush(&w);
+        std::free(line);
+        std::fclose(in);
+        std::cout << "Indice " << w.path << ": " << lines << " linhas" << std::endl;
     }
-    
-    std::cout << "\nConcluido. Total de linhas processadas: " << line_count << std::endl;
+    return failed ? 1 : 0;
 }
 
 int main(int argc, char* argv[]) {
-    if (argc == 3 && std::string(argv[1]) == "--raw") {
-        process_raw_file(argv[2]);
+    std::vector<std::string> raw_inputs;
+    std::vector<std::string> compress_inputs;
+    std::vector<std::string> index_inputs;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "--raw" && i + 1 < argc) {
+            // --raw dia1_raw_data.txt [dia2_raw_data.txt ...]
+            while (i + 1 < argc && std::strncmp(argv[i + 1], "--", 2) != 0) raw_inputs.push_back(argv[++i]);
+        }
+        else if (a == "--compress" && i + 1 < argc) {
+            while (i + 1 < argc && std::strncmp(argv[i + 1], "--", 2) != 0) compress_inputs.push_back(argv[++i]);
+        }
+        else if (a == "--index" && i + 1 < argc) {
+            while (i + 1 < argc && std::strncmp(argv[i + 1], "--", 2) != 0) index_inputs.push_back(argv[++i]);
+        }
+        else if (a == "--no-index") g_opts.index = false;
+        else if (a == "--archive") g_opts.archive = true;
+        else if (a == "--zst-level" && i + 1 < argc) g_opts.zst_level = std::atoi(argv[++i]);
+        else if (a == "--threads" && i + 1 < argc) g_opts.raw_threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (a == "--journal") g_opts.journal = true;
+        else if (a == "--writer" && i + 1 < argc) {
+            std::string w = argv[++i];
+            if (w == "mmap") g_opts.writer = WriterBackend::MMAP;
+            else if (w == "uring") g_opts.writer = WriterBackend::URING;
+            else if (w == "ofstream") g_opts.writer = WriterBackend::OFSTREAM;
+            else { std::cerr << "--writer deve ser ofstream, mmap ou uring" << std::endl; return 2; }
+        }
+        else if (a == "--prealloc-mb" && i + 1 < argc) g_opts.prealloc_mb = std::strtoul(argv[++i], nullptr, 10);
+        else if (a == "--msync-ms" && i + 1 < argc) g_opts.msync_ms = std::atoi(argv[++i]);
+        else if (a == "--host" && i + 1 < argc) g_opts.host = argv[++i];
+        else if (a == "--port" && i + 1 < argc) g_opts.port = argv[++i];
+        else if (a == "--stats") g_opts.stats = true;
+        else if (a == "--once") g_opts.once = true;
+        else if (a == "--ignore-hours") g_opts.ignore_hours = true;
+        else if (a == "--out-dir" && i + 1 < argc) g_opts.out_dir = argv[++i];
+        else if (a == "--kernel-ts") g_opts.kernel_ts = true;
+        else if (a == "--stall-ms" && i + 1 < argc) g_opts.stall_ms = std::atoi(argv[++i]);
+        else if (a == "--stall-hours" && i + 1 < argc) {
+            int h1, m1, h2, m2;
+            if (std::sscanf(argv[++i], "%d:%d-%d:%d", &h1, &m1, &h2, &m2) != 4) {
+                std::cerr << "--stall-hours espera HH:MM-HH:MM" << std::endl;
+                return 2;
+            }
+            g_opts.stall_from_sec = h1 * 3600 + m1 * 60;
+            g_opts.stall_to_sec = h2 * 3600 + m2 * 60;
+        }
+        else if (a == "--backoff-min-ms" && i + 1 < argc) g_opts.backoff_min_ms = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (a == "--backoff-max-ms" && i + 1 < argc) g_opts.backoff_max_ms = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (a == "--host2" && i + 1 < argc) g_opts.host2 = argv[++i];
+        else if (a == "--port2" && i + 1 < argc) g_opts.port2 = argv[++i];
+        else if (a == "--user2" && i + 1 < argc) g_opts.user2 = argv[++i];
+        else if (a == "--pass2" && i + 1 < argc) g_opts.pass2 = argv[++i];
+        else if (a == "--shm" && i + 1 < argc) g_opts.shm = argv[++i];
+        else if (a == "--universe" && i + 1 < argc) g_opts.universe = argv[++i];
+        else if (a == "--sessions" && i + 1 < argc) g_opts.sessions = std::atoi(argv[++i]);
+        else if (a == "--cpus" && i + 1 < argc) {
+            std::stringstream ss(argv[++i]);
+            std::string cpu;
+            while (std::getline(ss, cpu, ',')) {
+                if (!cpu.empty()) g_opts.cpus.push_back(std::atoi(cpu.c_str()));
+            }
+        }
+        else {
+            std::cerr << "Uso: " << argv[0] << " [--journal] [--writer ofstream|mmap|uring] [--prealloc-mb N] [--msync-ms N]\n"
+                      << "       " << std::string(std::strlen(argv[0]), ' ') << " [--host H] [--port P] [--stats] [--once] [--ignore-hours] [--out-dir D] [--kernel-ts]\n"
+                      << "       " << std::string(std::strlen(argv[0]), ' ') << " [--stall-ms N] [--stall-hours 09:00-18:20] [--backoff-min-ms N] [--backoff-max-ms N] [--host2 H [--port2 P] [--user2 U --pass2 S]] [--shm NOME]\n"
+                      << "       " << std::string(std::strlen(argv[0]), ' ') << " [--universe ARQ] [--sessions N] [--cpus 2,3,...] [--archive [--zst-level N]] [--no-index]\n"
+                      << "       " << argv[0] << " --raw <YYYYMMDD_raw_data.txt[.zst]> [...] [--threads N] [--out-dir D]\n"
+                      << "       " << argv[0] << " --compress <arquivo> [...] [--threads N] [--zst-level N]\n"
+                      << "       " << argv[0] << " --index <YYYYMMDD_T.txt[.zst]> [...]" << std::endl;
+            return 2;
+        }
+    }
+    if (!raw_inputs.empty()) {
+        process_raw_files(raw_inputs);
         return 0;
     }
+    if (!compress_inputs.empty()) return compress_files(compress_inputs);
+    if (!index_inputs.empty()) return index_files(index_inputs);
+    if (g_opts.archive) {
+        g_archiver.reset(new DayArchiver(get_output_dir(), g_opts.zst_level));
+    }
 
+    if (g_opts.once) {
+        connect_and_listen();
+        return 0;
+    }
     while (true) {
         try {
             connect_and_listen();
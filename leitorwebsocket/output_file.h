@@ -0,0 +1,587 @@
+// output_file.h - backends de gravação dos arquivos do dia do coletor.
+//
+//  - OfstreamOutput: o comportamento original (ofstream em append + flush por lote).
+//  - MmapOutput: fallocate do arquivo até o tamanho esperado, mmap e memcpy no
+//    mapeamento; o fim dos dados fica no sidecar "<arquivo>.tail" (ver
+//    parsers/cedro_mmap_tail.h) e o msync(MS_ASYNC) roda na cadência do
+//    gravador, não a cada lote. No fechamento o arquivo é truncado em tail.
+//  - UringOutput: os lotes de todos os arquivos de uma janela de flush viram
+//    SQEs IORING_OP_WRITE_FIXED encadeados (IOSQE_IO_LINK) num único anel, e um
+//    io_uring_enter submete a janela inteira (UringContext::submit()). Syscalls
+//    diretas, sem liburing.
+//
+// Selecionado por leitorwebsocket --writer ofstream|mmap|uring.
+#ifndef OUTPUT_FILE_H
+#define OUTPUT_FILE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "cedro_mmap_tail.h"
+
+class OutputFile {
+public:
+    virtual ~OutputFile() {}
+    virtual bool open(const std::string& path) = 0;
+    virtual bool is_open() const = 0;
+    // Acrescenta no fim; retorna false se não gravou (o lote deve ser mantido)
+    virtual bool append(const char* data, size_t len) = 0;
+    // Chamado na cadência de sync do gravador
+    virtual void sync() {}
+    virtual void close() = 0;
+};
+
+class OfstreamOutput : public OutputFile {
+public:
+    bool open(const std::string& path) override {
+        file_.open(path, std::ios::app | std::ios::binary);
+        return file_.is_open();
+    }
+    bool is_open() const override { return file_.is_open(); }
+    bool append(const char* data, size_t len) override {
+        file_.write(data, static_cast<std::streamsize>(len));
+        file_.flush();
+        return !file_.fail();
+    }
+    void close() override {
+        if (file_.is_open()) file_.close();
+    }
+
+private:
+    std::ofstream file_;
+};
+
+class MmapOutput : public OutputFile {
+public:
+    explicit MmapOutput(size_t prealloc_bytes) : prealloc_(prealloc_bytes < 65536 ? 65536 : prealloc_bytes) {}
+    ~MmapOutput() override { close(); }
+
+    bool open(const std::string& path) override {
+        close();
+        path_ = path;
+        tail_ = 0;
+
+        // Sidecar primeiro: quem vê o arquivo de dados já encontra o .tail
+        char side_path[4096];
+        if (!cmt_sidecar_path(path.c_str(), side_path, sizeof(side_path))) return false;
+        side_fd_ = ::open(side_path, O_RDWR | O_CREAT, 0644);
+        if (side_fd_ < 0) return fail("open sidecar");
+        struct stat sst;
+        if (fstat(side_fd_, &sst) != 0) return fail("fstat sidecar");
+        const bool side_new = sst.st_size < static_cast<off_t>(sizeof(CmtHeader));
+        if (sst.st_size < CMT_FILE_SIZE && ftruncate(side_fd_, CMT_FILE_SIZE) != 0) return fail("ftruncate sidecar");
+        void* sp = mmap(nullptr, CMT_FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, side_fd_, 0);
+        if (sp == MAP_FAILED) return fail("mmap sidecar");
+        side_ = static_cast<CmtHeader*>(sp);
+
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd_ < 0) return fail("open");
+        struct stat st;
+        if (fstat(fd_, &st) != 0) return fail("fstat");
+        const uint64_t file_size = static_cast<uint64_t>(st.st_size);
+
+        // Retomada no mesmo dia: vale o tail publicado; arquivo sem sidecar
+        // (gravado pelo backend ofstream) continua do tamanho atual.
+        if (side_new || std::memcmp(side_->magic, CMT_MAGIC, 8) != 0) {
+            tail_ = file_size;
+        } else {
+            tail_ = cmt_load_tail(side_);
+            if (tail_ > file_size) tail_ = file_size;
+        }
+        synced_ = tail_;
+
+        size_t cap = prealloc_;
+        while (cap < tail_ + prealloc_ / 4) cap *= 2;
+        if (!map(cap)) return false;
+
+        std::memcpy(side_->magic, CMT_MAGIC, 8);
+        side_->capacity = cap_;
+        cmt_store_tail(side_, tail_);
+        return true;
+    }
+
+    bool is_open() const override { return base_ != nullptr; }
+
+    bool append(const char* data, size_t len) override {
+        if (!base_) return false;
+        if (tail_ + len > cap_) {
+            size_t cap = cap_;
+            while (tail_ + len > cap) cap *= 2;
+            if (!map(cap)) return false;
+            side_->capacity = cap_;
+        }
+        std::memcpy(base_ + tail_, data, len);
+        tail_ += len;
+        cmt_store_tail(side_, tail_);
+        return true;
+    }
+
+    void sync() override {
+        if (!base_ || tail_ == synced_) return;
+        // msync exige início alinhado à página
+        const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const size_t from = (synced_ / page) * page;
+        msync(base_ + from, tail_ - from, MS_ASYNC);
+        msync(side_, CMT_FILE_SIZE, MS_ASYNC);
+        synced_ = tail_;
+    }
+
+    void close() override {
+        const bool mapped = base_ != nullptr;
+        if (base_) {
+            msync(base_, tail_, MS_SYNC);
+            munmap(base_, cap_);
+            base_ = nullptr;
+        }
+        if (fd_ >= 0) {
+            // Fora do coletor o arquivo volta a ter só os dados
+            if (mapped && ftruncate(fd_, static_cast<off_t>(tail_)) != 0) {
+                std::cerr << "Erro ao truncar " << path_ << ": " << std::strerror(errno) << std::endl;
+            }
+            ::close(fd_);
+            fd_ = -1;
+        }
+        if (side_ && mapped) {
+            cmt_store_tail(side_, tail_);
+            side_->capacity = tail_;
+            msync(side_, CMT_FILE_SIZE, MS_SYNC);
+        }
+        if (side_) {
+            munmap(side_, CMT_FILE_SIZE);
+            side_ = nullptr;
+        }
+        if (side_fd_ >= 0) {
+            ::close(side_fd_);
+            side_fd_ = -1;
+        }
+        cap_ = 0;
+    }
+
+private:
+    bool map(size_t cap) {
+        int rc = posix_fallocate(fd_, 0, static_cast<off_t>(cap));
+        if (rc != 0) {
+            errno = rc;
+            return fail("fallocate");
+        }
+        if (base_) {
+            munmap(base_, cap_);
+            base_ = nullptr;
+        }
+        void* p = mmap(nullptr, cap, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (p == MAP_FAILED) return fail("mmap");
+        base_ = static_cast<char*>(p);
+        cap_ = cap;
+        return true;
+    }
+
+    bool fail(const char* what) {
+        std::cerr << "Erro no backend mmap (" << what << ") " << path_ << ": " << std::strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+
+    std::string path_;
+    size_t prealloc_;
+    int fd_ = -1;
+    int side_fd_ = -1;
+    char* base_ = nullptr;
+    CmtHeader* side_ = nullptr;
+    size_t cap_ = 0;
+    uint64_t tail_ = 0;
+    uint64_t synced_ = 0;
+};
+
+// ---------- io_uring ----------
+
+// Anel compartilhado pelos arquivos do dia. Cada arquivo tem um slot fixo:
+// um descritor registrado (IORING_REGISTER_FILES) e duas metades de um buffer
+// registrado (IORING_REGISTER_BUFFERS). append() copia o lote para a metade
+// corrente e prepara o SQE; submit() publica a janela num io_uring_enter sem
+// esperar. Só quando a metade corrente enche é que se espera a outra esvaziar
+// para trocar, então o gravador não dorme a cada flush.
+class UringContext {
+public:
+    static const unsigned kSlots = 8;
+    static const unsigned kEntries = 256;  // SQEs do anel e escritas por metade (CQ = 2x)
+
+    explicit UringContext(size_t half_bytes) : half_(half_bytes < 65536 ? 65536 : half_bytes) {}
+    ~UringContext() { shutdown(); }
+
+    bool init() {
+        io_uring_params p;
+        std::memset(&p, 0, sizeof(p));
+        ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, kEntries, &p));
+        if (ring_fd_ < 0) return fail("io_uring_setup");
+
+        sq_sz_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_sz_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        single_mmap_ = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap_) sq_sz_ = cq_sz_ = std::max(sq_sz_, cq_sz_);
+        void* sq = mmap(nullptr, sq_sz_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+        if (sq == MAP_FAILED) return fail("mmap sq");
+        sq_ptr_ = static_cast<char*>(sq);
+        if (single_mmap_) {
+            cq_ptr_ = sq_ptr_;
+        } else {
+            void* cq = mmap(nullptr, cq_sz_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+            if (cq == MAP_FAILED) return fail("mmap cq");
+            cq_ptr_ = static_cast<char*>(cq);
+        }
+        sqes_sz_ = p.sq_entries * sizeof(io_uring_sqe);
+        void* se = mmap(nullptr, sqes_sz_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+        if (se == MAP_FAILED) return fail("mmap sqes");
+        sqes_ = static_cast<io_uring_sqe*>(se);
+
+        sq_head_ = reinterpret_cast<unsigned*>(sq_ptr_ + p.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq_ptr_ + p.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq_ptr_ + p.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq_ptr_ + p.sq_off.array);
+        cq_head_ = reinterpret_cast<unsigned*>(cq_ptr_ + p.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq_ptr_ + p.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq_ptr_ + p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq_ptr_ + p.cq_off.cqes);
+        local_tail_ = *sq_tail_;
+
+        // Tabela esparsa de descritores; cada arquivo ocupa um slot ao abrir
+        int fds[kSlots];
+        for (unsigned i = 0; i < kSlots; i++) fds[i] = -1;
+        if (syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_FILES, fds, kSlots) < 0) return fail("register files");
+
+        // Buffers fixos: kSlots x 2 metades numa arena só. Se o RLIMIT_MEMLOCK
+        // não deixar registrar, cai para IORING_OP_WRITE com o mesmo buffer.
+        arena_sz_ = static_cast<size_t>(kSlots) * 2 * half_;
+        void* ar = mmap(nullptr, arena_sz_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ar == MAP_FAILED) return fail("mmap arena");
+        arena_ = static_cast<char*>(ar);
+        iovec iov;
+        iov.iov_base = arena_;
+        iov.iov_len = arena_sz_;
+        fixed_bufs_ = syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_BUFFERS, &iov, 1) == 0;
+        if (!fixed_bufs_) {
+            std::cerr << "io_uring: buffers não registrados (" << std::strerror(errno) << "); usando IORING_OP_WRITE" << std::endl;
+        }
+        return true;
+    }
+
+    bool ok() const { return ring_fd_ >= 0 && arena_ != nullptr; }
+
+    int claim_slot() {
+        for (unsigned i = 0; i < kSlots; i++) {
+            if (!slot_used_[i]) { slot_used_[i] = true; return static_cast<int>(i); }
+        }
+        return -1;
+    }
+
+    void release_slot(int slot) {
+        if (slot >= 0) slot_used_[slot] = false;
+    }
+
+    bool set_fd(int slot, int fd) {
+        io_uring_files_update up;
+        std::memset(&up, 0, sizeof(up));
+        up.offset = static_cast<unsigned>(slot);
+        up.fds = reinterpret_cast<uint64_t>(&fd);
+        return syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_FILES_UPDATE, &up, 1) >= 0;
+    }
+
+    // Enfileira a escrita de len bytes em off, copiando para a metade corrente
+    // do slot. Se a metade encheu, troca para a outra (esperando as escritas
+    // que ainda a usam). Retorna false se não cabe nem assim: o chamador faz
+    // drain() e grava síncrono.
+    bool queue_write(int slot, int fd, const char* data, size_t len, uint64_t off) {
+        if (used_[slot][cur_] + len > half_ || n_ops_[cur_] >= kEntries) {
+            rotate();
+            if (used_[slot][cur_] + len > half_ || n_ops_[cur_] >= kEntries) return false;
+        }
+        size_t& used = used_[slot][cur_];
+        char* buf = arena_ + (static_cast<size_t>(slot) * 2 + cur_) * half_ + used;
+        std::memcpy(buf, data, len);
+        used += len;
+
+        const unsigned op_idx = cur_ * kEntries + n_ops_[cur_]++;
+        Op& op = ops_[op_idx];
+        op.fd = fd;
+        op.buf = buf;
+        op.len = len;
+        op.off = off;
+
+        const unsigned idx = local_tail_ & sq_mask_;
+        io_uring_sqe* sqe = &sqes_[idx];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = fixed_bufs_ ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        sqe->flags = IOSQE_FIXED_FILE;
+        sqe->fd = slot;
+        sqe->addr = reinterpret_cast<uint64_t>(buf);
+        sqe->len = static_cast<unsigned>(len);
+        sqe->off = off;
+        sqe->user_data = op_idx;
+        // Encadeia com o SQE anterior da janela; o último fica sem IO_LINK
+        if (last_sqe_) last_sqe_->flags |= IOSQE_IO_LINK;
+        last_sqe_ = sqe;
+        sq_array_[idx] = idx;
+        local_tail_++;
+        pending_[cur_]++;
+        return true;
+    }
+
+    // Fecha a janela: publica os SQEs num único io_uring_enter, sem esperar.
+    // As conclusões são colhidas aqui e na troca de metade.
+    void submit() {
+        unsigned to_submit = local_tail_ - *sq_tail_;
+        if (to_submit > 0) {
+            __atomic_store_n(sq_tail_, local_tail_, __ATOMIC_RELEASE);
+            last_sqe_ = nullptr;
+            while (to_submit > 0) {
+                int rc = enter(to_submit, 0);
+                if (rc < 0) {
+                    if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                        if (enter(0, 1) < 0 && errno != EINTR) break;
+                        reap();
+                        continue;
+                    }
+                    std::cerr << "io_uring_enter: " << std::strerror(errno) << std::endl;
+                    break;
+                }
+                to_submit -= std::min(to_submit, static_cast<unsigned>(rc));
+            }
+        }
+        reap();
+    }
+
+    // Espera tudo que está em voo (antes de fechar um arquivo ou gravar síncrono)
+    void drain() {
+        submit();
+        wait_half(0);
+        wait_half(1);
+        for (unsigned s = 0; s < kSlots; s++) used_[s][0] = used_[s][1] = 0;
+        n_ops_[0] = n_ops_[1] = 0;
+    }
+
+    unsigned long long enters() const { return enters_; }
+
+    void shutdown() {
+        if (ring_fd_ >= 0) {
+            if (sqes_) drain();
+            if (sqes_) munmap(sqes_, sqes_sz_);
+            if (cq_ptr_ && !single_mmap_) munmap(cq_ptr_, cq_sz_);
+            if (sq_ptr_) munmap(sq_ptr_, sq_sz_);
+            ::close(ring_fd_);
+            ring_fd_ = -1;
+        }
+        if (arena_) {
+            munmap(arena_, arena_sz_);
+            arena_ = nullptr;
+        }
+        sqes_ = nullptr;
+        sq_ptr_ = cq_ptr_ = nullptr;
+    }
+
+private:
+    struct Op {
+        int fd = -1;
+        const char* buf = nullptr;
+        size_t len = 0;
+        uint64_t off = 0;
+    };
+
+    // Submete o que está na metade corrente e passa para a outra, depois que
+    // as escritas que ainda usam a outra terminaram.
+    void rotate() {
+        const unsigned next = cur_ ^ 1;
+        submit();
+        wait_half(next);
+        for (unsigned s = 0; s < kSlots; s++) used_[s][next] = 0;
+        n_ops_[next] = 0;
+        cur_ = next;
+    }
+
+    void wait_half(unsigned half) {
+        while (pending_[half] > 0) {
+            if (enter(0, 1) < 0 && errno != EINTR) {
+                std::cerr << "io_uring_enter: " << std::strerror(errno) << std::endl;
+                break;
+            }
+            reap();
+        }
+    }
+
+    int enter(unsigned to_submit, unsigned min_complete) {
+        enters_++;
+        return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete,
+                                        min_complete ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0));
+    }
+
+    // Consome os CQEs. Escrita curta, com erro ou cancelada pelo link é
+    // completada com pwrite: o buffer da metade só é reusado depois daqui.
+    void reap() {
+        unsigned head = *cq_head_;
+        const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+            const unsigned op_idx = static_cast<unsigned>(cqe.user_data);
+            const Op& op = ops_[op_idx];
+            if (cqe.res < 0 || static_cast<size_t>(cqe.res) < op.len) {
+                size_t done = cqe.res > 0 ? static_cast<size_t>(cqe.res) : 0;
+                if (cqe.res < 0 && cqe.res != -ECANCELED) {
+                    std::cerr << "io_uring write: " << std::strerror(-cqe.res) << "; regravando com pwrite" << std::endl;
+                }
+                while (done < op.len) {
+                    ssize_t w = pwrite(op.fd, op.buf + done, op.len - done, static_cast<off_t>(op.off + done));
+                    if (w <= 0) {
+                        if (w < 0 && errno == EINTR) continue;
+                        std::cerr << "pwrite: " << std::strerror(errno) << std::endl;
+                        break;
+                    }
+                    done += static_cast<size_t>(w);
+                }
+            }
+            unsigned& pend = pending_[op_idx / kEntries];
+            if (pend > 0) pend--;
+            head++;
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+
+    bool fail(const char* what) {
+        std::cerr << "Erro no backend io_uring (" << what << "): " << std::strerror(errno) << std::endl;
+        shutdown();
+        return false;
+    }
+
+    size_t half_;
+    int ring_fd_ = -1;
+    bool single_mmap_ = false;
+    char* sq_ptr_ = nullptr;
+    char* cq_ptr_ = nullptr;
+    size_t sq_sz_ = 0, cq_sz_ = 0, sqes_sz_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned local_tail_ = 0;
+    io_uring_sqe* last_sqe_ = nullptr;
+
+    char* arena_ = nullptr;
+    size_t arena_sz_ = 0;
+    bool fixed_bufs_ = false;
+    bool slot_used_[kSlots] = {};
+    size_t used_[kSlots][2] = {};
+    unsigned cur_ = 0;               // metade sendo preenchida
+    unsigned pending_[2] = {0, 0};   // escritas em voo por metade
+    unsigned n_ops_[2] = {0, 0};
+    Op ops_[2 * kEntries];           // user_data = índice aqui
+    unsigned long long enters_ = 0;
+};
+
+// Arquivo gravado pelo anel: offset explícito (sem O_APPEND), lote copiado para
+// o buffer registrado do slot. O gravador chama UringContext::submit() ao fim
+// de cada flush_all; a escrita está no page cache quando o CQE volta (no
+// máximo na próxima troca de metade ou no close()).
+class UringOutput : public OutputFile {
+public:
+    explicit UringOutput(UringContext* ctx) : ctx_(ctx) {}
+    ~UringOutput() override { close(); }
+
+    bool open(const std::string& path) override {
+        close();
+        slot_ = ctx_ ? ctx_->claim_slot() : -1;
+        if (slot_ < 0) {
+            std::cerr << "io_uring: sem slot livre para " << path << std::endl;
+            return false;
+        }
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ < 0) return fail("open", path);
+        struct stat st;
+        if (fstat(fd_, &st) != 0) return fail("fstat", path);
+        off_ = static_cast<uint64_t>(st.st_size);
+        if (!ctx_->set_fd(slot_, fd_)) return fail("register fd", path);
+        path_ = path;
+        return true;
+    }
+
+    bool is_open() const override { return fd_ >= 0; }
+
+    bool append(const char* data, size_t len) override {
+        if (fd_ < 0) return false;
+        if (len == 0) return true;
+        if (!ctx_->queue_write(slot_, fd_, data, len, off_)) {
+            // Lote maior que a metade do buffer (ou janela cheia): grava direto
+            ctx_->drain();
+            size_t done = 0;
+            while (done < len) {
+                ssize_t w = pwrite(fd_, data + done, len - done, static_cast<off_t>(off_ + done));
+                if (w < 0 && errno == EINTR) continue;
+                if (w <= 0) {
+                    std::cerr << "pwrite " << path_ << ": " << std::strerror(errno) << std::endl;
+                    off_ += done;
+                    return false;
+                }
+                done += static_cast<size_t>(w);
+            }
+        }
+        off_ += len;
+        return true;
+    }
+
+    void close() override {
+        if (fd_ >= 0) {
+            ctx_->drain();
+            ctx_->set_fd(slot_, -1);
+            ::close(fd_);
+            fd_ = -1;
+        }
+        if (slot_ >= 0) {
+            ctx_->release_slot(slot_);
+            slot_ = -1;
+        }
+    }
+
+private:
+    bool fail(const char* what, const std::string& path) {
+        std::cerr << "Erro no backend io_uring (" << what << " " << path << "): " << std::strerror(errno) << std::endl;
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+        ctx_->release_slot(slot_);
+        slot_ = -1;
+        return false;
+    }
+
+    UringContext* ctx_;
+    int slot_ = -1;
+    int fd_ = -1;
+    uint64_t off_ = 0;
+    std::string path_;
+};
+
+enum class WriterBackend { OFSTREAM, MMAP, URING };
+
+// uring: ctx é do gravador e precisa viver mais que os arquivos (sem ctx, ofstream)
+inline std::unique_ptr<OutputFile> make_output_file(WriterBackend backend, size_t prealloc_bytes,
+                                                    UringContext* ctx = nullptr) {
+    if (backend == WriterBackend::MMAP) return std::unique_ptr<OutputFile>(new MmapOutput(prealloc_bytes));
+    if (backend == WriterBackend::URING && ctx) return std::unique_ptr<OutputFile>(new UringOutput(ctx));
+    return std::unique_ptr<OutputFile>(new OfstreamOutput());
+}
+
+#endif
@@ -0,0 +1,351 @@
+// raw_rebuild.h - leitorwebsocket --raw: regera os arquivos por tipo a partir do _raw_data.txt.
+//
+// Cada arquivo raw é mapeado (mmap) e cortado em blocos de ~32 MB alinhados
+// em '\n'. Um pool de threads pega os blocos de todos os arquivos na ordem
+// (arquivo 1 bloco 0, 1, ..., arquivo 2 bloco 0, ...) e separa as linhas de
+// cada bloco em buffers B/V/T/Z por data. Os buffers vão para a saída na
+// ordem dos blocos, em write() grandes, por uma thread de cada vez por arquivo
+// raw (as outras seguem classificando), então a saída é idêntica à da versão
+// sequencial. Com vários dias, cada núcleo acaba
+// trabalhando num dia diferente; com um dia só, os blocos dele se dividem.
+//
+// Dia arquivado (_raw_data.txt.zst, cedro_zst.h): cada frame do .zst é um
+// bloco (já termina em '\n') e a thread que o pega descomprime antes de
+// classificar; "X_raw_data.txt" sem o texto no disco cai no .zst.
+//
+// Mesmas regras do process_raw_file antigo: linha vazia e sem os três campos
+// "ts,len,delta," é ignorada, '\r' final sai, a data são os 8 primeiros
+// caracteres do ts, o arquivo de saída é truncado na primeira linha e o
+// marcador de lacuna (cedro_gap.h) vai para os quatro tipos.
+#ifndef RAW_REBUILD_H
+#define RAW_REBUILD_H
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cedro_gap.h"
+#include "cedro_zst.h"
+#include "record_format.h"
+
+class RawRebuilder {
+public:
+    static const size_t kChunkBytes = 32u << 20;
+
+    RawRebuilder(std::string out_dir, unsigned threads)
+        : out_dir_(std::move(out_dir)), threads_(threads ? threads : 1) {}
+
+    ~RawRebuilder() {
+        for (auto& kv : outputs_) {
+            if (kv.second >= 0) ::close(kv.second);
+        }
+        for (auto& in : inputs_) {
+            if (in->base) munmap(in->base, in->size);
+            if (in->zst) cz_index_close(&in->zix);
+        }
+    }
+
+    // Mapeia o arquivo e corta os blocos; false se não abriu
+    bool add_input(const std::string& path) {
+        if (cz_has_suffix(path.c_str())) return add_zst_input(path);
+        if (::access(path.c_str(), F_OK) != 0 && ::access((path + ".zst").c_str(), F_OK) == 0) {
+            return add_zst_input(path + ".zst");
+        }
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "Erro: Nao foi possivel abrir o arquivo raw: " << path << std::endl;
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            return false;
+        }
+        auto in = std::make_unique<Input>();
+        in->path = path;
+        in->size = static_cast<size_t>(st.st_size);
+        if (in->size > 0) {
+            void* p = mmap(nullptr, in->size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                std::cerr << "Erro: mmap de " << path << ": " << std::strerror(errno) << std::endl;
+                ::close(fd);
+                return false;
+            }
+            in->base = static_cast<char*>(p);
+            madvise(p, in->size, MADV_SEQUENTIAL);
+        }
+        ::close(fd);
+
+        // Blocos terminam logo depois de um '\n' (o último, no fim do arquivo)
+        size_t pos = 0;
+        while (pos < in->size) {
+            size_t end = pos + kChunkBytes;
+            if (end >= in->size) {
+                end = in->size;
+            } else {
+                const void* nl = std::memchr(in->base + end, '\n', in->size - end);
+                end = nl ? static_cast<size_t>(static_cast<const char*>(nl) - in->base) + 1 : in->size;
+            }
+            in->chunks.push_back(Chunk{pos, end, {}, {}, false});
+            pos = end;
+        }
+        for (size_t c = 0; c < in->chunks.size(); c++) tasks_.push_back(Task{inputs_.size(), c});
+        inputs_.push_back(std::move(in));
+        return true;
+    }
+
+    // .zst: um bloco por frame, descomprimido na thread que classifica
+    bool add_zst_input(const std::string& path) {
+        auto in = std::make_unique<Input>();
+        if (cz_index_open(&in->zix, path.c_str()) != 0) {
+            std::cerr << "Erro: Nao foi possivel abrir o arquivo raw: " << path << " (" << std::strerror(errno) << ")"
+                      << std::endl;
+            return false;
+        }
+        in->zst = true;
+        in->path = path;
+        in->size = in->zix.d_total;
+        for (int f = 0; f < in->zix.nframes; f++) {
+            in->chunks.push_back(Chunk{static_cast<size_t>(f), static_cast<size_t>(f) + 1, {}, {}, false});
+        }
+        for (size_t c = 0; c < in->chunks.size(); c++) tasks_.push_back(Task{inputs_.size(), c});
+        inputs_.push_back(std::move(in));
+        return true;
+    }
+
+    // Processa tudo; retorna o total de linhas classificadas
+    long long run() {
+        const auto t0 = std::chrono::steady_clock::now();
+        const unsigned n = threads_ < tasks_.size() ? threads_ : static_cast<unsigned>(tasks_.size());
+        std::vector<std::thread> pool;
+        for (unsigned i = 1; i < n; i++) pool.emplace_back([this]() { work(); });
+        work();
+        for (auto& t : pool) t.join();
+        const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+        long long total = 0;
+        double mb = 0;
+        for (const auto& in : inputs_) {
+            std::cout << "Concluido " << in->path << ": " << in->lines << " linhas" << std::endl;
+            total += in->lines;
+            mb += in->size / 1e6;
+        }
+        char buf[160];
+        std::snprintf(buf, sizeof(buf), "Total: %lld linhas, %.1f MB em %.2fs (%.0f MB/s, %u threads)",
+                      total, mb, secs, secs > 0 ? mb / secs : 0.0, n ? n : 1);
+        std::cout << buf << std::endl;
+        return total;
+    }
+
+private:
+    static const int kTypes = 4;   // B, V, T, Z
+
+    // Saída de um bloco para uma data: um buffer por tipo
+    struct DayOut {
+        char date[9];
+        std::string buf[kTypes];
+    };
+
+    struct Chunk {
+        size_t begin, end;       // offsets no arquivo; no .zst, frame begin
+        std::vector<DayOut> days;
+        long long lines;
+        bool done;
+    };
+
+    struct Input {
+        std::string path;
+        char* base = nullptr;
+        size_t size = 0;         // no .zst, o tamanho descomprimido
+        bool zst = false;
+        CzIndex zix;
+        std::vector<Chunk> chunks;
+        std::mutex mu;           // done, next_write e writing
+        size_t next_write = 0;   // próximo bloco a gravar
+        bool writing = false;    // alguma thread está gravando este arquivo
+        long long lines = 0;
+    };
+
+    struct Task {
+        size_t input, chunk;
+    };
+
+    static int type_slot(char t) {
+        switch (t) {
+            case 'B': return 0;
+            case 'V': return 1;
+            case 'T': return 2;
+            default: return 3;
+        }
+    }
+
+    void work() {
+        ZSTD_DCtx* dctx = nullptr;
+        char* zsrc = nullptr;
+        size_t zsrc_cap = 0;
+        std::string frame;
+        for (;;) {
+            const size_t t = next_task_.fetch_add(1, std::memory_order_relaxed);
+            if (t >= tasks_.size()) break;
+            Input& in = *inputs_[tasks_[t].input];
+            Chunk& c = in.chunks[tasks_[t].chunk];
+            if (in.zst) {
+                const int f = static_cast<int>(c.begin);
+                if (!dctx) dctx = ZSTD_createDCtx();
+                frame.resize(in.zix.frames[f].d_size);
+                if (!dctx || cz_read_frame(&in.zix, f, dctx, &zsrc, &zsrc_cap, &frame[0]) != 0) {
+                    std::cerr << "Erro: frame " << f << " de " << in.path << " ilegivel" << std::endl;
+                    frame.clear();
+                }
+                classify(frame.data(), frame.data() + frame.size(), c);
+            } else {
+                classify(in.base + c.begin, in.base + c.end, c);
+            }
+
+            // Só uma thread grava cada arquivo: ela leva este e os seguintes
+            // que já estiverem prontos, na ordem; as outras voltam a classificar
+            {
+                std::lock_guard<std::mutex> lock(in.mu);
+                c.done = true;
+                if (in.writing) continue;
+                in.writing = true;
+            }
+            for (;;) {
+                Chunk* w;
+                {
+                    std::lock_guard<std::mutex> lock(in.mu);
+                    if (in.next_write == in.chunks.size() || !in.chunks[in.next_write].done) {
+                        in.writing = false;
+                        break;
+                    }
+                    w = &in.chunks[in.next_write++];
+                }
+                write_chunk(*w);
+                in.lines += w->lines;
+                std::vector<DayOut>().swap(w->days);
+            }
+        }
+        ZSTD_freeDCtx(dctx);
+        std::free(zsrc);
+    }
+
+    static DayOut& day_of(std::vector<DayOut>& days, const char* date) {
+        // Quase sempre uma data por arquivo: a última usada está no fim
+        for (size_t i = days.size(); i-- > 0;) {
+            if (std::memcmp(days[i].date, date, 8) == 0) return days[i];
+        }
+        days.emplace_back();
+        DayOut& d = days.back();
+        std::memcpy(d.date, date, 8);
+        d.date[8] = '\0';
+        return d;
+    }
+
+    static void classify(const char* p, const char* const end, Chunk& c) {
+        DayOut* day = nullptr;
+        long long lines = 0;
+        while (p < end) {
+            const char* nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+            const char* eol = nl ? nl : end;
+            std::string_view line(p, static_cast<size_t>(eol - p));
+            p = nl ? nl + 1 : end;
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (line.empty()) continue;
+
+            // Format: ts,len,delta,content
+            const size_t p1 = line.find(',');
+            if (p1 == std::string_view::npos || p1 < 8) continue;
+            const size_t p2 = line.find(',', p1 + 1);
+            if (p2 == std::string_view::npos) continue;
+            const size_t p3 = line.find(',', p2 + 1);
+            if (p3 == std::string_view::npos) continue;
+            lines++;
+
+            const std::string_view content = line.substr(p3 + 1);
+            const char type = record_type(content);
+            int gap = CEDRO_GAP_NONE;
+            if (!type) {
+                if (content.size() < 3 || content[0] != 'G') continue;
+                const std::string head(content.substr(0, sizeof(CEDRO_GAP_START)));
+                gap = cedro_gap_kind(head.c_str());
+                if (gap == CEDRO_GAP_NONE) continue;
+            }
+            if (!day || std::memcmp(day->date, line.data(), 8) != 0) day = &day_of(c.days, line.data());
+            if (type) {
+                std::string& b = day->buf[type_slot(type)];
+                b.append(line.data(), line.size());
+                b.push_back('\n');
+            } else {
+                // Marcador de lacuna vai para todos os tipos, como na coleta
+                for (std::string& b : day->buf) {
+                    b.append(line.data(), line.size());
+                    b.push_back('\n');
+                }
+            }
+        }
+        c.lines = lines;
+    }
+
+    void write_chunk(const Chunk& c) {
+        static const char* suffix[kTypes] = {"_B.txt", "_V.txt", "_T.txt", "_Z.txt"};
+        for (const DayOut& d : c.days) {
+            for (int t = 0; t < kTypes; t++) {
+                if (d.buf[t].empty()) continue;
+                const int fd = output(out_dir_ + d.date + suffix[t]);
+                if (fd < 0) continue;
+                write_all(fd, d.buf[t].data(), d.buf[t].size());
+            }
+        }
+    }
+
+    // Descritor do arquivo de saída; truncado na primeira vez nesta execução
+    int output(const std::string& path) {
+        std::lock_guard<std::mutex> lock(outputs_mu_);
+        auto it = outputs_.find(path);
+        if (it != outputs_.end()) return it->second;
+        const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+        if (fd < 0) std::cerr << "Erro ao criar arquivo: " << path << std::endl;
+        else std::cout << "Regerando arquivo: " << path << std::endl;
+        outputs_.emplace(path, fd);
+        return fd;
+    }
+
+    static void write_all(int fd, const char* data, size_t len) {
+        while (len > 0) {
+            const ssize_t n = ::write(fd, data, len);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "Erro de gravacao: " << std::strerror(errno) << std::endl;
+                return;
+            }
+            data += n;
+            len -= static_cast<size_t>(n);
+        }
+    }
+
+    std::string out_dir_;
+    unsigned threads_;
+    std::vector<std::unique_ptr<Input>> inputs_;
+    std::vector<Task> tasks_;
+    std::atomic<size_t> next_task_{0};
+    std::mutex outputs_mu_;
+    std::map<std::string, int> outputs_;
+};
+
+#endif
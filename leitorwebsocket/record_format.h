@@ -0,0 +1,125 @@
+// record_format.h - enquadramento de linhas e formatação dos registros do coletor.
+//
+// Usado pela thread gravadora do leitorwebsocket e pelo bench_framing.
+// Nada aqui aloca por linha: as linhas são string_view sobre o bloco recebido
+// e os registros são acrescentados em buffers que mantêm a capacidade.
+#ifndef RECORD_FORMAT_H
+#define RECORD_FORMAT_H
+
+#include <charconv>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <string_view>
+
+// Prefixo "YYYYMMDD_HHMMSS" em UTC-3, recalculado só quando muda o segundo.
+class TsPrefixCache {
+public:
+    std::string_view get() { return get(std::time(nullptr)); }
+
+    std::string_view get(std::time_t now) {
+        if (now != sec_) {
+            sec_ = now;
+            std::time_t t = now - 3 * 3600; // horário brasileiro (UTC-3)
+            std::tm local_tm;
+#ifdef _WIN32
+            gmtime_s(&local_tm, &t);
+#else
+            gmtime_r(&t, &local_tm);
+#endif
+            std::strftime(buf_, sizeof(buf_), "%Y%m%d_%H%M%S", &local_tm);
+        }
+        return std::string_view(buf_, 15);
+    }
+
+    // YYYYMMDD do último get()
+    std::string_view date() const { return std::string_view(buf_, 8); }
+
+private:
+    std::time_t sec_ = -1;
+    char buf_[20] = {0};
+};
+
+// Separa linhas terminadas em '\n', remove '\r' final e ignora linhas vazias.
+// Linhas inteiras dentro do bloco são entregues direto sobre o bloco; só o
+// pedaço incompleto do fim é copiado para o carry até chegar o resto.
+class LineFramer {
+public:
+    LineFramer() { carry_.reserve(131072); }
+
+    template <typename F>
+    void feed(const char* data, size_t len, F&& on_line) {
+        const char* p = data;
+        const char* end = data + len;
+
+        if (!carry_.empty()) {
+            const char* nl = static_cast<const char*>(std::memchr(p, '\n', len));
+            if (!nl) {
+                append_carry(p, len);
+                return;
+            }
+            carry_.append(p, static_cast<size_t>(nl - p));
+            emit(std::string_view(carry_), on_line);
+            carry_.clear();
+            p = nl + 1;
+        }
+
+        while (p < end) {
+            const char* nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+            if (!nl) break;
+            emit(std::string_view(p, static_cast<size_t>(nl - p)), on_line);
+            p = nl + 1;
+        }
+
+        if (p < end) append_carry(p, static_cast<size_t>(end - p));
+    }
+
+    void reset() { carry_.clear(); }
+    size_t pending() const { return carry_.size(); }
+
+private:
+    template <typename F>
+    static void emit(std::string_view line, F& on_line) {
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty()) return;
+        on_line(line);
+    }
+
+    void append_carry(const char* p, size_t n) {
+        carry_.append(p, n);
+        // Linha sem '\n' gigante: mantém só o fim, como o rx_buffer antigo
+        if (carry_.size() > 1048576) carry_.erase(0, carry_.size() - 65536);
+    }
+
+    std::string carry_;
+};
+
+// Acrescenta "ts,reply_length,delta_ms,line\n" ao fim de out.
+inline void append_record(std::string& out, std::string_view ts,
+                          size_t reply_length, long long delta_ms,
+                          std::string_view line) {
+    char num[48];
+    char* p = num;
+    char* const end = num + sizeof(num);
+    *p++ = ',';
+    p = std::to_chars(p, end - 1, reply_length).ptr;
+    *p++ = ',';
+    p = std::to_chars(p, end - 1, delta_ms).ptr;
+    *p++ = ',';
+
+    out.append(ts.data(), ts.size());
+    out.append(num, static_cast<size_t>(p - num));
+    out.append(line.data(), line.size());
+    out.push_back('\n');
+}
+
+// Tipo do registro pelo prefixo do payload ('B', 'V', 'T', 'Z'), ou 0.
+inline char record_type(std::string_view line) {
+    if (line.size() < 2 || line[1] != ':') return 0;
+    switch (line[0]) {
+        case 'B': case 'V': case 'T': case 'Z': return line[0];
+        default: return 0;
+    }
+}
+
+#endif
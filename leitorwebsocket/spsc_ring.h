@@ -0,0 +1,85 @@
+// spsc_ring.h - fila circular lock-free para um produtor e um consumidor.
+//
+// O produtor escreve direto no slot (try_acquire/publish) e o consumidor lê no
+// próprio slot (front/pop), então nenhum bloco é copiado entre as threads.
+// A capacidade é arredondada para potência de 2.
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity) {
+        size_t cap = 2;
+        while (cap < capacity) cap <<= 1;
+        cap_ = cap;
+        mask_ = cap - 1;
+        slots_.reset(new T[cap]);
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Produtor: slot livre para preencher, ou nullptr se a fila está cheia.
+    T* try_acquire() {
+        size_t h = head_.load(std::memory_order_relaxed);
+        if (h - cached_tail_ >= cap_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (h - cached_tail_ >= cap_) return nullptr;
+        }
+        return &slots_[h & mask_];
+    }
+
+    // Produtor: torna visível ao consumidor o slot obtido em try_acquire().
+    void publish() {
+        size_t h = head_.load(std::memory_order_relaxed) + 1;
+        head_.store(h, std::memory_order_release);
+        size_t occ = h - tail_.load(std::memory_order_relaxed);
+        if (occ > high_water_.load(std::memory_order_relaxed)) {
+            high_water_.store(occ, std::memory_order_relaxed);
+        }
+    }
+
+    // Consumidor: próximo slot publicado, ou nullptr se a fila está vazia.
+    T* front() {
+        size_t t = tail_.load(std::memory_order_relaxed);
+        if (t == cached_head_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (t == cached_head_) return nullptr;
+        }
+        return &slots_[t & mask_];
+    }
+
+    // Consumidor: libera o slot devolvido por front().
+    void pop() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Ocupação aproximada (pode ser lida de qualquer thread).
+    size_t size() const {
+        size_t h = head_.load(std::memory_order_acquire);
+        size_t t = tail_.load(std::memory_order_acquire);
+        return h - t;
+    }
+
+    size_t high_water() const { return high_water_.load(std::memory_order_relaxed); }
+    size_t capacity() const { return cap_; }
+
+private:
+    size_t cap_ = 0;
+    size_t mask_ = 0;
+    std::unique_ptr<T[]> slots_;
+
+    alignas(64) std::atomic<size_t> head_{0};
+    size_t cached_tail_ = 0;                     // só o produtor usa
+    std::atomic<size_t> high_water_{0};
+
+    alignas(64) std::atomic<size_t> tail_{0};
+    size_t cached_head_ = 0;                     // só o consumidor usa
+};
+
+#endif
@@ -0,0 +1,182 @@
+// symbol_universe.h - universo de símbolos do coletor e divisão entre sessões.
+//
+// Arquivo do --universe, uma assinatura por linha:
+//   # comentário
+//   BQT {WIN}
+//   GQT {WIN} S
+//   SQT DI1F27
+//   SAB PETR4 sessao=2   (fixa o símbolo na sessão 2, contando de 0)
+//   BQT VALE3 peso=20    (peso da linha no balanceamento)
+// {WIN} e {WDO} viram o contrato vigente (get_win_contract/get_wdo_contract).
+// Sem --universe vale o conjunto de sempre (builtin()).
+//
+// partition(N) junta as linhas por símbolo (todas as assinaturas de um
+// símbolo ficam na mesma sessão, então um book nunca se divide) e distribui
+// os símbolos do mais pesado para o mais leve, sempre na sessão menos
+// carregada. O peso padrão vem do volume típico de cada tipo num pregão:
+// book (BQT) > book agregado (SAB) > negócios (GQT) > cotação (SQT).
+#ifndef SYMBOL_UNIVERSE_H
+#define SYMBOL_UNIVERSE_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Assinaturas e símbolos de uma sessão
+struct FeedPartition {
+    std::vector<std::string> commands;   // "BQT WINZ26", "GQT WINZ26 S" ...
+    std::vector<std::string> symbols;
+    unsigned weight = 0;
+};
+
+class SymbolUniverse {
+public:
+    // Assinaturas que o coletor sempre fez
+    static SymbolUniverse builtin() {
+        SymbolUniverse u;
+        for (const char* line : {"BQT {WIN}", "BQT {WDO}", "GQT {WIN} S", "GQT {WDO} S", "SQT {WIN}", "SQT {WDO}",
+                                 "SAB {WIN}", "SAB {WDO}", "SQT DI1F27"}) {
+            std::string err;
+            u.add_line(line, 0, err);
+        }
+        return u;
+    }
+
+    // false com err preenchido ("linha 12: ...") se o arquivo não abre ou tem erro
+    bool load(const std::string& path, std::string& err) {
+        std::ifstream in(path);
+        if (!in.is_open()) {
+            err = "nao foi possivel abrir " + path;
+            return false;
+        }
+        entries_.clear();
+        std::string line;
+        int n = 0;
+        while (std::getline(in, line)) {
+            n++;
+            if (!add_line(line, n, err)) return false;
+        }
+        if (entries_.empty()) {
+            err = path + " sem assinaturas";
+            return false;
+        }
+        return true;
+    }
+
+    size_t size() const { return entries_.size(); }
+
+    // Divide em n sessões; sessão fixada além de n-1 cai em (sessao % n)
+    std::vector<FeedPartition> partition(int n, const std::string& win, const std::string& wdo) const {
+        if (n < 1) n = 1;
+        struct Sym {
+            std::string name;
+            std::vector<std::string> commands;
+            unsigned weight = 0;
+            int pinned = -1;
+        };
+        std::vector<Sym> syms;
+        std::map<std::string, size_t> index;
+        for (const Entry& e : entries_) {
+            const std::string sym = expand(e.symbol, win, wdo);
+            auto it = index.find(sym);
+            if (it == index.end()) {
+                it = index.emplace(sym, syms.size()).first;
+                syms.push_back(Sym{sym, {}, 0, -1});
+            }
+            Sym& s = syms[it->second];
+            std::string cmd = e.verb + " " + sym;
+            if (!e.args.empty()) cmd += " " + expand(e.args, win, wdo);
+            s.commands.push_back(cmd);
+            s.weight += e.weight;
+            if (e.session >= 0) s.pinned = e.session % n;
+        }
+
+        std::vector<FeedPartition> parts(static_cast<size_t>(n));
+        auto assign = [&](const Sym& s, int p) {
+            FeedPartition& fp = parts[static_cast<size_t>(p)];
+            fp.commands.insert(fp.commands.end(), s.commands.begin(), s.commands.end());
+            fp.symbols.push_back(s.name);
+            fp.weight += s.weight;
+        };
+        std::vector<const Sym*> free_syms;
+        for (const Sym& s : syms) {
+            if (s.pinned >= 0) assign(s, s.pinned);
+            else free_syms.push_back(&s);
+        }
+        // Mais pesado primeiro; empate pela ordem do arquivo
+        std::stable_sort(free_syms.begin(), free_syms.end(),
+                         [](const Sym* a, const Sym* b) { return a->weight > b->weight; });
+        for (const Sym* s : free_syms) {
+            int best = 0;
+            for (int p = 1; p < n; p++) {
+                if (parts[static_cast<size_t>(p)].weight < parts[static_cast<size_t>(best)].weight) best = p;
+            }
+            assign(*s, best);
+        }
+        return parts;
+    }
+
+private:
+    struct Entry {
+        std::string verb, symbol, args;
+        unsigned weight;
+        int session;
+    };
+
+    static unsigned default_weight(const std::string& verb) {
+        if (verb == "BQT") return 7;
+        if (verb == "SAB") return 6;
+        if (verb == "GQT") return 4;
+        return 3;
+    }
+
+    static std::string expand(std::string s, const std::string& win, const std::string& wdo) {
+        for (const auto& kv : {std::make_pair(std::string("{WIN}"), win), std::make_pair(std::string("{WDO}"), wdo)}) {
+            size_t p;
+            while ((p = s.find(kv.first)) != std::string::npos) s.replace(p, kv.first.size(), kv.second);
+        }
+        return s;
+    }
+
+    bool add_line(const std::string& raw, int n, std::string& err) {
+        std::string line = raw.substr(0, raw.find('#'));
+        std::istringstream ss(line);
+        std::string tok;
+        Entry e{"", "", "", 0, -1};
+        while (ss >> tok) {
+            const size_t eq = tok.find('=');
+            if (eq != std::string::npos) {
+                const std::string key = tok.substr(0, eq);
+                const int val = std::atoi(tok.c_str() + eq + 1);
+                if (key == "sessao" && val >= 0) e.session = val;
+                else if (key == "peso" && val > 0) e.weight = static_cast<unsigned>(val);
+                else {
+                    err = "linha " + std::to_string(n) + ": opcao invalida " + tok;
+                    return false;
+                }
+            } else if (e.verb.empty()) {
+                e.verb = tok;
+            } else if (e.symbol.empty()) {
+                e.symbol = tok;
+            } else {
+                e.args += (e.args.empty() ? "" : " ") + tok;
+            }
+        }
+        if (e.verb.empty()) return true;   // linha vazia ou só comentário
+        if (e.symbol.empty()) {
+            err = "linha " + std::to_string(n) + ": falta o simbolo em " + e.verb;
+            return false;
+        }
+        if (e.weight == 0) e.weight = default_weight(e.verb);
+        entries_.push_back(e);
+        return true;
+    }
+
+    std::vector<Entry> entries_;
+};
+
+#endif
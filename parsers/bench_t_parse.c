@@ -0,0 +1,245 @@
+// bench_t_parse.c - compara o parse das mensagens T: antigo (malloc + strtok_r + atoi + strtod)
+// com o scanner do parser_T.c (no próprio buffer, tabela de campos), em mensagens por segundo.
+//
+// Build: gcc -O3 -march=native -std=c11 -D_POSIX_C_SOURCE=200809L bench_t_parse.c -o bench_t_parse -lm -lzstd -lpthread
+// Uso:   ./bench_t_parse /home/grao/dados/cedro_files/20260108_T.txt [--symbols WIN,WDO] [--tf 9] [--iters 5]
+//
+// O _T.txt é lido para a memória antes de medir; cada caminho aplica todas as
+// mensagens em --tf timeframes (as barras de um --bar-sec com --tf valores).
+// Antes de medir, os dois caminhos rodam lado a lado em cada mensagem e as
+// barras têm que sair iguais campo a campo; sai com 1 se alguma diferir.
+#define main parser_T_main
+#include "parser_T.c"
+#undef main
+
+// ---------------------- caminho antigo ----------------------
+
+static double legacy_parse_double(const char *s, int *ok){
+    if(ok) *ok = 0;
+    if(!s) return NAN;
+    while(*s && isspace((unsigned char)*s)) s++;
+    if(*s=='\0') return NAN;
+    char *end=NULL;
+    errno = 0;
+    double v = strtod(s, &end);
+    if(end == s || errno != 0) return NAN;
+    if(ok) *ok = 1;
+    return v;
+}
+
+static int legacy_tick_dir_value(const char *s){
+    if(!s) return 0;
+    while(*s && isspace((unsigned char)*s)) s++;
+    if(*s == '\0') return 0;
+    if(strchr(s, '+')) return 1;
+    if(strchr(s, '-')) return -1;
+    return 0;
+}
+
+static int legacy_parse(const char *msg_in, TfOut *tf, int ntf, const unsigned char *on, int nslots,
+                        long long *parsed_lines, long long *ignored_symbols){
+    if(!msg_in) return 0;
+    while(*msg_in && isspace((unsigned char)*msg_in)) msg_in++;
+    if(strncmp(msg_in, "T:", 2) != 0) return 0;
+    const char *bang = strchr(msg_in, '!');
+    if(!bang) return 0;
+    size_t mlen = (size_t)(bang - msg_in);
+    if(mlen < 4) return 0;
+    char *buf = (char*)malloc(mlen + 1);
+    if(!buf) return 0;
+    memcpy(buf, msg_in, mlen);
+    buf[mlen] = '\0';
+
+    char *save=NULL;
+    char *tok = strtok_r(buf, ":", &save);
+    if(!tok || strcmp(tok, "T") != 0){ free(buf); return 0; }
+    char *sym = strtok_r(NULL, ":", &save);
+    if(!sym){ free(buf); return 0; }
+    char *skip = strtok_r(NULL, ":", &save);
+    if(!skip){ free(buf); return 0; }
+
+    int idx_sym = find_symbol(tf[0].slots, nslots, sym, strlen(sym));
+    (*parsed_lines)++;
+    if(idx_sym < 0){
+        (*ignored_symbols)++;
+        free(buf);
+        return 1;
+    }
+
+    Bucket *bs[T_MAX_TF];
+    int nb = 0;
+    for(int k=0;k<ntf;k++) if(on[k]) bs[nb++] = &tf[k].slots[idx_sym].b;
+    for(int k=0;k<nb;k++) bs[k]->n_events += 1;
+
+    #define T_SET(field, v) for(int k_=0;k_<nb;k_++) bs[k_]->field = (v)
+    #define T_SETS(field, v) for(int k_=0;k_<nb;k_++){ \
+        strncpy(bs[k_]->field, (v), sizeof(bs[k_]->field)-1); \
+        bs[k_]->field[sizeof(bs[k_]->field)-1] = '\0'; \
+    }
+    while(1){
+        char *idx_s = strtok_r(NULL, ":", &save);
+        if(!idx_s) break;
+        char *val_s = strtok_r(NULL, ":", &save);
+        if(!val_s) break;
+        int all_digits = 1;
+        for(char *p=idx_s; *p; ++p){ if(!isdigit((unsigned char)*p)){ all_digits=0; break; } }
+        if(!all_digits) continue;
+        int idx = atoi(idx_s);
+        int ok=0;
+        switch(idx){
+            case 2: { double v = legacy_parse_double(val_s, &ok); if(ok) T_SET(last, v); } break;
+            case 3: { double v = legacy_parse_double(val_s, &ok); if(ok) T_SET(bid, v); } break;
+            case 4: { double v = legacy_parse_double(val_s, &ok); if(ok) T_SET(ask, v); } break;
+            case 19: { long long v = parse_ll_from_any(val_s, &ok); if(ok) T_SET(bid_qty1, v); } break;
+            case 20: { long long v = parse_ll_from_any(val_s, &ok); if(ok) T_SET(ask_qty1, v); } break;
+            case 6: { long long v = parse_ll_from_any(val_s, &ok); if(ok) T_SET(trade_qty_cur, v); } break;
+            case 7: { long long v = parse_ll_from_any(val_s, &ok); if(ok) T_SET(trade_qty_last, v); } break;
+            case 8: { long long v = parse_ll_from_any(val_s, &ok); if(ok) T_SET(cum_trades, v); } break;
+            case 9: { long long v = parse_ll_from_any(val_s, &ok); if(ok) T_SET(cum_vol, v); } break;
+            case 10: { double v = legacy_parse_double(val_s, &ok); if(ok) T_SET(cum_fin, v); } break;
+            case 21: { double v = legacy_parse_double(val_s, &ok); if(ok) T_SET(variation, v); } break;
+            case 67: { long long v = parse_ll_from_any(val_s, &ok); if(ok) T_SET(status, v); } break;
+            case 88: { while(*val_s && isspace((unsigned char)*val_s)) val_s++; T_SETS(phase, val_s); } break;
+            case 106: {
+                while(*val_s && isspace((unsigned char)*val_s)) val_s++;
+                T_SETS(tick_dir_last, val_s);
+                int vdir = legacy_tick_dir_value(val_s);
+                for(int k=0;k<nb;k++){ bs[k]->tick_dir_sum += vdir; bs[k]->tick_dir_n += 1; }
+            } break;
+            case 142: { while(*val_s && isspace((unsigned char)*val_s)) val_s++; T_SETS(last_event_142, val_s); } break;
+            case 143: { while(*val_s && isspace((unsigned char)*val_s)) val_s++; T_SETS(last_trade_143, val_s); } break;
+            default: break;
+        }
+    }
+    #undef T_SET
+    #undef T_SETS
+    free(buf);
+    return 1;
+}
+
+// ---------------------- conferência ----------------------
+
+static int same_d(double a, double b){ return memcmp(&a, &b, sizeof(a)) == 0; }
+
+static int same_bucket(const Bucket *a, const Bucket *b){
+    return same_d(a->last, b->last) && same_d(a->bid, b->bid) && same_d(a->ask, b->ask) &&
+           a->bid_qty1 == b->bid_qty1 && a->ask_qty1 == b->ask_qty1 &&
+           a->trade_qty_cur == b->trade_qty_cur && a->trade_qty_last == b->trade_qty_last &&
+           a->status == b->status && strcmp(a->phase, b->phase) == 0 &&
+           strcmp(a->tick_dir_last, b->tick_dir_last) == 0 &&
+           a->tick_dir_sum == b->tick_dir_sum && a->tick_dir_n == b->tick_dir_n &&
+           same_d(a->variation, b->variation) && a->cum_trades == b->cum_trades &&
+           a->cum_vol == b->cum_vol && same_d(a->cum_fin, b->cum_fin) &&
+           strcmp(a->last_event_142, b->last_event_142) == 0 &&
+           strcmp(a->last_trade_143, b->last_trade_143) == 0 && a->n_events == b->n_events;
+}
+
+// Valores fora do que o feed manda, para os caminhos rápido e de volta ao strtod
+static int check_numbers(void){
+    static const char *const vals[] = {
+        "0", "-0", "+7", "128765", "5477.5", "-0.0217391304", "24334707690", " 42", "42 ", "1e3", "-2.5E-2",
+        "nan", "inf", "0x1A", ".5", "5.", ".", "-", "", "  ", "12abc", "999999999999999", "9999999999999999",
+        "9007199254740993", "123456789.123456", "0.1", "0.30000000000000004", "-12.7", "1.9999999999999999",
+        "99999999999999999999999", "1e400", "-1e400", "1e-400",
+    };
+    int bad = 0;
+    for(size_t i=0;i<sizeof(vals)/sizeof(vals[0]);i++){
+        const char *s = vals[i];
+        const char *e = s + strlen(s);
+        int ok_a = 0, ok_b = 0;
+        double da = legacy_parse_double(s, &ok_a), db = t_parse_double(s, e, &ok_b);
+        if(ok_a != ok_b || (ok_a && !same_d(da, db))){ fprintf(stderr, "double difere em \"%s\"\n", s); bad = 1; }
+        long long la = parse_ll_from_any(s, &ok_a), lb = t_parse_ll(s, e, &ok_b);
+        if(ok_a != ok_b || la != lb){ fprintf(stderr, "ll difere em \"%s\"\n", s); bad = 1; }
+    }
+    return bad;
+}
+
+// ---------------------- medida ----------------------
+
+static TfOut* make_tfs(const char *symbols, int ntf, int *nslots){
+    TfOut *tf = (TfOut*)calloc((size_t)ntf, sizeof(TfOut));
+    if(!tf) return NULL;
+    for(int k=0;k<ntf;k++) *nslots = parse_symbols(symbols, &tf[k].slots);
+    return tf;
+}
+
+static double now_sec(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv){
+    if(argc < 2){
+        fprintf(stderr, "Uso: %s <YYYYMMDD_T.txt> [--symbols WIN,WDO] [--tf 9] [--iters 5]\n", argv[0]);
+        return 2;
+    }
+    const char *path = argv[1];
+    const char *symbols = "WIN,WDO";
+    int ntf = 9, iters = 5;
+    for(int i=2;i+1<argc;i+=2){
+        if(!strcmp(argv[i], "--symbols")) symbols = argv[i+1];
+        else if(!strcmp(argv[i], "--tf")) ntf = atoi(argv[i+1]);
+        else if(!strcmp(argv[i], "--iters")) iters = atoi(argv[i+1]);
+    }
+    if(ntf < 1 || ntf > T_MAX_TF) ntf = 9;
+    if(iters < 1) iters = 1;
+
+    FILE *f = cz_fopen(path, "r");
+    if(!f){ perror(path); return 2; }
+    size_t cap = 1 << 20, n = 0, nmsg = 0, msg_cap = 1 << 16;
+    char *data = (char*)malloc(cap);
+    size_t *msg_off = (size_t*)malloc(msg_cap * sizeof(size_t));
+    char *line = NULL;
+    size_t lcap = 0;
+    ssize_t len;
+    while((len = getline(&line, &lcap, f)) > 0){
+        char write_ts[64];
+        const char *msg = NULL;
+        if(!split_first3_commas(line, write_ts, sizeof(write_ts), &msg)) continue;
+        size_t ml = strlen(msg) + 1;
+        while(n + ml > cap){ cap *= 2; data = (char*)realloc(data, cap); }
+        if(nmsg == msg_cap){ msg_cap *= 2; msg_off = (size_t*)realloc(msg_off, msg_cap * sizeof(size_t)); }
+        memcpy(data + n, msg, ml);
+        msg_off[nmsg++] = n;
+        n += ml;
+    }
+    free(line);
+    fclose(f);
+
+    unsigned char on[T_MAX_TF];
+    memset(on, 1, sizeof(on));
+    int nslots = 0;
+    TfOut *tf_a = make_tfs(symbols, ntf, &nslots);
+    TfOut *tf_b = make_tfs(symbols, ntf, &nslots);
+    long long bad = 0, parsed_a = 0, parsed_b = 0, ign_a = 0, ign_b = 0;
+
+    int diff = check_numbers();
+    for(size_t i=0;i<nmsg && !diff;i++){
+        const char *m = data + msg_off[i];
+        int ra = legacy_parse(m, tf_a, ntf, on, nslots, &parsed_a, &ign_a);
+        int rb = parse_T_message_and_update(m, tf_b, ntf, on, nslots, &bad, &parsed_b, &ign_b);
+        int same = ra == rb && parsed_a == parsed_b && ign_a == ign_b;
+        for(int k=0;k<ntf && same;k++)
+            for(int s=0;s<nslots && same;s++) same = same_bucket(&tf_a[k].slots[s].b, &tf_b[k].slots[s].b);
+        if(!same){ fprintf(stderr, "mensagem %zu difere: %s\n", i, m); diff = 1; }
+    }
+    fprintf(stderr, "conferência: %s (%zu mensagens, %lld de símbolos fora de --symbols)\n",
+            diff ? "DIFERE" : "igual", nmsg, ign_b);
+
+    double best_a = 1e30, best_b = 1e30;
+    for(int it=0;it<iters;it++){
+        double t0 = now_sec();
+        for(size_t i=0;i<nmsg;i++) legacy_parse(data + msg_off[i], tf_a, ntf, on, nslots, &parsed_a, &ign_a);
+        double t1 = now_sec();
+        for(size_t i=0;i<nmsg;i++) parse_T_message_and_update(data + msg_off[i], tf_b, ntf, on, nslots, &bad, &parsed_b, &ign_b);
+        double t2 = now_sec();
+        if(t1 - t0 < best_a) best_a = t1 - t0;
+        if(t2 - t1 < best_b) best_b = t2 - t1;
+    }
+    printf("antigo: %8.1f ns/msg %7.2f Mmsg/s\n", best_a * 1e9 / (double)nmsg, (double)nmsg / best_a / 1e6);
+    printf("novo:   %8.1f ns/msg %7.2f Mmsg/s  (%.2fx)\n", best_b * 1e9 / (double)nmsg, (double)nmsg / best_b / 1e6,
+           best_a / best_b);
+    return diff ? 1 : 0;
+}
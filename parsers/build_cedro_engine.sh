@@ -0,0 +1,18 @@
+#!/usr/bin/env bash
+# Compila o cedro_engine: cada parser (e o gerarenko) com -DCEDRO_ENGINE, que
+# troca o main por parser_X_main e o --shm pela fila do engine (cedro_shm.h)
+set -euo pipefail
+
+cd "$(dirname "$0")"
+CC="${CC:-gcc}"
+CFLAGS="${CFLAGS:--O3 -march=native -std=c11}"
+OBJ="$(mktemp -d)"
+trap 'rm -rf "$OBJ"' EXIT
+
+for p in T B V Z; do
+  $CC $CFLAGS -DCEDRO_ENGINE -c "parser_$p.c" -o "$OBJ/parser_$p.o"
+done
+$CC $CFLAGS -DCEDRO_ENGINE -c ../gerarenko/gerarenko.c -o "$OBJ/gerarenko.o"
+$CC $CFLAGS cedro_engine.c "$OBJ"/*.o -o cedro_engine -lm -lzstd -lpthread
+
+echo "OK: $(pwd)/cedro_engine"
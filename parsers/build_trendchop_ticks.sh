@@ -9,13 +9,10 @@ START="20251216"
 END="$(date +%Y%m%d)"   # hoje
 
 mkdir -p "$OUT_DIR"
+JOBS="${JOBS:-$(nproc)}"
 
-d="$START"
-while [[ "$d" -le "$END" ]]; do
-  echo "=== $d ==="
-  python3 "$SCRIPT" --date "$d" --symbols "$SYMBOLS" || true
-  d="$(date -d "${d:0:4}-${d:4:2}-${d:6:2} +1 day" +%Y%m%d)"
-done
+# um dia por processo, JOBS em paralelo; dia sem CSV de 1s é pulado
+./cedro_batch --from "$START" --to "$END" --pipelines chop -j "$JOBS" \
+  --bin-dir "$(dirname "$SCRIPT")" --symbols "$SYMBOLS" "$@" || true
 
 echo "DONE. Saídas em: $OUT_DIR"
-
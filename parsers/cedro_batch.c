@@ -0,0 +1,593 @@
+// cedro_batch.c - reprocessamento de um intervalo de dias em paralelo (no lugar dos run_*_range.sh)
+//
+// Os run_*_range.sh e o build_trendchop_ticks.sh andam um dia por vez: um
+// backfill de dois meses usa um núcleo. O cedro_batch monta as tarefas
+// (dia x pipeline) do intervalo a partir dos inputs que existem no
+// --in-dir e as roda num pool de -j threads, cada tarefa um processo do
+// parser com os mesmos argumentos dos scripts. As tarefas são ordenadas da
+// maior para a menor (tamanho do input; do conteúdo, no .zst do dia
+// arquivado) e distribuídas em rodízio nas filas das threads; cada thread
+// pega a maior da própria fila e, sem nada, rouba a menor da fila mais
+// carregada, então os dias grandes começam primeiro e o fim do lote não fica
+// esperando uma thread só.
+//
+// Os timeframes não viram tarefas separadas: T, B e V já fazem todos os
+// --bar-sec numa passada só pelo input, e separar releria o arquivo uma vez
+// por timeframe.
+//
+// Pipelines: T, B, V, Z (parser_X) e chop (build_trendchop_ticks.py, que lê
+// os CSVs de 1s dos outros; roda numa segunda fase, depois que os do mesmo
+// dia terminaram).
+//
+// Tarefa em dia é pulada: ao terminar bem, cada tarefa grava em
+// {stamp-dir}/{ymd}_{pipeline}.stamp o hash dos argumentos e o tamanho e o
+// mtime do input; se eles batem e os CSVs de saída existem, a tarefa não
+// roda de novo (--force roda assim mesmo). A saída de cada processo vai para
+// {stamp-dir}/{ymd}_{pipeline}.log. No fim, o total: tarefas, MB de input,
+// tempo e MB/s agregados.
+//
+// Build: gcc -O2 -std=c11 cedro_batch.c -o cedro_batch -lzstd -lpthread
+//
+// Uso:
+//   ./cedro_batch --from 20251201 --to 20260107 --pipelines T,B,V,Z,chop -j 32
+//   ./cedro_batch --from 20251216 --to 20251227 --pipelines V --bar-sec 1,5,60 --dry-run
+// Diretórios (default dos scripts): --in-dir /home/grao/dados/cedro_files,
+// --t-dir/--b-dir/--v-dir/--z-dir /home/grao/dados/{t,b,v,z},
+// --chop-dir /home/grao/dados/chope, --state-dir /home/grao/dados/state
+// (--stamp-dir, default {state-dir}/batch), --bin-dir . (parser_X e o .py).
+// --z-args troca os parâmetros do parser_Z (default: os do run_z_range.sh,
+// "--depth 15 --topn 5 --snapshot-sec 1 ... --flush-sec 5"); entram no hash
+// do stamp como os outros argumentos, então mudá-los refaz os dias.
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cedro_catchup.h"
+#include "cedro_state.h"
+#include "cedro_zst.h"
+
+extern char **environ;
+
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+#define CB_MAX_ARGS 48
+#define CB_MAX_BARS 16
+
+enum { P_T, P_B, P_V, P_Z, P_CHOP, P_COUNT };
+static const char *const P_NAME[P_COUNT] = {"T", "B", "V", "Z", "chop"};
+
+typedef struct {
+    char ymd[9];
+    int pipe;
+    uint64_t bytes;            // input (conteúdo) para ordenar e para o MB/s
+    int64_t in_mtime;
+    char *argv[CB_MAX_ARGS];
+    int argc;
+    char *outs[CB_MAX_BARS];   // CSVs que a tarefa gera
+    int nouts;
+    uint64_t hash;             // argumentos
+    char stamp[PATH_MAX];
+    char log[PATH_MAX];
+    int status;                // 0 ok, 1 falhou, 2 em dia (pulada)
+    double secs;
+} Task;
+
+// Fila de uma thread: a maior tarefa na frente; o dono tira da frente, o ladrão do fim
+typedef struct {
+    pthread_mutex_t mu;
+    int *ids;
+    int head, tail;
+    uint64_t bytes;            // soma do que ainda está na fila
+    int steals;
+} Deque;
+
+typedef struct {
+    int from, to;              // YYYYMMDD
+    int on[P_COUNT];
+    int jobs;
+    int force, dry_run;
+    char in_dir[PATH_MAX], bin_dir[PATH_MAX], state_dir[PATH_MAX], stamp_dir[PATH_MAX];
+    char out_dir[P_COUNT][PATH_MAX];
+    char bars[128];
+    char t_symbols[256], symbols[256];
+    char z_args[512];          // parâmetros do parser_Z, separados por espaço
+} Args;
+
+static Args g_a;
+static Task *g_tasks;
+static int g_ntasks;
+static Deque *g_dq;
+static pthread_mutex_t g_print_mu = PTHREAD_MUTEX_INITIALIZER;
+
+static void die(const char *msg) {
+    fprintf(stderr, "ERRO: %s\n", msg);
+    exit(2);
+}
+
+// snprintf de caminho; o que não cabe no buffer é erro, não caminho cortado
+__attribute__((format(printf, 3, 4)))
+static void cb_path(char *out, size_t sz, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    const int n = vsnprintf(out, sz, fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)n >= sz) die("caminho grande demais");
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+        "Uso: %s --from YYYYMMDD --to YYYYMMDD [--pipelines T,B,V,Z,chop] [-j N]\n"
+        "       [--bar-sec 1,5,10,30,60,120,300,600,900] [--t-symbols WIN,WDO] [--symbols WING26,WDOF26]\n"
+        "       [--z-args \"--depth 15 --topn 5 ...\"]\n"
+        "       [--in-dir D] [--t-dir D] [--b-dir D] [--v-dir D] [--z-dir D] [--chop-dir D]\n"
+        "       [--state-dir D] [--stamp-dir D] [--bin-dir D] [--force] [--dry-run]\n",
+        argv0);
+}
+
+static int parse_ymd(const char *s) {
+    if (strlen(s) != 8 || strspn(s, "0123456789") != 8) die("data espera YYYYMMDD");
+    return atoi(s);
+}
+
+static void parse_pipelines(const char *s, int on[P_COUNT]) {
+    char tmp[128];
+    snprintf(tmp, sizeof(tmp), "%s", s);
+    memset(on, 0, sizeof(int) * P_COUNT);
+    char *save = NULL;
+    for (char *t = strtok_r(tmp, ",", &save); t; t = strtok_r(NULL, ",", &save)) {
+        int k = 0;
+        while (k < P_COUNT && strcmp(t, P_NAME[k]) != 0) k++;
+        if (k == P_COUNT) {
+            fprintf(stderr, "ERRO: pipeline desconhecido: %s (T, B, V, Z ou chop)\n", t);
+            exit(2);
+        }
+        on[k] = 1;
+    }
+}
+
+static void parse_args(int argc, char **argv) {
+    Args *a = &g_a;
+    memset(a, 0, sizeof(*a));
+    a->jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    for (int k = 0; k < P_CHOP; k++) a->on[k] = 1;
+    snprintf(a->in_dir, sizeof(a->in_dir), "/home/grao/dados/cedro_files");
+    snprintf(a->bin_dir, sizeof(a->bin_dir), ".");
+    snprintf(a->state_dir, sizeof(a->state_dir), "/home/grao/dados/state");
+    snprintf(a->out_dir[P_T], PATH_MAX, "/home/grao/dados/t");
+    snprintf(a->out_dir[P_B], PATH_MAX, "/home/grao/dados/b");
+    snprintf(a->out_dir[P_V], PATH_MAX, "/home/grao/dados/v");
+    snprintf(a->out_dir[P_Z], PATH_MAX, "/home/grao/dados/z");
+    snprintf(a->out_dir[P_CHOP], PATH_MAX, "/home/grao/dados/chope");
+    snprintf(a->bars, sizeof(a->bars), "1,5,10,30,60,120,300,600,900");
+    snprintf(a->t_symbols, sizeof(a->t_symbols), "WIN,WDO");
+    snprintf(a->symbols, sizeof(a->symbols), "WING26,WDOF26");
+    snprintf(a->z_args, sizeof(a->z_args),
+             "--depth 15 --topn 5 --snapshot-sec 1 --min-warmup 60 --zwin 60 --score-th 1.2 --persist 3 "
+             "--cooldown-sec 30 --require-sign --reset-state --batch --ckpt-sec 5 --flush-sec 5");
+
+    for (int i = 1; i < argc; i++) {
+        const char *k = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : NULL;
+        char *dst = NULL;
+        size_t dst_sz = PATH_MAX;
+        if (!strcmp(k, "--force")) { a->force = 1; continue; }
+        if (!strcmp(k, "--dry-run")) { a->dry_run = 1; continue; }
+        if (!strcmp(k, "-h") || !strcmp(k, "--help")) { usage(argv[0]); exit(0); }
+        if (!v) { usage(argv[0]); exit(2); }
+        if (!strcmp(k, "--from")) a->from = parse_ymd(v);
+        else if (!strcmp(k, "--to")) a->to = parse_ymd(v);
+        else if (!strcmp(k, "--pipelines")) parse_pipelines(v, a->on);
+        else if (!strcmp(k, "-j")) a->jobs = atoi(v);
+        else if (!strcmp(k, "--bar-sec")) { dst = a->bars; dst_sz = sizeof(a->bars); }
+        else if (!strcmp(k, "--t-symbols")) { dst = a->t_symbols; dst_sz = sizeof(a->t_symbols); }
+        else if (!strcmp(k, "--symbols")) { dst = a->symbols; dst_sz = sizeof(a->symbols); }
+        else if (!strcmp(k, "--z-args")) { dst = a->z_args; dst_sz = sizeof(a->z_args); }
+        else if (!strcmp(k, "--in-dir")) dst = a->in_dir;
+        else if (!strcmp(k, "--bin-dir")) dst = a->bin_dir;
+        else if (!strcmp(k, "--state-dir")) dst = a->state_dir;
+        else if (!strcmp(k, "--stamp-dir")) dst = a->stamp_dir;
+        else if (!strcmp(k, "--t-dir")) dst = a->out_dir[P_T];
+        else if (!strcmp(k, "--b-dir")) dst = a->out_dir[P_B];
+        else if (!strcmp(k, "--v-dir")) dst = a->out_dir[P_V];
+        else if (!strcmp(k, "--z-dir")) dst = a->out_dir[P_Z];
+        else if (!strcmp(k, "--chop-dir")) dst = a->out_dir[P_CHOP];
+        else {
+            fprintf(stderr, "ERRO: argumento desconhecido: %s\n", k);
+            usage(argv[0]);
+            exit(2);
+        }
+        if (dst) snprintf(dst, dst_sz, "%s", v);
+        i++;
+    }
+    if (!a->from || !a->to) { usage(argv[0]); exit(2); }
+    if (a->from > a->to) die("--from depois de --to");
+    if (a->jobs < 1) a->jobs = 1;
+    if (!a->stamp_dir[0]) cb_path(a->stamp_dir, sizeof(a->stamp_dir), "%s/batch", a->state_dir);
+}
+
+// ---------- tarefas ----------
+
+static char *cb_strdup(const char *fmt, const char *a, const char *b, const char *c) {
+    char buf[PATH_MAX];
+    cb_path(buf, sizeof(buf), fmt, a, b, c);
+    char *s = strdup(buf);
+    if (!s) die("sem memória");
+    return s;
+}
+
+static void add_arg(Task *t, const char *s) {
+    if (t->argc >= CB_MAX_ARGS - 1) die("argumentos demais");
+    t->argv[t->argc++] = strdup(s);
+    t->argv[t->argc] = NULL;
+}
+
+static void add_args(Task *t, const char *const *list) {
+    for (int i = 0; list[i]; i++) add_arg(t, list[i]);
+}
+
+// Tamanho do conteúdo e mtime de path (ou path.zst, dia arquivado); 0 se não existe
+static int input_info(const char *path, uint64_t *bytes, int64_t *mtime, char *used, size_t used_sz) {
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        *bytes = (uint64_t)st.st_size;
+        *mtime = (int64_t)st.st_mtime;
+        snprintf(used, used_sz, "%s", path);
+        return 1;
+    }
+    char z[PATH_MAX];
+    cb_path(z, sizeof(z), "%s.zst", path);
+    if (stat(z, &st) != 0) return 0;
+    *bytes = (uint64_t)st.st_size;
+    *mtime = (int64_t)st.st_mtime;
+    CzIndex ix;
+    if (cz_index_open(&ix, z) == 0) {
+        *bytes = ix.d_total;
+        cz_index_close(&ix);
+    }
+    snprintf(used, used_sz, "%s", path);
+    return 1;
+}
+
+// Saídas de T/B/V: um CSV por --bar-sec ({dir}/{ymd}_{x}_{N}s.csv)
+static void add_bar_outputs(Task *t, const char *dir, const char *x) {
+    char tmp[128];
+    snprintf(tmp, sizeof(tmp), "%s", g_a.bars);
+    char *save = NULL;
+    for (char *b = strtok_r(tmp, ",", &save); b && t->nouts < CB_MAX_BARS; b = strtok_r(NULL, ",", &save)) {
+        char p[PATH_MAX];
+        cb_path(p, sizeof(p), "%s/%s_%s_%ss.csv", dir, t->ymd, x, b);
+        t->outs[t->nouts++] = strdup(p);
+    }
+}
+
+// Monta a tarefa (dia, pipeline); 0 se o input não existe
+static int make_task(Task *t, const char *ymd, int pipe) {
+    memset(t, 0, sizeof(*t));
+    snprintf(t->ymd, sizeof(t->ymd), "%s", ymd);
+    t->pipe = pipe;
+    const char *od = g_a.out_dir[pipe];
+    char in[PATH_MAX], used[PATH_MAX], bin[PATH_MAX], out[PATH_MAX];
+
+    if (pipe == P_CHOP) {
+        // Lê os CSVs de 1s que existirem: o "input" é a soma deles
+        const char *x[4] = {"t_1s", "b_1s", "v_1s", "ztop_signal_1s"};
+        const int src[4] = {P_T, P_B, P_V, P_Z};
+        int any = 0;
+        for (int i = 0; i < 4; i++) {
+            uint64_t b = 0;
+            int64_t m = 0;
+            cb_path(in, sizeof(in), "%s/%s_%s.csv", g_a.out_dir[src[i]], ymd, x[i]);
+            if (!input_info(in, &b, &m, used, sizeof(used))) continue;
+            any = 1;
+            t->bytes += b;
+            if (m > t->in_mtime) t->in_mtime = m;
+        }
+        if (!any) return 0;
+        cb_path(bin, sizeof(bin), "%s/build_trendchop_ticks.py", g_a.bin_dir);
+        const char *const base[] = {"python3", bin, "--date", ymd, "--symbols", g_a.symbols,
+                                    "--t-dir", g_a.out_dir[P_T], "--b-dir", g_a.out_dir[P_B],
+                                    "--v-dir", g_a.out_dir[P_V], "--z-dir", g_a.out_dir[P_Z],
+                                    "--out-dir", od, NULL};
+        add_args(t, base);
+        t->outs[t->nouts++] = cb_strdup("%s/%s_trendchop.csv", od, ymd, "");
+    } else {
+        cb_path(in, sizeof(in), "%s/%s_%s.txt", g_a.in_dir, ymd, P_NAME[pipe]);
+        if (!input_info(in, &t->bytes, &t->in_mtime, used, sizeof(used))) return 0;
+        cb_path(bin, sizeof(bin), "%s/parser_%s", g_a.bin_dir, P_NAME[pipe]);
+        if (pipe == P_T) {
+            cb_path(out, sizeof(out), "%s/%s_t_{bar}s.csv", od, ymd);
+            const char *const args[] = {bin, "--input", used, "--output", out, "--symbols", g_a.t_symbols,
+                                        "--bar-sec", g_a.bars, NULL};
+            add_args(t, args);
+            add_bar_outputs(t, od, "t");
+        } else if (pipe == P_B || pipe == P_V) {
+            const char *x = pipe == P_B ? "b" : "v";
+            cb_path(out, sizeof(out), "%s/%s_%s_{bar}s.csv", od, ymd, x);
+            const char *const args[] = {bin, "--file", used, "--out", out, "--bar-sec", g_a.bars, NULL};
+            add_args(t, args);
+            add_bar_outputs(t, od, x);
+        } else {
+            // --date separa o estado de cada dia (dias em paralelo não podem
+            // dividir o {state-dir}/fixed_Z.offset); o resto vem do --z-args
+            cb_path(out, sizeof(out), "%s/%s_ztop_signal_1s.csv", od, ymd);
+            const char *const args[] = {bin, "--input-template", used, "--out-csv", out,
+                                        "--state-dir", g_a.state_dir, "--symbols", g_a.symbols, "--date", ymd, NULL};
+            add_args(t, args);
+            char tmp[sizeof(g_a.z_args)];
+            memcpy(tmp, g_a.z_args, sizeof(tmp));
+            char *save = NULL;
+            for (char *w = strtok_r(tmp, " ", &save); w; w = strtok_r(NULL, " ", &save)) add_arg(t, w);
+            t->outs[t->nouts++] = strdup(out);
+        }
+    }
+    for (int i = 0; i < t->argc; i++) t->hash = cst_hash(t->hash, t->argv[i], strlen(t->argv[i]) + 1);
+    cb_path(t->stamp, sizeof(t->stamp), "%s/%s_%s.stamp", g_a.stamp_dir, ymd, P_NAME[pipe]);
+    cb_path(t->log, sizeof(t->log), "%s/%s_%s.log", g_a.stamp_dir, ymd, P_NAME[pipe]);
+    return 1;
+}
+
+// Stamp bate com argumentos e input, e as saídas existem
+static int up_to_date(const Task *t) {
+    FILE *f = fopen(t->stamp, "r");
+    if (!f) return 0;
+    unsigned long long h = 0, b = 0;
+    long long m = 0;
+    const int n = fscanf(f, "v1 %llx %llu %lld", &h, &b, &m);
+    fclose(f);
+    if (n != 3 || h != t->hash || b != t->bytes || m != t->in_mtime) return 0;
+    for (int i = 0; i < t->nouts; i++) {
+        if (access(t->outs[i], F_OK) != 0) return 0;
+    }
+    return 1;
+}
+
+static void write_stamp(const Task *t) {
+    char tmp[PATH_MAX + 8];
+    cb_path(tmp, sizeof(tmp), "%s.tmp", t->stamp);
+    FILE *f = fopen(tmp, "w");
+    if (!f) return;
+    fprintf(f, "v1 %llx %llu %lld\n", (unsigned long long)t->hash, (unsigned long long)t->bytes,
+            (long long)t->in_mtime);
+    if (fclose(f) == 0) rename(tmp, t->stamp);
+}
+
+static void mkdirs(const char *path) {
+    char p[PATH_MAX];
+    snprintf(p, sizeof(p), "%s", path);
+    for (char *s = p + 1; *s; s++) {
+        if (*s != '/') continue;
+        *s = '\0';
+        mkdir(p, 0755);
+        *s = '/';
+    }
+    mkdir(p, 0755);
+}
+
+// Processo da tarefa, stdout/stderr no log; 0 se saiu com 0
+static int run_task(Task *t) {
+    posix_spawn_file_actions_t fa;
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_addopen(&fa, 1, t->log, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    posix_spawn_file_actions_adddup2(&fa, 1, 2);
+    pid_t pid;
+    const int e = posix_spawnp(&pid, t->argv[0], &fa, NULL, t->argv, environ);
+    posix_spawn_file_actions_destroy(&fa);
+    if (e != 0) {
+        pthread_mutex_lock(&g_print_mu);
+        fprintf(stderr, "ERRO: não executei %s: %s\n", t->argv[0], strerror(e));
+        pthread_mutex_unlock(&g_print_mu);
+        return -1;
+    }
+    int st = 0;
+    while (waitpid(pid, &st, 0) < 0 && errno == EINTR) {}
+    return WIFEXITED(st) && WEXITSTATUS(st) == 0 ? 0 : -1;
+}
+
+// ---------- pool ----------
+
+static int dq_pop(Deque *d) {
+    int id = -1;
+    pthread_mutex_lock(&d->mu);
+    if (d->head < d->tail) {
+        id = d->ids[d->head++];
+        d->bytes -= g_tasks[id].bytes;
+    }
+    pthread_mutex_unlock(&d->mu);
+    return id;
+}
+
+// Rouba a menor tarefa da fila com mais bytes pendentes
+static int dq_steal(int self) {
+    for (;;) {
+        int victim = -1;
+        uint64_t most = 0;
+        for (int w = 0; w < g_a.jobs; w++) {
+            if (w == self) continue;
+            const uint64_t b = __atomic_load_n(&g_dq[w].bytes, __ATOMIC_RELAXED);
+            const int left = __atomic_load_n(&g_dq[w].tail, __ATOMIC_RELAXED) -
+                             __atomic_load_n(&g_dq[w].head, __ATOMIC_RELAXED);
+            if (left > 0 && (victim < 0 || b > most)) { victim = w; most = b; }
+        }
+        if (victim < 0) return -1;
+        Deque *d = &g_dq[victim];
+        int id = -1;
+        pthread_mutex_lock(&d->mu);
+        if (d->head < d->tail) {
+            id = d->ids[--d->tail];
+            d->bytes -= g_tasks[id].bytes;
+        }
+        pthread_mutex_unlock(&d->mu);
+        if (id >= 0) {
+            g_dq[self].steals++;
+            return id;
+        }
+        // a fila esvaziou entre a escolha e o lock: procura outra
+    }
+}
+
+static void *worker(void *arg) {
+    const int self = (int)(intptr_t)arg;
+    for (;;) {
+        int id = dq_pop(&g_dq[self]);
+        if (id < 0) id = dq_steal(self);
+        if (id < 0) break;
+        Task *t = &g_tasks[id];
+        unlink(t->stamp);   // saída pela metade não pode passar por em dia
+        // O parser_Z abre o CSV em append: sem isso a nova passada vai depois da antiga
+        for (int i = 0; i < t->nouts; i++) unlink(t->outs[i]);
+        const double t0 = ccu_now();
+        const int rc = run_task(t);
+        t->secs = ccu_now() - t0;
+        t->status = rc == 0 ? 0 : 1;
+        if (rc == 0) write_stamp(t);
+        pthread_mutex_lock(&g_print_mu);
+        if (rc == 0) {
+            fprintf(stderr, "[OK]   %s %-4s %8.1f MB %7.2fs\n", t->ymd, P_NAME[t->pipe], (double)t->bytes / 1e6, t->secs);
+        } else {
+            fprintf(stderr, "[FAIL] %s %-4s (log: %s)\n", t->ymd, P_NAME[t->pipe], t->log);
+        }
+        pthread_mutex_unlock(&g_print_mu);
+    }
+    return NULL;
+}
+
+static int by_bytes_desc(const void *a, const void *b) {
+    const uint64_t x = g_tasks[*(const int *)a].bytes, y = g_tasks[*(const int *)b].bytes;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+// Roda as tarefas ids[0..n) no pool; maiores primeiro, em rodízio pelas filas
+static void run_pool(int *ids, int n) {
+    if (n == 0) return;
+    qsort(ids, (size_t)n, sizeof(int), by_bytes_desc);
+    const int jobs = g_a.jobs;
+    for (int w = 0; w < jobs; w++) {
+        Deque *d = &g_dq[w];
+        d->head = d->tail = 0;
+        d->bytes = 0;
+    }
+    for (int i = 0; i < n; i++) {
+        Deque *d = &g_dq[i % jobs];
+        d->ids[d->tail++] = ids[i];
+        d->bytes += g_tasks[ids[i]].bytes;
+    }
+    pthread_t *th = (pthread_t *)calloc((size_t)jobs, sizeof(pthread_t));
+    if (!th) die("sem memória");
+    for (int w = 0; w < jobs; w++) {
+        if (pthread_create(&th[w], NULL, worker, (void *)(intptr_t)w) != 0) die("pthread_create");
+    }
+    for (int w = 0; w < jobs; w++) pthread_join(th[w], NULL);
+    free(th);
+}
+
+// ---------- main ----------
+
+static void next_day(char ymd[9]) {
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    const int v = atoi(ymd);
+    tm.tm_year = v / 10000 - 1900;
+    tm.tm_mon = v / 100 % 100 - 1;
+    tm.tm_mday = v % 100 + 1;
+    tm.tm_hour = 12;
+    tm.tm_isdst = -1;
+    mktime(&tm);
+    strftime(ymd, 9, "%Y%m%d", &tm);
+}
+
+// Tarefas de uma fase (pipelines em on[]); devolve quantas vão rodar
+static int collect(const int on[P_COUNT], int *ids, int *skipped) {
+    int n = 0;
+    char ymd[9];
+    snprintf(ymd, sizeof(ymd), "%08d", g_a.from);
+    while (atoi(ymd) <= g_a.to) {
+        for (int p = 0; p < P_COUNT; p++) {
+            if (!on[p]) continue;
+            Task *t = &g_tasks[g_ntasks];
+            if (!make_task(t, ymd, p)) continue;
+            g_ntasks++;
+            if (!g_a.force && up_to_date(t)) {
+                t->status = 2;
+                (*skipped)++;
+                continue;
+            }
+            if (g_a.dry_run) {
+                printf("%s %-4s %8.1f MB ", t->ymd, P_NAME[p], (double)t->bytes / 1e6);
+                for (int i = 0; i < t->argc; i++) printf(" %s", t->argv[i]);
+                printf("\n");
+                continue;
+            }
+            mkdirs(g_a.out_dir[p]);
+            ids[n++] = (int)(t - g_tasks);
+        }
+        next_day(ymd);
+    }
+    return n;
+}
+
+int main(int argc, char **argv) {
+    parse_args(argc, argv);
+    int ndays = 0;
+    char ymd[9];
+    snprintf(ymd, sizeof(ymd), "%08d", g_a.from);
+    for (; atoi(ymd) <= g_a.to; ndays++) next_day(ymd);
+    g_tasks = (Task *)calloc((size_t)ndays * P_COUNT, sizeof(Task));
+    int *ids = (int *)calloc((size_t)ndays * P_COUNT, sizeof(int));
+    g_dq = (Deque *)calloc((size_t)g_a.jobs, sizeof(Deque));
+    if (!g_tasks || !ids || !g_dq) die("sem memória");
+    for (int w = 0; w < g_a.jobs; w++) {
+        pthread_mutex_init(&g_dq[w].mu, NULL);
+        g_dq[w].ids = (int *)calloc((size_t)ndays * P_COUNT, sizeof(int));
+        if (!g_dq[w].ids) die("sem memória");
+    }
+    if (!g_a.dry_run) mkdirs(g_a.stamp_dir);
+
+    const double t0 = ccu_now();
+    int skipped = 0;
+    // Fase 1: parsers; fase 2: chop, que lê os CSVs de 1s da fase 1
+    int phase1[P_COUNT] = {0}, phase2[P_COUNT] = {0};
+    for (int p = 0; p < P_CHOP; p++) phase1[p] = g_a.on[p];
+    phase2[P_CHOP] = g_a.on[P_CHOP];
+    int n = collect(phase1, ids, &skipped);
+    run_pool(ids, n);
+    n = collect(phase2, ids, &skipped);
+    run_pool(ids, n);
+    const double dt = ccu_now() - t0;
+    if (g_a.dry_run) return 0;
+
+    int ok = 0, failed = 0, steals = 0;
+    uint64_t bytes = 0;
+    double busy = 0;
+    for (int i = 0; i < g_ntasks; i++) {
+        const Task *t = &g_tasks[i];
+        if (t->status == 2) continue;
+        if (t->status == 0) {
+            ok++;
+            bytes += t->bytes;
+        } else {
+            failed++;
+        }
+        busy += t->secs;
+    }
+    for (int w = 0; w < g_a.jobs; w++) steals += g_dq[w].steals;
+    fprintf(stderr,
+            "[cedro_batch] %d tarefas: %d ok, %d falharam, %d em dia (puladas); %.1f MB de input em %.2fs "
+            "(%.1f MB/s); %.1fs somando as tarefas em %d threads (paralelismo %.1fx), %d roubos\n",
+            ok + failed + skipped, ok, failed, skipped, (double)bytes / 1e6, dt, dt > 0 ? (double)bytes / 1e6 / dt : 0.0,
+            busy, g_a.jobs, dt > 0 ? busy / dt : 0.0, steals);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,102 @@
+// cedro_catchup.h - partida no meio do pregão: recupera o dia e depois segue ao vivo
+//
+// Parser em follow/live que começa pelo início do arquivo do dia (ou pelo
+// keyframe/checkpoint, quando há) fica em recuperação até o primeiro EOF:
+// lê na velocidade do disco, com o CSV em buffer cheio e sem fflush por
+// barra. No primeiro EOF vira ao vivo: descarrega o CSV, volta o fflush por
+// barra e escreve no stderr o resumo da recuperação (registros, MB, MB/s,
+// hora em que ficou ao vivo e até que horário do feed tinha chegado).
+//
+// --catchup-emit HH:MM:SS: barras anteriores a esse horário só atualizam o
+// estado, sem ir para o CSV; "live" faz isso com todas as barras da
+// recuperação. Estado zerado (memset) é "ao vivo, imprime tudo": o
+// comportamento antigo.
+//
+// Só header, compila como C e C++.
+#ifndef CEDRO_CATCHUP_H
+#define CEDRO_CATCHUP_H
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "cedro_index.h"
+
+#define CCU_EMIT_LIVE (-2)   // --catchup-emit live
+
+typedef struct {
+    const char *name;     // prefixo do resumo ("parser_B")
+    int active;           // 1 enquanto recupera
+    int emit_from_sec;    // barras antes disso não vão para o CSV; CCU_EMIT_LIVE
+    double t0;
+    long long records;
+    long long bytes;
+    int data_sec;         // segundo do dia do último registro lido (-1 nenhum)
+} CcuState;
+
+static inline double ccu_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// "HH:MM:SS" ou "live"; 0 se inválido
+static inline int ccu_parse_emit(const char *s, int *emit_from_sec) {
+    if (strcmp(s, "live") == 0) {
+        *emit_from_sec = CCU_EMIT_LIVE;
+        return 1;
+    }
+    return ci_parse_hms(s, emit_from_sec);
+}
+
+// Entra em recuperação (emit_from_sec -1 = imprime tudo)
+static inline void ccu_begin(CcuState *c, const char *name, int emit_from_sec) {
+    memset(c, 0, sizeof(*c));
+    c->name = name;
+    c->active = 1;
+    c->emit_from_sec = emit_from_sec;
+    c->data_sec = -1;
+    c->t0 = ccu_now();
+}
+
+// Registro lido (bytes do input; sec -1 se não tem horário)
+static inline void ccu_count(CcuState *c, size_t bytes, int sec) {
+    if (!c->active) return;
+    c->records++;
+    c->bytes += (long long)bytes;
+    if (sec >= 0) c->data_sec = sec;
+}
+
+// A barra que começa em sec (segundos do dia) vai para o CSV?
+static inline int ccu_emit(const CcuState *c, int sec) {
+    if (c->emit_from_sec == CCU_EMIT_LIVE) return !c->active;
+    return sec >= c->emit_from_sec;
+}
+
+// fflush por barra só ao vivo
+static inline void ccu_flush(const CcuState *c, FILE *out) {
+    if (!c->active) fflush(out);
+}
+
+// Primeiro EOF: vira ao vivo e mostra o resumo da recuperação
+static inline void ccu_live(CcuState *c, FILE *out) {
+    if (!c->active) return;
+    c->active = 0;
+    if (out) fflush(out);
+    const double dt = ccu_now() - c->t0;
+    const double mb = (double)c->bytes / 1e6;
+    const time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    char feed[16] = "-";
+    if (c->data_sec >= 0) {
+        snprintf(feed, sizeof(feed), "%02d:%02d:%02d", c->data_sec / 3600, c->data_sec / 60 % 60, c->data_sec % 60);
+    }
+    fprintf(stderr,
+            "[%s] recuperação: %lld registros, %.1f MB em %.2fs (%.1f MB/s, %.0f reg/s); "
+            "ao vivo às %02d:%02d:%02d, feed em %s\n",
+            c->name ? c->name : "parser", c->records, mb, dt, dt > 0 ? mb / dt : 0.0,
+            dt > 0 ? (double)c->records / dt : 0.0, tm.tm_hour, tm.tm_min, tm.tm_sec, feed);
+}
+
+#endif
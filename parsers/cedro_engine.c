@@ -0,0 +1,594 @@
+// cedro_engine.c - um processo, uma leitura do feed: parser_T, parser_B, parser_V, parser_Z e renko
+//
+// Hoje o coletor grava cada linha duas vezes (_raw_data.txt e o arquivo do
+// tipo) e cada parser abre, relê e tokeniza o seu arquivo. O engine lê o raw
+// uma vez (arquivo, arquivo seguido ou o anel do coletor --shm) e reparte os
+// registros pelo prefixo do payload em filas de um produtor e um consumidor
+// (cedro_engine.h), uma por tipo. Cada parser roda inteiro numa thread presa
+// a uma CPU, com os mesmos argumentos de sempre: o engine acrescenta
+// "--shm engine" e o parser, compilado com -DCEDRO_ENGINE, lê a sua fila pelo
+// caminho do --shm (cedro_shm.h). As saídas são as do parser rodando sozinho
+// em --shm, com o {ymd} dos caminhos e a data das barras tirados dos
+// registros (cshm_next_day), não do relógio: um raw de outro dia sai com a
+// data dele. Sem --follow, no fim do arquivo as filas fecham, cada parser
+// fecha as últimas barras e o engine termina.
+//
+// --renko liga o builder do gerarenko numa thread a mais, com as linhas B:/V:
+// do feed sem o prefixo do coletor (o formato do raw que ele espera) e as
+// mesmas saídas em /home/grao/dados/renko_files, um dia por vez.
+//
+// Erro de argumento num parser derruba o engine, como derrubaria o parser
+// sozinho. Parser que volta antes do fim da entrada (--to, saída que não
+// abriu) só sai: a fila dele passa a descartar e os outros seguem.
+//
+// Build: ./build_cedro_engine.sh (cada parser e o gerarenko compilados com
+// -DCEDRO_ENGINE, que troca o main de cada um por parser_X_main)
+//
+// Uso:
+//   ./cedro_engine --raw /home/grao/dados/cedro_files/{ymd}_raw_data.txt --follow
+//       --t-args "--output-template /home/grao/dados/sab/{ymd}_T_{bar}s.csv --symbols WING26,WDOF26 --rotate-daily --bar-sec 1,5,60"
+//       --b-args "--live --out-dir /home/grao/dados/sab --bar-sec 1,5,60"
+//       --v-args "--live --out-dir /home/grao/dados/sab"
+//       --z-args "--out-template /home/grao/dados/sab/{ymd}_ztop_signal_1s.csv --state-dir /home/grao/dados/state --symbols WING26,WDOF26"
+//       --renko
+//   ./cedro_engine --shm cedro ...        (lê os quatro canais do leitorwebsocket --shm cedro)
+//   ./cedro_engine --raw /home/grao/dados/cedro_files/20251222_raw_data.txt ...   (o dia inteiro e sai)
+//
+// --raw PATH: {ymd} vira a data de hoje (e a de amanhã na virada, com --follow);
+//   sem --follow, o .zst do dia arquivado também serve (cedro_zst.h).
+// --follow: segue o arquivo por inotify (cedro_tail.h) em vez de sair no fim.
+// --cpus LISTA: CPUs do leitor, T, B, V, Z e renko, nessa ordem (só dos
+//   ligados); default: as CPUs permitidas ao processo, em rodízio. --no-pin
+//   deixa o escalonador decidir.
+// --queue-mb N: tamanho de cada fila (default 16).
+#define _GNU_SOURCE
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cedro_catchup.h"
+#include "cedro_engine.h"
+#include "cedro_gap.h"
+#include "cedro_journal.h"
+#include "cedro_mmap_tail.h"
+#include "cedro_shm.h"
+#include "cedro_tail.h"
+#include "cedro_zst.h"
+
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+#define CE_MAX_ARGS 64
+#define CE_STACK_BYTES (16u << 20)   // os parsers têm buffers grandes na pilha do main
+
+// main de cada parser (parser_X.c com -DCEDRO_ENGINE) e o builder do gerarenko
+int parser_T_main(int argc, char **argv);
+int parser_B_main(int argc, char **argv);
+int parser_V_main(int argc, char **argv);
+int parser_Z_main(int argc, char **argv);
+void gerarenko_engine_run(void);
+
+enum { H_T, H_B, H_V, H_Z, H_RENKO, H_COUNT };
+
+typedef struct {
+    const char *name;
+    char type;                 // tipo do feed; 0 = renko (B e V)
+    int (*main_fn)(int, char **);
+    int on;
+    char *args;                // --x-args, separados por espaço
+    char *argv[CE_MAX_ARGS + 4];
+    int argc;
+    int cpu;                   // -1 = sem afinidade
+    CeQueue q;
+    long long records;
+    pthread_t th;
+} Handler;
+
+typedef struct {
+    char raw[PATH_MAX];
+    char shm[128];
+    int follow;
+    int pin;
+    char cpus[256];
+    uint64_t queue_bytes;
+} Args;
+
+static Handler g_h[H_COUNT] = {
+    {.name = "parser_T", .type = 'T', .main_fn = parser_T_main},
+    {.name = "parser_B", .type = 'B', .main_fn = parser_B_main},
+    {.name = "parser_V", .type = 'V', .main_fn = parser_V_main},
+    {.name = "parser_Z", .type = 'Z', .main_fn = parser_Z_main},
+    {.name = "renko", .type = 0, .main_fn = NULL},
+};
+
+static void die(const char *msg) {
+    fprintf(stderr, "ERRO: %s\n", msg);
+    exit(2);
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+        "Uso: %s (--raw <path|tmpl {ymd}> [--follow] | --shm <nome>)\n"
+        "       [--t-args \"...\"] [--b-args \"...\"] [--v-args \"...\"] [--z-args \"...\"] [--renko]\n"
+        "       [--cpus 0,2,3,4,5,6 | --no-pin] [--queue-mb 16]\n"
+        "  --x-args: argumentos do parser_X (sem --shm/--input: o engine entrega o feed)\n"
+        "  --cpus: CPUs do leitor, T, B, V, Z e renko, nessa ordem (só dos ligados)\n",
+        argv0);
+}
+
+static Args parse_args(int argc, char **argv) {
+    Args a;
+    memset(&a, 0, sizeof(a));
+    a.pin = 1;
+    a.queue_bytes = CE_DEFAULT_QUEUE_BYTES;
+    for (int i = 1; i < argc; i++) {
+        const char *k = argv[i];
+        const int has = i + 1 < argc;
+        if (!strcmp(k, "--raw") && has) snprintf(a.raw, sizeof(a.raw), "%s", argv[++i]);
+        else if (!strcmp(k, "--shm") && has) snprintf(a.shm, sizeof(a.shm), "%s", argv[++i]);
+        else if (!strcmp(k, "--follow")) a.follow = 1;
+        else if (!strcmp(k, "--t-args") && has) g_h[H_T].args = argv[++i];
+        else if (!strcmp(k, "--b-args") && has) g_h[H_B].args = argv[++i];
+        else if (!strcmp(k, "--v-args") && has) g_h[H_V].args = argv[++i];
+        else if (!strcmp(k, "--z-args") && has) g_h[H_Z].args = argv[++i];
+        else if (!strcmp(k, "--renko")) g_h[H_RENKO].on = 1;
+        else if (!strcmp(k, "--cpus") && has) snprintf(a.cpus, sizeof(a.cpus), "%s", argv[++i]);
+        else if (!strcmp(k, "--no-pin")) a.pin = 0;
+        else if (!strcmp(k, "--queue-mb") && has) a.queue_bytes = (uint64_t)atoi(argv[++i]) << 20;
+        else if (!strcmp(k, "-h") || !strcmp(k, "--help")) { usage(argv[0]); exit(0); }
+        else {
+            fprintf(stderr, "ERRO: argumento desconhecido: %s\n", k);
+            usage(argv[0]);
+            exit(2);
+        }
+    }
+    for (int i = 0; i < H_RENKO; i++) g_h[i].on = g_h[i].args != NULL;
+    if (!a.raw[0] == !a.shm[0]) { usage(argv[0]); exit(2); }
+    if (a.shm[0] && a.follow) die("--follow é só para --raw");
+    if (a.queue_bytes < (1u << 20)) die("--queue-mb precisa ser >= 1");
+    int any = 0;
+    for (int i = 0; i < H_COUNT; i++) any |= g_h[i].on;
+    if (!any) die("nada para rodar: informe --t-args, --b-args, --v-args, --z-args ou --renko");
+    return a;
+}
+
+// argv do parser: nome, --x-args quebrado em espaços, --shm engine
+static void build_argv(Handler *h) {
+    h->argc = 0;
+    h->argv[h->argc++] = (char *)h->name;
+    char *save = NULL;
+    for (char *t = strtok_r(h->args, " \t", &save); t; t = strtok_r(NULL, " \t", &save)) {
+        if (h->argc >= CE_MAX_ARGS) die("argumentos demais num --x-args");
+        h->argv[h->argc++] = t;
+    }
+    h->argv[h->argc++] = (char *)"--shm";
+    h->argv[h->argc++] = (char *)"engine";
+    h->argv[h->argc] = NULL;
+}
+
+// ---------- filas ----------
+
+CeQueue *ce_engine_queue(char type) {
+    for (int i = 0; i < H_RENKO; i++) {
+        if (g_h[i].on && g_h[i].type == type) return &g_h[i].q;
+    }
+    return NULL;
+}
+
+static void route(const CjRecordHeader *h, const char *payload) {
+    if (h->type == CJ_TYPE_GAP) {
+        for (int i = 0; i < H_RENKO; i++) {
+            if (g_h[i].on) ce_push(&g_h[i].q, h, payload);
+        }
+        return;
+    }
+    for (int i = 0; i < H_RENKO; i++) {
+        if (g_h[i].on && g_h[i].type == (char)h->type) {
+            ce_push(&g_h[i].q, h, payload);
+            g_h[i].records++;
+            break;
+        }
+    }
+    if (g_h[H_RENKO].on && (h->type == 'B' || h->type == 'V')) {
+        ce_push(&g_h[H_RENKO].q, h, payload);
+        g_h[H_RENKO].records++;
+    }
+}
+
+static void close_all(void) {
+    for (int i = 0; i < H_COUNT; i++) {
+        if (g_h[i].on) ce_close(&g_h[i].q);
+    }
+}
+
+// ---------- renko: a fila vira um FILE* com as linhas de um dia ----------
+
+static CjRecord g_rk_rec;
+static char *g_rk_buf;
+static size_t g_rk_cap;
+static int g_rk_have;          // g_rk_rec lido e ainda não entregue
+static size_t g_rk_off;        // bytes de g_rk_rec já entregues
+static char g_rk_day[9];
+
+// Próximo registro da fila de renko; 0 se a entrada acabou
+static int rk_fetch(int block) {
+    if (g_rk_have) return 1;
+    CeQueue *q = &g_h[H_RENKO].q;
+    for (;;) {
+        if (ce_pop(q, &g_rk_rec, &g_rk_buf, &g_rk_cap) > 0) {
+            g_rk_have = 1;
+            g_rk_off = 0;
+            return 1;
+        }
+        if (!block || ce_drained(q)) return 0;
+        ce_wait(q);
+    }
+}
+
+static void rk_day(char out[9]) {
+    int sec;
+    cj_ymd_sec(&g_rk_rec, out, &sec);
+}
+
+// Dia do próximo registro. O que sobrou do dia anterior (o builder parou
+// antes do EOF, ex.: não criou os CSVs) é descartado.
+int ce_renko_next_day(char day[9]) {
+    while (rk_fetch(1)) {
+        char d[9];
+        rk_day(d);
+        if (strcmp(d, g_rk_day) != 0) {
+            memcpy(g_rk_day, d, sizeof(g_rk_day));
+            memcpy(day, d, 9);
+            return 1;
+        }
+        g_rk_have = 0;
+    }
+    return 0;
+}
+
+// Entrega payload + '\n'; EOF no primeiro registro de outro dia ou no fim
+static ssize_t rk_read(void *cookie, char *buf, size_t n) {
+    (void)cookie;
+    size_t got = 0;
+    while (got < n) {
+        if (!rk_fetch(got == 0)) break;
+        if (g_rk_off == 0) {
+            char d[9];
+            rk_day(d);
+            if (strcmp(d, g_rk_day) != 0) break;
+        }
+        const size_t len = (size_t)g_rk_rec.h.len + 1;
+        g_rk_rec.payload[len - 1] = '\n';
+        size_t c = len - g_rk_off;
+        if (c > n - got) c = n - got;
+        memcpy(buf + got, g_rk_rec.payload + g_rk_off, c);
+        got += c;
+        g_rk_off += c;
+        if (g_rk_off == len) g_rk_have = 0;
+    }
+    return (ssize_t)got;
+}
+
+static int rk_close(void *cookie) {
+    (void)cookie;
+    return 0;
+}
+
+FILE *ce_renko_fopen(const char *path, const char *mode) {
+    (void)path;
+    (void)mode;
+    cookie_io_functions_t io;
+    memset(&io, 0, sizeof(io));
+    io.read = rk_read;
+    io.close = rk_close;
+    return fopencookie(NULL, "r", io);
+}
+
+// ---------- threads ----------
+
+static void *handler_thread(void *arg) {
+    Handler *h = (Handler *)arg;
+    if (h->main_fn) h->main_fn(h->argc, h->argv);
+    else gerarenko_engine_run();
+    ce_abandon(&h->q);
+    return NULL;
+}
+
+// CPUs do processo em ordem; n = quantas
+static int allowed_cpus(int *out, int max) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return 0;
+    int n = 0;
+    for (int c = 0; c < CPU_SETSIZE && n < max; c++) {
+        if (CPU_ISSET(c, &set)) out[n++] = c;
+    }
+    return n;
+}
+
+// CPU de cada thread: leitor primeiro, depois os handlers ligados
+static int assign_cpus(const Args *a) {
+    int list[CPU_SETSIZE];
+    int n = 0;
+    if (a->cpus[0]) {
+        char tmp[256];
+        snprintf(tmp, sizeof(tmp), "%s", a->cpus);
+        char *save = NULL;
+        for (char *t = strtok_r(tmp, ",", &save); t && n < CPU_SETSIZE; t = strtok_r(NULL, ",", &save)) {
+            list[n++] = atoi(t);
+        }
+    } else {
+        n = allowed_cpus(list, CPU_SETSIZE);
+    }
+    if (!a->pin || n == 0) {
+        for (int i = 0; i < H_COUNT; i++) g_h[i].cpu = -1;
+        return -1;
+    }
+    int k = 1;
+    for (int i = 0; i < H_COUNT; i++) {
+        if (g_h[i].on) g_h[i].cpu = list[k++ % n];
+    }
+    return list[0];
+}
+
+static void pin_self(int cpu) {
+    if (cpu < 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    const int e = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (e != 0) fprintf(stderr, "AVISO: CPU %d para o leitor: %s\n", cpu, strerror(e));
+}
+
+static void start_handlers(void) {
+    for (int i = 0; i < H_COUNT; i++) {
+        Handler *h = &g_h[i];
+        if (!h->on) continue;
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setstacksize(&attr, CE_STACK_BYTES);
+        if (h->cpu >= 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(h->cpu, &set);
+            pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+        }
+        int e = pthread_create(&h->th, &attr, handler_thread, h);
+        if (e == EINVAL && h->cpu >= 0) {
+            // CPU fora do permitido: roda sem afinidade
+            fprintf(stderr, "AVISO: CPU %d inválida para %s, sem afinidade\n", h->cpu, h->name);
+            pthread_attr_destroy(&attr);
+            pthread_attr_init(&attr);
+            pthread_attr_setstacksize(&attr, CE_STACK_BYTES);
+            h->cpu = -1;
+            e = pthread_create(&h->th, &attr, handler_thread, h);
+        }
+        pthread_attr_destroy(&attr);
+        if (e != 0) {
+            fprintf(stderr, "ERRO: thread de %s: %s\n", h->name, strerror(e));
+            exit(1);
+        }
+    }
+}
+
+// ---------- leitura do raw ----------
+
+static void today_ymd(char out[9]) {
+    time_t t = time(NULL);
+    struct tm tm;
+    localtime_r(&t, &tm);
+    strftime(out, 9, "%Y%m%d", &tm);
+}
+
+static void raw_path(const char *tmpl, const char *ymd, char *out, size_t out_sz) {
+    const char *p = strstr(tmpl, "{ymd}");
+    if (p) snprintf(out, out_sz, "%.*s%s%s", (int)(p - tmpl), tmpl, ymd, p + 5);
+    else snprintf(out, out_sz, "%s", tmpl);
+}
+
+// "YYYYMMDD_HHMMSS" (UTC-3, prefixo do coletor) -> epoch; o inverso do
+// cj_local_tm, independente do TZ da máquina. Cacheia o último (o feed manda
+// milhares por segundo)
+static time_t ts_epoch(const char *ts) {
+    static char last[16];
+    static time_t last_t = (time_t)-1;
+    if (last_t != (time_t)-1 && memcmp(ts, last, 15) == 0) return last_t;
+    for (int i = 0; i < 15; i++) {
+        if (i == 8 ? ts[i] != '_' : (ts[i] < '0' || ts[i] > '9')) return (time_t)-1;
+    }
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = (ts[0] - '0') * 1000 + (ts[1] - '0') * 100 + (ts[2] - '0') * 10 + (ts[3] - '0') - 1900;
+    tm.tm_mon = (ts[4] - '0') * 10 + (ts[5] - '0') - 1;
+    tm.tm_mday = (ts[6] - '0') * 10 + (ts[7] - '0');
+    tm.tm_hour = (ts[9] - '0') * 10 + (ts[10] - '0');
+    tm.tm_min = (ts[11] - '0') * 10 + (ts[12] - '0');
+    tm.tm_sec = (ts[13] - '0') * 10 + (ts[14] - '0');
+    memcpy(last, ts, 15);
+    last_t = timegm(&tm) + 3 * 3600;
+    return last_t;
+}
+
+// Linha "ts,len,delta,payload" do raw -> registro; 0 se não é de um tipo do feed
+static int raw_record(char *line, size_t n, CjRecordHeader *h, const char **payload) {
+    while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r')) line[--n] = '\0';
+    const char *p = cedro_gap_payload(line);
+    if (!p || p - line < 16) return 0;
+    char type;
+    if (cedro_gap_kind(p)) type = CJ_TYPE_GAP;
+    else if (p[1] == ':' && cshm_channel_of(p[0]) >= 0) type = p[0];
+    else return 0;
+    const time_t t = ts_epoch(line);
+    if (t == (time_t)-1) return 0;
+    memset(h, 0, sizeof(*h));
+    h->type = (uint8_t)type;
+    h->symbol_id = 0xFFFF;
+    h->len = (uint32_t)(n - (size_t)(p - line));
+    h->realtime_ns = (uint64_t)t * 1000000000ull;
+    *payload = p;
+    return 1;
+}
+
+// Arquivo inteiro (ou seguido, com --follow); volta no fim da entrada
+static void read_raw(const Args *a, long long *bytes) {
+    char ymd[9];
+    today_ymd(ymd);
+    char path[PATH_MAX];
+    raw_path(a->raw, ymd, path, sizeof(path));
+    const int rotate = a->follow && strstr(a->raw, "{ymd}") != NULL;
+
+    CtlWatch cw;
+    memset(&cw, 0, sizeof(cw));
+    cw.fd = -1;
+    if (a->follow) {
+        ctl_init(&cw);
+        ctl_follow(&cw, path);
+    }
+    CmtTail tail;
+    memset(&tail, 0, sizeof(tail));
+    FILE *in = NULL;
+    char *line = NULL;
+    size_t cap = 0;
+    for (;;) {
+        if (!in) {
+            if (!a->follow) {
+                in = cz_fopen(path, "r");
+                if (!in) {
+                    fprintf(stderr, "ERRO: não abri %s: %s\n", path, strerror(errno));
+                    break;
+                }
+            } else {
+                in = cmt_fopen(path, "r");   // não lê a área pré-alocada do --writer mmap
+                if (!in) {
+                    ctl_wait(&cw, CTL_IDLE_MS);
+                    continue;
+                }
+                cmt_attach(&tail, path);
+            }
+            setvbuf(in, NULL, _IOFBF, 1 << 20);
+        }
+        ssize_t n;
+        while (!cmt_at_limit(&tail, in) && (n = getline(&line, &cap, in)) != -1 &&
+               !(a->follow && ctl_partial_line(in, line, (size_t)n))) {
+            *bytes += n;
+            CjRecordHeader h;
+            const char *payload;
+            if (raw_record(line, (size_t)n, &h, &payload)) route(&h, payload);
+        }
+        if (!a->follow) break;
+        clearerr(in);
+        if (rotate) {
+            char now[9];
+            today_ymd(now);
+            if (strcmp(now, ymd) != 0) {
+                // Virada do dia: o arquivo de ontem já foi fechado pelo coletor
+                memcpy(ymd, now, sizeof(ymd));
+                raw_path(a->raw, ymd, path, sizeof(path));
+                fclose(in);
+                in = NULL;
+                cmt_detach(&tail);
+                ctl_follow(&cw, path);
+                continue;
+            }
+        }
+        ctl_wait(&cw, CTL_IDLE_MS);
+    }
+    free(line);
+    if (in) fclose(in);
+    cmt_detach(&tail);
+    ctl_close(&cw);
+}
+
+// Os quatro canais do anel do coletor; não acaba
+static void read_shm(const Args *a, long long *bytes) {
+    static CshmReader sr[CSHM_CHANNELS];
+    const char types[CSHM_CHANNELS] = {'B', 'V', 'T', 'Z'};
+    int on[CSHM_CHANNELS];
+    for (int c = 0; c < CSHM_CHANNELS; c++) {
+        on[c] = ce_engine_queue(types[c]) != NULL || (g_h[H_RENKO].on && (types[c] == 'B' || types[c] == 'V'));
+        if (!on[c]) continue;
+        // Espera o coletor criar o segmento
+        while (cshm_open(&sr[c], a->shm, types[c]) != 0) usleep(100000);
+    }
+    for (;;) {
+        int got = 0;
+        for (int c = 0; c < CSHM_CHANNELS; c++) {
+            if (!on[c]) continue;
+            CjRecord rec;
+            // Um lote por canal por volta, para nenhum tipo esperar os outros
+            for (int k = 0; k < 256 && cshm_next(&sr[c], &rec) > 0; k++) {
+                got = 1;
+                *bytes += rec.h.len;
+                // Lacuna vem em todos os canais: cada cópia vai só para a fila do canal
+                if (rec.h.type == CJ_TYPE_GAP) {
+                    CeQueue *q = ce_engine_queue(types[c]);
+                    if (q) ce_push(q, &rec.h, rec.payload);
+                    continue;
+                }
+                route(&rec.h, rec.payload);
+            }
+        }
+        if (got) {
+            // A espera é sempre no primeiro canal: dado em qualquer um zera o sono dele
+            for (int c = 0; c < CSHM_CHANNELS; c++) sr[c].idle_us = 0;
+            continue;
+        }
+        for (int c = 0; c < CSHM_CHANNELS; c++) {
+            if (on[c]) { cshm_wait(&sr[c]); break; }
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    Args a = parse_args(argc, argv);
+    for (int i = 0; i < H_COUNT; i++) {
+        Handler *h = &g_h[i];
+        if (!h->on) continue;
+        if (ce_queue_init(&h->q, a.queue_bytes) != 0) die("sem memória para as filas");
+        if (h->main_fn) build_argv(h);
+    }
+    const int reader_cpu = assign_cpus(&a);
+    pin_self(reader_cpu);
+    for (int i = 0; i < H_COUNT; i++) {
+        if (!g_h[i].on) continue;
+        if (g_h[i].cpu >= 0) fprintf(stderr, "[cedro_engine] %s na CPU %d\n", g_h[i].name, g_h[i].cpu);
+        else fprintf(stderr, "[cedro_engine] %s sem afinidade\n", g_h[i].name);
+    }
+    start_handlers();
+
+    const double t0 = ccu_now();
+    long long bytes = 0;
+    if (a.shm[0]) read_shm(&a, &bytes);
+    else read_raw(&a, &bytes);
+    close_all();
+    const double t_read = ccu_now() - t0;
+    for (int i = 0; i < H_COUNT; i++) {
+        if (g_h[i].on) pthread_join(g_h[i].th, NULL);
+    }
+    const double dt = ccu_now() - t0;
+
+    fprintf(stderr, "[cedro_engine] %.1f MB lidos em %.2fs, tudo processado em %.2fs\n",
+            (double)bytes / 1e6, t_read, dt);
+    for (int i = 0; i < H_COUNT; i++) {
+        const Handler *h = &g_h[i];
+        if (!h->on) continue;
+        fprintf(stderr, "[cedro_engine] %s: %lld registros, fila cheia %llu vezes, pico %.1f MB\n",
+                h->name, h->records, (unsigned long long)h->q.full_waits, (double)h->q.high_water / 1e6);
+        if (h->q.dropped) {
+            fprintf(stderr, "[cedro_engine] %s saiu antes do fim: %llu registros descartados\n", h->name,
+                    (unsigned long long)h->q.dropped);
+        }
+    }
+    for (int i = 0; i < H_COUNT; i++) {
+        if (g_h[i].on) ce_queue_free(&g_h[i].q);
+    }
+    return 0;
+}
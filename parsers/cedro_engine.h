@@ -0,0 +1,225 @@
+// cedro_engine.h - filas em processo do cedro_engine (um produtor, um consumidor)
+//
+// O cedro_engine lê o _raw_data.txt (ou o anel do coletor) uma vez e entrega
+// cada registro na fila do tipo dele; cada parser roda numa thread do engine
+// lendo a sua fila pelo mesmo caminho do --shm (cedro_shm.h compilado com
+// -DCEDRO_ENGINE troca o segmento pela fila). O registro é o mesmo do anel:
+// CjRecordHeader + payload sem o prefixo "ts,len,delta,".
+//
+// Diferente do anel do coletor, a fila não perde registro: produtor com a
+// fila cheia espera o consumidor (ler um arquivo é mais rápido que qualquer
+// parser). Os dois lados giram um pouco antes de dormir numa condvar; parado,
+// o engine não gasta CPU.
+//
+// ce_close() marca o fim da entrada (arquivo lido até o fim): o consumidor
+// esvazia a fila e ce_drained() passa a dar 1. ce_abandon() é o contrário:
+// o consumidor saiu antes (--to, erro ao abrir a saída) e ce_push passa a
+// descartar, para o produtor não ficar preso esperando espaço numa fila que
+// ninguém mais esvazia.
+//
+// Só header, compila como C e C++.
+#ifndef CEDRO_ENGINE_H
+#define CEDRO_ENGINE_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cedro_journal.h"
+
+#define CE_DEFAULT_QUEUE_BYTES (16u << 20)
+#define CE_SPIN 2000                // voltas olhando a fila antes de dormir
+#define CE_FLAG_PAD 0x1             // resto da fila até o fim é enchimento
+
+typedef struct {
+    uint32_t size;                  // bytes do registro na fila, com alinhamento
+    uint32_t flags;                 // CE_FLAG_*
+} CeRecHeader;
+
+#define CE_REC_OVERHEAD (sizeof(CeRecHeader) + sizeof(CjRecordHeader))
+
+typedef struct {
+    char *ring;
+    uint64_t size;                  // potência de 2
+    uint64_t mask;
+    pthread_mutex_t mu;
+    pthread_cond_t cv;
+    // produtor
+    uint64_t head __attribute__((aligned(64)));   // fim do último registro publicado (release)
+    int closed;
+    uint64_t full_waits;            // vezes que o produtor esperou a fila
+    uint64_t high_water;            // maior ocupação vista pelo produtor
+    uint64_t dropped;               // registros descartados depois de ce_abandon
+    // consumidor
+    uint64_t tail __attribute__((aligned(64)));   // fim do último registro consumido (release)
+    int sleeping;                   // 1 = algum lado dormindo na condvar
+    int abandoned;                  // 1 = consumidor saiu (ce_abandon)
+} CeQueue;
+
+// bytes é arredondado para potência de 2; 0 se ok
+static inline int ce_queue_init(CeQueue *q, uint64_t bytes) {
+    memset(q, 0, sizeof(*q));
+    uint64_t size = 1u << 16;
+    while (size < bytes) size <<= 1;
+    q->ring = (char *)malloc((size_t)size);
+    if (!q->ring) return -1;
+    q->size = size;
+    q->mask = size - 1;
+    pthread_mutex_init(&q->mu, NULL);
+    pthread_cond_init(&q->cv, NULL);
+    return 0;
+}
+
+static inline void ce_queue_free(CeQueue *q) {
+    if (!q->ring) return;
+    free(q->ring);
+    pthread_mutex_destroy(&q->mu);
+    pthread_cond_destroy(&q->cv);
+    q->ring = NULL;
+}
+
+static inline void ce_wake(CeQueue *q) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&q->sleeping, __ATOMIC_RELAXED)) return;
+    pthread_mutex_lock(&q->mu);
+    pthread_cond_broadcast(&q->cv);
+    pthread_mutex_unlock(&q->mu);
+}
+
+// Há dado para o consumidor (want_data) ou espaço need para o produtor?
+static inline int ce_ready(CeQueue *q, int want_data, uint64_t need) {
+    if (want_data) {
+        return __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) != q->tail ||
+               __atomic_load_n(&q->closed, __ATOMIC_ACQUIRE);
+    }
+    return __atomic_load_n(&q->abandoned, __ATOMIC_ACQUIRE) ||
+           q->head + need - __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE) <= q->size;
+}
+
+// Gira CE_SPIN voltas e depois dorme até ce_ready (teto de 100 ms por volta,
+// só por garantia: o outro lado sempre acorda quem marcou sleeping)
+static inline void ce_block(CeQueue *q, int want_data, uint64_t need) {
+    for (int i = 0; i < CE_SPIN; i++) {
+        if (ce_ready(q, want_data, need)) return;
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+    pthread_mutex_lock(&q->mu);
+    __atomic_store_n(&q->sleeping, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    while (!ce_ready(q, want_data, need)) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += 100000000L;
+        if (ts.tv_nsec >= 1000000000L) { ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
+        pthread_cond_timedwait(&q->cv, &q->mu, &ts);
+    }
+    __atomic_store_n(&q->sleeping, 0, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&q->mu);
+}
+
+// Publica um registro; com a fila cheia, espera o consumidor (ou descarta,
+// se ele já saiu)
+static inline void ce_push(CeQueue *q, const CjRecordHeader *h, const char *payload) {
+    const uint64_t need = (CE_REC_OVERHEAD + h->len + 7) & ~(uint64_t)7;
+    if (need > q->size / 2) return;   // não acontece com linha do feed
+    uint64_t off = q->head & q->mask;
+    const uint64_t pad = off + need > q->size ? q->size - off : 0;
+    if (!ce_ready(q, 0, pad + need)) {
+        q->full_waits++;
+        ce_block(q, 0, pad + need);
+    }
+    if (__atomic_load_n(&q->abandoned, __ATOMIC_ACQUIRE)) {
+        q->dropped++;
+        return;
+    }
+    const uint64_t used = q->head + pad + need - __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+    if (used > q->high_water) q->high_water = used;
+    uint64_t pos = q->head;
+    if (pad) {
+        CeRecHeader ph = {(uint32_t)pad, CE_FLAG_PAD};
+        memcpy(q->ring + off, &ph, sizeof(ph));
+        pos += pad;
+        off = 0;
+    }
+    CeRecHeader rh = {(uint32_t)need, 0};
+    memcpy(q->ring + off, &rh, sizeof(rh));
+    memcpy(q->ring + off + sizeof(rh), h, sizeof(*h));
+    memcpy(q->ring + off + CE_REC_OVERHEAD, payload, h->len);
+    __atomic_store_n(&q->head, pos + need, __ATOMIC_RELEASE);
+    ce_wake(q);
+}
+
+// Fim da entrada: nada mais vai ser publicado
+static inline void ce_close(CeQueue *q) {
+    __atomic_store_n(&q->closed, 1, __ATOMIC_RELEASE);
+    ce_wake(q);
+}
+
+// Consumidor saiu: acorda o produtor se estiver esperando espaço
+static inline void ce_abandon(CeQueue *q) {
+    __atomic_store_n(&q->abandoned, 1, __ATOMIC_RELEASE);
+    ce_wake(q);
+}
+
+// Próximo registro, copiado para *buf (payload terminado em '\0', válido até
+// a próxima chamada). 1 = rec preenchido, 0 = fila vazia.
+static inline int ce_pop(CeQueue *q, CjRecord *rec, char **buf, size_t *cap) {
+    for (;;) {
+        const uint64_t head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+        if (q->tail == head) return 0;
+        const uint64_t off = q->tail & q->mask;
+        CeRecHeader rh;
+        memcpy(&rh, q->ring + off, sizeof(rh));
+        if (rh.flags & CE_FLAG_PAD) {
+            __atomic_store_n(&q->tail, q->tail + rh.size, __ATOMIC_RELEASE);
+            continue;
+        }
+        if ((size_t)rh.size + 1 > *cap) {
+            size_t c = *cap ? *cap : 4096;
+            while (c < (size_t)rh.size + 1) c *= 2;
+            char *nb = (char *)realloc(*buf, c);
+            if (!nb) return 0;
+            *buf = nb;
+            *cap = c;
+        }
+        memcpy(&rec->h, q->ring + off + sizeof(rh), sizeof(rec->h));
+        memcpy(*buf, q->ring + off + CE_REC_OVERHEAD, rec->h.len);
+        (*buf)[rec->h.len] = '\0';
+        __atomic_store_n(&q->tail, q->tail + rh.size, __ATOMIC_RELEASE);
+        ce_wake(q);
+        rec->payload = *buf;
+        rec->symbol = "";
+        rec->offset = -1;
+        return 1;
+    }
+}
+
+// Sem dados: espera o produtor publicar (ou fechar a fila)
+static inline void ce_wait(CeQueue *q) {
+    ce_block(q, 1, 0);
+}
+
+// Entrada acabou e a fila foi esvaziada
+static inline int ce_drained(CeQueue *q) {
+    return __atomic_load_n(&q->closed, __ATOMIC_ACQUIRE) &&
+           __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) == q->tail;
+}
+
+// Definidos no cedro_engine.c: fila do parser do tipo ('T','B','V','Z') e a
+// entrada do builder de renko (linhas B:/V: de um dia, como no raw antigo)
+#ifdef __cplusplus
+extern "C" {
+#endif
+CeQueue *ce_engine_queue(char type);
+FILE *ce_renko_fopen(const char *path, const char *mode);
+int ce_renko_next_day(char day[9]);
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,69 @@
+// cedro_gap.h - marcadores de lacuna gravados pelo leitorwebsocket
+//
+// Quando a conexão com o feed cai (erro, EOF ou travamento detectado), o
+// coletor grava em raw e em todos os arquivos por tipo um registro
+//   ts,0,0,GAP_START:<motivo>
+// e, quando chegam os primeiros dados da nova conexão,
+//   ts,0,<ms sem dados>,GAP_END:<ms sem dados>
+// No journal (.cj) o mesmo payload vai num registro tipo CJ_TYPE_GAP.
+//
+// Depois de uma reconexão o servidor manda o book de novo desde o início, então
+// quem mantém book (parser_B, parser_Z) deve zerá-lo no marcador em vez de
+// aplicar as atualizações por cima do estado de antes da lacuna.
+//
+// Com o coletor dividido em sessões (leitorwebsocket --sessions N), a queda de
+// uma sessão só afeta os símbolos dela, que vão no fim do payload separados por
+// ';' ("GAP_START:eof;WINZ26;WDOZ26"). cedro_gap_covers() diz se o book de um
+// símbolo deve ser zerado; marcador sem lista vale para todos.
+//
+// Só header, compila como C e C++.
+#ifndef CEDRO_GAP_H
+#define CEDRO_GAP_H
+
+#include <string.h>
+
+#define CEDRO_GAP_START "GAP_START"
+#define CEDRO_GAP_END "GAP_END"
+
+enum { CEDRO_GAP_NONE = 0, CEDRO_GAP_BEGIN = 1, CEDRO_GAP_FINISH = 2 };
+
+// Tipo do marcador no payload (sem o prefixo ts,len,delta)
+static inline int cedro_gap_kind(const char *payload) {
+    if (payload[0] != 'G' || payload[1] != 'A' || payload[2] != 'P') return CEDRO_GAP_NONE;
+    if (strncmp(payload, CEDRO_GAP_START ":", sizeof(CEDRO_GAP_START)) == 0) return CEDRO_GAP_BEGIN;
+    if (strncmp(payload, CEDRO_GAP_END ":", sizeof(CEDRO_GAP_END)) == 0) return CEDRO_GAP_FINISH;
+    return CEDRO_GAP_NONE;
+}
+
+// Payload de uma linha com prefixo "ts,len,delta,payload" (NULL se não tem)
+static inline const char *cedro_gap_payload(const char *line) {
+    const char *p = line;
+    for (int commas = 0; commas < 3; commas++) {
+        p = strchr(p, ',');
+        if (!p) return NULL;
+        p++;
+    }
+    return p;
+}
+
+// Mesmo teste numa linha com prefixo "ts,len,delta,payload"
+static inline int cedro_gap_line(const char *line) {
+    const char *p = cedro_gap_payload(line);
+    return p ? cedro_gap_kind(p) : CEDRO_GAP_NONE;
+}
+
+// A lacuna do marcador atinge symbol? (payload termina em '\0', '\r' ou '\n')
+static inline int cedro_gap_covers(const char *payload, const char *symbol) {
+    const char *p = payload;
+    while (*p && *p != ';' && *p != '\r' && *p != '\n') p++;
+    if (*p != ';') return 1;
+    const size_t n = strlen(symbol);
+    while (*p == ';') {
+        const char *s = ++p;
+        while (*p && *p != ';' && *p != '\r' && *p != '\n') p++;
+        if ((size_t)(p - s) == n && strncmp(s, symbol, n) == 0) return 1;
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,173 @@
+// cedro_index.h - índice por minuto dos arquivos do dia ("<arquivo>.idx")
+//
+// O leitorwebsocket grava, ao lado de _raw_data.txt e de cada _B/_V/_T/_Z.txt,
+// um "<arquivo>.idx" em texto, uma linha por minuto e por símbolo:
+//   HH:MM SIMBOLO OFFSET LINHAS
+// OFFSET é o byte da primeira linha do símbolo no minuto e LINHAS quantas ele
+// teve; SIMBOLO "*" é o minuto inteiro (inclui os marcadores de lacuna). O
+// minuto é o do carimbo ts do registro (relógio do coletor). As linhas de um
+// minuto saem quando chega o minuto seguinte ou o dia fecha, então o minuto em
+// curso ainda não está no índice. Coletor reiniciado no mesmo dia continua o
+// .idx; um minuto repetido vale pelo menor offset.
+// Arquivo antigo sem índice: leitorwebsocket --index ARQ gera o .idx depois.
+//
+// ci_seek_offset() diz de onde ler para pegar tudo a partir de HH:MM:SS (só
+// dos símbolos pedidos, se houver). O parser ainda descarta as linhas do
+// minuto anteriores ao --from. O --archive não comprime o .idx e os offsets
+// são do conteúdo original, que o cz_fopen do .zst entrega igual.
+//
+// Só header, compila como C e C++.
+#ifndef CEDRO_INDEX_H
+#define CEDRO_INDEX_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CI_SUFFIX ".idx"
+#define CI_MAX_SYMS 256
+
+// "HH:MM:SS" ou "HH:MM" -> segundos do dia; 0 se inválido
+static inline int ci_parse_hms(const char *s, int *sec) {
+    int h = 0, m = 0, x = 0;
+    const int n = sscanf(s, "%d:%d:%d", &h, &m, &x);
+    if (n < 2 || h < 0 || h > 23 || m < 0 || m > 59 || x < 0 || x > 59) return 0;
+    *sec = h * 3600 + m * 60 + (n == 3 ? x : 0);
+    return 1;
+}
+
+// Segundos do dia do ts "YYYYMMDD_HHMMSS" no início de uma linha; -1 se não tem
+static inline int ci_line_sec(const char *line) {
+    for (int i = 0; i < 8; i++) {
+        if (line[i] < '0' || line[i] > '9') return -1;
+    }
+    if (line[8] != '_') return -1;
+    for (int i = 9; i < 15; i++) {
+        if (line[i] < '0' || line[i] > '9') return -1;
+    }
+    return ((line[9] - '0') * 10 + (line[10] - '0')) * 3600 + ((line[11] - '0') * 10 + (line[12] - '0')) * 60 +
+           (line[13] - '0') * 10 + (line[14] - '0');
+}
+
+// ---------- escrita (leitorwebsocket) ----------
+
+typedef struct {
+    char sym[32];
+    uint64_t off;
+    uint32_t lines;
+} CiSym;
+
+typedef struct {
+    char path[4096];            // "<arquivo>.idx"; vazio = desligado
+    int minute;                 // HH*60+MM em curso, -1 nenhum
+    uint64_t off;
+    uint32_t lines;
+    int nsyms;
+    CiSym syms[CI_MAX_SYMS];
+} CiWriter;
+
+// data_path NULL = índice desligado
+static inline void ci_writer_open(CiWriter *w, const char *data_path) {
+    w->minute = -1;
+    w->nsyms = 0;
+    w->path[0] = '\0';
+    if (data_path && snprintf(w->path, sizeof(w->path), "%s%s", data_path, CI_SUFFIX) >= (int)sizeof(w->path)) w->path[0] = '\0';
+}
+
+// Grava o minuto em curso (fim de minuto ou fechamento do dia)
+static inline void ci_writer_flush(CiWriter *w) {
+    if (w->minute < 0 || !w->path[0]) {
+        w->minute = -1;
+        return;
+    }
+    FILE *f = fopen(w->path, "a");
+    if (f) {
+        const int hh = w->minute / 60, mm = w->minute % 60;
+        fprintf(f, "%02d:%02d * %llu %u\n", hh, mm, (unsigned long long)w->off, w->lines);
+        for (int i = 0; i < w->nsyms; i++) {
+            fprintf(f, "%02d:%02d %s %llu %u\n", hh, mm, w->syms[i].sym, (unsigned long long)w->syms[i].off,
+                    w->syms[i].lines);
+        }
+        fclose(f);
+    }
+    w->minute = -1;
+    w->nsyms = 0;
+}
+
+// Linha com carimbo ts ("YYYYMMDD_HHMMSS") que começa no byte off do arquivo;
+// sym/sym_len do payload (NULL/0 em marcador de lacuna)
+static inline void ci_writer_add(CiWriter *w, const char *ts, const char *sym, size_t sym_len, uint64_t off) {
+    if (!w->path[0]) return;
+    const int minute = ((ts[9] - '0') * 10 + (ts[10] - '0')) * 60 + (ts[11] - '0') * 10 + (ts[12] - '0');
+    if (minute != w->minute) {
+        ci_writer_flush(w);
+        w->minute = minute;
+        w->off = off;
+        w->lines = 0;
+    }
+    w->lines++;
+    if (!sym_len || sym_len >= sizeof(w->syms[0].sym)) return;
+    for (int i = 0; i < w->nsyms; i++) {
+        CiSym *s = &w->syms[i];
+        if (strncmp(s->sym, sym, sym_len) == 0 && s->sym[sym_len] == '\0') {
+            s->lines++;
+            return;
+        }
+    }
+    if (w->nsyms == CI_MAX_SYMS) return;   // o "*" ainda cobre
+    CiSym *s = &w->syms[w->nsyms++];
+    memcpy(s->sym, sym, sym_len);
+    s->sym[sym_len] = '\0';
+    s->off = off;
+    s->lines = 1;
+}
+
+// ---------- leitura (parsers) ----------
+
+// sym casa com algum item de list ("WING26,WDOF26" ou raízes "WIN,WDO")?
+static inline int ci_symbol_in(const char *sym, const char *list) {
+    const char *p = list;
+    while (*p) {
+        const char *e = strchr(p, ',');
+        const size_t n = e ? (size_t)(e - p) : strlen(p);
+        if (n > 0 && strncmp(sym, p, n) == 0) return 1;
+        if (!e) break;
+        p = e + 1;
+    }
+    return 0;
+}
+
+// Offset de onde ler para ter todas as linhas com ts >= from_sec dos símbolos
+// de symbols (NULL ou "" = todos): o começo do último minuto indexado até
+// from ou, se os símbolos aparecem no índice a partir de from, a primeira
+// linha deles. 0 se from é antes do índice; -1 se não há .idx.
+static inline long long ci_seek_offset(const char *data_path, int from_sec, const char *symbols) {
+    char path[4096];
+    if (snprintf(path, sizeof(path), "%s%s", data_path, CI_SUFFIX) >= (int)sizeof(path)) return -1;
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    const int target = from_sec / 60;
+    int base_min = -1;
+    long long base = 0, sym_off = -1;
+    char line[256], sym[64];
+    while (fgets(line, sizeof(line), f)) {
+        int hh, mm;
+        unsigned long long off;
+        unsigned lines;
+        if (sscanf(line, "%d:%d %63s %llu %u", &hh, &mm, sym, &off, &lines) != 5) continue;
+        const int minute = hh * 60 + mm;
+        if (strcmp(sym, "*") == 0) {
+            if (minute <= target && (minute > base_min || (minute == base_min && (long long)off < base))) {
+                base_min = minute;
+                base = (long long)off;
+            }
+        } else if (symbols && *symbols && minute >= target && ci_symbol_in(sym, symbols)) {
+            if (sym_off < 0 || (long long)off < sym_off) sym_off = (long long)off;
+        }
+    }
+    fclose(f);
+    return sym_off >= 0 ? sym_off : base;
+}
+
+#endif
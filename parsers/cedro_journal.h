@@ -0,0 +1,282 @@
+// cedro_journal.h - journal binário do feed Cedro (gravado pelo leitorwebsocket --journal)
+//
+// Formato (little-endian, ordem do host x86_64):
+//   cabeçalho do arquivo (16 bytes): "CDRJ" | u16 versão | u16 tam. cabeçalho de registro | 8 bytes reservados
+//   registros: CjRecordHeader (24 bytes) + payload (len bytes, sem '\n')
+//
+// Cada registro traz o instante de recepção em ns (CLOCK_REALTIME e CLOCK_MONOTONIC;
+// com CJ_FLAG_KERNEL_TS, a chegada do bloco no kernel em vez da volta do read),
+// o tipo da mensagem ('B','V','T','Z'), o id do símbolo e o tamanho do payload.
+// Ids de símbolo valem só dentro do arquivo: antes do primeiro uso, o gravador
+// emite um registro tipo 'S' com o nome do símbolo no payload. O leitor consome
+// esses registros sozinho e expõe o nome via cj_symbol().
+//
+// Só header: os parsers C incluem direto (#include "cedro_journal.h"), sem link extra.
+// Também compila como C++ (usado pelo leitorwebsocket).
+#ifndef CEDRO_JOURNAL_H
+#define CEDRO_JOURNAL_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CJ_MAGIC "CDRJ"
+#define CJ_VERSION 1
+#define CJ_FILE_HEADER_SIZE 16
+#define CJ_MAX_SYMBOLS 1024
+#define CJ_MAX_PAYLOAD (1u << 20)
+
+#define CJ_TYPE_SYMBOL 'S'
+#define CJ_TYPE_GAP 'G'       // marcador de lacuna (cedro_gap.h), symbol_id 0xFFFF
+
+// CjRecordHeader.flags
+#define CJ_FLAG_KERNEL_TS 0x01   // timestamps = chegada no kernel (leitorwebsocket --kernel-ts)
+#define CJ_FLAG_LEG_B 0x02       // gravado da perna B (leitorwebsocket --host2)
+
+typedef struct {
+    uint64_t realtime_ns;  // CLOCK_REALTIME na recepção
+    uint64_t mono_ns;      // CLOCK_MONOTONIC na recepção
+    uint32_t len;          // bytes de payload que seguem
+    uint16_t symbol_id;
+    uint8_t type;          // 'B','V','T','Z', CJ_TYPE_SYMBOL ou CJ_TYPE_GAP
+    uint8_t flags;         // CJ_FLAG_*
+} CjRecordHeader;
+
+typedef struct {
+    CjRecordHeader h;
+    char *payload;         // terminado em '\0'; válido até a próxima chamada
+    const char *symbol;    // nome do símbolo (ou "" se desconhecido)
+    long long offset;      // offset do registro no arquivo
+} CjRecord;
+
+typedef struct {
+    FILE *f;
+    long long offset;      // próximo registro a ler
+    char *buf;
+    size_t cap;
+    int nsyms;
+    char syms[CJ_MAX_SYMBOLS][32];
+} CjReader;
+
+// ---------- gravação ----------
+
+static inline void cj_file_header(unsigned char out[CJ_FILE_HEADER_SIZE]) {
+    uint16_t ver = CJ_VERSION;
+    uint16_t rec = (uint16_t)sizeof(CjRecordHeader);
+    memset(out, 0, CJ_FILE_HEADER_SIZE);
+    memcpy(out, CJ_MAGIC, 4);
+    memcpy(out + 4, &ver, 2);
+    memcpy(out + 6, &rec, 2);
+}
+
+// Extrai o símbolo de "X:SIMBOLO:..." ; retorna o tamanho (0 se não houver)
+static inline size_t cj_payload_symbol(const char *payload, size_t len, const char **sym) {
+    if (len < 3 || payload[1] != ':') return 0;
+    const char *s = payload + 2;
+    const char *end = (const char *)memchr(s, ':', len - 2);
+    size_t n = end ? (size_t)(end - s) : (len - 2);
+    if (n == 0 || n >= 32) return 0;
+    *sym = s;
+    return n;
+}
+
+// ---------- leitura ----------
+
+static inline void cj_init(CjReader *r, FILE *f) {
+    memset(r, 0, sizeof(*r));
+    r->f = f;
+}
+
+static inline void cj_free(CjReader *r) {
+    free(r->buf);
+    r->buf = NULL;
+    r->cap = 0;
+}
+
+static inline const char *cj_symbol(const CjReader *r, uint16_t id) {
+    if (id >= r->nsyms) return "";
+    return r->syms[id];
+}
+
+// Posiciona no offset (0 = início, incluindo o cabeçalho do arquivo), que
+// deve ser fronteira de registro ou o tamanho do arquivo. Os símbolos
+// definidos antes do offset são recarregados. Se o fim estiver incompleto,
+// para no último registro inteiro e retorna 0.
+static inline int cj_seek(CjReader *r, long long off) {
+    r->offset = 0;
+    r->nsyms = 0;
+    clearerr(r->f);
+    if (off < CJ_FILE_HEADER_SIZE) return fseeko(r->f, 0, SEEK_SET) == 0;
+    if (fseeko(r->f, CJ_FILE_HEADER_SIZE, SEEK_SET) != 0) return 0;
+    r->offset = CJ_FILE_HEADER_SIZE;
+    CjRecordHeader h;
+    char name[32];
+    int ok = 1;
+    while (r->offset < off) {
+        if (fread(&h, sizeof(h), 1, r->f) != 1 || h.type == 0) { ok = 0; break; }
+        if (h.type == CJ_TYPE_SYMBOL && h.len < sizeof(name)) {
+            if (fread(name, 1, h.len, r->f) != h.len) { ok = 0; break; }
+            name[h.len] = '\0';
+            if (h.symbol_id < CJ_MAX_SYMBOLS) {
+                memcpy(r->syms[h.symbol_id], name, h.len + 1);
+                if (h.symbol_id >= r->nsyms) r->nsyms = h.symbol_id + 1;
+            }
+        } else if (r->offset + (long long)sizeof(h) + h.len > off) {
+            ok = 0;
+            break;
+        }
+        r->offset += (long long)sizeof(h) + h.len;
+        if (fseeko(r->f, (off_t)r->offset, SEEK_SET) != 0) { ok = 0; break; }
+    }
+    clearerr(r->f);
+    if (fseeko(r->f, (off_t)r->offset, SEEK_SET) != 0) return 0;
+    return ok;
+}
+
+// Lê o próximo registro de dados (registros de símbolo são consumidos aqui).
+// Retorna 1 = ok, 0 = fim do arquivo ou registro incompleto (ainda sendo
+// gravado; a posição volta para o início dele, então dá para tentar de novo
+// depois), -1 = arquivo inválido.
+static inline int cj_next(CjReader *r, CjRecord *rec) {
+    for (;;) {
+        if (r->offset == 0) {
+            unsigned char fh[CJ_FILE_HEADER_SIZE];
+            size_t n = fread(fh, 1, sizeof(fh), r->f);
+            if (n < sizeof(fh)) {
+                clearerr(r->f);
+                fseeko(r->f, 0, SEEK_SET);
+                return 0;
+            }
+            uint16_t rec_size;
+            memcpy(&rec_size, fh + 6, 2);
+            if (memcmp(fh, CJ_MAGIC, 4) != 0 || rec_size != sizeof(CjRecordHeader)) return -1;
+            r->offset = CJ_FILE_HEADER_SIZE;
+        }
+
+        CjRecordHeader h;
+        size_t n = fread(&h, 1, sizeof(h), r->f);
+        if (n < sizeof(h)) {
+            clearerr(r->f);
+            fseeko(r->f, (off_t)r->offset, SEEK_SET);
+            return 0;
+        }
+        // Tipo 0: área pré-alocada ainda não escrita (leitorwebsocket --writer mmap)
+        if (h.type == 0) {
+            fseeko(r->f, (off_t)r->offset, SEEK_SET);
+            return 0;
+        }
+        if (h.len > CJ_MAX_PAYLOAD) return -1;
+        if (r->cap < (size_t)h.len + 1) {
+            size_t cap = r->cap ? r->cap : 4096;
+            while (cap < (size_t)h.len + 1) cap *= 2;
+            char *nb = (char *)realloc(r->buf, cap);
+            if (!nb) return -1;
+            r->buf = nb;
+            r->cap = cap;
+        }
+        if (fread(r->buf, 1, h.len, r->f) != h.len) {
+            clearerr(r->f);
+            fseeko(r->f, (off_t)r->offset, SEEK_SET);
+            return 0;
+        }
+        r->buf[h.len] = '\0';
+        long long rec_off = r->offset;
+        r->offset += (long long)sizeof(h) + h.len;
+
+        if (h.type == CJ_TYPE_SYMBOL) {
+            if (h.symbol_id < CJ_MAX_SYMBOLS && h.len < 32) {
+                memcpy(r->syms[h.symbol_id], r->buf, h.len + 1);
+                if (h.symbol_id >= r->nsyms) r->nsyms = h.symbol_id + 1;
+            }
+            continue;
+        }
+
+        rec->h = h;
+        rec->payload = r->buf;
+        rec->symbol = cj_symbol(r, h.symbol_id);
+        rec->offset = rec_off;
+        return 1;
+    }
+}
+
+// Segundos epoch do registro
+static inline time_t cj_sec(const CjRecord *rec) {
+    return (time_t)(rec->h.realtime_ns / 1000000000ull);
+}
+
+// Hora do registro no relógio do prefixo dos .txt: UTC-3 fixo, como o
+// TsPrefixCache do leitorwebsocket (gmtime_r(t - 3*3600)), e não o TZ da
+// máquina. Cacheia o último segundo (o feed manda milhares por segundo). O
+// cache é por thread: no cedro_engine os parsers chamam isto ao mesmo tempo.
+static inline const struct tm *cj_local_tm(const CjRecord *rec) {
+    static __thread time_t cached_sec = (time_t)-1;
+    static __thread struct tm cached;
+    time_t sec = cj_sec(rec);
+    if (sec != cached_sec) {
+        const time_t brt = sec - 3 * 3600;
+        gmtime_r(&brt, &cached);
+        cached_sec = sec;
+    }
+    return &cached;
+}
+
+// Epoch que o caminho de texto tira do mesmo registro (mktime do prefixo
+// YYYYMMDD_HHMMSS): para o journal e o .txt darem os mesmos segundos nas
+// contas e na formatação com localtime_r, em qualquer TZ da máquina.
+static inline time_t cj_text_sec(const CjRecord *rec) {
+    static __thread time_t cached_sec = (time_t)-1;
+    static __thread time_t cached;
+    time_t sec = cj_sec(rec);
+    if (sec != cached_sec) {
+        struct tm t = *cj_local_tm(rec);
+        t.tm_isdst = -1;
+        cached = mktime(&t);
+        cached_sec = sec;
+    }
+    return cached;
+}
+
+// n dígitos de v com zeros à esquerda, sem '\0' (largura fixa, sem snprintf)
+static inline void cj_put_digits(char *p, int v, int n) {
+    for (int i = n - 1; i >= 0; i--) {
+        p[i] = (char)('0' + v % 10);
+        v /= 10;
+    }
+}
+
+// "YYYYMMDD" em p[0..8), sem '\0'
+static inline void cj_put_ymd(char *p, const struct tm *t) {
+    cj_put_digits(p, t->tm_year + 1900, 4);
+    cj_put_digits(p + 4, t->tm_mon + 1, 2);
+    cj_put_digits(p + 6, t->tm_mday, 2);
+}
+
+// write_ts "YYYYMMDD_HHMMSS" (UTC-3), como no prefixo dos .txt
+static inline void cj_write_ts(const CjRecord *rec, char out[16]) {
+    static __thread time_t cached_sec = (time_t)-1;
+    static __thread char cached[16];
+    time_t sec = cj_sec(rec);
+    if (sec != cached_sec) {
+        const struct tm *t = cj_local_tm(rec);
+        cj_put_ymd(cached, t);
+        cached[8] = '_';
+        cj_put_digits(cached + 9, t->tm_hour, 2);
+        cj_put_digits(cached + 11, t->tm_min, 2);
+        cj_put_digits(cached + 13, t->tm_sec, 2);
+        cached[15] = '\0';
+        cached_sec = sec;
+    }
+    memcpy(out, cached, 16);
+}
+
+// YYYYMMDD e segundos desde a meia-noite (UTC-3, como no prefixo dos .txt)
+static inline void cj_ymd_sec(const CjRecord *rec, char out_ymd[9], int *out_sec) {
+    const struct tm *t = cj_local_tm(rec);
+    cj_put_ymd(out_ymd, t);
+    out_ymd[8] = '\0';
+    *out_sec = t->tm_hour * 3600 + t->tm_min * 60 + t->tm_sec;
+}
+
+#endif
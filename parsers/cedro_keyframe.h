@@ -0,0 +1,328 @@
+// cedro_keyframe.h - keyframes do book do parser_B e do parser_Z ("<input>.B.kf", "<input>.Z.kf")
+//
+// O book só sai certo lendo o dia desde a abertura. A cada --kf-sec segundos de
+// feed o parser anexa ao .kf um keyframe com o book inteiro de cada símbolo e o
+// offset do input logo depois da última linha aplicada. Para continuar depois
+// de parado (live) ou começar no meio do dia (--from), carrega o keyframe mais
+// próximo, posiciona o input no offset e segue lendo dali.
+//
+// Formato (binário, ordem de bytes da máquina, só anexado):
+//   CkfHeader | zstd(por símbolo: CkfSym + extra + bid[nbid] + ask[nask]) | CKF_MAGIC
+// Cada lado do book vai com os bytes transpostos (byte 0 de todas as posições,
+// depois o byte 1...): preço, quantidade e id de posições vizinhas ficam lado a
+// lado e o zstd nível 1 comprime bem mais, sem pesar na cadência. O magic no
+// fim marca o frame completo; frame cortado (parser caiu no meio da
+// gravação) é ignorado. kind ('B'/'Z'), param (book-cap/depth) e os tamanhos
+// dos registros vão no cabeçalho e frame de outra configuração não é usado.
+// "extra" é estado do parser por símbolo (EMAs etc.), opaco aqui.
+// Um novo frame só é gravado depois do offset do último que já está no
+// arquivo, então reprocessar o dia ou dois parsers no mesmo input não duplicam.
+//
+// Os ponteiros de ckf_next_sym apontam para dentro do frame, sem alinhamento:
+// copiar com memcpy.
+//
+// Só header, compila como C e C++.
+#ifndef CEDRO_KEYFRAME_H
+#define CEDRO_KEYFRAME_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <zstd.h>
+
+#define CKF_MAGIC 0x31464B43u   // "CKF1"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t body;         // bytes depois do cabeçalho, incluindo o magic final
+    uint32_t raw;          // bytes dos símbolos descomprimidos
+    uint32_t reserved;
+    uint64_t in_off;       // offset do input depois da última linha aplicada
+    int32_t sec;           // segundo do dia dessa linha
+    uint32_t param;        // book-cap (B) / depth (Z)
+    uint16_t nsyms;
+    uint16_t extra_size;   // bytes de estado extra por símbolo
+    uint16_t elem_size;    // bytes por posição do book
+    char kind;
+    char pad[5];
+} CkfHeader;
+
+typedef struct {
+    char symbol[32];
+    uint32_t nbid;
+    uint32_t nask;
+} CkfSym;
+
+// "<input>.B.kf" / "<input>.Z.kf"; 0 se não cabe
+static inline int ckf_path(const char *input, char kind, char *out, size_t out_sz) {
+    const int n = snprintf(out, out_sz, "%s.%c.kf", input, kind);
+    return n > 0 && (size_t)n < out_sz;
+}
+
+// Percorre os frames completos de path e devolve em *pos/*hdr o último que casa
+// com a configuração e tem sec <= max_sec e in_off <= max_off (-1 = sem limite).
+// 1 se achou. *end (se não NULL) recebe o fim do último frame completo.
+static inline int ckf_scan(const char *path, char kind, uint32_t param, uint16_t extra_size, uint16_t elem_size,
+                           int max_sec, long long max_off, long long *pos, CkfHeader *hdr, long long *end) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+    int found = 0;
+    long long at = 0;
+    CkfHeader h;
+    while (fread(&h, sizeof(h), 1, f) == 1) {
+        if (h.magic != CKF_MAGIC || h.body < sizeof(uint32_t)) break;
+        uint32_t tail = 0;
+        if (fseeko(f, (off_t)(at + (long long)sizeof(h) + h.body - sizeof(tail)), SEEK_SET) != 0) break;
+        if (fread(&tail, sizeof(tail), 1, f) != 1 || tail != CKF_MAGIC) break;   // frame cortado
+        if (h.kind == kind && h.param == param && h.extra_size == extra_size && h.elem_size == elem_size &&
+            (max_sec < 0 || h.sec <= max_sec) && (max_off < 0 || (long long)h.in_off <= max_off)) {
+            *pos = at;
+            *hdr = h;
+            found = 1;
+        }
+        at += (long long)sizeof(h) + h.body;
+    }
+    fclose(f);
+    if (end) *end = at;
+    return found;
+}
+
+// ---------- escrita ----------
+
+typedef struct {
+    char path[4096];       // vazio = desligado
+    char kind;
+    uint32_t param;
+    uint16_t extra_size, elem_size;
+    long long last_off;    // in_off do último frame no arquivo
+    unsigned char *buf;    // cabeçalho + símbolos do frame em montagem
+    size_t len, cap;
+    unsigned char *zbuf;   // símbolos comprimidos
+    size_t zcap;
+} CkfWriter;
+
+// path NULL = desligado
+static inline void ckf_writer_open(CkfWriter *w, const char *path, char kind, uint32_t param, uint16_t extra_size,
+                                   uint16_t elem_size) {
+    memset(w, 0, sizeof(*w));
+    w->kind = kind;
+    w->param = param;
+    w->extra_size = extra_size;
+    w->elem_size = elem_size;
+    w->last_off = -1;
+    if (!path || snprintf(w->path, sizeof(w->path), "%s", path) >= (int)sizeof(w->path)) {
+        w->path[0] = '\0';
+        return;
+    }
+    long long pos, end = 0;
+    CkfHeader h;
+    if (ckf_scan(path, kind, param, extra_size, elem_size, -1, -1, &pos, &h, &end)) w->last_off = (long long)h.in_off;
+    // Frame cortado no fim: os próximos entram no lugar dele
+    struct stat st;
+    if (stat(path, &st) == 0 && st.st_size > end && truncate(path, (off_t)end) != 0) w->path[0] = '\0';
+}
+
+static inline void ckf_writer_close(CkfWriter *w) {
+    free(w->buf);
+    free(w->zbuf);
+    w->buf = w->zbuf = NULL;
+    w->len = w->cap = w->zcap = 0;
+    w->path[0] = '\0';
+}
+
+// n registros de es bytes <-> es planos de n bytes
+static inline void ckf_transpose(unsigned char *dst, const unsigned char *src, size_t n, size_t es, int back) {
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < es; j++) {
+            if (back) dst[i * es + j] = src[j * n + i];
+            else dst[j * n + i] = src[i * es + j];
+        }
+    }
+}
+
+static inline unsigned char *ckf_reserve(CkfWriter *w, size_t n) {
+    if (w->len + n > w->cap) {
+        size_t cap = w->cap ? w->cap : 1 << 16;
+        while (cap < w->len + n) cap *= 2;
+        unsigned char *nb = (unsigned char *)realloc(w->buf, cap);
+        if (!nb) return NULL;
+        w->buf = nb;
+        w->cap = cap;
+    }
+    unsigned char *p = w->buf + w->len;
+    w->len += n;
+    return p;
+}
+
+static inline int ckf_put(CkfWriter *w, const void *p, size_t n) {
+    unsigned char *d = ckf_reserve(w, n);
+    if (!d) return 0;
+    if (n) memcpy(d, p, n);
+    return 1;
+}
+
+static inline void ckf_put_side(CkfWriter *w, const void *side, uint32_t n) {
+    unsigned char *d = ckf_reserve(w, (size_t)n * w->elem_size);
+    if (d) ckf_transpose(d, (const unsigned char *)side, n, w->elem_size, 0);
+}
+
+// Começa um frame; 0 se desligado ou se o arquivo já tem esse offset
+static inline int ckf_begin(CkfWriter *w, long long in_off, int sec) {
+    if (!w->path[0] || in_off <= w->last_off) return 0;
+    CkfHeader h;
+    memset(&h, 0, sizeof(h));
+    h.magic = CKF_MAGIC;
+    h.in_off = (uint64_t)in_off;
+    h.sec = sec;
+    h.param = w->param;
+    h.extra_size = w->extra_size;
+    h.elem_size = w->elem_size;
+    h.kind = w->kind;
+    w->len = 0;
+    return ckf_put(w, &h, sizeof(h));
+}
+
+// extra com extra_size bytes (NULL se 0); bid/ask com nbid/nask posições de elem_size bytes
+static inline void ckf_add(CkfWriter *w, const char *symbol, const void *extra, const void *bid, uint32_t nbid,
+                           const void *ask, uint32_t nask) {
+    CkfSym s;
+    memset(&s, 0, sizeof(s));
+    snprintf(s.symbol, sizeof(s.symbol), "%s", symbol);
+    s.nbid = nbid;
+    s.nask = nask;
+    ckf_put(w, &s, sizeof(s));
+    if (extra) ckf_put(w, extra, w->extra_size);
+    ckf_put_side(w, bid, nbid);
+    ckf_put_side(w, ask, nask);
+    ((CkfHeader *)w->buf)->nsyms++;
+}
+
+// Comprime e anexa o frame ao arquivo de uma vez; 0 se falhou
+static inline int ckf_commit(CkfWriter *w) {
+    CkfHeader *h = (CkfHeader *)w->buf;
+    const size_t raw = w->len - sizeof(*h);
+    const size_t bound = ZSTD_compressBound(raw) + sizeof(uint32_t);
+    if (bound > w->zcap) {
+        unsigned char *nb = (unsigned char *)realloc(w->zbuf, bound);
+        if (!nb) return 0;
+        w->zbuf = nb;
+        w->zcap = bound;
+    }
+    const size_t z = ZSTD_compress(w->zbuf, w->zcap, w->buf + sizeof(*h), raw, 1);
+    if (ZSTD_isError(z)) return 0;
+    const uint32_t magic = CKF_MAGIC;
+    memcpy(w->zbuf + z, &magic, sizeof(magic));
+    h->raw = (uint32_t)raw;
+    h->body = (uint32_t)(z + sizeof(magic));
+    FILE *f = fopen(w->path, "ab");
+    if (!f) {
+        fprintf(stderr, "AVISO: keyframe desligado, sem escrita em %s\n", w->path);
+        w->path[0] = '\0';
+        return 0;
+    }
+    const int ok = fwrite(h, sizeof(*h), 1, f) == 1 && fwrite(w->zbuf, 1, h->body, f) == h->body;
+    if (fclose(f) != 0 || !ok) return 0;
+    w->last_off = (long long)h->in_off;
+    return 1;
+}
+
+// ---------- leitura ----------
+
+typedef struct {
+    CkfHeader h;
+    unsigned char *body;   // símbolos descomprimidos (h.raw bytes)
+    size_t pos;
+} CkfFrame;
+
+// Desfaz a transposição dos lados do book; 0 se o frame está inconsistente
+static inline int ckf_untranspose(CkfFrame *fr) {
+    const size_t es = fr->h.elem_size;
+    unsigned char *tmp = NULL;
+    size_t tcap = 0, pos = 0;
+    int ok = 1;
+    for (unsigned i = 0; ok && i < fr->h.nsyms; i++) {
+        CkfSym sym;
+        if (pos + sizeof(sym) > fr->h.raw) { ok = 0; break; }
+        memcpy(&sym, fr->body + pos, sizeof(sym));
+        pos += sizeof(sym) + fr->h.extra_size;
+        const uint32_t n[2] = {sym.nbid, sym.nask};
+        for (int k = 0; k < 2; k++) {
+            const size_t len = (size_t)n[k] * es;
+            if (pos + len > fr->h.raw) { ok = 0; break; }
+            if (len > tcap) {
+                unsigned char *nb = (unsigned char *)realloc(tmp, len);
+                if (!nb) { ok = 0; break; }
+                tmp = nb;
+                tcap = len;
+            }
+            memcpy(tmp, fr->body + pos, len);
+            ckf_transpose(fr->body + pos, tmp, n[k], es, 1);
+            pos += len;
+        }
+    }
+    free(tmp);
+    return ok;
+}
+
+// Carrega o keyframe mais próximo (ver ckf_scan); 1 se achou
+static inline int ckf_load(const char *path, char kind, uint32_t param, uint16_t extra_size, uint16_t elem_size,
+                           int max_sec, long long max_off, CkfFrame *fr) {
+    memset(fr, 0, sizeof(*fr));
+    long long pos;
+    if (!ckf_scan(path, kind, param, extra_size, elem_size, max_sec, max_off, &pos, &fr->h, NULL)) return 0;
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+    const size_t zlen = fr->h.body - sizeof(uint32_t);
+    unsigned char *z = (unsigned char *)malloc(zlen ? zlen : 1);
+    fr->body = (unsigned char *)malloc(fr->h.raw ? fr->h.raw : 1);
+    int ok = z && fr->body && fseeko(f, (off_t)(pos + (long long)sizeof(fr->h)), SEEK_SET) == 0 &&
+             fread(z, 1, zlen, f) == zlen;
+    fclose(f);
+    if (ok) ok = ZSTD_decompress(fr->body, fr->h.raw, z, zlen) == fr->h.raw;
+    free(z);
+    if (ok) ok = ckf_untranspose(fr);
+    if (!ok) {
+        free(fr->body);
+        fr->body = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+// Próximo símbolo do frame; 0 no fim
+static inline int ckf_next_sym(CkfFrame *fr, CkfSym *sym, const void **extra, const void **bid, const void **ask) {
+    const size_t end = fr->h.raw;
+    if (fr->pos + sizeof(*sym) > end) return 0;
+    memcpy(sym, fr->body + fr->pos, sizeof(*sym));
+    const size_t need = sizeof(*sym) + fr->h.extra_size + ((size_t)sym->nbid + sym->nask) * fr->h.elem_size;
+    if (fr->pos + need > end) return 0;
+    const unsigned char *p = fr->body + fr->pos + sizeof(*sym);
+    *extra = p;
+    *bid = p + fr->h.extra_size;
+    *ask = p + fr->h.extra_size + (size_t)sym->nbid * fr->h.elem_size;
+    fr->pos += need;
+    return 1;
+}
+
+// O frame tem symbol?
+static inline int ckf_has_sym(const CkfFrame *fr, const char *symbol) {
+    CkfFrame it = *fr;
+    it.pos = 0;
+    CkfSym s;
+    const void *e, *b, *a;
+    while (ckf_next_sym(&it, &s, &e, &b, &a)) {
+        if (strncmp(s.symbol, symbol, sizeof(s.symbol)) == 0) return 1;
+    }
+    return 0;
+}
+
+static inline void ckf_free(CkfFrame *fr) {
+    free(fr->body);
+    fr->body = NULL;
+}
+
+#endif
@@ -0,0 +1,183 @@
+// cedro_mmap_tail.h - sidecar ".tail" dos arquivos gravados pelo leitorwebsocket --writer mmap
+//
+// Com o backend mmap, cada arquivo do dia (_raw_data.txt, _B.txt, ..., _raw.cj)
+// é pré-alocado com fallocate e mapeado; o coletor faz memcpy no mapeamento e
+// publica o fim dos dados válidos em "<arquivo>.tail". Além de tail, o arquivo
+// tem zeros (área pré-alocada) até o fechamento do dia, quando é truncado.
+//
+// Parsers que fazem tail do arquivo enquanto o coletor grava devem parar em
+// cmt_committed(). Com stdio, abra com cmt_fopen(): o read do stream é um
+// pread até o tail publicado na hora do read, então o buffer do stdio nunca
+// guarda zeros da área pré-alocada (que o coletor ainda vai sobrescrever), e o
+// fim dos dados aparece como EOF. Só comparar ftello com o tail não basta: o
+// buffer pode ter sido enchido com um tail mais antigo. cmt_at_limit() só evita
+// o read quando já se sabe que não há dado novo. Sem sidecar (backend
+// ofstream), cmt_fopen é fopen e nada muda.
+//
+// Só header, compila como C e C++.
+#ifndef CEDRO_MMAP_TAIL_H
+#define CEDRO_MMAP_TAIL_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CMT_MAGIC "CDRTAIL1"
+#define CMT_SUFFIX ".tail"
+#define CMT_FILE_SIZE 4096
+
+// Cabeçalho do sidecar (primeiros 64 bytes do arquivo .tail)
+typedef struct {
+    char magic[8];
+    uint64_t tail;       // bytes válidos no arquivo de dados (escrito com release)
+    uint64_t capacity;   // bytes pré-alocados no arquivo de dados
+    uint64_t reserved[5];
+} CmtHeader;
+
+static inline int cmt_sidecar_path(const char *data_path, char *out, size_t out_sz) {
+    int n = snprintf(out, out_sz, "%s%s", data_path, CMT_SUFFIX);
+    return n > 0 && (size_t)n < out_sz;
+}
+
+static inline uint64_t cmt_load_tail(const CmtHeader *h) {
+    return __atomic_load_n(&h->tail, __ATOMIC_ACQUIRE);
+}
+
+static inline void cmt_store_tail(CmtHeader *h, uint64_t tail) {
+    __atomic_store_n(&h->tail, tail, __ATOMIC_RELEASE);
+}
+
+// ---------- leitura (parsers) ----------
+
+typedef struct {
+    CmtHeader *h;   // NULL = arquivo sem sidecar
+} CmtTail;
+
+// Mapeia "<data_path>.tail" (só leitura) se existir. Retorna 1 se achou.
+static inline int cmt_attach(CmtTail *t, const char *data_path) {
+    char path[4096];
+    t->h = NULL;
+    if (!cmt_sidecar_path(data_path, path, sizeof(path))) return 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(CmtHeader)) { close(fd); return 0; }
+    void *p = mmap(NULL, CMT_FILE_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return 0;
+    if (memcmp(p, CMT_MAGIC, 8) != 0) { munmap(p, CMT_FILE_SIZE); return 0; }
+    t->h = (CmtHeader *)p;
+    return 1;
+}
+
+static inline void cmt_detach(CmtTail *t) {
+    if (t->h) munmap((void *)t->h, CMT_FILE_SIZE);
+    t->h = NULL;
+}
+
+// Bytes válidos no arquivo de dados, ou -1 sem sidecar
+static inline long long cmt_committed(const CmtTail *t) {
+    if (!t->h) return -1;
+    return (long long)cmt_load_tail(t->h);
+}
+
+// 1 se a posição de f já chegou no fim publicado (trate como EOF).
+// Nesse caso reposiciona f no mesmo offset, o que descarta o buffer do stdio.
+// Não protege sozinho um FILE de fopen: use com um stream de cmt_fopen().
+static inline int cmt_at_limit(const CmtTail *t, FILE *f) {
+    long long lim = cmt_committed(t);
+    if (lim < 0) return 0;
+    off_t off = ftello(f);
+    if (off < (off_t)lim) return 0;
+    fseeko(f, off, SEEK_SET);
+    return 1;
+}
+
+// Posiciona f no fim dos dados: tail publicado, ou SEEK_END sem sidecar
+static inline void cmt_seek_end(const CmtTail *t, FILE *f) {
+    long long lim = cmt_committed(t);
+    if (lim >= 0) fseeko(f, (off_t)lim, SEEK_SET);
+    else fseeko(f, 0, SEEK_END);
+}
+
+// ---------- stdio limitado ao tail ----------
+
+#ifdef _GNU_SOURCE   // fopencookie (g++ já define)
+typedef struct {
+    int fd;
+    CmtTail t;
+    uint64_t pos;
+} CmtStream;
+
+// Lê no máximo até o tail de agora; no tail devolve 0 (EOF para o stdio)
+static inline ssize_t cmt_cookie_read(void *cookie, char *buf, size_t n) {
+    CmtStream *s = (CmtStream *)cookie;
+    const uint64_t lim = cmt_load_tail(s->t.h);
+    if (s->pos >= lim) return 0;
+    if (n > lim - s->pos) n = (size_t)(lim - s->pos);
+    ssize_t r;
+    do {
+        r = pread(s->fd, buf, n, (off_t)s->pos);
+    } while (r < 0 && errno == EINTR);
+    if (r > 0) s->pos += (uint64_t)r;
+    return r;
+}
+
+// SEEK_END é relativo ao tail, não ao tamanho pré-alocado
+static inline int cmt_cookie_seek(void *cookie, off64_t *offset, int whence) {
+    CmtStream *s = (CmtStream *)cookie;
+    int64_t target;
+    switch (whence) {
+        case SEEK_SET: target = *offset; break;
+        case SEEK_CUR: target = (int64_t)s->pos + *offset; break;
+        case SEEK_END: target = (int64_t)cmt_load_tail(s->t.h) + *offset; break;
+        default: errno = EINVAL; return -1;
+    }
+    if (target < 0) { errno = EINVAL; return -1; }
+    s->pos = (uint64_t)target;
+    *offset = (off64_t)target;
+    return 0;
+}
+
+static inline int cmt_cookie_close(void *cookie) {
+    CmtStream *s = (CmtStream *)cookie;
+    close(s->fd);
+    cmt_detach(&s->t);
+    free(s);
+    return 0;
+}
+
+// fopen de leitura que não passa do tail quando o arquivo tem sidecar
+static inline FILE *cmt_fopen(const char *path, const char *mode) {
+    CmtTail t;
+    if (!cmt_attach(&t, path)) return fopen(path, mode);
+    CmtStream *s = (CmtStream *)calloc(1, sizeof(CmtStream));
+    const int fd = s ? open(path, O_RDONLY | O_CLOEXEC) : -1;
+    if (fd < 0) {
+        const int e = s ? errno : ENOMEM;
+        free(s);
+        cmt_detach(&t);
+        errno = e;
+        return NULL;
+    }
+    s->fd = fd;
+    s->t = t;
+    cookie_io_functions_t io;
+    memset(&io, 0, sizeof(io));
+    io.read = cmt_cookie_read;
+    io.seek = cmt_cookie_seek;
+    io.close = cmt_cookie_close;
+    FILE *f = fopencookie(s, "r", io);
+    if (!f) cmt_cookie_close(s);
+    else setvbuf(f, NULL, _IOFBF, 1 << 16);
+    return f;
+}
+#endif
+
+#endif
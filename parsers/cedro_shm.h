@@ -0,0 +1,398 @@
+// cedro_shm.h - anel em memória compartilhada publicado pelo leitorwebsocket --shm <nome>
+//
+// O coletor publica cada registro enquadrado num segmento POSIX (shm_open
+// "/<nome>") com um canal por tipo (B, V, T, Z). Cada canal é um anel de
+// bytes com um produtor e qualquer número de leitores: o produtor nunca
+// espera, e cada leitor guarda a própria posição. Os arquivos do dia
+// continuam sendo a cópia durável; o anel é só o caminho rápido.
+//
+// Registro no anel (alinhado em 8 bytes):
+//   CshmRecHeader {size, flags, seq} + CjRecordHeader (mesmo do journal) + payload
+// O payload é a linha do feed sem o prefixo "ts,len,delta," (como no .cj), e
+// seq numera os registros do canal desde a criação do segmento. Um marcador de
+// lacuna do coletor (cedro_gap.h) vai em todos os canais como CJ_TYPE_GAP.
+//
+// Leitura sem syscall: cshm_next() compara a posição do leitor com o head do
+// canal (acquire), copia o registro e confere no reserve do produtor que ele
+// não foi sobrescrito durante a cópia (como num seqlock). Leitor que ficou
+// mais de um anel para trás perde registros: recebe um CJ_TYPE_GAP sintético
+// ("GAP_START:shm ...") e continua do head. O mesmo acontece se o coletor
+// reiniciar (generation muda). Sem dados, cshm_wait() gira um pouco e só
+// depois dorme 50 us.
+//
+// Leitor: cshm_open(&r, nome, 'T'); loop { while (cshm_next(&r, &rec) > 0) ...; cshm_wait(&r); }
+// Em glibc < 2.34, linkar com -lrt (shm_open).
+//
+// Compilado com -DCEDRO_ENGINE (parser rodando dentro do cedro_engine), o
+// leitor lê a fila em processo do tipo (cedro_engine.h) e ignora o nome; ali
+// a entrada pode acabar, e cshm_eof() diz quando.
+//
+// Só header, compila como C e C++.
+#ifndef CEDRO_SHM_H
+#define CEDRO_SHM_H
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cedro_journal.h"
+#ifdef CEDRO_ENGINE
+#include "cedro_engine.h"
+#endif
+
+#define CSHM_MAGIC "CDRSHM01"
+#define CSHM_CHANNELS 4               // B, V, T, Z
+#define CSHM_DEFAULT_CHANNEL_BYTES (8u << 20)
+#define CSHM_FLAG_PAD 0x1             // resto do anel até o fim é enchimento
+#define CSHM_SPIN_NS 200000ull        // cshm_wait: giro antes de dormir
+#define CSHM_IDLE_MIN_US 50u          // cshm_wait: primeiro sono; dobra a cada volta sem dados
+#define CSHM_IDLE_MAX_US 2000u        // cshm_wait: teto do sono (leitor parado à noite)
+
+typedef struct {
+    char magic[8];
+    uint32_t channels;
+    uint32_t channel_bytes;    // potência de 2
+    uint64_t generation;       // muda a cada (re)abertura pelo coletor
+    uint64_t reserved[5];
+} CshmHeader;
+
+typedef struct {
+    uint64_t head;             // fim do último registro publicado (release)
+    uint64_t reserve;          // fim do que o produtor está escrevendo
+    uint64_t seq;              // próximo número de sequência
+    uint64_t pad[5];           // uma linha de cache por canal
+} CshmChannel;
+
+typedef struct {
+    uint32_t size;             // bytes do registro no anel, com alinhamento
+    uint32_t flags;            // CSHM_FLAG_*
+    uint64_t seq;
+} CshmRecHeader;
+
+#define CSHM_REC_OVERHEAD (sizeof(CshmRecHeader) + sizeof(CjRecordHeader))
+
+static inline int cshm_channel_of(char type) {
+    switch (type) {
+        case 'B': return 0;
+        case 'V': return 1;
+        case 'T': return 2;
+        case 'Z': return 3;
+        default: return -1;
+    }
+}
+
+static inline size_t cshm_map_size(uint32_t channel_bytes) {
+    return sizeof(CshmHeader) + CSHM_CHANNELS * sizeof(CshmChannel) + (size_t)CSHM_CHANNELS * channel_bytes;
+}
+
+static inline char *cshm_ring(void *base, int ch, uint32_t channel_bytes) {
+    return (char *)base + sizeof(CshmHeader) + CSHM_CHANNELS * sizeof(CshmChannel) + (size_t)ch * channel_bytes;
+}
+
+// "/nome" para shm_open
+static inline void cshm_path(const char *name, char *out, size_t out_sz) {
+    snprintf(out, out_sz, "%s%s", name[0] == '/' ? "" : "/", name);
+}
+
+static inline uint64_t cshm_now_ns(clockid_t clk) {
+    struct timespec ts;
+    clock_gettime(clk, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// ---------- escrita (leitorwebsocket) ----------
+
+typedef struct {
+    void *base;
+    size_t map_size;
+    CshmHeader *hdr;
+    CshmChannel *ch;
+    uint32_t channel_bytes;
+} CshmWriter;
+
+// Cria ou reabre o segmento. Reaberto com o mesmo tamanho, as posições
+// continuam e só generation muda; com outro tamanho, é recriado.
+static inline int cshm_create(CshmWriter *w, const char *name, uint32_t channel_bytes) {
+    char path[256];
+    cshm_path(name, path, sizeof(path));
+    memset(w, 0, sizeof(*w));
+    int fd = shm_open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return -1;
+    const size_t size = cshm_map_size(channel_bytes);
+    struct stat st;
+    int fresh = fstat(fd, &st) != 0 || (size_t)st.st_size != size;
+    if (fresh && ftruncate(fd, 0) != 0) { close(fd); return -1; }
+    if (fresh && ftruncate(fd, (off_t)size) != 0) { close(fd); return -1; }
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return -1;
+    CshmHeader *h = (CshmHeader *)p;
+    if (fresh || memcmp(h->magic, CSHM_MAGIC, 8) != 0 || h->channel_bytes != channel_bytes) {
+        memset(p, 0, sizeof(CshmHeader) + CSHM_CHANNELS * sizeof(CshmChannel));
+        h->channels = CSHM_CHANNELS;
+        h->channel_bytes = channel_bytes;
+        memcpy(h->magic, CSHM_MAGIC, 8);
+    }
+    __atomic_add_fetch(&h->generation, 1, __ATOMIC_RELEASE);
+    w->base = p;
+    w->map_size = size;
+    w->hdr = h;
+    w->ch = (CshmChannel *)((char *)p + sizeof(CshmHeader));
+    w->channel_bytes = channel_bytes;
+    return 0;
+}
+
+static inline void cshm_close(CshmWriter *w) {
+    if (w->base) munmap(w->base, w->map_size);
+    memset(w, 0, sizeof(*w));
+}
+
+// Publica um registro (cabeçalho do journal + payload) no canal c
+static inline void cshm_publish_to(CshmWriter *w, int c, const CjRecordHeader *h, const char *payload) {
+    CshmChannel *ch = &w->ch[c];
+    char *ring = cshm_ring(w->base, c, w->channel_bytes);
+    const uint64_t mask = w->channel_bytes - 1;
+    const uint32_t need = (uint32_t)((CSHM_REC_OVERHEAD + h->len + 7) & ~(size_t)7);
+    if (need > w->channel_bytes / 2) return;   // registro maior que meio anel: fica só nos arquivos
+
+    uint64_t pos = ch->head;
+    uint64_t off = pos & mask;
+    const uint64_t pad = off + need > w->channel_bytes ? w->channel_bytes - off : 0;
+    // Leitores conferem reserve depois de copiar: o que passou dele pode ter sido sobrescrito
+    __atomic_store_n(&ch->reserve, pos + pad + need, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    if (pad) {
+        CshmRecHeader ph = {(uint32_t)pad, CSHM_FLAG_PAD, 0};
+        memcpy(ring + off, &ph, sizeof(uint64_t));
+        pos += pad;
+        off = 0;
+    }
+    CshmRecHeader rh;
+    rh.size = need;
+    rh.flags = 0;
+    rh.seq = ch->seq++;
+    memcpy(ring + off, &rh, sizeof(rh));
+    memcpy(ring + off + sizeof(rh), h, sizeof(*h));
+    memcpy(ring + off + CSHM_REC_OVERHEAD, payload, h->len);
+    __atomic_store_n(&ch->head, pos + need, __ATOMIC_RELEASE);
+}
+
+// Canal pelo tipo do registro; marcador de lacuna vai para todos
+static inline void cshm_publish(CshmWriter *w, const CjRecordHeader *h, const char *payload) {
+    if (!w->base) return;
+    const int c = cshm_channel_of((char)h->type);
+    if (c >= 0) {
+        cshm_publish_to(w, c, h, payload);
+    } else if (h->type == CJ_TYPE_GAP) {
+        for (int i = 0; i < CSHM_CHANNELS; i++) cshm_publish_to(w, i, h, payload);
+    }
+}
+
+// ---------- leitura (parsers) ----------
+
+typedef struct {
+    void *base;
+    size_t map_size;
+    const CshmHeader *hdr;
+    const CshmChannel *ch;
+    const char *ring;
+    uint64_t mask;
+    uint32_t channel_bytes;
+    uint64_t pos;              // próximo byte a ler no canal
+    uint64_t generation;
+    uint64_t next_seq;         // seq esperado (para contar perdas)
+    uint64_t lost;             // registros perdidos por atraso
+    uint32_t idle_us;          // cshm_wait: sono corrente (0 = acabou de ficar sem dados)
+    CjRecord held;             // cshm_next_day: primeiro registro do dia seguinte, retido
+    int has_held;
+    char *buf;                 // cópia do registro corrente (payload terminado em '\0')
+    size_t cap;
+#ifdef CEDRO_ENGINE
+    CeQueue *eq;               // fila do engine no lugar do segmento
+#endif
+} CshmReader;
+
+// Abre o canal do tipo type no segmento "nome", a partir do head atual.
+// Retorna -1 se o segmento ainda não existe (coletor não subiu).
+static inline int cshm_open(CshmReader *r, const char *name, char type) {
+#ifdef CEDRO_ENGINE
+    (void)name;
+    memset(r, 0, sizeof(*r));
+    r->eq = ce_engine_queue(type);
+    return r->eq ? 0 : -1;
+#endif
+    char path[256];
+    cshm_path(name, path, sizeof(path));
+    memset(r, 0, sizeof(*r));
+    const int c = cshm_channel_of(type);
+    if (c < 0) return -1;
+    int fd = shm_open(path, O_RDONLY, 0);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CshmHeader)) { close(fd); return -1; }
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return -1;
+    const CshmHeader *h = (const CshmHeader *)p;
+    if (memcmp(h->magic, CSHM_MAGIC, 8) != 0 || cshm_map_size(h->channel_bytes) != (size_t)st.st_size) {
+        munmap(p, (size_t)st.st_size);
+        return -1;
+    }
+    r->base = p;
+    r->map_size = (size_t)st.st_size;
+    r->hdr = h;
+    r->ch = (const CshmChannel *)((const char *)p + sizeof(CshmHeader)) + c;
+    r->ring = cshm_ring(p, c, h->channel_bytes);
+    r->channel_bytes = h->channel_bytes;
+    r->mask = h->channel_bytes - 1;
+    r->generation = __atomic_load_n(&h->generation, __ATOMIC_ACQUIRE);
+    r->pos = __atomic_load_n(&r->ch->head, __ATOMIC_ACQUIRE);
+    r->next_seq = __atomic_load_n(&r->ch->seq, __ATOMIC_ACQUIRE);
+    r->cap = 4096;
+    r->buf = (char *)malloc(r->cap);
+    return r->buf ? 0 : -1;
+}
+
+static inline void cshm_free(CshmReader *r) {
+    if (r->base) munmap(r->base, r->map_size);
+    free(r->buf);
+    memset(r, 0, sizeof(*r));
+}
+
+// Perdeu registros (atraso ou coletor reiniciado): pula para o head e devolve um marcador de lacuna
+static inline int cshm_resync(CshmReader *r, CjRecord *rec, const char *why) {
+    r->pos = __atomic_load_n(&r->ch->head, __ATOMIC_ACQUIRE);
+    r->next_seq = __atomic_load_n(&r->ch->seq, __ATOMIC_ACQUIRE);
+    int n = snprintf(r->buf, r->cap, "GAP_START:shm %s", why);
+    memset(&rec->h, 0, sizeof(rec->h));
+    rec->h.type = CJ_TYPE_GAP;
+    rec->h.symbol_id = 0xFFFF;
+    rec->h.len = (uint32_t)(n > 0 ? n : 0);
+    rec->h.realtime_ns = cshm_now_ns(CLOCK_REALTIME);
+    rec->h.mono_ns = cshm_now_ns(CLOCK_MONOTONIC);
+    rec->payload = r->buf;
+    rec->symbol = "";
+    rec->offset = -1;
+    return 1;
+}
+
+// Próximo registro do canal. 1 = rec preenchido (payload válido até a próxima
+// chamada), 0 = nada novo. rec->symbol é sempre "" (não há tabela de símbolos).
+static inline int cshm_next(CshmReader *r, CjRecord *rec) {
+#ifdef CEDRO_ENGINE
+    return ce_pop(r->eq, rec, &r->buf, &r->cap);
+#endif
+    for (;;) {
+        if (__atomic_load_n(&r->hdr->generation, __ATOMIC_ACQUIRE) != r->generation) {
+            r->generation = __atomic_load_n(&r->hdr->generation, __ATOMIC_ACQUIRE);
+            return cshm_resync(r, rec, "coletor reiniciado");
+        }
+        const uint64_t head = __atomic_load_n(&r->ch->head, __ATOMIC_ACQUIRE);
+        if (r->pos == head) return 0;
+        if (head - r->pos > r->channel_bytes) return cshm_resync(r, rec, "leitor atrasado");
+
+        const uint64_t off = r->pos & r->mask;
+        CshmRecHeader rh;
+        memcpy(&rh, r->ring + off, sizeof(uint64_t));
+        if (rh.flags & CSHM_FLAG_PAD) {
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&r->ch->reserve, __ATOMIC_RELAXED) - r->pos > r->channel_bytes)
+                return cshm_resync(r, rec, "leitor atrasado");
+            r->pos += r->channel_bytes - off;
+            continue;
+        }
+        if (rh.size < CSHM_REC_OVERHEAD || rh.size > r->channel_bytes - off) return cshm_resync(r, rec, "leitor atrasado");
+        if (rh.size + 1 > r->cap) {
+            size_t cap = r->cap;
+            while (cap < (size_t)rh.size + 1) cap *= 2;
+            char *nb = (char *)realloc(r->buf, cap);
+            if (!nb) return 0;
+            r->buf = nb;
+            r->cap = cap;
+        }
+        memcpy(r->buf, r->ring + off, rh.size);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&r->ch->reserve, __ATOMIC_RELAXED) - r->pos > r->channel_bytes)
+            return cshm_resync(r, rec, "leitor atrasado");
+
+        memcpy(&rh, r->buf, sizeof(rh));
+        memcpy(&rec->h, r->buf + sizeof(rh), sizeof(rec->h));
+        if (rec->h.len > rh.size - CSHM_REC_OVERHEAD) return cshm_resync(r, rec, "registro invalido");
+        r->pos += rh.size;
+        if (rh.seq != r->next_seq) r->lost += rh.seq - r->next_seq;
+        r->next_seq = rh.seq + 1;
+        rec->payload = r->buf + CSHM_REC_OVERHEAD;
+        rec->payload[rec->h.len] = '\0';
+        rec->symbol = "";
+        rec->offset = (long long)rh.seq;
+        r->idle_us = 0;
+        return 1;
+    }
+}
+
+// Próximo registro para quem nomeia as saídas pela data do feed (no
+// cedro_engine a entrada pode ser de outro dia, não a de hoje): o primeiro
+// registro de um dia diferente de ymd fica retido e volta 2, com o dia em
+// day; o parser troca de dia e chama de novo, que entrega o retido. Com ymd
+// "" (nenhum dia aberto) o primeiro registro já volta 2; ymd NULL não confere.
+static inline int cshm_next_day(CshmReader *r, CjRecord *rec, const char *ymd, char day[9]) {
+    if (r->has_held) {
+        *rec = r->held;
+        r->has_held = 0;
+        return 1;
+    }
+    const int got = cshm_next(r, rec);
+    if (got <= 0 || !ymd) return got;
+    int sec;
+    cj_ymd_sec(rec, day, &sec);
+    if (strcmp(day, ymd) == 0) return 1;
+    r->held = *rec;
+    r->has_held = 1;
+    return 2;
+}
+
+// Sem dados: logo depois do último registro gira até CSHM_SPIN_NS olhando o
+// head (no pregão o próximo vem em microssegundos); depois dorme, de
+// CSHM_IDLE_MIN_US dobrando até CSHM_IDLE_MAX_US enquanto nada chega, para o
+// leitor parado (noite, fim de semana) não queimar um núcleo. cshm_next
+// zera o sono quando lê.
+static inline void cshm_wait(CshmReader *r) {
+#ifdef CEDRO_ENGINE
+    ce_wait(r->eq);
+    return;
+#endif
+    if (r->idle_us == 0) {
+        const uint64_t start = cshm_now_ns(CLOCK_MONOTONIC);
+        do {
+            if (__atomic_load_n(&r->ch->head, __ATOMIC_ACQUIRE) != r->pos) return;
+            for (int i = 0; i < 64; i++) {
+#if defined(__x86_64__) || defined(__i386__)
+                __builtin_ia32_pause();
+#endif
+            }
+        } while (cshm_now_ns(CLOCK_MONOTONIC) - start < CSHM_SPIN_NS);
+        r->idle_us = CSHM_IDLE_MIN_US;
+    } else if (r->idle_us < CSHM_IDLE_MAX_US) {
+        r->idle_us = r->idle_us * 2 < CSHM_IDLE_MAX_US ? r->idle_us * 2 : CSHM_IDLE_MAX_US;
+    }
+    struct timespec ts = {0, (long)r->idle_us * 1000};
+    nanosleep(&ts, NULL);
+}
+
+// Fim da entrada: só no cedro_engine (o anel do coletor não acaba)
+static inline int cshm_eof(const CshmReader *r) {
+#ifdef CEDRO_ENGINE
+    return r->eq && ce_drained(r->eq);
+#else
+    (void)r;
+    return 0;
+#endif
+}
+
+#endif
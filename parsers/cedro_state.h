@@ -0,0 +1,164 @@
+// cedro_state.h - estado dos parsers em arquivo mmap com dois buffers
+//
+// Checkpoint do estado inteiro de um parser (books, EMAs, janelas, offsets)
+// para retomar sem reaquecer. O arquivo tem um cabeçalho e dois slots do
+// mesmo tamanho; cada gravação vai no slot que não tem o estado mais novo:
+//   seq = 0 (slot inválido), copia o estado, seq_end = n, seq = n
+// Um slot só vale com seq == seq_end != 0, então o processo caindo no meio da
+// cópia deixa o outro slot, do checkpoint anterior, inteiro. A cópia é um
+// memcpy no mapeamento: sem write/fsync na cadência do checkpoint (o kernel
+// grava as páginas depois; queda de energia pode perder os últimos).
+//
+// tag identifica o layout do estado (configuração do parser, tamanhos das
+// structs); arquivo com outro tag ou tamanho é recriado vazio.
+//
+// Só header, compila como C e C++.
+#ifndef CEDRO_STATE_H
+#define CEDRO_STATE_H
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CST_MAGIC 0x31545343u   // "CST1"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t nslots;
+    uint64_t tag;
+    uint64_t size;       // bytes de estado por slot
+    uint64_t pad[5];
+} CstHeader;
+
+typedef struct {
+    volatile uint64_t seq;
+    volatile uint64_t seq_end;
+    uint64_t pad[6];
+} CstSlot;
+
+typedef struct {
+    int fd;
+    unsigned char *map;
+    size_t map_len;
+    uint64_t size;
+    size_t stride;       // slot + estado, múltiplo de 64
+    uint64_t seq;        // seq do slot mais novo (0 = nenhum)
+} CstFile;
+
+// FNV-1a, para montar o tag a partir da configuração
+static inline uint64_t cst_hash(uint64_t h, const void *p, size_t n) {
+    const unsigned char *b = (const unsigned char *)p;
+    if (h == 0) h = 1469598103934665603ULL;
+    for (size_t i = 0; i < n; i++) {
+        h ^= b[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static inline CstSlot *cst_slot(const CstFile *f, int i) {
+    return (CstSlot *)(f->map + sizeof(CstHeader) + (size_t)i * f->stride);
+}
+
+static inline int cst_valid(const CstSlot *s) {
+    return s->seq != 0 && s->seq == s->seq_end;
+}
+
+// 0 se ok
+static inline int cst_open(CstFile *f, const char *path, uint64_t tag, uint64_t size) {
+    memset(f, 0, sizeof(*f));
+    f->fd = -1;
+    f->size = size;
+    f->stride = (sizeof(CstSlot) + (size_t)size + 63) & ~(size_t)63;
+    f->map_len = sizeof(CstHeader) + 2 * f->stride;
+    f->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (f->fd < 0) return -1;
+    struct stat st;
+    int fresh = fstat(f->fd, &st) != 0 || (size_t)st.st_size != f->map_len;
+    if (!fresh) {
+        CstHeader h;
+        fresh = pread(f->fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h) || h.magic != CST_MAGIC || h.tag != tag ||
+                h.size != size || h.nslots != 2;
+    }
+    if (fresh) {
+        CstHeader h;
+        memset(&h, 0, sizeof(h));
+        h.magic = CST_MAGIC;
+        h.nslots = 2;
+        h.tag = tag;
+        h.size = size;
+        if (ftruncate(f->fd, 0) != 0 || ftruncate(f->fd, (off_t)f->map_len) != 0 ||
+            pwrite(f->fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h)) {
+            close(f->fd);
+            f->fd = -1;
+            return -1;
+        }
+    }
+    void *m = mmap(NULL, f->map_len, PROT_READ | PROT_WRITE, MAP_SHARED, f->fd, 0);
+    if (m == MAP_FAILED) {
+        close(f->fd);
+        f->fd = -1;
+        return -1;
+    }
+    f->map = (unsigned char *)m;
+    for (int i = 0; i < 2; i++) {
+        const CstSlot *s = cst_slot(f, i);
+        if (cst_valid(s) && s->seq > f->seq) f->seq = s->seq;
+    }
+    return 0;
+}
+
+static inline int cst_is_open(const CstFile *f) {
+    return f->map != NULL;
+}
+
+// Copia o estado mais novo para out; 0 se não há
+static inline int cst_load(const CstFile *f, void *out) {
+    if (!f->map || f->seq == 0) return 0;
+    for (int i = 0; i < 2; i++) {
+        const CstSlot *s = cst_slot(f, i);
+        if (cst_valid(s) && s->seq == f->seq) {
+            memcpy(out, (const unsigned char *)s + sizeof(CstSlot), (size_t)f->size);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Grava o estado no slot mais velho
+static inline void cst_save(CstFile *f, const void *in) {
+    if (!f->map) return;
+    CstSlot *s = cst_slot(f, 0);
+    if (cst_valid(s) && s->seq == f->seq) s = cst_slot(f, 1);
+    const uint64_t n = f->seq + 1;
+    s->seq = 0;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    memcpy((unsigned char *)s + sizeof(CstSlot), in, (size_t)f->size);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    s->seq_end = n;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    s->seq = n;
+    f->seq = n;
+}
+
+// Descarta o estado (--reset-state)
+static inline void cst_clear(CstFile *f) {
+    if (!f->map) return;
+    cst_slot(f, 0)->seq = 0;
+    cst_slot(f, 1)->seq = 0;
+    f->seq = 0;
+}
+
+static inline void cst_close(CstFile *f) {
+    if (f->map) munmap(f->map, f->map_len);
+    if (f->fd >= 0) close(f->fd);
+    f->map = NULL;
+    f->fd = -1;
+    f->seq = 0;
+}
+
+#endif
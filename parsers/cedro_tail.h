@@ -0,0 +1,169 @@
+// cedro_tail.h - espera por dado novo no arquivo seguido (inotify), no lugar do sleep fixo
+//
+// ctl_follow(w, path) aponta o watch para o arquivo do dia: IN_MODIFY no
+// próprio arquivo (append, truncamento) e IN_CREATE/IN_MOVED_TO no diretório,
+// só para ver o arquivo (ou o dia seguinte, depois de outro ctl_follow) ser
+// criado. O diretório não é vigiado para IN_MODIFY: o coletor grava os
+// _B/_V/_T/_Z.txt lado a lado e cada parser só acorda pelo seu arquivo.
+//
+// ctl_wait(w, poll_ms) dorme até um evento do arquivo e retorna 1, ou retorna
+// 0 no teto de espera. O teto é poll_ms (o --poll-ms/--sleep-sec de antes)
+// quando não há como saber do dado novo por evento:
+//   - arquivo gravado pelo leitorwebsocket --writer mmap (sidecar .tail): o
+//     memcpy no mapeamento não gera evento de inotify; para latência baixa com
+//     esse backend use --shm;
+//   - inotify indisponível (limite de watches, sistema de arquivos de rede).
+// Com evento, o teto é CTL_IDLE_MS: só serve para o laço do parser olhar a
+// virada do dia. Parado, o processo fica bloqueado no poll(), sem gastar CPU.
+//
+// Acordando no primeiro IN_MODIFY, o parser pode achar a última linha ainda
+// pela metade no disco: ctl_partial_line() a devolve para ser lida inteira
+// depois.
+//
+// Só header, compila como C e C++.
+#ifndef CEDRO_TAIL_H
+#define CEDRO_TAIL_H
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cedro_mmap_tail.h"
+
+#define CTL_IDLE_MS 1000
+
+typedef struct {
+    int fd;            // inotify; -1 = só o teto de espera
+    int wd_dir;
+    int wd_file;
+    int polled;        // arquivo sem evento de escrita (sidecar .tail): teto = poll_ms
+    char path[4096];
+    char name[256];    // basename de path
+    char side[270];    // basename do sidecar .tail
+} CtlWatch;
+
+static inline void ctl_init(CtlWatch *w) {
+    memset(w, 0, sizeof(*w));
+    w->wd_dir = -1;
+    w->wd_file = -1;
+    w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (w->fd < 0) fprintf(stderr, "AVISO: inotify indisponível (%s), seguindo por polling\n", strerror(errno));
+}
+
+static inline void ctl_watch_file(CtlWatch *w) {
+    if (w->fd < 0 || w->wd_file >= 0) return;
+    w->wd_file = inotify_add_watch(w->fd, w->path, IN_MODIFY | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF);
+    char side[4096 + 8];
+    if (cmt_sidecar_path(w->path, side, sizeof(side)) && access(side, F_OK) == 0) w->polled = 1;
+}
+
+// Passa a seguir path (pode ainda não existir)
+static inline void ctl_follow(CtlWatch *w, const char *path) {
+    if (w->fd < 0) return;
+    if (w->wd_file >= 0) inotify_rm_watch(w->fd, w->wd_file);
+    if (w->wd_dir >= 0) inotify_rm_watch(w->fd, w->wd_dir);
+    w->wd_file = -1;
+    w->wd_dir = -1;
+    w->polled = 0;
+    snprintf(w->path, sizeof(w->path), "%s", path);
+    const char *slash = strrchr(path, '/');
+    snprintf(w->name, sizeof(w->name), "%s", slash ? slash + 1 : path);
+    snprintf(w->side, sizeof(w->side), "%s%s", w->name, CMT_SUFFIX);
+    char dir[4096];
+    if (slash) {
+        const size_t n = (size_t)(slash - path) < sizeof(dir) - 1 ? (size_t)(slash - path) : sizeof(dir) - 1;
+        memcpy(dir, path, n);
+        dir[n] = '\0';
+        if (n == 0) snprintf(dir, sizeof(dir), "/");
+    } else {
+        snprintf(dir, sizeof(dir), ".");
+    }
+    w->wd_dir = inotify_add_watch(w->fd, dir, IN_CREATE | IN_MOVED_TO);
+    if (w->wd_dir < 0) fprintf(stderr, "AVISO: inotify em %s: %s\n", dir, strerror(errno));
+    ctl_watch_file(w);
+}
+
+// Consome os eventos pendentes; 1 se algum é do arquivo seguido
+static inline int ctl_drain(CtlWatch *w) {
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int hit = 0;
+    for (;;) {
+        const ssize_t n = read(w->fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        for (ssize_t i = 0; i < n;) {
+            const struct inotify_event *ev = (const struct inotify_event *)(buf + i);
+            if (ev->wd == w->wd_file) {
+                hit = 1;
+                if (ev->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+                    // Apagado/renomeado (ou rotação): volta a esperar a criação
+                    if (!(ev->mask & IN_IGNORED)) inotify_rm_watch(w->fd, w->wd_file);
+                    w->wd_file = -1;
+                }
+            } else if (ev->wd == w->wd_dir && ev->len > 0) {
+                if (strcmp(ev->name, w->name) == 0) {
+                    hit = 1;
+                    ctl_watch_file(w);
+                } else if (strcmp(ev->name, w->side) == 0) {
+                    w->polled = 1;
+                    hit = 1;
+                }
+            }
+            i += (ssize_t)sizeof(struct inotify_event) + ev->len;
+        }
+    }
+    return hit;
+}
+
+// Linha de n bytes lida no fim do arquivo sem '\n': o coletor ainda está
+// gravando o resto. Volta f para o início dela; 1 = trate como EOF.
+static inline int ctl_partial_line(FILE *f, const char *line, size_t n) {
+    if (n == 0 || line[n - 1] == '\n' || !feof(f)) return 0;
+    fseeko(f, -(off_t)n, SEEK_CUR);
+    return 1;
+}
+
+static inline long long ctl_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Espera dado novo no arquivo seguido; 1 se veio evento, 0 no teto
+static inline int ctl_wait(CtlWatch *w, int poll_ms) {
+    if (poll_ms < 1) poll_ms = 1;
+    if (w->fd < 0 || w->wd_dir < 0) {
+        usleep((useconds_t)poll_ms * 1000);
+        return 0;
+    }
+    if (w->wd_file < 0) ctl_watch_file(w);   // criado entre o ctl_follow e agora
+    const int limit = w->polled ? poll_ms : CTL_IDLE_MS;
+    const long long end = ctl_now_ms() + limit;
+    for (;;) {
+        const long long left = end - ctl_now_ms();
+        if (left <= 0) return 0;
+        struct pollfd p;
+        p.fd = w->fd;
+        p.events = POLLIN;
+        p.revents = 0;
+        const int r = poll(&p, 1, (int)left);
+        if (r < 0 && errno != EINTR) {
+            usleep((useconds_t)poll_ms * 1000);
+            return 0;
+        }
+        if (r > 0 && ctl_drain(w)) return 1;
+    }
+}
+
+static inline void ctl_close(CtlWatch *w) {
+    if (w->fd >= 0) close(w->fd);
+    w->fd = -1;
+    w->wd_dir = -1;
+    w->wd_file = -1;
+}
+
+#endif
@@ -0,0 +1,581 @@
+// cedro_zst.h - arquivos de dias fechados comprimidos em zstd com índice de frames
+//
+// O leitorwebsocket --archive comprime os arquivos de cada dia que fecha
+// (raw, B/V/T/Z, .cj) para "<arquivo>.zst" e apaga o original. O formato é o
+// "seekable format" do zstd (contrib/seekable_format): o conteúdo é cortado em
+// frames independentes de ~4 MB, cada um terminando logo depois de um '\n', e
+// no fim vai um frame "skippable" com a tabela de frames:
+//   0x184D2A5E | u32 tamanho | N x {u32 comprimido, u32 original} | u32 N | u8 descritor | 0x8F92EAB1
+// `zstd -d` ignora o frame skippable, então o arquivo segue sendo um .zst comum.
+//
+// Leitura: cz_fopen(path, "r") devolve um FILE* que entrega o conteúdo
+// original (fopencookie): getline, fread, fseeko/ftello funcionam como no
+// arquivo de texto, e o seek pula direto para o frame certo pela tabela.
+// Threads descomprimem os frames seguintes enquanto o parser consome o atual
+// (CEDRO_ZST_THREADS, padrão min(4, núcleos); 0 = tudo na thread do leitor).
+// Se "X_T.txt" não existe mas "X_T.txt.zst" existe, cz_fopen("X_T.txt") abre
+// o comprimido; cz_exists() segue a mesma regra. Um .zst sem tabela (zstd
+// comum) também abre, desde que os frames tragam o tamanho original.
+//
+// cz_index_open()/cz_read_frame() dão acesso direto aos frames (o --raw do
+// coletor processa um frame por tarefa). cz_compress_file() grava o formato.
+//
+// Só header, compila como C (com _GNU_SOURCE, por causa do fopencookie) e C++.
+// Linkar com -lzstd -lpthread.
+#ifndef CEDRO_ZST_H
+#define CEDRO_ZST_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <zstd.h>
+
+#include "cedro_mmap_tail.h"
+
+#define CZ_FRAME_BYTES (4u << 20)
+#define CZ_SKIPPABLE_MAGIC 0x184D2A5Eu
+#define CZ_SEEKABLE_MAGIC 0x8F92EAB1u
+#define CZ_FOOTER_SIZE 9
+#define CZ_MAX_FRAME (1u << 30)     // frame maior que isso não abre (buffer inteiro em memória)
+#define CZ_MAX_THREADS 16
+
+typedef struct {
+    uint64_t c_off, d_off;      // início no arquivo e no conteúdo original
+    uint32_t c_size, d_size;
+} CzFrame;
+
+typedef struct {
+    int fd;
+    int nframes;                // só frames com conteúdo
+    CzFrame *frames;
+    uint64_t d_total;           // tamanho do conteúdo original
+} CzIndex;
+
+static inline uint32_t cz_le32(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void cz_put32(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+static inline int cz_has_suffix(const char *path) {
+    size_t n = strlen(path);
+    return n > 4 && strcmp(path + n - 4, ".zst") == 0;
+}
+
+static inline int cz_pread_all(int fd, void *buf, size_t n, uint64_t off) {
+    char *p = (char *)buf;
+    while (n > 0) {
+        ssize_t r = pread(fd, p, n, (off_t)off);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        p += r;
+        n -= (size_t)r;
+        off += (uint64_t)r;
+    }
+    return 0;
+}
+
+static inline int cz_write_all(int fd, const void *buf, size_t n) {
+    const char *p = (const char *)buf;
+    while (n > 0) {
+        ssize_t r = write(fd, p, n);
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0) return -1;
+        p += r;
+        n -= (size_t)r;
+    }
+    return 0;
+}
+
+static inline int cz_index_push(CzIndex *ix, int *cap, uint64_t c_off, uint32_t c_size, uint32_t d_size) {
+    if (d_size == 0) return 0;
+    if (ix->nframes == *cap) {
+        int ncap = *cap ? *cap * 2 : 256;
+        CzFrame *nf = (CzFrame *)realloc(ix->frames, (size_t)ncap * sizeof(CzFrame));
+        if (!nf) return -1;
+        ix->frames = nf;
+        *cap = ncap;
+    }
+    CzFrame *f = &ix->frames[ix->nframes++];
+    f->c_off = c_off;
+    f->c_size = c_size;
+    f->d_off = ix->d_total;
+    f->d_size = d_size;
+    ix->d_total += d_size;
+    return 0;
+}
+
+// Tabela do fim do arquivo; 0 ok, 1 sem tabela, -1 tabela inválida
+static inline int cz_index_from_table(CzIndex *ix, uint64_t fsize) {
+    unsigned char foot[CZ_FOOTER_SIZE];
+    if (fsize < 8 + CZ_FOOTER_SIZE || cz_pread_all(ix->fd, foot, sizeof(foot), fsize - CZ_FOOTER_SIZE) != 0) return 1;
+    if (cz_le32(foot + 5) != CZ_SEEKABLE_MAGIC) return 1;
+    const uint32_t n = cz_le32(foot);
+    const size_t esz = (foot[4] & 0x80) ? 12 : 8;
+    const uint64_t table = 8 + (uint64_t)n * esz + CZ_FOOTER_SIZE;
+    if (table > fsize) return -1;
+    unsigned char *buf = (unsigned char *)malloc((size_t)table);
+    if (!buf) return -1;
+    int cap = 0, rc = 0;
+    if (cz_pread_all(ix->fd, buf, (size_t)table, fsize - table) != 0 || cz_le32(buf) != CZ_SKIPPABLE_MAGIC ||
+        cz_le32(buf + 4) != table - 8) {
+        rc = -1;
+    } else {
+        uint64_t c_off = 0;
+        for (uint32_t i = 0; i < n && rc == 0; i++) {
+            const unsigned char *e = buf + 8 + (size_t)i * esz;
+            const uint32_t c_size = cz_le32(e), d_size = cz_le32(e + 4);
+            if (d_size > CZ_MAX_FRAME || c_off + c_size > fsize - table) rc = -1;
+            else if (cz_index_push(ix, &cap, c_off, c_size, d_size) != 0) rc = -1;
+            c_off += c_size;
+        }
+    }
+    free(buf);
+    return rc;
+}
+
+// Sem tabela: percorre os frames pelos cabeçalhos (precisam do tamanho original)
+static inline int cz_index_scan(CzIndex *ix, uint64_t fsize) {
+    if (fsize == 0) return 0;
+    void *map = mmap(NULL, (size_t)fsize, PROT_READ, MAP_PRIVATE, ix->fd, 0);
+    if (map == MAP_FAILED) return -1;
+    const char *base = (const char *)map;
+    uint64_t off = 0;
+    int cap = 0, rc = 0;
+    while (off < fsize && rc == 0) {
+        const size_t c_size = ZSTD_findFrameCompressedSize(base + off, (size_t)(fsize - off));
+        if (ZSTD_isError(c_size)) { rc = -1; break; }
+        const unsigned long long d_size = ZSTD_getFrameContentSize(base + off, (size_t)(fsize - off));
+        if (d_size == ZSTD_CONTENTSIZE_UNKNOWN || d_size == ZSTD_CONTENTSIZE_ERROR || d_size > CZ_MAX_FRAME) rc = -1;
+        else rc = cz_index_push(ix, &cap, off, (uint32_t)c_size, (uint32_t)d_size);
+        off += c_size;
+    }
+    munmap(map, (size_t)fsize);
+    return rc;
+}
+
+// 0 ok; -1 com errno (EINVAL = não é um .zst legível)
+static inline int cz_index_open(CzIndex *ix, const char *path) {
+    memset(ix, 0, sizeof(*ix));
+    ix->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (ix->fd < 0) return -1;
+    struct stat st;
+    int rc = fstat(ix->fd, &st) == 0 ? cz_index_from_table(ix, (uint64_t)st.st_size) : -1;
+    if (rc == 1) rc = cz_index_scan(ix, (uint64_t)st.st_size);
+    if (rc != 0) {
+        close(ix->fd);
+        free(ix->frames);
+        memset(ix, 0, sizeof(*ix));
+        ix->fd = -1;
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+static inline void cz_index_close(CzIndex *ix) {
+    if (ix->fd >= 0) close(ix->fd);
+    free(ix->frames);
+    memset(ix, 0, sizeof(*ix));
+    ix->fd = -1;
+}
+
+// Frame que contém o byte pos do original (nframes se pos >= d_total)
+static inline int cz_frame_of(const CzIndex *ix, uint64_t pos) {
+    if (pos >= ix->d_total) return ix->nframes;
+    int lo = 0, hi = ix->nframes - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (ix->frames[mid].d_off <= pos) lo = mid;
+        else hi = mid - 1;
+    }
+    return lo;
+}
+
+// Descomprime o frame f em dst (>= d_size bytes); *src/*src_cap é o buffer do
+// comprimido, reaproveitado entre chamadas. 0 ok.
+static inline int cz_read_frame(const CzIndex *ix, int f, ZSTD_DCtx *dctx, char **src, size_t *src_cap, char *dst) {
+    const CzFrame *fr = &ix->frames[f];
+    if (*src_cap < fr->c_size) {
+        char *nb = (char *)realloc(*src, fr->c_size);
+        if (!nb) return -1;
+        *src = nb;
+        *src_cap = fr->c_size;
+    }
+    if (cz_pread_all(ix->fd, *src, fr->c_size, fr->c_off) != 0) return -1;
+    const size_t r = ZSTD_decompressDCtx(dctx, dst, fr->d_size, *src, fr->c_size);
+    return (ZSTD_isError(r) || r != fr->d_size) ? -1 : 0;
+}
+
+// ---------------------------------------------------------------- escrita
+
+// Comprime src em dst (gravado em dst.tmp e renomeado no fim, depois do fsync).
+// Frames de ~CZ_FRAME_BYTES, cortados no '\n' seguinte. 0 ok; -1 com errno.
+static inline int cz_compress_file(const char *src, const char *dst, int level, uint64_t *in_bytes,
+                                   uint64_t *out_bytes) {
+    char tmp[4096];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", dst) >= (int)sizeof(tmp)) { errno = ENAMETOOLONG; return -1; }
+    int in = open(src, O_RDONLY | O_CLOEXEC);
+    if (in < 0) return -1;
+    struct stat st;
+    if (fstat(in, &st) != 0) { close(in); return -1; }
+    const size_t size = (size_t)st.st_size;
+    const char *base = NULL;
+    if (size > 0) {
+        void *p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, in, 0);
+        if (p == MAP_FAILED) { close(in); return -1; }
+        base = (const char *)p;
+        madvise(p, size, MADV_SEQUENTIAL);
+    }
+    close(in);
+
+    int out = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    ZSTD_CCtx *cctx = ZSTD_createCCtx();
+    unsigned char *table = NULL;
+    size_t tcap = 0, tlen = 8;
+    char *zbuf = NULL;
+    size_t zcap = 0;
+    uint32_t nframes = 0;
+    uint64_t written = 0;
+    int rc = (out < 0 || !cctx) ? -1 : 0;
+    if (rc == 0) {
+        ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level);
+        ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 1);
+    }
+
+    size_t pos = 0;
+    while (rc == 0 && pos < size) {
+        size_t end = pos + CZ_FRAME_BYTES;
+        if (end >= size) {
+            end = size;
+        } else {
+            const void *nl = memchr(base + end, '\n', size - end);
+            end = nl ? (size_t)((const char *)nl - base) + 1 : size;
+        }
+        if (end - pos > CZ_MAX_FRAME) end = pos + CZ_FRAME_BYTES;   // linha gigante: corta no meio
+        const size_t bound = ZSTD_compressBound(end - pos);
+        if (zcap < bound) {
+            char *nb = (char *)realloc(zbuf, bound);
+            if (!nb) { rc = -1; break; }
+            zbuf = nb;
+            zcap = bound;
+        }
+        const size_t z = ZSTD_compress2(cctx, zbuf, zcap, base + pos, end - pos);
+        if (ZSTD_isError(z)) { errno = EIO; rc = -1; break; }
+        if (cz_write_all(out, zbuf, z) != 0) { rc = -1; break; }
+        if (tlen + 8 + CZ_FOOTER_SIZE > tcap) {
+            tcap = tcap ? tcap * 2 : 4096;
+            unsigned char *nt = (unsigned char *)realloc(table, tcap);
+            if (!nt) { rc = -1; break; }
+            table = nt;
+        }
+        cz_put32(table + tlen, (uint32_t)z);
+        cz_put32(table + tlen + 4, (uint32_t)(end - pos));
+        tlen += 8;
+        nframes++;
+        written += z;
+        pos = end;
+    }
+    if (rc == 0 && !table) {
+        table = (unsigned char *)malloc(8 + CZ_FOOTER_SIZE);
+        if (!table) rc = -1;
+    }
+    if (rc == 0) {
+        cz_put32(table, CZ_SKIPPABLE_MAGIC);
+        cz_put32(table + 4, (uint32_t)(tlen - 8 + CZ_FOOTER_SIZE));
+        cz_put32(table + tlen, nframes);
+        table[tlen + 4] = 0;   // sem checksum por frame na tabela (o frame zstd já tem)
+        cz_put32(table + tlen + 5, CZ_SEEKABLE_MAGIC);
+        tlen += CZ_FOOTER_SIZE;
+        if (cz_write_all(out, table, tlen) != 0 || fsync(out) != 0) rc = -1;
+        written += tlen;
+    }
+
+    const int saved = errno;
+    if (out >= 0 && close(out) != 0 && rc == 0) rc = -1;
+    if (rc == 0 && rename(tmp, dst) != 0) rc = -1;
+    if (rc != 0 && out >= 0) unlink(tmp);
+    if (base) munmap((void *)base, size);
+    ZSTD_freeCCtx(cctx);
+    free(zbuf);
+    free(table);
+    if (rc == 0) {
+        if (in_bytes) *in_bytes = size;
+        if (out_bytes) *out_bytes = written;
+    } else {
+        errno = saved ? saved : EIO;
+    }
+    return rc;
+}
+
+// ---------------------------------------------------------------- leitura via FILE*
+
+enum { CZ_SLOT_FREE = 0, CZ_SLOT_BUSY = 1, CZ_SLOT_READY = 2 };
+
+typedef struct {
+    int frame;
+    int state;
+    int err;
+    char *buf;
+    size_t cap;
+} CzSlot;
+
+// O frame f fica no slot f % window. As threads pegam o próximo frame (next)
+// enquanto ele estiver dentro da janela do leitor e o slot estiver livre; o
+// leitor libera o slot quando termina o frame. Um seek para outro frame
+// descarta a janela (gen muda e os frames em andamento são jogados fora).
+typedef struct {
+    CzIndex ix;
+    uint64_t pos;
+    int cur;                    // frame que contém pos
+    int next;                   // próximo frame a descomprimir
+    int window;
+    CzSlot *slots;
+    int nthreads;
+    pthread_t th[CZ_MAX_THREADS];
+    pthread_mutex_t mu;
+    pthread_cond_t cv;
+    unsigned gen;
+    int stop;
+    ZSTD_DCtx *dctx;            // sem threads: descomprime no leitor
+    char *src;
+    size_t src_cap;
+} CzReader;
+
+static inline int cz_slot_fill(const CzIndex *ix, CzSlot *s, int f, ZSTD_DCtx *dctx, char **src, size_t *src_cap) {
+    const size_t need = ix->frames[f].d_size;
+    if (s->cap < need) {
+        char *nb = (char *)realloc(s->buf, need);
+        if (!nb) return -1;
+        s->buf = nb;
+        s->cap = need;
+    }
+    return cz_read_frame(ix, f, dctx, src, src_cap, s->buf);
+}
+
+static inline void *cz_worker(void *arg) {
+    CzReader *r = (CzReader *)arg;
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+    char *src = NULL;
+    size_t src_cap = 0;
+    pthread_mutex_lock(&r->mu);
+    while (!r->stop) {
+        const int f = r->next;
+        CzSlot *s = f < r->ix.nframes ? &r->slots[f % r->window] : NULL;
+        if (!s || f >= r->cur + r->window || s->state != CZ_SLOT_FREE) {
+            pthread_cond_wait(&r->cv, &r->mu);
+            continue;
+        }
+        s->state = CZ_SLOT_BUSY;
+        s->frame = f;
+        r->next++;
+        const unsigned gen = r->gen;
+        pthread_mutex_unlock(&r->mu);
+        const int err = dctx ? cz_slot_fill(&r->ix, s, f, dctx, &src, &src_cap) : -1;
+        pthread_mutex_lock(&r->mu);
+        s->err = err;
+        s->state = gen == r->gen ? CZ_SLOT_READY : CZ_SLOT_FREE;
+        pthread_cond_broadcast(&r->cv);
+    }
+    pthread_mutex_unlock(&r->mu);
+    ZSTD_freeDCtx(dctx);
+    free(src);
+    return NULL;
+}
+
+// Slot pronto com o frame f (NULL em erro de leitura/descompressão)
+static inline CzSlot *cz_acquire(CzReader *r, int f) {
+    CzSlot *s = &r->slots[f % r->window];
+    if (r->nthreads == 0) {
+        if (s->frame != f || s->state != CZ_SLOT_READY) {
+            s->err = cz_slot_fill(&r->ix, s, f, r->dctx, &r->src, &r->src_cap);
+            s->frame = f;
+            s->state = CZ_SLOT_READY;
+        }
+        return s->err ? NULL : s;
+    }
+    pthread_mutex_lock(&r->mu);
+    while (s->frame != f || s->state != CZ_SLOT_READY) pthread_cond_wait(&r->cv, &r->mu);
+    pthread_mutex_unlock(&r->mu);
+    return s->err ? NULL : s;
+}
+
+static inline void cz_release(CzReader *r, int f) {
+    if (r->nthreads == 0) {
+        r->cur = f + 1;
+        return;
+    }
+    pthread_mutex_lock(&r->mu);
+    r->slots[f % r->window].state = CZ_SLOT_FREE;
+    r->cur = f + 1;
+    pthread_cond_broadcast(&r->cv);
+    pthread_mutex_unlock(&r->mu);
+}
+
+static inline ssize_t cz_cookie_read(void *cookie, char *buf, size_t n) {
+    CzReader *r = (CzReader *)cookie;
+    size_t done = 0;
+    while (done < n && r->pos < r->ix.d_total) {
+        const CzFrame *fr = &r->ix.frames[r->cur];
+        CzSlot *s = cz_acquire(r, r->cur);
+        if (!s) {
+            errno = EIO;
+            return done ? (ssize_t)done : -1;
+        }
+        const size_t off = (size_t)(r->pos - fr->d_off);
+        size_t k = fr->d_size - off;
+        if (k > n - done) k = n - done;
+        memcpy(buf + done, s->buf + off, k);
+        done += k;
+        r->pos += k;
+        if (r->pos == fr->d_off + fr->d_size) cz_release(r, r->cur);
+    }
+    return (ssize_t)done;
+}
+
+static inline int cz_cookie_seek(void *cookie, off64_t *offset, int whence) {
+    CzReader *r = (CzReader *)cookie;
+    int64_t target;
+    switch (whence) {
+        case SEEK_SET: target = *offset; break;
+        case SEEK_CUR: target = (int64_t)r->pos + *offset; break;
+        case SEEK_END: target = (int64_t)r->ix.d_total + *offset; break;
+        default: errno = EINVAL; return -1;
+    }
+    if (target < 0) { errno = EINVAL; return -1; }
+    const int f = cz_frame_of(&r->ix, (uint64_t)target);
+    if (f != r->cur) {
+        // Fora do frame atual: a janela recomeça em f
+        if (r->nthreads) pthread_mutex_lock(&r->mu);
+        r->gen++;
+        for (int i = 0; i < r->window; i++) {
+            if (r->slots[i].state == CZ_SLOT_READY && r->nthreads) r->slots[i].state = CZ_SLOT_FREE;
+        }
+        r->cur = f;
+        r->next = f;
+        if (r->nthreads) {
+            pthread_cond_broadcast(&r->cv);
+            pthread_mutex_unlock(&r->mu);
+        }
+    }
+    r->pos = (uint64_t)target;
+    *offset = (off64_t)target;
+    return 0;
+}
+
+static inline int cz_cookie_close(void *cookie) {
+    CzReader *r = (CzReader *)cookie;
+    if (r->nthreads) {
+        pthread_mutex_lock(&r->mu);
+        r->stop = 1;
+        pthread_cond_broadcast(&r->cv);
+        pthread_mutex_unlock(&r->mu);
+        for (int i = 0; i < r->nthreads; i++) pthread_join(r->th[i], NULL);
+        pthread_mutex_destroy(&r->mu);
+        pthread_cond_destroy(&r->cv);
+    }
+    for (int i = 0; i < r->window; i++) free(r->slots[i].buf);
+    free(r->slots);
+    ZSTD_freeDCtx(r->dctx);
+    free(r->src);
+    cz_index_close(&r->ix);
+    free(r);
+    return 0;
+}
+
+static inline int cz_threads(void) {
+    const char *env = getenv("CEDRO_ZST_THREADS");
+    long n = env && *env ? strtol(env, NULL, 10) : sysconf(_SC_NPROCESSORS_ONLN);
+    if (!env || !*env) n = n > 4 ? 4 : n;
+    if (n < 0) n = 0;
+    return n > CZ_MAX_THREADS ? CZ_MAX_THREADS : (int)n;
+}
+
+// Abre um .zst para leitura como FILE*
+static inline FILE *cz_open_zst(const char *path) {
+    CzReader *r = (CzReader *)calloc(1, sizeof(CzReader));
+    if (!r) return NULL;
+    if (cz_index_open(&r->ix, path) != 0) {
+        const int e = errno;
+        free(r);
+        errno = e;
+        return NULL;
+    }
+    r->nthreads = cz_threads();
+    if (r->nthreads > r->ix.nframes) r->nthreads = r->ix.nframes;
+    r->window = r->nthreads ? 2 * r->nthreads : 1;
+    r->slots = (CzSlot *)calloc((size_t)r->window, sizeof(CzSlot));
+    for (int i = 0; r->slots && i < r->window; i++) r->slots[i].frame = -1;
+    if (!r->nthreads) r->dctx = ZSTD_createDCtx();
+    if (!r->slots || (!r->nthreads && !r->dctx)) {
+        free(r->slots);
+        ZSTD_freeDCtx(r->dctx);
+        cz_index_close(&r->ix);
+        free(r);
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (r->nthreads) {
+        pthread_mutex_init(&r->mu, NULL);
+        pthread_cond_init(&r->cv, NULL);
+        int started = 0;
+        while (started < r->nthreads && pthread_create(&r->th[started], NULL, cz_worker, r) == 0) started++;
+        r->nthreads = started;
+        if (!started) {
+            pthread_mutex_destroy(&r->mu);
+            pthread_cond_destroy(&r->cv);
+            r->dctx = ZSTD_createDCtx();
+            r->window = 1;
+        }
+    }
+
+    cookie_io_functions_t io;
+    memset(&io, 0, sizeof(io));
+    io.read = cz_cookie_read;
+    io.seek = cz_cookie_seek;
+    io.close = cz_cookie_close;
+    FILE *f = fopencookie(r, "r", io);
+    if (!f) cz_cookie_close(r);
+    else setvbuf(f, NULL, _IOFBF, 1 << 16);
+    return f;
+}
+
+// path existe, ou path.zst existe
+static inline int cz_exists(const char *path) {
+    if (access(path, F_OK) == 0) return 1;
+    char z[4096];
+    if (snprintf(z, sizeof(z), "%s.zst", path) >= (int)sizeof(z)) return 0;
+    return access(z, F_OK) == 0;
+}
+
+// fopen que também lê .zst: "X.zst" direto, ou "X" quando só "X.zst" existe.
+// Arquivo do dia ainda gravado pelo --writer mmap abre pelo cmt_fopen (para no tail).
+// Escrita ("w", "a", "+") é sempre fopen comum.
+static inline FILE *cz_fopen(const char *path, const char *mode) {
+    if (strpbrk(mode, "wa+")) return fopen(path, mode);
+    if (cz_has_suffix(path)) return cz_open_zst(path);
+    FILE *f = cmt_fopen(path, mode);
+    if (f || errno != ENOENT) return f;
+    char z[4096];
+    if (snprintf(z, sizeof(z), "%s.zst", path) >= (int)sizeof(z) || access(z, F_OK) != 0) {
+        errno = ENOENT;
+        return NULL;
+    }
+    return cz_open_zst(z);
+}
+
+#endif
@@ -3,19 +3,42 @@
 // Cedro Socket BQT (B:) parser -> book top-N features + EMA + signal
 //
 // Modes:
-//  - File: --file <YYYYMMDD_B.txt> --out <csv>
+//  - File: --file <YYYYMMDD_B.txt> --out <csv>  (ou o .zst do dia arquivado, cedro_zst.h)
 //  - Live: --live --input-dir <dir> --out-dir <dir>
+//  - --journal: lê o journal binário ({ymd}_raw.cj) do leitorwebsocket --journal em vez do
+//    _B.txt; ymd/segundo vêm do timestamp em ns do registro (sem parse de texto).
+//  - --shm NOME (com --live): lê o canal B do anel em memória do leitorwebsocket --shm NOME
+//    em vez do arquivo; sem --input-dir e sem poll (cedro_shm.h).
+//  - --from/--to HH:MM:SS (com --file): só as barras desse trecho. O book e as EMAs não têm
+//    como começar no meio do dia, então as linhas antes do --from são aplicadas sem imprimir
+//    e a leitura para depois do --to.
+//  - Keyframes (cedro_keyframe.h): a cada --kf-sec segundos de feed (default 300, 0 desliga)
+//    o book inteiro e o estado de cada símbolo vão para "<input>.B.kf" com o offset do input.
+//    O --from começa no último keyframe até ele em vez de reprocessar o dia, e o live retoma
+//    do último keyframe do dia (sem keyframe, do início do arquivo) em vez de começar no fim
+//    com o book vazio; as barras que o CSV de saída já tem não são repetidas.
+//  - Recuperação (cedro_catchup.h): o live lê do keyframe até o fim do arquivo com o CSV em
+//    buffer cheio e sem fflush por barra, e só no primeiro EOF passa ao fflush por barra e
+//    mostra o resumo (MB/s, hora em que ficou ao vivo). --catchup-emit HH:MM:SS|live: barras
+//    da recuperação antes disso não vão para o CSV. O --file também grava sem fflush por barra.
+//  - Marcador de lacuna do coletor (GAP_START/GAP_END, cedro_gap.h): o servidor reenvia o
+//    book inteiro após reconectar, então os books atingidos (todos, ou os símbolos que o
+//    marcador lista quando só uma sessão do coletor caiu) são zerados no marcador.
+//  - O live espera o input crescer (ou ser criado) por inotify (cedro_tail.h), sem poll; o
+//    --poll-ms só é o teto de espera com o leitorwebsocket --writer mmap, que não gera evento.
 //
 // Notes:
 //  - Reconstructs book by order-position with simple shifting (insert/delete/move).
 //  - Tracks up to --book-cap positions per side (default 2000). Deeper positions are ignored.
 //  - Aggregates per bar (--bar-sec, default 1) using write_ts (YYYYMMDD_HHMMSS) if present,
 //    otherwise tries to use date from filename.
+//  - --bar-sec 1,5,60: one pass, one book, one CSV per timeframe (--out with {bar}, live
+//    {ymd}_b_{N}s.csv each). Bar counters, OFI sums and EMAs live in SymState.bars[k].
 //
 // Output: one line per (symbol, bar) with best bid/ask, spread, mid, microprice,
 // depth sums, imbalance, OFI (top-of-book order flow imbalance), EMAs and signal.
 //
-// Build: gcc -O2 -std=c11 parser_B.c -o parser_B -lm
+// Build: gcc -O2 -std=c11 parser_B.c -o parser_B -lm -lzstd -lpthread
 //
 #define _GNU_SOURCE
 #include <ctype.h>
@@ -28,24 +51,41 @@
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include <sys/stat.h>
+
+#include "cedro_catchup.h"
+#include "cedro_gap.h"
+#include "cedro_index.h"
+#include "cedro_journal.h"
+#include "cedro_keyframe.h"
+#include "cedro_shm.h"
+#include "cedro_tail.h"
+#include "cedro_mmap_tail.h"
+#include "cedro_zst.h"
+
+// Compilado para o cedro_engine, o main vira parser_B_main
+#ifdef CEDRO_ENGINE
+#define main parser_B_main
+#endif
 
 #ifndef PATH_MAX
 #define PATH_MAX 4096
 #endif
 
 #define MAX_SYMS 64
+#define B_MAX_TF 16   // timeframes de um --bar-sec 1,5,60,...
+
+// Recuperação do live (e --file): sem fflush por barra até o primeiro EOF
+static CcuState g_cu;
 
 static void die(const char *msg) { perror(msg); exit(1); }
 
 static bool file_exists(const char *path) { return access(path, F_OK) == 0; }
 
 static long long file_size(const char *path) {
-    FILE *f = fopen(path, "rb");
-    if (!f) return -1;
-    if (fseeko(f, 0, SEEK_END) != 0) { fclose(f); return -1; }
-    off_t sz = ftello(f);
-    fclose(f);
-    return (long long)sz;
+    struct stat st;
+    if (stat(path, &st) != 0) return -1;
+    return (long long)st.st_size;
 }
 
 static double ema_alpha(int period) {
@@ -136,6 +176,19 @@ typedef struct {
     int len;  // current tracked length (0..cap)
 } SideBook;
 
+// Barra e EMAs de um timeframe
+typedef struct {
+    int bar_sec;       // de que timeframe é (keyframe gravado com outra lista de --bar-sec)
+    bool bar_inited;
+    int bar_start_sec; // aligned to bar_sec
+    int events, adds, updates, d1, d2, d3, e_msgs;
+    double ofi_sum; // accumulative OFI within bar
+
+    // EMAs
+    bool ema_fast_inited, ema_slow_inited, ema_imb_inited, ema_ofi_inited;
+    double ema_fast, ema_slow, ema_imb, ema_ofi;
+} BarAcc;
+
 typedef struct {
     char symbol[32];
     SideBook bid; // direction 'A' = buy
@@ -146,15 +199,8 @@ typedef struct {
     double prev_bid_px, prev_bid_qty;
     double prev_ask_px, prev_ask_qty;
 
-    // bar state
-    bool bar_inited;
-    int bar_start_sec; // aligned to bar_sec
-    int events, adds, updates, d1, d2, d3, e_msgs;
-    double ofi_sum; // accumulative OFI within bar
-
-    // EMAs
-    bool ema_fast_inited, ema_slow_inited, ema_imb_inited, ema_ofi_inited;
-    double ema_fast, ema_slow, ema_imb, ema_ofi;
+    // bar state, um por timeframe do --bar-sec (o book é um só)
+    BarAcc bars[B_MAX_TF];
 } SymState;
 
 typedef struct {
@@ -163,6 +209,17 @@ typedef struct {
     int book_cap;
 } SymBook;
 
+// Um CSV por timeframe: barras de SymState.bars[k] vão para out[k]
+typedef struct {
+    int n;
+    int bar_sec[B_MAX_TF];
+    // --from (ou última barra já no CSV do live): barras antes disso só atualizam
+    // book/EMA (-1 = imprime tudo)
+    int from_sec[B_MAX_TF];
+    FILE *out[B_MAX_TF];
+    char path[B_MAX_TF][PATH_MAX];
+} TfOuts;
+
 static void side_init(SideBook *sb, int cap) {
     sb->cap=cap;
     sb->len=0;
@@ -240,6 +297,13 @@ static void book_clear(SymState *st) {
     st->prev_bid_px = st->prev_bid_qty = st->prev_ask_px = st->prev_ask_qty = 0.0;
 }
 
+// Lacuna no feed: books antigos (dos símbolos que o marcador cobre) não valem mais
+static void book_clear_gap(SymBook *book, const char *payload) {
+    for (int i=0;i<book->nsyms;i++) {
+        if (cedro_gap_covers(payload, book->syms[i].symbol)) book_clear(&book->syms[i]);
+    }
+}
+
 static bool has_best_bid(const SymState *st) { return st->bid.len > 0; }
 static bool has_best_ask(const SymState *st) { return st->ask.len > 0; }
 
@@ -276,11 +340,12 @@ static double ofi_increment(double prev_bid_px, double prev_bid_qty,
     return ofi;
 }
 
-static void bar_reset(SymState *st, int bar_start_sec) {
-    st->bar_inited = true;
-    st->bar_start_sec = bar_start_sec;
-    st->events = st->adds = st->updates = st->d1 = st->d2 = st->d3 = st->e_msgs = 0;
-    st->ofi_sum = 0.0;
+static void bar_reset(BarAcc *b, int bar_sec, int bar_start_sec) {
+    b->bar_sec = bar_sec;
+    b->bar_inited = true;
+    b->bar_start_sec = bar_start_sec;
+    b->events = b->adds = b->updates = b->d1 = b->d2 = b->d3 = b->e_msgs = 0;
+    b->ofi_sum = 0.0;
 }
 
 static void ensure_header(FILE *out) {
@@ -306,12 +371,14 @@ static const char* signal_rule(double ema_fast, double ema_slow,
     return "FLAT";
 }
 
-static void emit_bar(FILE *out, const char ymd[9], int bar_sec,
+static void emit_bar(const TfOuts *to, int k, const char ymd[9],
                      SymState *st,
                      int levels_L,
                      int ema_fast_p, int ema_slow_p, int ema_imb_p, int ema_ofi_p,
                      double imb_th, double ofi_th, int min_events) {
-    if (!st->bar_inited) return;
+    BarAcc *b = &st->bars[k];
+    if (!b->bar_inited) return;
+    FILE *out = to->out[k];
 
     // Compute snapshot features from current book state
     bool bb = has_best_bid(st);
@@ -347,18 +414,20 @@ static void emit_bar(FILE *out, const char ymd[9], int bar_sec,
     // price reference: micro if valid else mid
     double px_ref = (!isnan(micro) ? micro : mid);
     if (!isnan(px_ref)) {
-        st->ema_fast = ema_update(st->ema_fast, px_ref, a_fast, &st->ema_fast_inited);
-        st->ema_slow = ema_update(st->ema_slow, px_ref, a_slow, &st->ema_slow_inited);
+        b->ema_fast = ema_update(b->ema_fast, px_ref, a_fast, &b->ema_fast_inited);
+        b->ema_slow = ema_update(b->ema_slow, px_ref, a_slow, &b->ema_slow_inited);
     }
-    st->ema_imb = ema_update(st->ema_imb, imb, a_imb, &st->ema_imb_inited);
-    st->ema_ofi = ema_update(st->ema_ofi, st->ofi_sum, a_ofi, &st->ema_ofi_inited);
+    b->ema_imb = ema_update(b->ema_imb, imb, a_imb, &b->ema_imb_inited);
+    b->ema_ofi = ema_update(b->ema_ofi, b->ofi_sum, a_ofi, &b->ema_ofi_inited);
+
+    double ema_diff = b->ema_fast - b->ema_slow;
+    const char *sig = signal_rule(b->ema_fast, b->ema_slow, b->ema_imb, b->ema_ofi,
+                                  imb_th, ofi_th, min_events, b->events);
 
-    double ema_diff = st->ema_fast - st->ema_slow;
-    const char *sig = signal_rule(st->ema_fast, st->ema_slow, st->ema_imb, st->ema_ofi,
-                                  imb_th, ofi_th, min_events, st->events);
+    if (b->bar_start_sec < to->from_sec[k] || !ccu_emit(&g_cu, b->bar_start_sec)) return;
 
     char hhmmss[9];
-    sec_to_hhmmss(st->bar_start_sec, hhmmss);
+    sec_to_hhmmss(b->bar_start_sec, hhmmss);
 
     char bar_ts[32];
     snprintf(bar_ts, sizeof(bar_ts), "%s_%s", ymd, hhmmss);
@@ -368,18 +437,18 @@ static void emit_bar(FILE *out, const char ymd[9], int bar_sec,
         "%.10g,%.10g,%.10g,%.10g,%.10g,%.10g,%.10g,"
         "%.10g,%.10g,%.10g,%.10g,"
         "%.10g,%.10g,%.10g,%.10g,%.10g,%s,%d,%d\n",
-        bar_ts, st->symbol, bar_sec,
-        st->events, st->adds, st->updates, st->d1, st->d2, st->d3, st->e_msgs,
+        bar_ts, st->symbol, to->bar_sec[k],
+        b->events, b->adds, b->updates, b->d1, b->d2, b->d3, b->e_msgs,
         bb_px, bb_q, ba_px, ba_q, spread, mid, micro,
-        bidL, askL, imb, st->ofi_sum,
-        st->ema_fast, st->ema_slow, st->ema_imb, st->ema_ofi, ema_diff, sig,
+        bidL, askL, imb, b->ofi_sum,
+        b->ema_fast, b->ema_slow, b->ema_imb, b->ema_ofi, ema_diff, sig,
         st->bid.len, st->ask.len
     );
-    fflush(out);
+    ccu_flush(&g_cu, out);
 }
 
-// Update OFI accumulator based on best quote changes after each event.
-static void update_ofi_after_event(SymState *st) {
+// Update OFI accumulator (de cada timeframe) based on best quote changes after each event.
+static void update_ofi_after_event(SymState *st, int ntf) {
     if (!(has_best_bid(st) && has_best_ask(st))) {
         // can't compute OFI without both sides; still update prev if possible
         if (has_best_bid(st) && has_best_ask(st)) {
@@ -404,17 +473,22 @@ static void update_ofi_after_event(SymState *st) {
     double inc = ofi_increment(st->prev_bid_px, st->prev_bid_qty,
                               st->prev_ask_px, st->prev_ask_qty,
                               bid_px, bid_qty, ask_px, ask_qty);
-    st->ofi_sum += inc;
+    for (int k=0;k<ntf;k++) st->bars[k].ofi_sum += inc;
 
     st->prev_bid_px = bid_px; st->prev_bid_qty = bid_qty;
     st->prev_ask_px = ask_px; st->prev_ask_qty = ask_qty;
 }
 
+static bool process_payload(SymBook *book, const char *payload,
+                            const char ymd[9], int sec,
+                            const TfOuts *to, int levels_L,
+                            int ema_fast_p, int ema_slow_p, int ema_imb_p, int ema_ofi_p,
+                            double imb_th, double ofi_th, int min_events);
+
 // Parse & process one line. Returns true if processed any B message.
 static bool process_line(SymBook *book, const char *line_in,
                          const char fallback_ymd[9],
-                         int bar_sec, int levels_L,
-                         FILE *out,
+                         const TfOuts *to, int levels_L,
                          int ema_fast_p, int ema_slow_p, int ema_imb_p, int ema_ofi_p,
                          double imb_th, double ofi_th, int min_events) {
     const char *pb = strstr(line_in, "B:");
@@ -440,7 +514,6 @@ static bool process_line(SymBook *book, const char *line_in,
     // Parse optional prefix: write_ts,buf_len,flag,...
     char ymd[9] = {0};
     int sec = -1;
-    int bar_start = -1;
 
     // Try parse csv prefix by splitting linebuf by ',' first 4 fields
     // Example: 20251222_090054,4284,0,B:WING26:...
@@ -462,10 +535,18 @@ static bool process_line(SymBook *book, const char *line_in,
         snprintf(ymd, sizeof(ymd), "%s", fallback_ymd);
     }
 
-    if (sec >= 0) {
-        int bar_len = bar_sec;
-        bar_start = (sec / bar_len) * bar_len;
-    }
+    return process_payload(book, payload, ymd, sec, to, levels_L,
+                           ema_fast_p, ema_slow_p, ema_imb_p, ema_ofi_p,
+                           imb_th, ofi_th, min_events);
+}
+
+// Process one "B:..." payload already separated from the prefix.
+// sec < 0 means time unknown (no bar emission).
+static bool process_payload(SymBook *book, const char *payload,
+                            const char ymd[9], int sec,
+                            const TfOuts *to, int levels_L,
+                            int ema_fast_p, int ema_slow_p, int ema_imb_p, int ema_ofi_p,
+                            double imb_th, double ofi_th, int min_events) {
 
     // Now parse payload tokens
     char paybuf[2048];
@@ -487,34 +568,42 @@ static bool process_line(SymBook *book, const char *line_in,
     if (!st) return false;
 
     // Bar handling: if we have time and bar moved forward, emit previous bar
+    // (em cada timeframe; o book abaixo é atualizado uma vez só)
     if (sec >= 0) {
-        if (!st->bar_inited) bar_reset(st, bar_start);
-        else if (bar_start > st->bar_start_sec) {
-            emit_bar(out, ymd, bar_sec, st, levels_L,
-                     ema_fast_p, ema_slow_p, ema_imb_p, ema_ofi_p,
-                     imb_th, ofi_th, min_events);
-            bar_reset(st, bar_start);
-        } else if (bar_start < st->bar_start_sec) {
-            // late line; ignore bar emission, but still apply book update
+        for (int k=0;k<to->n;k++) {
+            BarAcc *b = &st->bars[k];
+            const int bar_start = (sec / to->bar_sec[k]) * to->bar_sec[k];
+            if (!b->bar_inited) bar_reset(b, to->bar_sec[k], bar_start);
+            else if (bar_start > b->bar_start_sec) {
+                emit_bar(to, k, ymd, st, levels_L,
+                         ema_fast_p, ema_slow_p, ema_imb_p, ema_ofi_p,
+                         imb_th, ofi_th, min_events);
+                bar_reset(b, to->bar_sec[k], bar_start);
+            } else if (bar_start < b->bar_start_sec) {
+                // late line; ignore bar emission, but still apply book update
+            }
         }
     }
 
-    st->events++;
+    // Contadores da barra em curso de cada timeframe
+    #define BAR_COUNT(field) for (int k_=0;k_<to->n;k_++) st->bars[k_].field++
+
+    BAR_COUNT(events);
 
     // Handle operations
     if (op[0] == 'E') {
-        st->e_msgs++;
+        BAR_COUNT(e_msgs);
         // No state change
-        update_ofi_after_event(st);
+        update_ofi_after_event(st, to->n);
         return true;
     }
 
     if (op[0] == 'D') {
         // D:3 or D:<type>:<dir>:<pos>
         if (np >= 4 && strcmp(parts[3], "3") == 0) {
-            st->d3++;
+            BAR_COUNT(d3);
             book_clear(st);
-            update_ofi_after_event(st);
+            update_ofi_after_event(st, to->n);
             return true;
         }
         if (np < 6) return false;
@@ -522,9 +611,9 @@ static bool process_line(SymBook *book, const char *line_in,
         char dir = parts[4][0];
         int pos = atoi(parts[5]);
 
-        if (ctype == 1) st->d1++;
-        else if (ctype == 2) st->d2++;
-        else st->d1++; // fallback
+        if (ctype == 1) BAR_COUNT(d1);
+        else if (ctype == 2) BAR_COUNT(d2);
+        else BAR_COUNT(d1); // fallback
 
         SideBook *sb = (dir == 'A') ? &st->bid : &st->ask;
         if (ctype == 1) {
@@ -537,7 +626,7 @@ static bool process_line(SymBook *book, const char *line_in,
             side_remove_at(sb, pos);
         }
 
-        update_ofi_after_event(st);
+        update_ofi_after_event(st, to->n);
         return true;
     }
 
@@ -574,8 +663,8 @@ static bool process_line(SymBook *book, const char *line_in,
         SideBook *sb = (dir == 'A') ? &st->bid : &st->ask;
         side_insert(sb, pos, &o);
 
-        st->adds++;
-        update_ofi_after_event(st);
+        BAR_COUNT(adds);
+        update_ofi_after_event(st, to->n);
         return true;
     }
 
@@ -630,14 +719,15 @@ static bool process_line(SymBook *book, const char *line_in,
             side_insert(sb, pos_new, &o);
         }
 
-        st->updates++;
-        update_ofi_after_event(st);
+        BAR_COUNT(updates);
+        update_ofi_after_event(st, to->n);
         return true;
     }
 
     // Unknown op; ignore
-    update_ofi_after_event(st);
+    update_ofi_after_event(st, to->n);
     return false;
+    #undef BAR_COUNT
 }
 
 typedef struct {
@@ -647,7 +737,8 @@ typedef struct {
     char input_dir[PATH_MAX];
     char out_dir[PATH_MAX];
 
-    int bar_sec;
+    int bar_secs[B_MAX_TF];   // --bar-sec 1 ou 1,5,60: um CSV por timeframe
+    int ntf;
     int levels_L;
     int book_cap;
 
@@ -657,17 +748,41 @@ typedef struct {
     int min_events;
 
     int poll_ms;
+    bool journal;
+    char shm[128];
+    int from_sec, to_sec;   // --from/--to em segundos do dia; -1 = sem limite
+    int kf_sec;             // keyframe a cada N s de feed; 0 = sem keyframes
+    int catchup_emit;       // --catchup-emit: segundos do dia, CCU_EMIT_LIVE ou -1
 } Args;
 
 static bool streq(const char *a, const char *b) { return strcmp(a,b)==0; }
 
+// "1,5,60" -> secs/n; false se vazia, com mais de B_MAX_TF ou repetida
+static bool parse_bar_list(const char *s, int secs[B_MAX_TF], int *n) {
+    int k = 0;
+    while (*s) {
+        char *end = NULL;
+        long v = strtol(s, &end, 10);
+        if (end == s || k == B_MAX_TF) return false;
+        if (v <= 0) v = 1;
+        for (int j=0;j<k;j++) if (secs[j] == (int)v) return false;
+        secs[k++] = (int)v;
+        s = end;
+        if (*s == ',') s++;
+        else if (*s) return false;
+    }
+    if (k == 0) return false;
+    *n = k;
+    return true;
+}
+
 static void usage(const char *argv0) {
     fprintf(stderr,
         "Uso:\n"
         "  %s --file <YYYYMMDD_B.txt> --out <saida.csv> [opcoes]\n"
         "  %s --live --input-dir <dir> --out-dir <dir> [opcoes]\n\n"
         "Opcoes:\n"
-        "  --bar-sec N           (default 1)\n"
+        "  --bar-sec N[,N...]    (default 1) lista: um CSV por timeframe numa passada so (--out com {bar})\n"
         "  --levels N            (somatorio qty nos primeiros N niveis por lado; default 20)\n"
         "  --book-cap N          (posicoes rastreadas por lado; default 2000)\n"
         "  --ema-fast N          (default 9)\n"
@@ -677,14 +792,21 @@ static void usage(const char *argv0) {
         "  --imb-th X            (default 0.10)\n"
         "  --ofi-th X            (default 10)\n"
         "  --min-events N        (default 20)\n"
-        "  --poll-ms N           (default 200) apenas live\n",
+        "  --poll-ms N           (default 200) apenas live; teto de espera (o input acorda por inotify, menos o --writer mmap)\n"
+        "  --journal             entrada e o journal binario (--file X_raw.cj / live {ymd}_raw.cj)\n"
+        "  --shm NOME            live: le do anel em memoria do leitorwebsocket --shm NOME (sem --input-dir)\n"
+        "  --from HH:MM:SS       file: so barras a partir dai (o inicio do dia e reprocessado sem imprimir)\n"
+        "  --to HH:MM:SS         file: para de ler depois dai\n"
+        "  --kf-sec N            keyframe do book em <input>.B.kf a cada N s (default 300; 0 desliga)\n"
+        "  --catchup-emit X      live: barras da recuperacao antes de HH:MM:SS (ou todas, com live) nao vao para o CSV\n",
         argv0, argv0
     );
 }
 
 static Args parse_args(int argc, char **argv) {
     Args a; memset(&a, 0, sizeof(a));
-    a.bar_sec = 1;
+    a.bar_secs[0] = 1;
+    a.ntf = 1;
     a.levels_L = 20;
     a.book_cap = 2000;
     a.ema_fast_p = 9;
@@ -695,6 +817,10 @@ static Args parse_args(int argc, char **argv) {
     a.ofi_th = 10.0;
     a.min_events = 20;
     a.poll_ms = 200;
+    a.from_sec = -1;
+    a.to_sec = -1;
+    a.kf_sec = 300;
+    a.catchup_emit = -1;
 
     for (int i=1;i<argc;i++) {
         if (streq(argv[i],"--live")) a.live = true;
@@ -702,7 +828,13 @@ static Args parse_args(int argc, char **argv) {
         else if (streq(argv[i],"--out") && i+1<argc) snprintf(a.out,sizeof(a.out),"%s",argv[++i]);
         else if (streq(argv[i],"--input-dir") && i+1<argc) snprintf(a.input_dir,sizeof(a.input_dir),"%s",argv[++i]);
         else if (streq(argv[i],"--out-dir") && i+1<argc) snprintf(a.out_dir,sizeof(a.out_dir),"%s",argv[++i]);
-        else if (streq(argv[i],"--bar-sec") && i+1<argc) a.bar_sec = atoi(argv[++i]);
+        else if (streq(argv[i],"--bar-sec") && i+1<argc) {
+            if (!parse_bar_list(argv[i+1], a.bar_secs, &a.ntf)) {
+                fprintf(stderr, "--bar-sec espera N ou N1,N2,... (ate %d, sem repetir): %s\n", B_MAX_TF, argv[i+1]);
+                exit(2);
+            }
+            i++;
+        }
         else if (streq(argv[i],"--levels") && i+1<argc) a.levels_L = atoi(argv[++i]);
         else if (streq(argv[i],"--book-cap") && i+1<argc) a.book_cap = atoi(argv[++i]);
         else if (streq(argv[i],"--ema-fast") && i+1<argc) a.ema_fast_p = atoi(argv[++i]);
@@ -713,13 +845,34 @@ static Args parse_args(int argc, char **argv) {
         else if (streq(argv[i],"--ofi-th") && i+1<argc) a.ofi_th = atof(argv[++i]);
         else if (streq(argv[i],"--min-events") && i+1<argc) a.min_events = atoi(argv[++i]);
         else if (streq(argv[i],"--poll-ms") && i+1<argc) a.poll_ms = atoi(argv[++i]);
+        else if (streq(argv[i],"--journal")) a.journal = true;
+        else if (streq(argv[i],"--shm") && i+1<argc) snprintf(a.shm,sizeof(a.shm),"%s",argv[++i]);
+        else if (streq(argv[i],"--kf-sec") && i+1<argc) a.kf_sec = atoi(argv[++i]);
+        else if (streq(argv[i],"--catchup-emit") && i+1<argc) {
+            if (!ccu_parse_emit(argv[i+1], &a.catchup_emit)) {
+                fprintf(stderr, "--catchup-emit espera HH:MM:SS ou live: %s\n", argv[i+1]);
+                exit(2);
+            }
+            i++;
+        }
+        else if ((streq(argv[i],"--from") || streq(argv[i],"--to")) && i+1<argc) {
+            int *dst = streq(argv[i],"--from") ? &a.from_sec : &a.to_sec;
+            if (!ci_parse_hms(argv[i+1], dst)) {
+                fprintf(stderr, "%s espera HH:MM:SS: %s\n", argv[i], argv[i+1]);
+                exit(2);
+            }
+            i++;
+        }
         else {
             fprintf(stderr, "Argumento invalido: %s\n", argv[i]);
             usage(argv[0]);
             exit(2);
         }
     }
-    if (a.bar_sec <= 0) a.bar_sec = 1;
+    if (!a.live && a.ntf > 1 && !strstr(a.out, "{bar}")) {
+        fprintf(stderr, "Com mais de um --bar-sec o --out precisa ter {bar} (ex: 20251222_b_{bar}s.csv)\n");
+        exit(2);
+    }
     if (a.levels_L <= 0) a.levels_L = 20;
     if (a.book_cap < 50) a.book_cap = 50;
     if (a.poll_ms < 10) a.poll_ms = 10;
@@ -734,18 +887,59 @@ static void today_ymd(char out_ymd[9]) {
 }
 
 static void build_live_paths(const Args *a, const char ymd[9],
-                             char out_infile[PATH_MAX], char out_outfile[PATH_MAX]) {
-    // Try both ..._B.txt and ..._B
-    int n1 = snprintf(out_infile, PATH_MAX, "%s/%s_B.txt", a->input_dir, ymd);
-    if (n1 < 0 || n1 >= PATH_MAX) { fprintf(stderr,"ERRO: input path grande\n"); exit(2); }
+                             char out_infile[PATH_MAX], TfOuts *to) {
+    if (a->journal) {
+        int nj = snprintf(out_infile, PATH_MAX, "%s/%s_raw.cj", a->input_dir, ymd);
+        if (nj < 0 || nj >= PATH_MAX) { fprintf(stderr,"ERRO: input path grande\n"); exit(2); }
+    } else {
+        // Try both ..._B.txt and ..._B
+        int n1 = snprintf(out_infile, PATH_MAX, "%s/%s_B.txt", a->input_dir, ymd);
+        if (n1 < 0 || n1 >= PATH_MAX) { fprintf(stderr,"ERRO: input path grande\n"); exit(2); }
+
+        if (!file_exists(out_infile)) {
+            int n1b = snprintf(out_infile, PATH_MAX, "%s/%s_B", a->input_dir, ymd);
+            if (n1b < 0 || n1b >= PATH_MAX) { fprintf(stderr,"ERRO: input path grande\n"); exit(2); }
+        }
+    }
+
+    for (int k=0;k<to->n;k++) {
+        int n2 = snprintf(to->path[k], PATH_MAX, "%s/%s_b_%ds.csv", a->out_dir, ymd, to->bar_sec[k]);
+        if (n2 < 0 || n2 >= PATH_MAX) { fprintf(stderr,"ERRO: output path grande\n"); exit(2); }
+    }
+}
+
+static void tf_init(TfOuts *to, const Args *a) {
+    memset(to, 0, sizeof(*to));
+    to->n = a->ntf;
+    for (int k=0;k<to->n;k++) {
+        to->bar_sec[k] = a->bar_secs[k];
+        to->from_sec[k] = -1;
+    }
+}
+
+// Fecha a barra em curso de todos os símbolos, em todos os timeframes
+static void emit_all(const TfOuts *to, const char ymd[9], SymBook *book, const Args *a) {
+    for (int k=0;k<to->n;k++) {
+        for (int i=0;i<book->nsyms;i++) {
+            emit_bar(to, k, ymd, &book->syms[i], a->levels_L,
+                     a->ema_fast_p, a->ema_slow_p, a->ema_imb_p, a->ema_ofi_p,
+                     a->imb_th, a->ofi_th, a->min_events);
+        }
+    }
+}
 
-    if (!file_exists(out_infile)) {
-        int n1b = snprintf(out_infile, PATH_MAX, "%s/%s_B", a->input_dir, ymd);
-        if (n1b < 0 || n1b >= PATH_MAX) { fprintf(stderr,"ERRO: input path grande\n"); exit(2); }
+static void tf_close(TfOuts *to) {
+    for (int k=0;k<to->n;k++) {
+        if (to->out[k]) fclose(to->out[k]);
+        to->out[k] = NULL;
     }
+}
 
-    int n2 = snprintf(out_outfile, PATH_MAX, "%s/%s_b_%ds.csv", a->out_dir, ymd, a->bar_sec);
-    if (n2 < 0 || n2 >= PATH_MAX) { fprintf(stderr,"ERRO: output path grande\n"); exit(2); }
+// Primeiro EOF: descarrega os CSVs e mostra o resumo da recuperação
+static void tf_live(TfOuts *to) {
+    if (!g_cu.active) return;
+    for (int k=0;k<to->n;k++) if (to->out[k]) fflush(to->out[k]);
+    ccu_live(&g_cu, NULL);
 }
 
 static void free_book(SymBook *book) {
@@ -756,6 +950,100 @@ static void free_book(SymBook *book) {
     book->nsyms = 0;
 }
 
+// ---------- keyframes (cedro_keyframe.h) ----------
+
+// Keyframe na virada de cada período de kf_sec segundos de feed
+static bool kf_due(int *last_sec, int sec, int kf_sec) {
+    if (kf_sec <= 0 || sec < 0) return false;
+    const bool due = *last_sec >= 0 && sec / kf_sec != *last_sec / kf_sec;
+    *last_sec = sec;
+    return due;
+}
+
+static void kf_open(CkfWriter *w, const Args *a, const char *infile) {
+    char path[PATH_MAX];
+    const bool on = a->kf_sec > 0 && ckf_path(infile, 'B', path, sizeof(path));
+    ckf_writer_open(w, on ? path : NULL, 'B', (uint32_t)a->book_cap, sizeof(SymState), sizeof(Order));
+}
+
+// Book e estado de todos os símbolos depois da linha que termina em in_off
+static void kf_save(CkfWriter *w, const SymBook *book, long long in_off, int sec) {
+    if (!ckf_begin(w, in_off, sec)) return;
+    for (int i=0;i<book->nsyms;i++) {
+        const SymState *st = &book->syms[i];
+        SymState extra = *st;   // os ponteiros dos lados não valem fora deste processo
+        extra.bid.arr = NULL;
+        extra.ask.arr = NULL;
+        ckf_add(w, st->symbol, &extra, st->bid.arr, (uint32_t)st->bid.len, st->ask.arr, (uint32_t)st->ask.len);
+    }
+    ckf_commit(w);
+}
+
+// Keyframe gravado com outra lista de --bar-sec: cada timeframe fica com a
+// barra/EMAs do mesmo tamanho que estiver lá, ou começa do zero
+static void bars_remap(SymState *st, const TfOuts *to) {
+    BarAcc kf[B_MAX_TF];
+    memcpy(kf, st->bars, sizeof(kf));
+    memset(st->bars, 0, sizeof(st->bars));
+    for (int k=0;k<to->n;k++) {
+        for (int j=0;j<B_MAX_TF;j++) {
+            if (kf[j].bar_sec == to->bar_sec[k]) { st->bars[k] = kf[j]; break; }
+        }
+    }
+}
+
+// Carrega no book (vazio) o último keyframe de infile até max_sec (-1 = o
+// último); *in_off recebe de onde continuar a leitura. false se não há.
+static bool kf_restore(SymBook *book, const TfOuts *to, const char *infile, int max_sec, long long *in_off) {
+    char path[PATH_MAX];
+    CkfFrame fr;
+    if (!ckf_path(infile, 'B', path, sizeof(path)) ||
+        !ckf_load(path, 'B', (uint32_t)book->book_cap, sizeof(SymState), sizeof(Order), max_sec, -1, &fr)) {
+        return false;
+    }
+    CkfSym s;
+    const void *extra, *bid, *ask;
+    while (ckf_next_sym(&fr, &s, &extra, &bid, &ask)) {
+        SymState *st = get_sym(book, s.symbol);
+        if (!st) continue;
+        const SideBook b = st->bid, k = st->ask;
+        memcpy(st, extra, sizeof(*st));
+        st->bid = b;
+        st->ask = k;
+        memcpy(st->bid.arr, bid, (size_t)s.nbid * sizeof(Order));
+        memcpy(st->ask.arr, ask, (size_t)s.nask * sizeof(Order));
+        st->bid.len = (int)s.nbid;
+        st->ask.len = (int)s.nask;
+        bars_remap(st, to);
+    }
+    *in_off = (long long)fr.h.in_off;
+    ckf_free(&fr);
+    return true;
+}
+
+// Segundo do dia da última barra do CSV de saída (-1 se vazio)
+static int last_bar_sec(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    char buf[8192];
+    long long sz = 0;
+    if (fseeko(f, 0, SEEK_END) == 0) sz = (long long)ftello(f);
+    const long long from = sz > (long long)sizeof(buf) - 1 ? sz - (long long)sizeof(buf) + 1 : 0;
+    size_t n = 0;
+    if (fseeko(f, (off_t)from, SEEK_SET) == 0) n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+    int sec = -1;
+    char ymd[9];
+    for (char *p = buf; p && *p; ) {
+        int s;
+        if (parse_write_ts(p, ymd, &s)) sec = s;
+        p = strchr(p, '\n');
+        if (p) p++;
+    }
+    return sec;
+}
+
 static void run_file_mode(const Args *a) {
     char ymd[9] = {0};
     if (!extract_ymd_from_path(a->file, ymd)) {
@@ -763,121 +1051,261 @@ static void run_file_mode(const Args *a) {
         exit(2);
     }
 
-    FILE *in = fopen(a->file, "rb");
+    FILE *in = cz_fopen(a->file, "rb");   // aceita o .zst do dia arquivado
     if (!in) die("fopen input");
 
-    FILE *out = fopen(a->out, "wb");
-    if (!out) die("fopen out");
-    ensure_header(out);
+    // --out com {bar}: um CSV por timeframe
+    static TfOuts to;
+    tf_init(&to, a);
+    for (int k=0;k<to.n;k++) {
+        const char *p = strstr(a->out, "{bar}");
+        if (p) snprintf(to.path[k], PATH_MAX, "%.*s%d%s", (int)(p - a->out), a->out, to.bar_sec[k], p + 5);
+        else snprintf(to.path[k], PATH_MAX, "%s", a->out);
+        to.out[k] = fopen(to.path[k], "wb");
+        if (!to.out[k]) die("fopen out");
+        setvbuf(to.out[k], NULL, _IOFBF, 1<<20);
+        ensure_header(to.out[k]);
+        to.from_sec[k] = a->from_sec;
+    }
 
     SymBook book; memset(&book, 0, sizeof(book));
     book.book_cap = a->book_cap;
-
-    char *line=NULL;
-    size_t cap=0;
-    while (getline(&line, &cap, in) != -1) {
-        process_line(&book, line, ymd, a->bar_sec, a->levels_L, out,
-                     a->ema_fast_p, a->ema_slow_p, a->ema_imb_p, a->ema_ofi_p,
-                     a->imb_th, a->ofi_th, a->min_events);
+    ccu_begin(&g_cu, "parser_B", -1);   // nunca fica ao vivo: sem fflush por barra
+
+    // --from: começa no último keyframe até ele
+    long long start = 0;
+    if (a->from_sec >= 0) kf_restore(&book, &to, a->file, a->from_sec, &start);
+    CkfWriter kw;
+    kf_open(&kw, a, a->file);
+    int kf_last = -1;
+
+    if (a->journal) {
+        static CjReader jr;
+        cj_init(&jr, in);
+        if (start > 0) cj_seek(&jr, start);
+        CjRecord rec;
+        int r;
+        while ((r = cj_next(&jr, &rec)) > 0) {
+            if (rec.h.type == CJ_TYPE_GAP) { book_clear_gap(&book, rec.payload); continue; }
+            if (rec.h.type != 'B') continue;
+            int sec;
+            cj_ymd_sec(&rec, ymd, &sec);
+            if (a->to_sec >= 0 && sec > a->to_sec) break;
+            process_payload(&book, rec.payload, ymd, sec, &to, a->levels_L,
+                            a->ema_fast_p, a->ema_slow_p, a->ema_imb_p, a->ema_ofi_p,
+                            a->imb_th, a->ofi_th, a->min_events);
+            if (kf_due(&kf_last, sec, a->kf_sec)) kf_save(&kw, &book, jr.offset, sec);
+        }
+        if (r < 0) fprintf(stderr, "ERRO: journal invalido: %s\n", a->file);
+        cj_free(&jr);
+    } else {
+        char *line=NULL;
+        size_t cap=0;
+        if (start > 0 && fseeko(in, (off_t)start, SEEK_SET) != 0) die("fseeko input");
+        while (getline(&line, &cap, in) != -1) {
+            const int sec = ci_line_sec(line);
+            if (a->to_sec >= 0 && sec > a->to_sec) break;
+            if (cedro_gap_line(line)) { book_clear_gap(&book, cedro_gap_payload(line)); continue; }
+            process_line(&book, line, ymd, &to, a->levels_L,
+                         a->ema_fast_p, a->ema_slow_p, a->ema_imb_p, a->ema_ofi_p,
+                         a->imb_th, a->ofi_th, a->min_events);
+            if (kf_due(&kf_last, sec, a->kf_sec)) kf_save(&kw, &book, (long long)ftello(in), sec);
+        }
+        free(line);
     }
-    free(line);
+    ckf_writer_close(&kw);
 
     // flush last bars
-    for (int i=0;i<book.nsyms;i++) {
-        emit_bar(out, ymd, a->bar_sec, &book.syms[i], a->levels_L,
-                 a->ema_fast_p, a->ema_slow_p, a->ema_imb_p, a->ema_ofi_p,
-                 a->imb_th, a->ofi_th, a->min_events);
-    }
+    emit_all(&to, ymd, &book, a);
 
     free_book(&book);
     fclose(in);
-    fclose(out);
+    tf_close(&to);
 }
 
 static void run_live_mode(const Args *a) {
     SymBook book; memset(&book, 0, sizeof(book));
     book.book_cap = a->book_cap;
 
+    // --shm: o dia vem dos registros (cshm_next_day), e os CSVs só abrem com o
+    // primeiro; no cedro_engine a entrada pode ser de outro dia
     char cur_ymd[9] = {0};
-    today_ymd(cur_ymd);
+    char next_ymd[9] = {0};
+    if (!a->shm[0]) today_ymd(cur_ymd);
+    char last_ymd[9];   // do último registro lido (as barras levam a data do feed)
+    memcpy(last_ymd, cur_ymd, sizeof(last_ymd));
 
-    char infile[PATH_MAX], outfile[PATH_MAX];
-    build_live_paths(a, cur_ymd, infile, outfile);
+    // CSV de cada timeframe: {out-dir}/{ymd}_b_{bar_sec}s.csv
+    static TfOuts to;
+    tf_init(&to, a);
+    char infile[PATH_MAX];
+    build_live_paths(a, cur_ymd, infile, &to);
 
     FILE *in=NULL;
-    FILE *out=NULL;
     long long last_sz=-1;
 
     char *line=NULL;
     size_t cap=0;
+    static CjReader jr;
+    CmtTail tail = {0};   // sidecar .tail do leitorwebsocket --writer mmap
+    CkfWriter kw;
+    memset(&kw, 0, sizeof(kw));
+    int kf_last = -1;
+    int catchup_emit = a->catchup_emit;
+    CtlWatch cw;
+    memset(&cw, 0, sizeof(cw));
+    cw.fd = -1;
+    if (!a->shm[0]) {
+        ctl_init(&cw);
+        ctl_follow(&cw, infile);
+    }
+    bool waited = true;   // o tamanho do input só é conferido depois de uma espera
+    static CshmReader sr;
+    if (a->shm[0]) {
+        // Espera o coletor criar o segmento
+        while (cshm_open(&sr, a->shm, 'B') != 0) usleep(a->poll_ms * 1000);
+    }
 
     for (;;) {
         // rotate day
         char now_ymd[9] = {0};
-        today_ymd(now_ymd);
+        if (a->shm[0]) memcpy(now_ymd, next_ymd[0] ? next_ymd : cur_ymd, sizeof(now_ymd));
+        else today_ymd(now_ymd);
         if (strcmp(now_ymd, cur_ymd)!=0) {
-            if (out) {
-                for (int i=0;i<book.nsyms;i++) {
-                    emit_bar(out, cur_ymd, a->bar_sec, &book.syms[i], a->levels_L,
-                             a->ema_fast_p, a->ema_slow_p, a->ema_imb_p, a->ema_ofi_p,
-                             a->imb_th, a->ofi_th, a->min_events);
-                }
-                fclose(out); out=NULL;
+            if (to.out[0]) {
+                emit_all(&to, cur_ymd, &book, a);
+                tf_close(&to);
             }
             if (in) { fclose(in); in=NULL; }
+            cj_free(&jr);
+            cmt_detach(&tail);
+            ckf_writer_close(&kw);
+            kf_last = -1;
+            for (int k=0;k<to.n;k++) to.from_sec[k] = -1;
+            memset(&g_cu, 0, sizeof(g_cu));   // arquivo novo: já começa ao vivo
 
             free_book(&book);
             memset(&book, 0, sizeof(book));
             book.book_cap = a->book_cap;
 
             snprintf(cur_ymd,sizeof(cur_ymd),"%s", now_ymd);
-            build_live_paths(a, cur_ymd, infile, outfile);
+            build_live_paths(a, cur_ymd, infile, &to);
+            if (!a->shm[0]) ctl_follow(&cw, infile);
             last_sz=-1;
         }
 
-        if (!out) {
-            out = fopen(outfile, "ab+");
-            if (!out) die("fopen live out");
-            fseeko(out, 0, SEEK_END);
-            ensure_header(out);
+        for (int k=0;k<to.n && cur_ymd[0];k++) {
+            if (to.out[k]) continue;
+            to.out[k] = fopen(to.path[k], "ab+");
+            if (!to.out[k]) die("fopen live out");
+            setvbuf(to.out[k], NULL, _IOFBF, 1<<20);
+            fseeko(to.out[k], 0, SEEK_END);
+            ensure_header(to.out[k]);
         }
 
-        if (!in) {
-            if (!file_exists(infile)) { usleep(a->poll_ms * 1000); continue; }
-            in = fopen(infile, "rb");
-            if (!in) { usleep(a->poll_ms * 1000); continue; }
-            // tail mode: start at end
-            fseeko(in, 0, SEEK_END);
+        if (!in && !a->shm[0]) {
+            if (!file_exists(infile)) {
+                // _B.txt ou _B: o nome só se decide quando o arquivo aparece
+                build_live_paths(a, cur_ymd, infile, &to);
+                if (!file_exists(infile)) { ctl_wait(&cw, a->poll_ms); continue; }
+            }
+            in = cmt_fopen(infile, "rb");
+            if (!in) { ctl_wait(&cw, a->poll_ms); continue; }
+            ctl_follow(&cw, infile);
             last_sz = file_size(infile);
+            cmt_detach(&tail);
+            cmt_attach(&tail, infile);
+            // Book certo desde já: retoma do último keyframe do dia (ou do início)
+            // sem repetir as barras que o CSV já tem
+            long long start = 0;
+            if (kf_restore(&book, &to, infile, -1, &start)) {
+                fprintf(stderr, "[parser_B] keyframe: retomando de %lld em %s\n", start, infile);
+            }
+            for (int k=0;k<to.n;k++) {
+                const int done_sec = last_bar_sec(to.path[k]);
+                to.from_sec[k] = done_sec >= 0 ? done_sec + to.bar_sec[k] : -1;
+            }
+            if (last_sz > start) ccu_begin(&g_cu, "parser_B", catchup_emit);
+            catchup_emit = -1;   // --catchup-emit só vale na partida, não no arquivo do dia seguinte
+            kf_open(&kw, a, infile);
+            if (a->journal) { cj_init(&jr, in); cj_seek(&jr, start); }
+            else if (fseeko(in, (off_t)start, SEEK_SET) != 0) rewind(in);
         }
 
-        long long sz = file_size(infile);
+        long long sz = (a->shm[0] || !waited) ? -1 : file_size(infile);
         if (sz >= 0 && last_sz >= 0 && sz < last_sz) {
             // truncated/rotated
             fclose(in);
-            in = fopen(infile, "rb");
-            if (!in) { usleep(a->poll_ms * 1000); continue; }
-            fseeko(in, 0, SEEK_END);
+            in = cmt_fopen(infile, "rb");
+            if (!in) { ctl_wait(&cw, a->poll_ms); continue; }
+            cmt_detach(&tail);
+            cmt_attach(&tail, infile);
+            ctl_follow(&cw, infile);
+            if (a->journal) { cj_free(&jr); cj_init(&jr, in); cj_seek(&jr, sz); }
+            else cmt_seek_end(&tail, in);
             last_sz = sz;
-        } else {
+        } else if (sz >= 0) {
             last_sz = sz;
         }
+        waited = false;
 
         int got_any = 0;
-        while (getline(&line, &cap, in) != -1) {
-            got_any = 1;
-            process_line(&book, line, cur_ymd, a->bar_sec, a->levels_L, out,
-                         a->ema_fast_p, a->ema_slow_p, a->ema_imb_p, a->ema_ofi_p,
-                         a->imb_th, a->ofi_th, a->min_events);
+        if (a->journal || a->shm[0]) {
+            CjRecord rec;
+            int r;
+            while ((r = a->shm[0] ? cshm_next_day(&sr, &rec, cur_ymd, next_ymd) : cj_next(&jr, &rec)) > 0) {
+                got_any = 1;
+                if (r == 2) break;   // registro de outro dia: troca no topo do laço
+                if (rec.h.type == CJ_TYPE_GAP) { book_clear_gap(&book, rec.payload); continue; }
+                if (rec.h.type != 'B') continue;
+                char ymd[9];
+                int sec;
+                cj_ymd_sec(&rec, ymd, &sec);
+                memcpy(last_ymd, ymd, sizeof(last_ymd));
+                ccu_count(&g_cu, sizeof(rec.h) + rec.h.len, sec);
+                process_payload(&book, rec.payload, ymd, sec, &to, a->levels_L,
+                                a->ema_fast_p, a->ema_slow_p, a->ema_imb_p, a->ema_ofi_p,
+                                a->imb_th, a->ofi_th, a->min_events);
+                if (!a->shm[0] && kf_due(&kf_last, sec, a->kf_sec)) kf_save(&kw, &book, jr.offset, sec);
+            }
+        } else {
+            ssize_t nread;
+            while (!cmt_at_limit(&tail, in) && (nread = getline(&line, &cap, in)) != -1 &&
+                   !ctl_partial_line(in, line, (size_t)nread)) {
+                got_any = 1;
+                const int sec = ci_line_sec(line);
+                ccu_count(&g_cu, (size_t)nread, sec);
+                if (cedro_gap_line(line)) { book_clear_gap(&book, cedro_gap_payload(line)); continue; }
+                process_line(&book, line, cur_ymd, &to, a->levels_L,
+                             a->ema_fast_p, a->ema_slow_p, a->ema_imb_p, a->ema_ofi_p,
+                             a->imb_th, a->ofi_th, a->min_events);
+                if (kf_due(&kf_last, sec, a->kf_sec)) kf_save(&kw, &book, (long long)ftello(in), sec);
+            }
         }
 
         if (!got_any) {
+            if (a->shm[0]) {
+                if (cshm_eof(&sr)) {   // cedro_engine: entrada acabou, fecha as últimas barras
+                    emit_all(&to, last_ymd, &book, a);
+                    break;
+                }
+                cshm_wait(&sr);
+                continue;
+            }
+            tf_live(&to);
             clearerr(in);
-            usleep(a->poll_ms * 1000);
+            ctl_wait(&cw, a->poll_ms);
+            waited = true;
         }
     }
 
     free(line);
+    cshm_free(&sr);
+    cj_free(&jr);
+    cmt_detach(&tail);
+    ckf_writer_close(&kw);
+    ctl_close(&cw);
+    tf_close(&to);
     free_book(&book);
 }
 
@@ -890,7 +1318,7 @@ int main(int argc, char **argv) {
         return 0;
     }
 
-    if (a.input_dir[0]=='\0' || a.out_dir[0]=='\0') { usage(argv[0]); return 2; }
+    if ((a.input_dir[0]=='\0' && a.shm[0]=='\0') || a.out_dir[0]=='\0') { usage(argv[0]); return 2; }
     run_live_mode(&a);
     return 0;
 }
@@ -1,14 +1,32 @@
 // parser_T.c - C port of parser_T.py (Cedro log "T:" -> 1s bars per symbol)
-// Build: gcc -O3 -march=native -std=c11 -Wall -Wextra -D_POSIX_C_SOURCE=200809L parser_T.c -o parser_T -lm
+// Build: gcc -O3 -march=native -std=c11 -Wall -Wextra -D_POSIX_C_SOURCE=200809L parser_T.c -o parser_T -lm -lzstd -lpthread
 
 //gcc -O3 -march=native -std=c11 -Wall -Wextra -D_POSIX_C_SOURCE=200809L   parser_T_fixed.c -o parser_T -lm
 ////
 ///home/grao/cedrob3/parsers/parser_T   --input-template /home/grao/dados/cedro_files/{ymd}_T.txt   --output-template /home/grao/dados/sab/{ymd}_T_1s.csv   --symbols WING26,WDOF26   --session 09:00:00,18:30:00   --follow --rotate-daily --sleep-sec 0.25
+////./parser_T   --shm cedro   --output-template /home/grao/dados/sab/{ymd}_T_1s.csv   --symbols WING26,WDOF26   --rotate-daily   (com leitorwebsocket --shm cedro)
 ////./parser_T   --input /home/grao/dados/cedro_files/20251222_T.txt   --output /home/grao/dados/sab/20251222_T_1s.csv   --symbols WING26,WDOF26   --session 09:00:00,18:30:00
-
+////./parser_T   --input /home/grao/dados/cedro_files/20251222_T.txt   --output /tmp/tarde.csv   --symbols WING26   --from 14:00:00 --to 14:30:00   (pula direto pelo .idx, cedro_index.h)
+////  --state-dir DIR: checkpoint em DIR/{ymd}_T.state (cedro_state.h) dos estados dos símbolos, barra em curso e
+////  offsets de input e output, a cada --ckpt-sec na virada de barra e no EOF. Reiniciado no mesmo dia, o parser
+////  volta o CSV para o fim da última barra do checkpoint e continua do offset salvo em vez de refazer o dia.
+////  --follow começa recuperando o dia (do início ou do checkpoint) com o CSV em buffer cheio; no primeiro EOF
+////  passa ao fflush por barra e mostra o resumo da recuperação (cedro_catchup.h). --catchup-emit HH:MM:SS|live:
+////  barras da recuperação antes disso só atualizam o estado.
+////  --follow acorda por inotify quando o input cresce ou é criado (cedro_tail.h); --sleep-sec vira só o teto
+////  de espera para o input gravado pelo leitorwebsocket --writer mmap, que não gera evento.
+////  --bar-sec 1,5,10,30,60: vários timeframes numa passada só pelo input, um CSV por timeframe ({bar} no
+////  --output/--output-template vira os segundos). Cada timeframe tem os seus estados e barras e sai igual ao
+////  parser_T rodado só com aquele --bar-sec; o input é tokenizado uma vez para todos.
+////./parser_T   --input /home/grao/dados/cedro_files/20251222_T.txt   --output /home/grao/dados/t/20251222_t_{bar}s.csv   --symbols WIN,WDO   --bar-sec 1,5,10,30,60,120,300,600,900
+////  Mensagem T: lida no próprio buffer, com os campos usados numa tabela (T_FIELDS); bench_t_parse.c mede
+////  contra o parse antigo (malloc + strtok_r + strtod) num _T.txt gravado e confere que as barras saem iguais.
+
+#define _GNU_SOURCE   // fopencookie (cedro_zst.h)
 #define _POSIX_C_SOURCE 200809L
 
 #include <stdio.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
@@ -16,14 +34,35 @@
 #include <limits.h>
 #include <errno.h>
 #include <time.h>
+#include <unistd.h>
 #include <sys/time.h>
 
+#include "cedro_catchup.h"
+#include "cedro_index.h"
+#include "cedro_journal.h"
+#include "cedro_shm.h"
+#include "cedro_mmap_tail.h"
+#include "cedro_state.h"
+#include "cedro_tail.h"
+#include "cedro_zst.h"
+
+// -DCEDRO_ENGINE: o cedro_engine chama este main numa thread própria
+#ifdef CEDRO_ENGINE
+#define main parser_T_main
+#endif
+
 #ifndef NAN
 #define NAN (0.0/0.0)
 #endif
 
 #define STRLEN_MIN(a,b) ((a)<(b)?(a):(b))
 
+// Segundos lidos antes do --from só para aquecer deltas e janelas
+#define T_WARM_SEC 60
+
+// Timeframes de um --bar-sec 1,5,10,... (uma passada no input para todos)
+#define T_MAX_TF 16
+
 
 static int parse_ndigits(const char *p, int n, int *out){
     if(!p || n<=0 || !out) return 0;
@@ -138,12 +177,10 @@ static int parse_hms_to_int(const char *s, int *out){
     return 0;
 }
 
-static int tick_dir_value(const char *s){
-    if(!s) return 0;
-    while(*s && isspace((unsigned char)*s)) s++;
-    if(*s == '\0') return 0;
-    if(strchr(s, '+')) return 1;
-    if(strchr(s, '-')) return -1;
+static int tick_dir_value(const char *s, size_t n){
+    if(!s || n == 0) return 0;
+    if(memchr(s, '+', n)) return 1;
+    if(memchr(s, '-', n)) return -1;
     return 0;
 }
 
@@ -237,19 +274,6 @@ static void init_bucket(Bucket *b){
     b->n_events = 0;
 }
 
-static double parse_double(const char *s, int *ok){
-    if(ok) *ok = 0;
-    if(!s) return NAN;
-    while(*s && isspace((unsigned char)*s)) s++;
-    if(*s=='\0') return NAN;
-    char *end=NULL;
-    errno = 0;
-    double v = strtod(s, &end);
-    if(end == s || errno != 0) return NAN;
-    if(ok) *ok = 1;
-    return v;
-}
-
 static long long parse_ll_from_any(const char *s, int *ok){
     // int(float(s)) style
     if(ok) *ok = 0;
@@ -372,6 +396,13 @@ typedef struct {
     int follow;
     int rotate_daily;
     double sleep_sec;
+    int journal;
+    char shm[128];
+    int from_sec;    // --from/--to: segundos do dia (-1 = sem limite)
+    int to_sec;
+    char state_dir[1024];
+    int ckpt_sec;
+    int catchup_emit;   // --catchup-emit: segundos do dia, CCU_EMIT_LIVE ou -1
 
     double max_spread;
     int require_trade;
@@ -382,7 +413,8 @@ typedef struct {
     int tickdir_th;
     double enter_th;
     double keep_th;
-    int bar_sec;
+    int bar_secs[T_MAX_TF];   // --bar-sec: segundos por barra de cada timeframe
+    int ntf;
 } Options;
 
 static void opts_init(Options *o){
@@ -390,7 +422,12 @@ static void opts_init(Options *o){
     o->symbols[0] = 0;
     strncpy(o->symbols, "WIN,WDO", sizeof(o->symbols)-1);
     o->sleep_sec = 0.25;
-    o->bar_sec = 1;
+    o->bar_secs[0] = 1;
+    o->ntf = 1;
+    o->from_sec = -1;
+    o->to_sec = -1;
+    o->ckpt_sec = 1;
+    o->catchup_emit = -1;
 
     o->max_spread = 0.0;
     o->require_trade = 0;
@@ -411,10 +448,19 @@ static void usage(const char *prog){
         "Opções principais:\n"
         "  --symbols WING26,WDOF26\n"
         "  --session 09:00:00,18:30:00\n"
-        "  --bar-sec 1 (segundos por barra)\n"
+        "  --bar-sec 1 (segundos por barra; lista 1,5,60 gera um CSV por timeframe lendo o input uma vez,\n"
+        "      com {bar} no --output/--output-template virando os segundos: .../{ymd}_t_{bar}s.csv)\n"
         "  --follow (tail -f)\n"
-        "  --sleep-sec 0.25\n"
-        "  --rotate-daily (reabre input/output templates ao virar o dia)\n\n"
+        "  --sleep-sec 0.25 (teto de espera no EOF; o input acorda por inotify, menos o --writer mmap)\n"
+        "  --rotate-daily (reabre input/output templates ao virar o dia)\n"
+        "  --journal (input é o journal binário {ymd}_raw.cj do leitorwebsocket --journal)\n"
+        "  --shm NOME (lê do anel em memória do leitorwebsocket --shm NOME, sem input; implica --follow)\n"
+        "  --from HH:MM:SS --to HH:MM:SS (só esse trecho do dia; com o .idx do coletor o input\n"
+        "      é lido a partir de 1 min antes do --from, que só aquece o estado)\n"
+        "  --state-dir DIR (checkpoint em DIR/{ymd}_T.state; reiniciado, continua dele)\n"
+        "  --ckpt-sec 1 (cadência do checkpoint)\n"
+        "  --catchup-emit HH:MM:SS|live (--follow: barras da recuperação antes disso, ou todas,\n"
+        "      não vão para o CSV)\n\n"
         "Filtros/sinal (iguais ao Python):\n"
         "  --max-spread 0\n"
         "  --require-trade\n"
@@ -429,6 +475,26 @@ static void usage(const char *prog){
 
 static int streq(const char *a, const char *b){ return strcmp(a,b)==0; }
 
+// "1,5,10" -> o->bar_secs; 0 se vazia, longa demais ou com repetido
+static int parse_bar_secs(const char *s, Options *o){
+    int n = 0;
+    const char *p = s;
+    while(*p){
+        char *end = NULL;
+        long v = strtol(p, &end, 10);
+        if(end == p || n == T_MAX_TF) return 0;
+        if(v < 1) v = 1;
+        for(int k=0;k<n;k++) if(o->bar_secs[k] == (int)v) return 0;
+        o->bar_secs[n++] = (int)v;
+        p = end;
+        if(*p == ',') p++;
+        else if(*p) return 0;
+    }
+    if(n == 0) return 0;
+    o->ntf = n;
+    return 1;
+}
+
 static int parse_args(int argc, char **argv, Options *o){
     for(int i=1;i<argc;i++){
         const char *a = argv[i];
@@ -438,10 +504,23 @@ static int parse_args(int argc, char **argv, Options *o){
         else if(streq(a,"--output-template") && i+1<argc){ strncpy(o->output_template, argv[++i], sizeof(o->output_template)-1); }
         else if(streq(a,"--symbols") && i+1<argc){ strncpy(o->symbols, argv[++i], sizeof(o->symbols)-1); }
         else if(streq(a,"--session") && i+1<argc){ strncpy(o->session, argv[++i], sizeof(o->session)-1); }
-        else if(streq(a,"--bar-sec") && i+1<argc){ o->bar_sec = atoi(argv[++i]); if(o->bar_sec < 1) o->bar_sec=1; }
+        else if(streq(a,"--bar-sec") && i+1<argc){
+            if(!parse_bar_secs(argv[++i], o)){ fprintf(stderr, "ERRO: --bar-sec espera N ou N1,N2,... (até %d, sem repetir)\n", T_MAX_TF); return 0; }
+        }
         else if(streq(a,"--follow")){ o->follow = 1; }
         else if(streq(a,"--rotate-daily")){ o->rotate_daily = 1; }
         else if(streq(a,"--sleep-sec") && i+1<argc){ o->sleep_sec = atof(argv[++i]); }
+        else if(streq(a,"--journal")){ o->journal = 1; }
+        else if(streq(a,"--shm") && i+1<argc){ strncpy(o->shm, argv[++i], sizeof(o->shm)-1); o->follow = 1; }
+        else if(streq(a,"--state-dir") && i+1<argc){ strncpy(o->state_dir, argv[++i], sizeof(o->state_dir)-1); }
+        else if(streq(a,"--ckpt-sec") && i+1<argc){ o->ckpt_sec = atoi(argv[++i]); }
+        else if(streq(a,"--catchup-emit") && i+1<argc){
+            if(!ccu_parse_emit(argv[++i], &o->catchup_emit)){ fprintf(stderr, "ERRO: --catchup-emit espera HH:MM:SS ou live\n"); return 0; }
+        }
+        else if((streq(a,"--from")||streq(a,"--to")) && i+1<argc){
+            int *dst = streq(a,"--from") ? &o->from_sec : &o->to_sec;
+            if(!ci_parse_hms(argv[++i], dst)){ fprintf(stderr, "ERRO: %s espera HH:MM:SS\n", a); return 0; }
+        }
 
         else if(streq(a,"--max-spread") && i+1<argc){ o->max_spread = atof(argv[++i]); }
         else if(streq(a,"--require-trade")){ o->require_trade = 1; }
@@ -495,6 +574,16 @@ static void apply_template(const char *templ, const char *ymd, char *out, size_t
     strncat(out, p+5, out_sz-1 - strlen(out));
 }
 
+// {bar} -> segundos por barra do timeframe (sem {bar}, copia)
+static void apply_bar(const char *templ, int bar_sec, char *out, size_t out_sz){
+    const char *p = strstr(templ, "{bar}");
+    if(!p){
+        snprintf(out, out_sz, "%s", templ);
+        return;
+    }
+    snprintf(out, out_sz, "%.*s%d%s", (int)(p - templ), templ, bar_sec, p + 5);
+}
+
 // ---------------------- symbol list ----------------------
 
 typedef struct {
@@ -536,11 +625,21 @@ static int parse_symbols(const char *csv, SymSlot **out_slots){
     return n;
 }
 
-static int find_symbol(SymSlot *slots, int n, const char *sym){
+// Um timeframe do --bar-sec: estados/barras dos símbolos e o CSV dele
+typedef struct {
+    int bar_sec;
+    SymSlot *slots;
+    FILE *out;
+    char out_path[1024];
+    time_t current_dt;   // barra em curso
+    int have_current_dt;
+} TfOut;
+
+static int find_symbol(SymSlot *slots, int n, const char *sym, size_t sym_len){
     for(int i=0;i<n;i++){
         // Check if slots[i].name is a prefix of sym
         size_t len = strlen(slots[i].name);
-        if(strncmp(slots[i].name, sym, len)==0) return i;
+        if(len <= sym_len && memcmp(slots[i].name, sym, len)==0) return i;
     }
     return -1;
 }
@@ -576,7 +675,7 @@ static int in_session_time(const struct tm *tmv, int sess_start, int sess_end, i
 
 static void flush_second(time_t dt_sec, SymSlot *slots, int nslots, FILE *out,
                          int sess_start, int sess_end, int sess_enabled,
-                         const Options *opt){
+                         const Options *opt, const CcuState *cu){
 
     struct tm tmv;
     localtime_r(&dt_sec, &tmv);
@@ -598,6 +697,10 @@ static void flush_second(time_t dt_sec, SymSlot *slots, int nslots, FILE *out,
     char read_ts[64];
     iso_ms_from_time(read_sec, read_ms, read_ts, sizeof(read_ts));
 
+    // --from: os segundos de aquecimento antes dele só atualizam o estado (idem --catchup-emit)
+    const int tod = tmv.tm_hour*3600 + tmv.tm_min*60 + tmv.tm_sec;
+    const int quiet = tod < opt->from_sec || !ccu_emit(cu, tod);
+
     for(int i=0;i<nslots;i++){
         Bucket *b = &slots[i].b;
         SymbolState *st = &slots[i].st;
@@ -743,6 +846,8 @@ static void flush_second(time_t dt_sec, SymSlot *slots, int nslots, FILE *out,
         if(d_fin != 0.0) d_fin_est = d_fin;
         else if(!isnan(st->last)) d_fin_est = (double)d_vol * st->last;
 
+        if(quiet){ init_bucket(b); continue; }
+
         // Write row
         int first = 1;
         csv_put_str(out, &first, read_ts);
@@ -804,8 +909,6 @@ static void flush_second(time_t dt_sec, SymSlot *slots, int nslots, FILE *out,
 
         init_bucket(b);
     }
-
-    fflush(out);
 }
 
 // ---------------------- line parsing ----------------------
@@ -834,7 +937,128 @@ static int split_first3_commas(const char *line, char *write_ts, size_t write_ts
     return 1;
 }
 
-static int parse_T_message_and_update(const char *msg_in, SymSlot *slots, int nslots,
+// Campos do T: que viram coluna: id -> tipo e lugar no Bucket. O resto é pulado sem conversão.
+enum { TF_SKIP = 0, TF_DBL, TF_LL, TF_STR, TF_TICKDIR };
+
+typedef struct {
+    unsigned char kind;
+    unsigned short off;   // offsetof(Bucket, campo)
+    unsigned short sz;    // TF_STR/TF_TICKDIR: tamanho do char[]
+} TFieldDef;
+
+#define T_FIELD_MAX 144
+#define T_FSTR(f) offsetof(Bucket, f), (unsigned short)sizeof(((Bucket*)0)->f)
+
+static const TFieldDef T_FIELDS[T_FIELD_MAX] = {
+    [2]   = {TF_DBL, offsetof(Bucket, last), 0},
+    [3]   = {TF_DBL, offsetof(Bucket, bid), 0},
+    [4]   = {TF_DBL, offsetof(Bucket, ask), 0},
+    [6]   = {TF_LL,  offsetof(Bucket, trade_qty_cur), 0},
+    [7]   = {TF_LL,  offsetof(Bucket, trade_qty_last), 0},
+    [8]   = {TF_LL,  offsetof(Bucket, cum_trades), 0},
+    [9]   = {TF_LL,  offsetof(Bucket, cum_vol), 0},
+    [10]  = {TF_DBL, offsetof(Bucket, cum_fin), 0},
+    [19]  = {TF_LL,  offsetof(Bucket, bid_qty1), 0},
+    [20]  = {TF_LL,  offsetof(Bucket, ask_qty1), 0},
+    [21]  = {TF_DBL, offsetof(Bucket, variation), 0},
+    [67]  = {TF_LL,  offsetof(Bucket, status), 0},
+    [88]  = {TF_STR, T_FSTR(phase)},
+    [106] = {TF_TICKDIR, T_FSTR(tick_dir_last)},
+    [142] = {TF_STR, T_FSTR(last_event_142)},
+    [143] = {TF_STR, T_FSTR(last_trade_143)},
+};
+
+// Próximo campo de [*p, end): como o strtok_r de antes, "::" não gera campo vazio
+static int t_next_tok(const char **p, const char *end, const char **ts, const char **te){
+    const char *s = *p;
+    while(s < end && *s == ':') s++;
+    if(s == end) return 0;
+    const char *e = (const char*)memchr(s, ':', (size_t)(end - s));
+    if(!e) e = end;
+    *ts = s;
+    *te = e;
+    *p = e;
+    return 1;
+}
+
+static const double T_POW10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+
+// Número do feed ("128765", "5477.5", "-0.0217"): [+-]dígitos[.dígitos], até 15 dígitos.
+// Mantissa e 10^frac são exatas em double, então uma divisão dá o mesmo valor do strtod.
+static int t_scan_fixed(const char *s, const char *e, long long *m, int *frac, int *neg){
+    *neg = 0;
+    if(s < e && (*s == '-' || *s == '+')){ *neg = (*s == '-'); s++; }
+    long long v = 0;
+    int nd = 0, f = -1;
+    for(; s < e; s++){
+        const unsigned d = (unsigned)(*s - '0');
+        if(d < 10){
+            v = v*10 + (long long)d;
+            nd++;
+            if(f >= 0) f++;
+        } else if(*s == '.' && f < 0){
+            f = 0;
+        } else {
+            return 0;
+        }
+    }
+    if(nd == 0 || nd > 15) return 0;
+    *m = v;
+    *frac = f < 0 ? 0 : f;
+    return 1;
+}
+
+// Fora do formato acima (expoente, "nan", lixo no fim): strtod numa cópia na pilha
+static double t_strtod_tok(const char *s, const char *e, int *ok){
+    char tmp[128];
+    size_t n = (size_t)(e - s);
+    if(n >= sizeof(tmp)) n = sizeof(tmp) - 1;
+    memcpy(tmp, s, n);
+    tmp[n] = '\0';
+    char *end = NULL;
+    errno = 0;
+    double v = strtod(tmp, &end);
+    *ok = !(end == tmp || errno != 0);
+    return v;
+}
+
+static double t_parse_double(const char *s, const char *e, int *ok){
+    *ok = 0;
+    while(s < e && isspace((unsigned char)*s)) s++;
+    if(s == e) return NAN;
+    long long m;
+    int frac, neg;
+    if(t_scan_fixed(s, e, &m, &frac, &neg)){
+        double v = (double)m;
+        if(frac) v /= T_POW10[frac];
+        *ok = 1;
+        return neg ? -v : v;
+    }
+    double v = t_strtod_tok(s, e, ok);
+    return *ok ? v : NAN;
+}
+
+// int(float(s)), como o parse_ll_from_any; inteiro puro não passa por double
+static long long t_parse_ll(const char *s, const char *e, int *ok){
+    *ok = 0;
+    while(s < e && isspace((unsigned char)*s)) s++;
+    if(s == e) return LLONG_MIN;
+    long long m;
+    int frac, neg;
+    if(t_scan_fixed(s, e, &m, &frac, &neg)){
+        if(frac) m = (long long)((double)m / T_POW10[frac]);
+        *ok = 1;
+        return neg ? -m : m;
+    }
+    double v = t_strtod_tok(s, e, ok);
+    if(!*ok) return LLONG_MIN;
+    if(v > (double)LLONG_MAX) return LLONG_MAX;
+    if(v < (double)LLONG_MIN) return LLONG_MIN;
+    return (long long)v;
+}
+
+// Tokeniza a mensagem uma vez, no próprio buffer, e aplica nas barras dos timeframes com on[k]
+static int parse_T_message_and_update(const char *msg_in, TfOut *tf, int ntf, const unsigned char *on, int nslots,
                                      long long *bad_lines, long long *parsed_lines, long long *ignored_symbols){
     (void)bad_lines; // mantido por compatibilidade com o contador do Python
     if(!msg_in) return 0;
@@ -844,163 +1068,224 @@ static int parse_T_message_and_update(const char *msg_in, SymSlot *slots, int ns
 
     if(strncmp(msg_in, "T:", 2) != 0) return 0;
 
-    const char *bang = strchr(msg_in, '!');
-    if(!bang) return 0;
-
-    size_t mlen = (size_t)(bang - msg_in);
-    if(mlen < 4) return 0;
+    const char *end = strchr(msg_in, '!');
+    if(!end) return 0;
+    if(end - msg_in < 4) return 0;
 
-    char *buf = (char*)malloc(mlen + 1);
-    if(!buf) return 0;
-    memcpy(buf, msg_in, mlen);
-    buf[mlen] = '\0';
+    // "T", símbolo e parts[2] (pulado)
+    const char *p = msg_in + 1;
+    const char *sym, *sym_end, *ts, *te;
+    if(!t_next_tok(&p, end, &sym, &sym_end)) return 0;
+    if(!t_next_tok(&p, end, &ts, &te)) return 0;
 
-    // tokenize
-    char *save=NULL;
-    char *tok = strtok_r(buf, ":", &save);
-    if(!tok || strcmp(tok, "T") != 0){ free(buf); return 0; }
-
-    char *sym = strtok_r(NULL, ":", &save);
-    if(!sym){ free(buf); return 0; }
-
-    // skip parts[2]
-    char *skip = strtok_r(NULL, ":", &save);
-    if(!skip){ free(buf); return 0; }
-
-    int idx_sym = find_symbol(slots, nslots, sym);
+    int idx_sym = find_symbol(tf[0].slots, nslots, sym, (size_t)(sym_end - sym));
     (*parsed_lines)++;
     if(idx_sym < 0){
         (*ignored_symbols)++;
-        free(buf);
         return 1;
     }
 
-    Bucket *b = &slots[idx_sym].b;
-    b->n_events += 1;
+    char *bs[T_MAX_TF];
+    int nb = 0;
+    for(int k=0;k<ntf;k++) if(on[k]) bs[nb++] = (char*)&tf[k].slots[idx_sym].b;
+    for(int k=0;k<nb;k++) ((Bucket*)bs[k])->n_events += 1;
 
     // Now pairs: idx:value ... starting at parts[3]
-    while(1){
-        char *idx_s = strtok_r(NULL, ":", &save);
-        if(!idx_s) break;
-        char *val_s = strtok_r(NULL, ":", &save);
-        if(!val_s) break;
-
-        // idx must be digits
-        int all_digits = 1;
-        for(char *p=idx_s; *p; ++p){ if(!isdigit((unsigned char)*p)){ all_digits=0; break; } }
-        if(!all_digits) continue;
-        int idx = atoi(idx_s);
-
-        int ok=0;
-        switch(idx){
-            case 2: {
-                double v = parse_double(val_s, &ok);
-                if(ok) b->last = v;
-            } break;
-            case 3: {
-                double v = parse_double(val_s, &ok);
-                if(ok) b->bid = v;
-            } break;
-            case 4: {
-                double v = parse_double(val_s, &ok);
-                if(ok) b->ask = v;
-            } break;
-            case 19: {
-                long long v = parse_ll_from_any(val_s, &ok);
-                if(ok) b->bid_qty1 = v;
-            } break;
-            case 20: {
-                long long v = parse_ll_from_any(val_s, &ok);
-                if(ok) b->ask_qty1 = v;
-            } break;
-            case 6: {
-                long long v = parse_ll_from_any(val_s, &ok);
-                if(ok) b->trade_qty_cur = v;
-            } break;
-            case 7: {
-                long long v = parse_ll_from_any(val_s, &ok);
-                if(ok) b->trade_qty_last = v;
-            } break;
-            case 8: {
-                long long v = parse_ll_from_any(val_s, &ok);
-                if(ok) b->cum_trades = v;
-            } break;
-            case 9: {
-                long long v = parse_ll_from_any(val_s, &ok);
-                if(ok) b->cum_vol = v;
-            } break;
-            case 10: {
-                double v = parse_double(val_s, &ok);
-                if(ok) b->cum_fin = v;
-            } break;
-            case 21: {
-                double v = parse_double(val_s, &ok);
-                if(ok) b->variation = v;
-            } break;
-            case 67: {
-                long long v = parse_ll_from_any(val_s, &ok);
-                if(ok) b->status = v;
-            } break;
-            case 88: {
-                // phase
-                while(*val_s && isspace((unsigned char)*val_s)) val_s++;
-                strncpy(b->phase, val_s, sizeof(b->phase)-1);
-                b->phase[sizeof(b->phase)-1] = '\0';
-            } break;
-            case 106: {
-                while(*val_s && isspace((unsigned char)*val_s)) val_s++;
-                strncpy(b->tick_dir_last, val_s, sizeof(b->tick_dir_last)-1);
-                b->tick_dir_last[sizeof(b->tick_dir_last)-1] = '\0';
-                int vdir = tick_dir_value(val_s);
-                b->tick_dir_sum += vdir;
-                b->tick_dir_n += 1;
+    const char *vs, *ve;
+    while(t_next_tok(&p, end, &ts, &te) && t_next_tok(&p, end, &vs, &ve)){
+        // idx must be digits; acima da tabela satura em T_FIELD_MAX (pulado)
+        int idx = 0;
+        const char *q = ts;
+        for(; q < te; q++){
+            const unsigned d = (unsigned)(*q - '0');
+            if(d >= 10) break;
+            idx = idx < T_FIELD_MAX ? idx*10 + (int)d : T_FIELD_MAX;
+        }
+        if(q != te || idx >= T_FIELD_MAX) continue;
+
+        const TFieldDef *fd = &T_FIELDS[idx];
+        int ok = 0;
+        switch(fd->kind){
+            case TF_DBL: {
+                double v = t_parse_double(vs, ve, &ok);
+                if(ok) for(int k=0;k<nb;k++) *(double*)(bs[k] + fd->off) = v;
             } break;
-            case 142: {
-                while(*val_s && isspace((unsigned char)*val_s)) val_s++;
-                strncpy(b->last_event_142, val_s, sizeof(b->last_event_142)-1);
-                b->last_event_142[sizeof(b->last_event_142)-1] = '\0';
+            case TF_LL: {
+                long long v = t_parse_ll(vs, ve, &ok);
+                if(ok) for(int k=0;k<nb;k++) *(long long*)(bs[k] + fd->off) = v;
             } break;
-            case 143: {
-                while(*val_s && isspace((unsigned char)*val_s)) val_s++;
-                strncpy(b->last_trade_143, val_s, sizeof(b->last_trade_143)-1);
-                b->last_trade_143[sizeof(b->last_trade_143)-1] = '\0';
+            case TF_STR:
+            case TF_TICKDIR: {
+                while(vs < ve && isspace((unsigned char)*vs)) vs++;
+                size_t n = (size_t)(ve - vs);
+                if(n > (size_t)fd->sz - 1) n = (size_t)fd->sz - 1;
+                for(int k=0;k<nb;k++){
+                    memcpy(bs[k] + fd->off, vs, n);
+                    bs[k][fd->off + n] = '\0';
+                }
+                if(fd->kind == TF_TICKDIR){
+                    int vdir = tick_dir_value(vs, (size_t)(ve - vs));
+                    for(int k=0;k<nb;k++){ ((Bucket*)bs[k])->tick_dir_sum += vdir; ((Bucket*)bs[k])->tick_dir_n += 1; }
+                }
             } break;
             default:
                 break;
         }
     }
-
-    free(buf);
     return 1;
 }
 
 // ---------------------- main loop ----------------------
 
-static FILE* open_input_wait(const char *path, int follow, double sleep_sec){
+// Dia já arquivado pelo coletor (path.zst) abre descomprimindo (cedro_zst.h)
+// Com --follow espera o arquivo ser criado (cw já aponta para path)
+static FILE* open_input_wait(const char *path, int follow, double sleep_sec, CtlWatch *cw){
     while(1){
-        FILE *f = fopen(path, "r");
+        FILE *f = cz_fopen(path, "r");
         if(f) return f;
         if(!follow) return NULL;
-        msleep_double(sleep_sec);
+        ctl_wait(cw, (int)(sleep_sec * 1000));
     }
 }
 
+// Buffer cheio: ao vivo o fflush é por barra (ccu_flush), na recuperação só no fim
 static FILE* open_output_new(const char *path){
     FILE *f = fopen(path, "w");
     if(!f) return NULL;
-    setvbuf(f, NULL, _IOLBF, 0); // line-buffered
+    setvbuf(f, NULL, _IOFBF, 1<<20);
     write_header(f);
     return f;
 }
 
+// Reabre o CSV de um checkpoint: corta o que veio depois de out_off e continua dali
+static FILE* open_output_resume(const char *path, long long out_off){
+    FILE *f = fopen(path, "r+");
+    if(!f) return NULL;
+    if(ftruncate(fileno(f), (off_t)out_off) != 0 || fseeko(f, (off_t)out_off, SEEK_SET) != 0){
+        fclose(f);
+        return NULL;
+    }
+    setvbuf(f, NULL, _IOFBF, 1<<20);
+    return f;
+}
+
+// ---------------------- checkpoint (--state-dir, cedro_state.h) ----------------------
+
+typedef struct {
+    long long in_off;        // próxima linha/registro do input
+    int ntf;
+    int nslots;
+    long long bad_lines, parsed_lines, ignored_symbols, out_of_order;
+} TStateHead;
+
+// Por timeframe, seguido dos SymSlot dele
+typedef struct {
+    long long out_off;       // fim da última barra no CSV
+    long long current_dt;    // barra em curso
+    int have_current_dt;
+} TStateTf;
+
+// Cabeçalho + por timeframe os SymSlot (estado + barra em curso de cada símbolo) como estão
+static size_t tstate_size(int ntf, int nslots){
+    return sizeof(TStateHead) + (size_t)ntf * (sizeof(TStateTf) + (size_t)nslots * sizeof(SymSlot));
+}
+
+static uint64_t tstate_tag(const SymSlot *slots, int nslots, const Options *opt){
+    const uint32_t dims[] = {(uint32_t)nslots, (uint32_t)opt->ntf, (uint32_t)sizeof(SymSlot),
+                             (uint32_t)sizeof(TStateHead), (uint32_t)sizeof(TStateTf)};
+    uint64_t h = cst_hash(0, dims, sizeof(dims));
+    h = cst_hash(h, opt->bar_secs, (size_t)opt->ntf * sizeof(opt->bar_secs[0]));
+    for(int i=0;i<nslots;i++) h = cst_hash(h, slots[i].name, sizeof(slots[i].name));
+    return h;
+}
+
+// Abre DIR/{ymd}_T.state ("fixed" sem data); 0 se não deu
+static int tstate_open(CstFile *ts, const Options *opt, const char *ymd, const SymSlot *slots, int nslots){
+    char path[2048];
+    snprintf(path, sizeof(path), "%s/%s_T.state", opt->state_dir, ymd[0] ? ymd : "fixed");
+    if(cst_open(ts, path, tstate_tag(slots, nslots, opt), tstate_size(opt->ntf, nslots)) != 0){
+        fprintf(stderr, "AVISO: sem checkpoint em %s\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+// Descarrega os CSVs para o out_off de cada um ser o que está no disco
+static void tstate_save(CstFile *ts, unsigned char *buf, const TStateHead *h, TfOut *tf, int ntf, int nslots){
+    if(!cst_is_open(ts)) return;
+    memcpy(buf, h, sizeof(*h));
+    unsigned char *p = buf + sizeof(*h);
+    for(int k=0;k<ntf;k++){
+        fflush(tf[k].out);
+        TStateTf t = {(long long)ftello(tf[k].out), (long long)tf[k].current_dt, tf[k].have_current_dt};
+        memcpy(p, &t, sizeof(t));
+        memcpy(p + sizeof(t), tf[k].slots, (size_t)nslots * sizeof(SymSlot));
+        p += sizeof(t) + (size_t)nslots * sizeof(SymSlot);
+    }
+    cst_save(ts, buf);
+}
+
+// Restaura o checkpoint se cada CSV ainda tem tudo que ele diz ter gravado;
+// out_off[k] recebe o tamanho a manter no CSV do timeframe k
+static int tstate_load(const CstFile *ts, unsigned char *buf, TStateHead *h, TfOut *tf, int ntf, int nslots,
+                       long long *out_off){
+    if(!cst_load(ts, buf)) return 0;
+    memcpy(h, buf, sizeof(*h));
+    const size_t step = sizeof(TStateTf) + (size_t)nslots * sizeof(SymSlot);
+    for(int k=0;k<ntf;k++){
+        TStateTf t;
+        memcpy(&t, buf + sizeof(*h) + (size_t)k * step, sizeof(t));
+        FILE *f = fopen(tf[k].out_path, "rb");
+        if(!f) return 0;
+        const int ok = fseeko(f, 0, SEEK_END) == 0 && (long long)ftello(f) >= t.out_off;
+        fclose(f);
+        if(!ok) return 0;
+        out_off[k] = t.out_off;
+    }
+    for(int k=0;k<ntf;k++){
+        const unsigned char *p = buf + sizeof(*h) + (size_t)k * step;
+        TStateTf t;
+        memcpy(&t, p, sizeof(t));
+        tf[k].current_dt = (time_t)t.current_dt;
+        tf[k].have_current_dt = t.have_current_dt;
+        memcpy(tf[k].slots, p + sizeof(t), (size_t)nslots * sizeof(SymSlot));
+    }
+    return 1;
+}
+
+static void tf_close(TfOut *tf, int ntf){
+    for(int k=0;k<ntf;k++){
+        if(tf[k].out) fclose(tf[k].out);
+        tf[k].out = NULL;
+    }
+}
+
+// Primeiro EOF: descarrega os CSVs e mostra o resumo da recuperação
+static void tf_live(CcuState *cu, TfOut *tf, int ntf){
+    if(!cu->active) return;
+    for(int k=0;k<ntf;k++) fflush(tf[k].out);
+    ccu_live(cu, NULL);
+}
+
+// Caminho do CSV de cada timeframe para o dia ymd
+static void tf_paths(TfOut *tf, int ntf, const Options *opt, int use_templates, const char *ymd){
+    for(int k=0;k<ntf;k++){
+        char p[1024];
+        if(use_templates) apply_template(opt->output_template, ymd, p, sizeof(p));
+        else snprintf(p, sizeof(p), "%s", opt->output);
+        apply_bar(p, tf[k].bar_sec, tf[k].out_path, sizeof(tf[k].out_path));
+    }
+}
+
 int main(int argc, char **argv){
     Options opt; opts_init(&opt);
     if(!parse_args(argc, argv, &opt)) return 2;
 
-    int use_templates = (opt.input_template[0] && opt.output_template[0]);
+    // Com --shm não há arquivo de entrada, só o template de saída
+    int use_templates = (opt.output_template[0] && (opt.input_template[0] || opt.shm[0]));
 
     if(!use_templates){
-        if(!opt.input[0] || !opt.output[0]){
+        if((!opt.input[0] && !opt.shm[0]) || !opt.output[0]){
             fprintf(stderr, "ERRO: informe --input e --output (ou use --input-template/--output-template)\n");
             usage(argv[0]);
             return 2;
@@ -1011,13 +1296,25 @@ int main(int argc, char **argv){
         }
     }
 
-    SymSlot *slots=NULL;
-    int nslots = parse_symbols(opt.symbols, &slots);
-    if(nslots <= 0){
-        fprintf(stderr, "ERRO: lista de symbols inválida\n");
+    // Com mais de um timeframe cada um precisa de um CSV próprio
+    const int ntf = opt.ntf;
+    if(ntf > 1 && !strstr(use_templates ? opt.output_template : opt.output, "{bar}")){
+        fprintf(stderr, "ERRO: com mais de um --bar-sec o output precisa ter {bar} no nome\n");
         return 2;
     }
 
+    TfOut tf[T_MAX_TF];
+    memset(tf, 0, sizeof(tf));
+    int nslots = 0;
+    for(int k=0;k<ntf;k++){
+        tf[k].bar_sec = opt.bar_secs[k];
+        nslots = parse_symbols(opt.symbols, &tf[k].slots);
+        if(nslots <= 0){
+            fprintf(stderr, "ERRO: lista de symbols inválida\n");
+            return 2;
+        }
+    }
+
     int sess_enabled = 0;
     int sess_start = 0, sess_end = 0;
     if(opt.session[0]){
@@ -1042,15 +1339,18 @@ int main(int argc, char **argv){
 
     char current_ymd[16] = {0};
     char in_path[1024] = {0};
-    char out_path[1024] = {0};
-
-    if(use_templates){
+    // --shm com templates: o dia vem dos registros (cshm_next_day) e os CSVs só
+    // abrem com o primeiro; no cedro_engine a entrada pode ser de outro dia
+    const int ymd_from_rec = use_templates && opt.shm[0];
+    char next_ymd[9] = {0};
+
+    if(ymd_from_rec){
+        // current_ymd fica vazio até o primeiro registro
+    } else if(use_templates){
         ymd_from_now(current_ymd, sizeof(current_ymd));
         apply_template(opt.input_template, current_ymd, in_path, sizeof(in_path));
-        apply_template(opt.output_template, current_ymd, out_path, sizeof(out_path));
     } else {
         strncpy(in_path, opt.input, sizeof(in_path)-1);
-        strncpy(out_path, opt.output, sizeof(out_path)-1);
         // derive ymd from input name if possible, else leave blank
         if(strlen(in_path) >= 8){
             int ok=1;
@@ -1061,118 +1361,302 @@ int main(int argc, char **argv){
             }
         }
     }
-
-    FILE *fout = open_output_new(out_path);
-    if(!fout){
-        fprintf(stderr, "ERRO: não consegui abrir output: %s\n", out_path);
-        return 1;
+    tf_paths(tf, ntf, &opt, use_templates, current_ymd);
+
+    // Checkpoint do mesmo dia: continua dele (não vale com --shm, sem offset, nem com --from/--to)
+    CstFile ts;
+    memset(&ts, 0, sizeof(ts));
+    ts.fd = -1;
+    unsigned char *tbuf = NULL;
+    TStateHead th;
+    memset(&th, 0, sizeof(th));
+    int resumed = 0;
+    long long out_off[T_MAX_TF];
+    if(opt.state_dir[0] && !opt.shm[0] && opt.from_sec < 0 && opt.to_sec < 0){
+        tbuf = (unsigned char*)malloc(tstate_size(ntf, nslots));
+        if(tbuf && tstate_open(&ts, &opt, current_ymd, tf[0].slots, nslots)){
+            resumed = tstate_load(&ts, tbuf, &th, tf, ntf, nslots, out_off);
+        }
     }
 
-    FILE *fin = open_input_wait(in_path, opt.follow, opt.sleep_sec);
-    if(!fin){
-        fprintf(stderr, "ERRO: input não existe: %s\n", in_path);
-        fclose(fout);
-        return 1;
+    for(int k=0;k<ntf && !ymd_from_rec;k++){
+        tf[k].out = resumed ? open_output_resume(tf[k].out_path, out_off[k]) : open_output_new(tf[k].out_path);
+        if(!tf[k].out){
+            fprintf(stderr, "ERRO: não consegui abrir output: %s\n", tf[k].out_path);
+            return 1;
+        }
+    }
+    if(resumed){
+        bad_lines = th.bad_lines;
+        parsed_lines = th.parsed_lines;
+        ignored_symbols = th.ignored_symbols;
+        out_of_order = th.out_of_order;
+        fprintf(stderr, "[parser_T] checkpoint: input em %lld, output em %lld\n", th.in_off, out_off[0]);
     }
 
-    // main processing state
-    int have_current_dt = 0;
-    time_t current_dt = 0;
+    FILE *fin = NULL;
+    static CshmReader sr;
+    CtlWatch cw;
+    memset(&cw, 0, sizeof(cw));
+    cw.fd = -1;
+    if(opt.follow && !opt.shm[0]){
+        ctl_init(&cw);
+        ctl_follow(&cw, in_path);
+    }
+    if(opt.shm[0]){
+        // Espera o coletor criar o segmento
+        while(cshm_open(&sr, opt.shm, 'T') != 0) msleep_double(opt.sleep_sec);
+    } else {
+        fin = open_input_wait(in_path, opt.follow, opt.sleep_sec, &cw);
+        if(!fin){
+            fprintf(stderr, "ERRO: input não existe: %s\n", in_path);
+            tf_close(tf, ntf);
+            return 1;
+        }
+    }
 
     char line[65536];
 
+    // Journal binário: timestamp vem em ns no cabeçalho do registro (um mktime por segundo)
+    static CjReader jr;
+    if(opt.journal && fin) cj_init(&jr, fin);
+    if(resumed && fin){
+        if(opt.journal) cj_seek(&jr, th.in_off);
+        else if(fseeko(fin, (off_t)th.in_off, SEEK_SET) != 0){ fprintf(stderr, "ERRO: fseeko input\n"); return 1; }
+    }
+
+    // --from: começa pelo índice do coletor T_WARM_SEC antes, para os deltas e
+    // janelas da primeira barra (sem .idx, lê do início)
+    const int warm_sec = opt.from_sec >= 0 ? (opt.from_sec > T_WARM_SEC ? opt.from_sec - T_WARM_SEC : 0) : -1;
+    if(fin && !opt.journal && warm_sec >= 0){
+        long long off = ci_seek_offset(in_path, warm_sec, opt.symbols);
+        if(off > 0 && fseeko(fin, (off_t)off, SEEK_SET) != 0) rewind(fin);
+    }
+
+    // Arquivo gravado com leitorwebsocket --writer mmap: não ler além do tail publicado
+    CmtTail tail = {0};
+    if(fin) cmt_attach(&tail, in_path);
+
+    // Offset do input contado à mão (ftello por linha custaria uma syscall)
+    long long in_pos = !fin ? 0 : opt.journal ? jr.offset : (long long)ftello(fin);
+    long long ckpt_in = resumed ? th.in_off : -1;
+    time_t last_ckpt_t = 0;
+
+    // Do arquivo: recuperação até o primeiro EOF (sem --follow, até o fim)
+    CcuState cu;
+    memset(&cu, 0, sizeof(cu));
+    if(fin) ccu_begin(&cu, "parser_T", opt.follow ? opt.catchup_emit : -1);
+
     while(1){
-        if(use_templates && opt.rotate_daily){
+        if(use_templates && (opt.rotate_daily || ymd_from_rec)){
             char ymd_now[16];
-            ymd_from_now(ymd_now, sizeof(ymd_now));
+            if(ymd_from_rec) snprintf(ymd_now, sizeof(ymd_now), "%s", next_ymd[0] ? next_ymd : current_ymd);
+            else ymd_from_now(ymd_now, sizeof(ymd_now));
             if(strcmp(ymd_now, current_ymd) != 0){
                 // switch day
-                if(have_current_dt){
-                    flush_second(current_dt, slots, nslots, fout, sess_start, sess_end, sess_enabled, &opt);
-                    have_current_dt = 0;
+                for(int k=0;k<ntf;k++){
+                    if(!tf[k].have_current_dt) continue;
+                    flush_second(tf[k].current_dt, tf[k].slots, nslots, tf[k].out, sess_start, sess_end, sess_enabled, &opt, &cu);
+                    tf[k].have_current_dt = 0;
                 }
-                fclose(fin);
-                fclose(fout);
+                if(fin) fclose(fin);
+                tf_close(tf, ntf);
+                fin = NULL;
 
                 strncpy(current_ymd, ymd_now, sizeof(current_ymd)-1);
                 apply_template(opt.input_template, current_ymd, in_path, sizeof(in_path));
-                apply_template(opt.output_template, current_ymd, out_path, sizeof(out_path));
+                tf_paths(tf, ntf, &opt, use_templates, current_ymd);
 
-                fout = open_output_new(out_path);
-                if(!fout){
-                    fprintf(stderr, "ERRO: não consegui abrir output: %s\n", out_path);
-                    break;
+                int open_fail = -1;
+                for(int k=0;k<ntf && open_fail<0;k++){
+                    tf[k].out = open_output_new(tf[k].out_path);
+                    if(!tf[k].out) open_fail = k;
                 }
-                fin = open_input_wait(in_path, opt.follow, opt.sleep_sec);
-                if(!fin){
-                    fprintf(stderr, "ERRO: input não existe: %s\n", in_path);
+                if(open_fail >= 0){
+                    fprintf(stderr, "ERRO: não consegui abrir output: %s\n", tf[open_fail].out_path);
                     break;
                 }
+                if(cst_is_open(&ts)){
+                    cst_close(&ts);
+                    if(tstate_open(&ts, &opt, current_ymd, tf[0].slots, nslots)) cst_clear(&ts);
+                }
+                in_pos = 0;
+                ckpt_in = -1;
+                memset(&cu, 0, sizeof(cu));   // arquivo novo: já começa ao vivo
+                if(!opt.shm[0]){
+                    ctl_follow(&cw, in_path);
+                    fin = open_input_wait(in_path, opt.follow, opt.sleep_sec, &cw);
+                    if(!fin){
+                        fprintf(stderr, "ERRO: input não existe: %s\n", in_path);
+                        break;
+                    }
+                    if(opt.journal){ cj_free(&jr); cj_init(&jr, fin); }
+                    cmt_detach(&tail);
+                    cmt_attach(&tail, in_path);
+                }
             }
         }
 
-        if(!fgets(line, sizeof(line), fin)){
-            if(!opt.follow) break;
-            clearerr(fin);
-            msleep_double(opt.sleep_sec);
-            continue;
-        }
+        const char *msg=NULL;
+        time_t dt_sec;
+        long long line_off = in_pos;   // início da linha/registro atual
+
+        // Checkpoint: tudo até in_pos aplicado, CSVs até a última barra fechada
+        #define T_CHECKPOINT(off) do { \
+            if(cst_is_open(&ts) && (off) != ckpt_in){ \
+                TStateHead h_ = {(off), ntf, nslots, bad_lines, parsed_lines, ignored_symbols, out_of_order}; \
+                tstate_save(&ts, tbuf, &h_, tf, ntf, nslots); \
+                ckpt_in = (off); \
+            } \
+        } while(0)
+
+        if(opt.journal || opt.shm[0]){
+            CjRecord rec;
+            // Sem --rotate-daily o primeiro registro só escolhe o dia
+            const char *want = ymd_from_rec && (opt.rotate_daily || !current_ymd[0]) ? current_ymd : NULL;
+            int r = opt.shm[0] ? cshm_next_day(&sr, &rec, want, next_ymd) : cj_next(&jr, &rec);
+            if(r < 0){
+                fprintf(stderr, "ERRO: journal inválido: %s\n", in_path);
+                break;
+            }
+            if(r == 2) continue;   // registro de outro dia: troca no topo do laço
+            if(r == 0){
+                if(opt.shm[0]){
+                    if(cshm_eof(&sr)) break;   // cedro_engine: entrada acabou
+                    cshm_wait(&sr);
+                    continue;
+                }
+                T_CHECKPOINT(in_pos);
+                if(!opt.follow) break;
+                tf_live(&cu, tf, ntf);
+                ctl_wait(&cw, (int)(opt.sleep_sec * 1000));
+                continue;
+            }
+            line_off = rec.offset;
+            in_pos = jr.offset;
+            if(cu.active){
+                const struct tm *tmr = cj_local_tm(&rec);
+                ccu_count(&cu, sizeof(rec.h) + rec.h.len, tmr->tm_hour*3600 + tmr->tm_min*60 + tmr->tm_sec);
+            }
+            if(rec.h.type != 'T') continue;
+            msg = rec.payload;
+            dt_sec = cj_text_sec(&rec);
+            if(opt.from_sec >= 0 || opt.to_sec >= 0){
+                const struct tm *tmr = cj_local_tm(&rec);
+                const int tod = tmr->tm_hour*3600 + tmr->tm_min*60 + tmr->tm_sec;
+                if(tod < warm_sec) continue;
+                if(opt.to_sec >= 0 && tod > opt.to_sec) break;
+            }
+        } else {
+            if(cmt_at_limit(&tail, fin) || !fgets(line, sizeof(line), fin) ||
+               (opt.follow && ctl_partial_line(fin, line, strlen(line)))){
+                T_CHECKPOINT(in_pos);
+                if(!opt.follow) break;
+                tf_live(&cu, tf, ntf);
+                clearerr(fin);
+                ctl_wait(&cw, (int)(opt.sleep_sec * 1000));
+                continue;
+            }
 
-        // strip newline
-        size_t ln = strlen(line);
-        while(ln>0 && (line[ln-1]=='\n' || line[ln-1]=='\r')) line[--ln]='\0';
-        if(ln==0) continue;
+            // strip newline
+            size_t ln = strlen(line);
+            in_pos += (long long)ln;
+            ccu_count(&cu, ln, ci_line_sec(line));
+            while(ln>0 && (line[ln-1]=='\n' || line[ln-1]=='\r')) line[--ln]='\0';
+            if(ln==0) continue;
 
-        char write_ts_s[64];
-        const char *msg=NULL;
-        if(!split_first3_commas(line, write_ts_s, sizeof(write_ts_s), &msg)){
-            bad_lines++;
-            continue;
-        }
+            char write_ts_s[64];
+            if(!split_first3_commas(line, write_ts_s, sizeof(write_ts_s), &msg)){
+                bad_lines++;
+                continue;
+            }
 
-        time_t dt_sec;
-        if(!parse_write_ts_to_time(write_ts_s, &dt_sec)){
-            bad_lines++;
-            continue;
+            if(opt.from_sec >= 0 || opt.to_sec >= 0){
+                const int tod = ci_line_sec(write_ts_s);
+                if(tod >= 0 && tod < warm_sec) continue;
+                if(tod >= 0 && opt.to_sec >= 0 && tod > opt.to_sec) break;
+            }
+
+            if(!parse_write_ts_to_time(write_ts_s, &dt_sec)){
+                bad_lines++;
+                continue;
+            }
         }
 
-        if(!have_current_dt){
-            // align to bar start
-            current_dt = (dt_sec / opt.bar_sec) * opt.bar_sec;
-            have_current_dt = 1;
-        } else {
-            if(dt_sec < current_dt){
-                out_of_order++;
+        // Cada timeframe segue sozinho, como se fosse um parser_T com aquele --bar-sec:
+        // a mensagem só entra nos que não a têm como fora de ordem
+        unsigned char on[T_MAX_TF];
+        int n_on = 0;
+        for(int k=0;k<ntf;k++){
+            TfOut *t = &tf[k];
+            on[k] = 0;
+            if(!t->have_current_dt){
+                // align to bar start
+                t->current_dt = (dt_sec / t->bar_sec) * t->bar_sec;
+                t->have_current_dt = 1;
+            } else if(dt_sec < t->current_dt){
                 continue;
             }
+            on[k] = 1;
+            n_on++;
+        }
+        if(n_on < ntf) out_of_order++;
+        if(n_on == 0) continue;
+
+        int flushed = 0;
+        for(int k=0;k<ntf;k++){
+            TfOut *t = &tf[k];
+            if(!on[k]) continue;
+            int f = 0;
+            while((t->current_dt + t->bar_sec) <= dt_sec){
+                flush_second(t->current_dt, t->slots, nslots, t->out, sess_start, sess_end, sess_enabled, &opt, &cu);
+                t->current_dt += t->bar_sec;
+                f = 1;
+            }
+            if(f){
+                ccu_flush(&cu, t->out);
+                flushed = 1;
+            }
         }
 
-        while(have_current_dt && (current_dt + opt.bar_sec) <= dt_sec){
-            flush_second(current_dt, slots, nslots, fout, sess_start, sess_end, sess_enabled, &opt);
-            current_dt += opt.bar_sec;
+        // Na virada de barra, antes de aplicar a mensagem que abre a nova
+        if(flushed && cst_is_open(&ts)){
+            time_t now_t = time(NULL);
+            if(opt.ckpt_sec <= 0 || now_t - last_ckpt_t >= opt.ckpt_sec){
+                T_CHECKPOINT(line_off);
+                last_ckpt_t = now_t;
+            }
         }
 
         // parse message
-        int ok = parse_T_message_and_update(msg, slots, nslots, &bad_lines, &parsed_lines, &ignored_symbols);
+        int ok = parse_T_message_and_update(msg, tf, ntf, on, nslots, &bad_lines, &parsed_lines, &ignored_symbols);
         if(!ok){
             bad_lines++;
             continue;
         }
     }
 
-    if(have_current_dt){
-        flush_second(current_dt, slots, nslots, fout, sess_start, sess_end, sess_enabled, &opt);
+    for(int k=0;k<ntf;k++){
+        if(tf[k].have_current_dt && tf[k].out){
+            flush_second(tf[k].current_dt, tf[k].slots, nslots, tf[k].out, sess_start, sess_end, sess_enabled, &opt, &cu);
+        }
     }
 
-    fclose(fin);
-    fclose(fout);
+    if(opt.journal) cj_free(&jr);
+    if(opt.shm[0]) cshm_free(&sr);
+    cmt_detach(&tail);
+    cst_close(&ts);
+    ctl_close(&cw);
+    free(tbuf);
+    if(fin) fclose(fin);
+    tf_close(tf, ntf);
 
     fprintf(stdout, "OK\n");
     fprintf(stdout, "parsed_lines=%lld bad_lines=%lld ignored_symbols=%lld out_of_order=%lld\n",
             parsed_lines, bad_lines, ignored_symbols, out_of_order);
-    fprintf(stdout, "out_csv=%s\n", out_path);
+    for(int k=0;k<ntf;k++) fprintf(stdout, "out_csv=%s\n", tf[k].out_path);
 
-    free(slots);
+    for(int k=0;k<ntf;k++) free(tf[k].slots);
     return 0;
 }
 
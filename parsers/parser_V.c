@@ -1,8 +1,18 @@
 // v_gqt_parser.c
-// //gcc -O2 -std=c11 parser_V.c -o parser_V -lm
+// //gcc -O2 -std=c11 parser_V.c -o parser_V -lm -lzstd -lpthread
 // Parser/aggregator do Cedro GQT (V:) -> barras + EMA + sinal BUY/SELL/FLAT
-// - Modo arquivo: --file <path> --out <csv>
+// - Modo arquivo: --file <path> --out <csv>  (path.zst do dia arquivado também, cedro_zst.h)
 // - Modo live:   --live --input-dir <dir> --out-dir <dir>
+//                 ou --live --shm <nome> --out-dir <dir>: lê o canal V do anel em memória do
+//                 leitorwebsocket --shm <nome>, sem arquivo e sem poll (cedro_shm.h)
+// - --catchup (live): em vez de começar no fim do arquivo, recupera o dia desde o início na
+//   velocidade do disco (CSV em buffer cheio, sem fflush por barra; cedro_catchup.h) e segue
+//   ao vivo no primeiro EOF, sem repetir as barras que o CSV já tem. --catchup-emit
+//   HH:MM:SS|live: barras da recuperação antes disso só aquecem as EMAs.
+// - --bar-sec 1,5,60: uma passada no input, um CSV por timeframe (--out com {bar}; no live
+//   {ymd}_v_{N}s.csv cada). Barra/EMAs de cada timeframe em SymState.bars[k].
+// - O live espera o input crescer (ou ser criado) por inotify (cedro_tail.h); o --poll-ms só é o
+//   teto de espera com o leitorwebsocket --writer mmap, que não gera evento.
 // Suporta prefixo opcional antes do payload (ex: "20251222_093004,1428,0,").
 // Linhas truncadas/incompletas são ignoradas com segurança.
 
@@ -17,12 +27,28 @@
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include <sys/stat.h>
+
+#include "cedro_catchup.h"
+#include "cedro_mmap_tail.h"
+#include "cedro_zst.h"
+#include "cedro_shm.h"
+#include "cedro_tail.h"
+
+// cedro_engine.c roda o parser_V inteiro numa thread (build com -DCEDRO_ENGINE)
+#ifdef CEDRO_ENGINE
+#define main parser_V_main
+#endif
 
 #ifndef PATH_MAX
 #define PATH_MAX 4096
 #endif
 
 #define MAX_SYMS 64
+#define V_MAX_TF 16   // timeframes de um --bar-sec 1,5,60,...
+
+// Recuperação do live (e --file): sem fflush por barra até o primeiro EOF
+static CcuState g_cu;
 
 static void die(const char *msg) {
     perror(msg);
@@ -34,12 +60,9 @@ static bool file_exists(const char *path) {
 }
 
 static long long file_size(const char *path) {
-    FILE *f = fopen(path, "rb");
-    if (!f) return -1;
-    if (fseeko(f, 0, SEEK_END) != 0) { fclose(f); return -1; }
-    off_t sz = ftello(f);
-    fclose(f);
-    return (long long)sz;
+    struct stat st;
+    if (stat(path, &st) != 0) return -1;
+    return (long long)st.st_size;
 }
 
 static double ema_update(double prev, double x, double alpha, bool *inited) {
@@ -122,9 +145,8 @@ static int split_colon_n(char *s, char *out[], int max_parts) {
     return n;
 }
 
+// Barra e EMAs de um timeframe
 typedef struct {
-    char symbol[32];
-
     // bar state
     bool bar_inited;
     int bar_start_ms;       // ms do dia (alinhado em bar_sec)
@@ -143,12 +165,26 @@ typedef struct {
     double ema_fast;
     double ema_slow;
     double ema_delta;
+} VBar;
+
+typedef struct {
+    char symbol[32];
+    VBar bars[V_MAX_TF];    // um por timeframe do --bar-sec
 
     // stats
     long long late_events;
     long long bad_lines;
 } SymState;
 
+// Um CSV por timeframe: barras de SymState.bars[k] vão para out[k]
+typedef struct {
+    int n;
+    int bar_sec[V_MAX_TF];
+    int from_sec[V_MAX_TF];   // --catchup: barras antes disso já estão no CSV (-1 = imprime tudo)
+    FILE *out[V_MAX_TF];
+    char path[V_MAX_TF][PATH_MAX];
+} TfOuts;
+
 typedef struct {
     SymState syms[MAX_SYMS];
     int nsyms;
@@ -165,7 +201,7 @@ static SymState* get_sym(SymBook *book, const char *sym) {
     return st;
 }
 
-static void reset_bar(SymState *st, int bar_start_ms, double first_price) {
+static void reset_bar(VBar *st, int bar_start_ms, double first_price) {
     st->bar_inited = true;
     st->bar_start_ms = bar_start_ms;
     st->o = st->h = st->l = st->c = first_price;
@@ -177,7 +213,7 @@ static void reset_bar(SymState *st, int bar_start_ms, double first_price) {
     st->trades = 0.0;
 }
 
-static void bar_update(SymState *st, double price, double qty, char aggressor) {
+static void bar_update(VBar *st, double price, double qty, char aggressor) {
     if (price > st->h) st->h = price;
     if (price < st->l) st->l = price;
     st->c = price;
@@ -216,10 +252,12 @@ static void ensure_header(FILE *out) {
     }
 }
 
-static void emit_bar(FILE *out, const char ymd[9], int bar_sec,
-                     SymState *st,
+static void emit_bar(const TfOuts *to, int k, const char ymd[9],
+                     SymState *sym,
                      int ema_fast_p, int ema_slow_p, int ema_delta_p,
                      double delta_ema_th, double imb_th, int min_trades) {
+    VBar *st = &sym->bars[k];
+    FILE *out = to->out[k];
     if (!st->bar_inited) return;
     if (st->vwap_den <= 0.0) return;
 
@@ -245,6 +283,9 @@ static void emit_bar(FILE *out, const char ymd[9], int bar_sec,
         delta_ema_th, imb_th, min_trades, (int)st->trades
     );
 
+    const int bar_s = st->bar_start_ms / 1000;
+    if (bar_s < to->from_sec[k] || !ccu_emit(&g_cu, bar_s)) return;
+
     char hhmmss[8];
     ms_to_hhmmss(st->bar_start_ms, hhmmss);
 
@@ -253,7 +294,7 @@ static void emit_bar(FILE *out, const char ymd[9], int bar_sec,
 
     fprintf(out,
         "%s,%s,%d,%d,%.0f,%.0f,%.0f,%.0f,%.0f,%.6f,%.10g,%.10g,%.10g,%.10g,%.10g,%.10g,%.10g,%.10g,%.10g,%s\n",
-        bar_ts, st->symbol, bar_sec,
+        bar_ts, sym->symbol, to->bar_sec[k],
         (int)st->trades,
         vol_total, st->buy_vol, st->sell_vol, st->undef_vol,
         delta, imb,
@@ -262,14 +303,13 @@ static void emit_bar(FILE *out, const char ymd[9], int bar_sec,
         st->ema_fast, st->ema_slow, st->ema_delta, ema_diff,
         sig
     );
-    fflush(out);
+    ccu_flush(&g_cu, out);
 }
 
 // Processa uma linha; retorna true se consumiu um trade A com sucesso.
 static bool process_line(SymBook *book, const char *line_in,
                          const char ymd[9],
-                         int bar_sec,
-                         FILE *out,
+                         const TfOuts *to,
                          int ema_fast_p, int ema_slow_p, int ema_delta_p,
                          double delta_ema_th, double imb_th, int min_trades) {
     const char *pv = strstr(line_in, "V:");
@@ -307,8 +347,11 @@ static bool process_line(SymBook *book, const char *line_in,
     // Remoção de todos:   V:<ativo>:R
     if (op[0] == 'R') {
         // não temos book de trades aqui; apenas ignoramos e resetamos EMA/barras
-        st->bar_inited = false;
-        st->ema_fast_inited = st->ema_slow_inited = st->ema_delta_inited = false;
+        for (int k = 0; k < to->n; k++) {
+            VBar *b = &st->bars[k];
+            b->bar_inited = false;
+            b->ema_fast_inited = b->ema_slow_inited = b->ema_delta_inited = false;
+        }
         return true;
     }
     if (op[0] == 'D') {
@@ -359,31 +402,33 @@ static bool process_line(SymBook *book, const char *line_in,
 
     char aggressor = (aggr_s && aggr_s[0]) ? aggr_s[0] : 'I';
 
-    int bar_ms = bar_sec * 1000;
-    int bar_start_ms = (t_ms / bar_ms) * bar_ms;
-
-    if (!st->bar_inited) {
-        reset_bar(st, bar_start_ms, price);
-        bar_update(st, price, qty, aggressor);
-        return true;
-    }
-
-    if (bar_start_ms == st->bar_start_ms) {
-        bar_update(st, price, qty, aggressor);
-        return true;
+    // Negócio já parseado entra na barra de cada timeframe
+    bool late = false;
+    for (int k = 0; k < to->n; k++) {
+        VBar *b = &st->bars[k];
+        int bar_ms = to->bar_sec[k] * 1000;
+        int bar_start_ms = (t_ms / bar_ms) * bar_ms;
+
+        if (!b->bar_inited) {
+            reset_bar(b, bar_start_ms, price);
+            bar_update(b, price, qty, aggressor);
+        } else if (bar_start_ms == b->bar_start_ms) {
+            bar_update(b, price, qty, aggressor);
+        } else if (bar_start_ms > b->bar_start_ms) {
+            // fecha bar atual e inicia novo
+            emit_bar(to, k, ymd, st, ema_fast_p, ema_slow_p, ema_delta_p, delta_ema_th, imb_th, min_trades);
+            reset_bar(b, bar_start_ms, price);
+            bar_update(b, price, qty, aggressor);
+        } else {
+            // evento atrasado (bar antigo)
+            late = true;
+        }
     }
-
-    if (bar_start_ms > st->bar_start_ms) {
-        // fecha bar atual e inicia novo
-        emit_bar(out, ymd, bar_sec, st, ema_fast_p, ema_slow_p, ema_delta_p, delta_ema_th, imb_th, min_trades);
-        reset_bar(st, bar_start_ms, price);
-        bar_update(st, price, qty, aggressor);
-        return true;
+    if (late) {
+        st->late_events++;
+        return false;
     }
-
-    // evento atrasado (bar antigo)
-    st->late_events++;
-    return false;
+    return true;
 }
 
 typedef struct {
@@ -393,7 +438,8 @@ typedef struct {
     char input_dir[PATH_MAX];
     char out_dir[PATH_MAX];
 
-    int bar_sec;
+    int bar_secs[V_MAX_TF];   // --bar-sec 1 ou 1,5,60: um CSV por timeframe
+    int ntf;
     int ema_fast_p;
     int ema_slow_p;
     int ema_delta_p;
@@ -403,6 +449,9 @@ typedef struct {
     int min_trades;
 
     int poll_ms;
+    char shm[128];
+    bool catchup;
+    int catchup_emit;       // --catchup-emit: segundos do dia, CCU_EMIT_LIVE ou -1
 } Args;
 
 static void usage(const char *argv0) {
@@ -411,24 +460,47 @@ static void usage(const char *argv0) {
         "  %s --file <yyyymmdd_V.txt> --out <saida.csv> [opcoes]\n"
         "  %s --live --input-dir <dir> --out-dir <dir> [opcoes]\n\n"
         "Opcoes:\n"
-        "  --bar-sec N           (default 1)\n"
+        "  --bar-sec N[,N...]    (default 1) lista: um CSV por timeframe numa passada so (--out com {bar})\n"
         "  --ema-fast N          (default 9)\n"
         "  --ema-slow N          (default 21)\n"
         "  --ema-delta N         (default 21)\n"
         "  --imb-th X            (default 0.15)\n"
         "  --delta-ema-th X      (default 5)\n"
         "  --min-trades N        (default 3)\n"
-        "  --poll-ms N           (default 200) apenas live\n",
+        "  --poll-ms N           (default 200) apenas live; teto de espera (o input acorda por inotify, menos o --writer mmap)\n"
+        "  --shm NOME            live: le do anel em memoria do leitorwebsocket --shm NOME (sem --input-dir)\n"
+        "  --catchup             live: recupera o dia desde o inicio antes de seguir ao vivo (sem: comeca no fim)\n"
+        "  --catchup-emit X      com --catchup: barras antes de HH:MM:SS (ou todas da recuperacao, com live) nao vao para o CSV\n",
         argv0, argv0
     );
 }
 
 static bool streq(const char *a, const char *b) { return strcmp(a,b)==0; }
 
+// "1,5,60" -> secs/n; false se vazia, com mais de V_MAX_TF ou repetida
+static bool parse_bar_list(const char *s, int secs[V_MAX_TF], int *n) {
+    int k = 0;
+    while (*s) {
+        char *end = NULL;
+        long v = strtol(s, &end, 10);
+        if (end == s || k == V_MAX_TF) return false;
+        if (v <= 0) v = 1;
+        for (int j = 0; j < k; j++) if (secs[j] == (int)v) return false;
+        secs[k++] = (int)v;
+        s = end;
+        if (*s == ',') s++;
+        else if (*s) return false;
+    }
+    if (k == 0) return false;
+    *n = k;
+    return true;
+}
+
 static Args parse_args(int argc, char **argv) {
     Args a;
     memset(&a, 0, sizeof(a));
-    a.bar_sec = 1;
+    a.bar_secs[0] = 1;
+    a.ntf = 1;
     a.ema_fast_p = 9;
     a.ema_slow_p = 21;
     a.ema_delta_p = 21;
@@ -436,6 +508,7 @@ static Args parse_args(int argc, char **argv) {
     a.delta_ema_th = 5.0;
     a.min_trades = 3;
     a.poll_ms = 200;
+    a.catchup_emit = -1;
 
     for (int i = 1; i < argc; i++) {
         if (streq(argv[i], "--live")) a.live = true;
@@ -443,7 +516,13 @@ static Args parse_args(int argc, char **argv) {
         else if (streq(argv[i], "--out") && i+1 < argc)  snprintf(a.out, sizeof(a.out), "%s", argv[++i]);
         else if (streq(argv[i], "--input-dir") && i+1 < argc) snprintf(a.input_dir, sizeof(a.input_dir), "%s", argv[++i]);
         else if (streq(argv[i], "--out-dir") && i+1 < argc)   snprintf(a.out_dir, sizeof(a.out_dir), "%s", argv[++i]);
-        else if (streq(argv[i], "--bar-sec") && i+1 < argc)   a.bar_sec = atoi(argv[++i]);
+        else if (streq(argv[i], "--bar-sec") && i+1 < argc) {
+            if (!parse_bar_list(argv[i+1], a.bar_secs, &a.ntf)) {
+                fprintf(stderr, "--bar-sec espera N ou N1,N2,... (ate %d, sem repetir): %s\n", V_MAX_TF, argv[i+1]);
+                exit(2);
+            }
+            i++;
+        }
         else if (streq(argv[i], "--ema-fast") && i+1 < argc)  a.ema_fast_p = atoi(argv[++i]);
         else if (streq(argv[i], "--ema-slow") && i+1 < argc)  a.ema_slow_p = atoi(argv[++i]);
         else if (streq(argv[i], "--ema-delta") && i+1 < argc) a.ema_delta_p = atoi(argv[++i]);
@@ -451,6 +530,15 @@ static Args parse_args(int argc, char **argv) {
         else if (streq(argv[i], "--delta-ema-th") && i+1 < argc) a.delta_ema_th = atof(argv[++i]);
         else if (streq(argv[i], "--min-trades") && i+1 < argc) a.min_trades = atoi(argv[++i]);
         else if (streq(argv[i], "--poll-ms") && i+1 < argc)   a.poll_ms = atoi(argv[++i]);
+        else if (streq(argv[i], "--shm") && i+1 < argc)       snprintf(a.shm, sizeof(a.shm), "%s", argv[++i]);
+        else if (streq(argv[i], "--catchup")) a.catchup = true;
+        else if (streq(argv[i], "--catchup-emit") && i+1 < argc) {
+            if (!ccu_parse_emit(argv[i+1], &a.catchup_emit)) {
+                fprintf(stderr, "--catchup-emit espera HH:MM:SS ou live: %s\n", argv[i+1]);
+                exit(2);
+            }
+            i++;
+        }
         else {
             fprintf(stderr, "Argumento invalido: %s\n", argv[i]);
             usage(argv[0]);
@@ -458,7 +546,10 @@ static Args parse_args(int argc, char **argv) {
         }
     }
 
-    if (a.bar_sec <= 0) a.bar_sec = 1;
+    if (!a.live && a.ntf > 1 && !strstr(a.out, "{bar}")) {
+        fprintf(stderr, "Com mais de um --bar-sec o --out precisa ter {bar} (ex: 20251222_v_{bar}s.csv)\n");
+        exit(2);
+    }
     if (a.poll_ms < 10) a.poll_ms = 10;
 
     return a;
@@ -473,20 +564,78 @@ static void today_ymd(char out_ymd[9]) {
 
 
 static void build_live_paths(const Args *a, const char ymd[9],
-                             char out_infile[PATH_MAX], char out_outfile[PATH_MAX]) {
+                             char out_infile[PATH_MAX], TfOuts *to) {
     int n1 = snprintf(out_infile, PATH_MAX, "%s/%s_V.txt", a->input_dir, ymd);
-    int n2 = snprintf(out_outfile, PATH_MAX, "%s/%s_v_%ds.csv", a->out_dir, ymd, a->bar_sec);
 
     if (n1 < 0 || n1 >= PATH_MAX) {
         fprintf(stderr, "ERRO: caminho input muito grande (PATH_MAX=%d)\n", PATH_MAX);
         exit(2);
     }
-    if (n2 < 0 || n2 >= PATH_MAX) {
-        fprintf(stderr, "ERRO: caminho output muito grande (PATH_MAX=%d)\n", PATH_MAX);
-        exit(2);
+    for (int k = 0; k < to->n; k++) {
+        int n2 = snprintf(to->path[k], PATH_MAX, "%s/%s_v_%ds.csv", a->out_dir, ymd, to->bar_sec[k]);
+        if (n2 < 0 || n2 >= PATH_MAX) {
+            fprintf(stderr, "ERRO: caminho output muito grande (PATH_MAX=%d)\n", PATH_MAX);
+            exit(2);
+        }
+    }
+}
+
+static void tf_init(TfOuts *to, const Args *a) {
+    memset(to, 0, sizeof(*to));
+    to->n = a->ntf;
+    for (int k = 0; k < to->n; k++) {
+        to->bar_sec[k] = a->bar_secs[k];
+        to->from_sec[k] = -1;
+    }
+}
+
+// Fecha a barra em curso de todos os símbolos, em todos os timeframes
+static void emit_all(const TfOuts *to, const char ymd[9], SymBook *book, const Args *a) {
+    for (int k = 0; k < to->n; k++) {
+        for (int i = 0; i < book->nsyms; i++) {
+            emit_bar(to, k, ymd, &book->syms[i],
+                     a->ema_fast_p, a->ema_slow_p, a->ema_delta_p,
+                     a->delta_ema_th, a->imb_th, a->min_trades);
+        }
     }
 }
 
+static void tf_close(TfOuts *to) {
+    for (int k = 0; k < to->n; k++) {
+        if (to->out[k]) fclose(to->out[k]);
+        to->out[k] = NULL;
+    }
+}
+
+// Primeiro EOF: descarrega os CSVs e mostra o resumo da recuperação
+static void tf_live(TfOuts *to) {
+    if (!g_cu.active) return;
+    for (int k = 0; k < to->n; k++) if (to->out[k]) fflush(to->out[k]);
+    ccu_live(&g_cu, NULL);
+}
+
+
+// Segundo do dia da última barra do CSV de saída (-1 se vazio)
+static int last_bar_sec(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    char buf[8192];
+    long long sz = 0;
+    if (fseeko(f, 0, SEEK_END) == 0) sz = (long long)ftello(f);
+    const long long from = sz > (long long)sizeof(buf) - 1 ? sz - (long long)sizeof(buf) + 1 : 0;
+    size_t n = 0;
+    if (fseeko(f, (off_t)from, SEEK_SET) == 0) n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+    int sec = -1;
+    for (char *p = buf; p && *p; ) {
+        const int s = ci_line_sec(p);
+        if (s >= 0) sec = s;
+        p = strchr(p, '\n');
+        if (p) p++;
+    }
+    return sec;
+}
 
 static void run_file_mode(const Args *a) {
     char ymd[9] = {0};
@@ -495,128 +644,203 @@ static void run_file_mode(const Args *a) {
         exit(2);
     }
 
-    FILE *in = fopen(a->file, "rb");
+    FILE *in = cz_fopen(a->file, "rb");   // aceita o .zst do dia arquivado
     if (!in) die("fopen input");
 
-    FILE *out = fopen(a->out, "wb");
-    if (!out) die("fopen out");
-    ensure_header(out);
+    // --out com {bar}: um CSV por timeframe
+    static TfOuts to;
+    tf_init(&to, a);
+    for (int k = 0; k < to.n; k++) {
+        const char *p = strstr(a->out, "{bar}");
+        if (p) snprintf(to.path[k], PATH_MAX, "%.*s%d%s", (int)(p - a->out), a->out, to.bar_sec[k], p + 5);
+        else snprintf(to.path[k], PATH_MAX, "%s", a->out);
+        to.out[k] = fopen(to.path[k], "wb");
+        if (!to.out[k]) die("fopen out");
+        setvbuf(to.out[k], NULL, _IOFBF, 1<<20);
+        ensure_header(to.out[k]);
+    }
+    ccu_begin(&g_cu, "parser_V", -1);   // nunca fica ao vivo: sem fflush por barra
 
     SymBook book; memset(&book, 0, sizeof(book));
 
     char *line = NULL;
     size_t cap = 0;
     while (getline(&line, &cap, in) != -1) {
-        process_line(&book, line, ymd, a->bar_sec, out,
+        process_line(&book, line, ymd, &to,
                      a->ema_fast_p, a->ema_slow_p, a->ema_delta_p,
                      a->delta_ema_th, a->imb_th, a->min_trades);
     }
     free(line);
 
     // flush final: fecha a última barra de cada símbolo
-    for (int i = 0; i < book.nsyms; i++) {
-        emit_bar(out, ymd, a->bar_sec, &book.syms[i],
-                 a->ema_fast_p, a->ema_slow_p, a->ema_delta_p,
-                 a->delta_ema_th, a->imb_th, a->min_trades);
-    }
+    emit_all(&to, ymd, &book, a);
 
     fclose(in);
-    fclose(out);
+    tf_close(&to);
 }
 
 static void run_live_mode(const Args *a) {
     SymBook book; memset(&book, 0, sizeof(book));
 
+    // --shm: o dia vem dos registros (cshm_next_day), e os CSVs só abrem com o
+    // primeiro; no cedro_engine a entrada pode ser de outro dia
     char cur_ymd[9] = {0};
-    today_ymd(cur_ymd);
+    char next_ymd[9] = {0};
+    if (!a->shm[0]) today_ymd(cur_ymd);
 
-    char infile[PATH_MAX], outfile[PATH_MAX];
-    build_live_paths(a, cur_ymd, infile, outfile);
+    // CSV de cada timeframe: {out-dir}/{ymd}_v_{bar_sec}s.csv
+    static TfOuts to;
+    tf_init(&to, a);
+    char infile[PATH_MAX];
+    build_live_paths(a, cur_ymd, infile, &to);
+    CmtTail tail = {0};   // sidecar .tail do leitorwebsocket --writer mmap
 
     FILE *in = NULL;
-    FILE *out = NULL;
     off_t last_off = 0;
     long long last_sz = -1;
 
     char *line = NULL;
     size_t cap = 0;
+    int catchup_emit = a->catchup_emit;
+    CtlWatch cw;
+    memset(&cw, 0, sizeof(cw));
+    cw.fd = -1;
+    if (!a->shm[0]) {
+        ctl_init(&cw);
+        ctl_follow(&cw, infile);
+    }
+    bool waited = true;   // o tamanho do input só é conferido depois de uma espera
+    static CshmReader sr;
+    if (a->shm[0]) {
+        // Espera o coletor criar o segmento
+        while (cshm_open(&sr, a->shm, 'V') != 0) usleep(a->poll_ms * 1000);
+    }
 
     for (;;) {
         // troca de dia?
         char now_ymd[9] = {0};
-        today_ymd(now_ymd);
+        if (a->shm[0]) memcpy(now_ymd, next_ymd[0] ? next_ymd : cur_ymd, sizeof(now_ymd));
+        else today_ymd(now_ymd);
         if (strcmp(now_ymd, cur_ymd) != 0) {
             // flush e fecha
-            if (out) {
-                for (int i = 0; i < book.nsyms; i++) {
-                    emit_bar(out, cur_ymd, a->bar_sec, &book.syms[i],
-                             a->ema_fast_p, a->ema_slow_p, a->ema_delta_p,
-                             a->delta_ema_th, a->imb_th, a->min_trades);
-                }
-                fclose(out);
-                out = NULL;
+            if (to.out[0]) {
+                emit_all(&to, cur_ymd, &book, a);
+                tf_close(&to);
             }
             if (in) { fclose(in); in = NULL; }
+            cmt_detach(&tail);
 
             memset(&book, 0, sizeof(book));
+            for (int k = 0; k < to.n; k++) to.from_sec[k] = -1;
+            memset(&g_cu, 0, sizeof(g_cu));   // arquivo novo: já começa ao vivo
             snprintf(cur_ymd, sizeof(cur_ymd), "%s", now_ymd);
-            build_live_paths(a, cur_ymd, infile, outfile);
+            build_live_paths(a, cur_ymd, infile, &to);
+            if (!a->shm[0]) ctl_follow(&cw, infile);
             last_off = 0;
             last_sz = -1;
         }
 
         // garante output aberto
-        if (!out) {
-            out = fopen(outfile, "ab+");
-            if (!out) die("fopen live out");
-            fseeko(out, 0, SEEK_END);
-            ensure_header(out);
+        for (int k = 0; k < to.n && cur_ymd[0]; k++) {
+            if (to.out[k]) continue;
+            to.out[k] = fopen(to.path[k], "ab+");
+            if (!to.out[k]) die("fopen live out");
+            setvbuf(to.out[k], NULL, _IOFBF, 1<<20);
+            fseeko(to.out[k], 0, SEEK_END);
+            ensure_header(to.out[k]);
+        }
+
+        if (a->shm[0]) {
+            CjRecord rec;
+            int got_any = 0;
+            int r;
+            while ((r = cshm_next_day(&sr, &rec, cur_ymd, next_ymd)) > 0) {
+                got_any = 1;
+                if (r == 2) break;   // registro de outro dia: troca no topo do laço
+                if (rec.h.type != 'V') continue;
+                process_line(&book, rec.payload, cur_ymd, &to,
+                             a->ema_fast_p, a->ema_slow_p, a->ema_delta_p,
+                             a->delta_ema_th, a->imb_th, a->min_trades);
+            }
+            if (!got_any) {
+                if (cshm_eof(&sr)) {   // fim da entrada do engine: fecha a última barra
+                    emit_all(&to, cur_ymd, &book, a);
+                    break;
+                }
+                cshm_wait(&sr);
+            }
+            continue;
         }
 
         // abre input quando existir
         if (!in) {
             if (!file_exists(infile)) {
-                usleep(a->poll_ms * 1000);
+                ctl_wait(&cw, a->poll_ms);
                 continue;
             }
-            in = fopen(infile, "rb");
-            if (!in) { usleep(a->poll_ms * 1000); continue; }
-            // começa do final (tail) para live (pode mudar se quiser: troque SEEK_END por SEEK_SET)
-            fseeko(in, 0, SEEK_END);
+            in = cmt_fopen(infile, "rb");
+            if (!in) { ctl_wait(&cw, a->poll_ms); continue; }
+            // começa do final (tail) para live; com --catchup, do início sem
+            // repetir as barras que o CSV já tem
+            cmt_detach(&tail);
+            cmt_attach(&tail, infile);
+            if (a->catchup) {
+                for (int k = 0; k < to.n; k++) {
+                    const int done_sec = last_bar_sec(to.path[k]);
+                    to.from_sec[k] = done_sec >= 0 ? done_sec + to.bar_sec[k] : -1;
+                }
+                ccu_begin(&g_cu, "parser_V", catchup_emit);
+                catchup_emit = -1;   // --catchup-emit só vale na partida, não no arquivo do dia seguinte
+            } else {
+                cmt_seek_end(&tail, in);
+            }
             last_off = ftello(in);
             last_sz = file_size(infile);
         }
 
-        // detecta truncamento/rotacao do arquivo (tamanho diminuiu)
-        long long sz = file_size(infile);
+        // detecta truncamento/rotacao do arquivo (tamanho diminuiu); só depois de uma espera
+        long long sz = waited ? file_size(infile) : -1;
         if (sz >= 0 && last_sz >= 0 && sz < last_sz) {
             fclose(in);
-            in = fopen(infile, "rb");
-            if (!in) { usleep(a->poll_ms * 1000); continue; }
-            fseeko(in, 0, SEEK_END);
+            in = cmt_fopen(infile, "rb");
+            if (!in) { ctl_wait(&cw, a->poll_ms); continue; }
+            cmt_detach(&tail);
+            cmt_attach(&tail, infile);
+            ctl_follow(&cw, infile);
+            cmt_seek_end(&tail, in);
             last_off = ftello(in);
             last_sz = sz;
-        } else {
+        } else if (sz >= 0) {
             last_sz = sz;
         }
+        waited = false;
 
         // tenta ler linhas novas
         int got_any = 0;
-        while (getline(&line, &cap, in) != -1) {
+        ssize_t nread;
+        while (!cmt_at_limit(&tail, in) && (nread = getline(&line, &cap, in)) != -1 &&
+               !ctl_partial_line(in, line, (size_t)nread)) {
             got_any = 1;
-            process_line(&book, line, cur_ymd, a->bar_sec, out,
+            ccu_count(&g_cu, (size_t)nread, ci_line_sec(line));
+            process_line(&book, line, cur_ymd, &to,
                          a->ema_fast_p, a->ema_slow_p, a->ema_delta_p,
                          a->delta_ema_th, a->imb_th, a->min_trades);
             last_off = ftello(in);
         }
 
         if (!got_any) {
+            tf_live(&to);
             clearerr(in); // EOF
-            usleep(a->poll_ms * 1000);
+            ctl_wait(&cw, a->poll_ms);
+            waited = true;
         }
     }
 
     free(line);
+    cshm_free(&sr);
+    cmt_detach(&tail);
+    ctl_close(&cw);
+    tf_close(&to);
 }
 
 int main(int argc, char **argv) {
@@ -632,7 +856,7 @@ int main(int argc, char **argv) {
     }
 
     // live
-    if (a.input_dir[0] == '\0' || a.out_dir[0] == '\0') {
+    if ((a.input_dir[0] == '\0' && a.shm[0] == '\0') || a.out_dir[0] == '\0') {
         usage(argv[0]);
         return 2;
     }
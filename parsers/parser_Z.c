@@ -1,4 +1,4 @@
-//gcc -O3 -march=native -pipe -std=c11 parser_Z.c -o parser_Z -lm 
+//gcc -O3 -march=native -pipe -std=c11 parser_Z.c -o parser_Z -lm -lzstd -lpthread
 //
 // parser_Z_signal_v3.c  (Linux, GCC 7.5+, Ubuntu 18.04 OK)
 //
@@ -27,10 +27,42 @@
 //     --min-warmup 60 --score-th 1.2 --persist 3 --cooldown-sec 30 --require-sign
 //
 // Observações:
-// - Lê em loop; quando chega EOF, dorme e continua.
-// - Guarda offset em state-dir (arquivo .offset) para retomar.
+// - Lê em loop; quando chega EOF, espera o input crescer por inotify
+//   (cedro_tail.h) e continua. --poll-sec só é o teto dessa espera com o
+//   leitorwebsocket --writer mmap, que não gera evento.
+// - Guarda offset em state-dir (arquivo .offset) para retomar e, na mesma
+//   cadência (--ckpt-sec), o estado inteiro dos símbolos (book, EMAs, janelas
+//   do z-score, anel de mid, persist/cooldown, contadores) em {key}_Z.state,
+//   mmap com dois buffers (cedro_state.h). Na partida o estado é restaurado e
+//   a leitura segue do offset dele: sinal quente desde a primeira linha, sem
+//   min_warmup de novo. Estado de outra configuração (símbolos, depth, zwin)
+//   é descartado e a retomada cai no keyframe.
 // - Se {ymd} estiver no input-template, faz rollover diário automaticamente.
 // - "delay_ms" em replay será enorme (ok).
+// - --journal: input-template aponta para o journal binário ({ymd}_raw.cj) do
+//   leitorwebsocket --journal; write_ts vem do timestamp em ns do registro e o
+//   offset salvo é o do registro no journal.
+// - Marcador de lacuna do coletor (GAP_START/GAP_END, cedro_gap.h): o book dos
+//   símbolos atingidos (todos, se o marcador não lista) é zerado e volta a ser
+//   montado pelo reenvio do servidor.
+// - --shm NOME: lê os registros 'Z' direto do anel em memória do leitorwebsocket
+//   --shm NOME (cedro_shm.h), sem --input-template nem offset salvo.
+// - Dia arquivado pelo coletor (--archive): se o input não existe mas
+//   input.zst existe, lê o comprimido (cedro_zst.h); o offset salvo é o do
+//   conteúdo original, então vale para os dois.
+// - --from/--to HH:MM:SS: só as linhas de snapshot desse trecho, em batch; não
+//   lê nem grava o offset do state-dir.
+// - Keyframes (cedro_keyframe.h): a cada --kf-sec segundos de feed (default 60,
+//   0 desliga) o book dos símbolos vai para "<input>.Z.kf" com o offset do
+//   input. Ao retomar do offset salvo (ou --start-at-end) o book é refeito do
+//   último keyframe antes dele, ou do início do arquivo, sem gerar linhas até o
+//   ponto de retomada; o --from começa no keyframe Z_WARM_SEC antes, para
+//   aquecer o sinal.
+// - Recuperação (cedro_catchup.h): do ponto de partida (estado, keyframe ou
+//   início do arquivo) até o primeiro EOF o CSV só é descarregado nos
+//   checkpoints, sem o --flush-sec; no EOF vira ao vivo e mostra o resumo
+//   (MB/s, hora em que ficou ao vivo). --catchup-emit HH:MM:SS|live: linhas
+//   da recuperação antes disso só aquecem o sinal.
 //
 #define _GNU_SOURCE
 #include <stdio.h>
@@ -44,6 +76,22 @@
 #include <sys/time.h>
 #include <time.h>
 
+#include "cedro_catchup.h"
+#include "cedro_gap.h"
+#include "cedro_index.h"
+#include "cedro_journal.h"
+#include "cedro_keyframe.h"
+#include "cedro_shm.h"
+#include "cedro_state.h"
+#include "cedro_tail.h"
+#include "cedro_mmap_tail.h"
+#include "cedro_zst.h"
+
+// Build do cedro_engine
+#ifdef CEDRO_ENGINE
+#define main parser_Z_main
+#endif
+
 #ifndef NAN
 #define NAN (0.0/0.0)
 #endif
@@ -51,6 +99,7 @@
 #define MAX_SYMS 16
 #define MAX_PATH 4096
 #define MID_RING 256
+#define Z_WARM_SEC 300   // --from: keyframe até 5 min antes, sinal aquecido no trecho
 
 typedef struct {
   double price;
@@ -137,6 +186,12 @@ typedef struct {
   int flush_sec;
   int batch_mode;
   int reset_state;
+  int journal;
+  char shm[128];
+  int from_sec;   // --from/--to em segundos do dia; -1 = sem limite
+  int to_sec;
+  int kf_sec;     // keyframe a cada N s de feed; 0 = sem keyframes
+  int catchup_emit;   // --catchup-emit: segundos do dia, CCU_EMIT_LIVE ou -1
 } Config;
 
 // ---------- utils ----------
@@ -146,11 +201,6 @@ static void die(const char *msg) {
   exit(2);
 }
 
-static int file_exists(const char *path) {
-  struct stat st;
-  return stat(path, &st) == 0;
-}
-
 static void ensure_dir(const char *path) {
   if (!path || !path[0]) return;
   struct stat st;
@@ -429,11 +479,12 @@ static void dirname_of(const char *path, char out[MAX_PATH]) {
   if (slash) *slash = 0; else strcpy(out, ".");
 }
 
-static void state_path_for(const Config *cfg, const char *ymd, char out[MAX_PATH]) {
+// {state_dir}/{key}_Z{ext}, ext ".offset" ou ".state"
+static void state_path_for(const Config *cfg, const char *ymd, const char *ext, char out[MAX_PATH]) {
   char key[32];
   if (has_ymd_placeholder(cfg->input_template) || (cfg->date_fixed[0] != 0)) strncpy(key, ymd, sizeof(key)-1);
   else strcpy(key, "fixed");
-  int n = snprintf(out, MAX_PATH, "%s/%s_Z.offset", cfg->state_dir, key);
+  int n = snprintf(out, MAX_PATH, "%s/%s_Z%s", cfg->state_dir, key, ext);
   if (n < 0 || n >= MAX_PATH) { fprintf(stderr, "ERRO: state path muito longo\n"); exit(2); }
 }
 
@@ -467,6 +518,8 @@ typedef struct {
   int n_orders;
 } Event;
 
+static int parse_payload(char *payload, Event *ev);
+
 static int parse_event(char *line, Event *ev) {
   // line: write_ts,buf,src,payload
   char *p1 = strchr(line, ','); if (!p1) return 0;
@@ -480,6 +533,11 @@ static int parse_event(char *line, Event *ev) {
   size_t L = strlen(payload);
   while (L && (payload[L-1] == '\n' || payload[L-1] == '\r')) payload[--L] = 0;
 
+  return parse_payload(payload, ev);
+}
+
+// payload "Z:..." (mutável; strtok_r escreve nele). Não toca ev->write_ts.
+static int parse_payload(char *payload, Event *ev) {
   if (payload[0] != 'Z' || payload[1] != ':') return 0;
 
   char *save = NULL;
@@ -707,6 +765,131 @@ static void reset_counters(SymCtx *sc) {
   sc->ctr.A = sc->ctr.U = sc->ctr.D1 = sc->ctr.D3 = sc->ctr.E = sc->ctr.bad = 0;
 }
 
+// ---------- keyframes (cedro_keyframe.h) ----------
+
+// Keyframe na virada de cada período de kf_sec segundos de feed
+static int kf_due(int *last_sec, int sec, int kf_sec) {
+  if (kf_sec <= 0 || sec < 0) return 0;
+  int due = *last_sec >= 0 && sec / kf_sec != *last_sec / kf_sec;
+  *last_sec = sec;
+  return due;
+}
+
+static void kf_save(CkfWriter *w, const SymCtx *ctx, int n, long long in_off, int sec) {
+  if (!ckf_begin(w, in_off, sec)) return;
+  for (int i=0;i<n;i++) {
+    const OrderBook *ob = &ctx[i].book;
+    ckf_add(w, ctx[i].symbol, NULL, ob->bids, (uint32_t)ob->depth, ob->asks, (uint32_t)ob->depth);
+  }
+  ckf_commit(w);
+}
+
+// Books do último keyframe de input_path com sec <= max_sec e offset <= max_off
+// (-1 = sem limite); vale só o que tem todos os símbolos. 0 se não há.
+static int kf_restore(SymCtx *ctx, int n, int depth, const char *input_path, int max_sec, long long max_off,
+                      long long *in_off) {
+  char path[MAX_PATH];
+  CkfFrame fr;
+  if (!ckf_path(input_path, 'Z', path, sizeof(path)) ||
+      !ckf_load(path, 'Z', (uint32_t)depth, 0, sizeof(Level), max_sec, max_off, &fr)) return 0;
+  for (int i=0;i<n;i++) {
+    if (!ckf_has_sym(&fr, ctx[i].symbol)) { ckf_free(&fr); return 0; }
+  }
+  CkfSym s;
+  const void *extra, *bid, *ask;
+  while (ckf_next_sym(&fr, &s, &extra, &bid, &ask)) {
+    SymCtx *sc = find_sym(ctx, n, s.symbol);
+    if (!sc || s.nbid != (uint32_t)depth || s.nask != (uint32_t)depth) continue;
+    memcpy(sc->book.bids, bid, (size_t)depth * sizeof(Level));
+    memcpy(sc->book.asks, ask, (size_t)depth * sizeof(Level));
+  }
+  *in_off = (long long)fr.h.in_off;
+  ckf_free(&fr);
+  return 1;
+}
+
+// ---------- estado quente ({key}_Z.state, cedro_state.h) ----------
+
+typedef struct {
+  long long in_off;       // input aplicado até aqui
+  char last_write_ts[32];
+  int last_sec_of_day;
+  int nsyms;
+} ZStateHead;
+
+// Por símbolo: nome, bids/asks, FeatState (sem os ponteiros), as duas janelas
+// do z-score, contadores e seen_any
+static size_t zstate_sym_size(const Config *cfg) {
+  return 32 + 2 * (size_t)cfg->depth * sizeof(Level) + sizeof(FeatState) + 2 * (size_t)cfg->zwin * sizeof(double) +
+         sizeof(Counters) + sizeof(int);
+}
+
+static size_t zstate_size(const Config *cfg, int n) {
+  return sizeof(ZStateHead) + (size_t)n * zstate_sym_size(cfg);
+}
+
+static uint64_t zstate_tag(const Config *cfg, const SymCtx *ctx, int n) {
+  const uint32_t dims[] = {(uint32_t)cfg->depth, (uint32_t)cfg->zwin, (uint32_t)n, MID_RING,
+                           (uint32_t)sizeof(FeatState), (uint32_t)sizeof(Level), (uint32_t)sizeof(Counters)};
+  uint64_t h = cst_hash(0, dims, sizeof(dims));
+  for (int i=0;i<n;i++) h = cst_hash(h, ctx[i].symbol, sizeof(ctx[i].symbol));
+  return h;
+}
+
+static void zstate_save(CstFile *zs, unsigned char *buf, const Config *cfg, const SymCtx *ctx, int n,
+                        long long in_off, const char *last_write_ts, int last_sec_of_day) {
+  if (!cst_is_open(zs)) return;
+  ZStateHead hd;
+  memset(&hd, 0, sizeof(hd));
+  hd.in_off = in_off;
+  strncpy(hd.last_write_ts, last_write_ts, sizeof(hd.last_write_ts)-1);
+  hd.last_sec_of_day = last_sec_of_day;
+  hd.nsyms = n;
+  unsigned char *p = buf;
+  memcpy(p, &hd, sizeof(hd)); p += sizeof(hd);
+  const size_t lv = (size_t)cfg->depth * sizeof(Level), rw = (size_t)cfg->zwin * sizeof(double);
+  for (int i=0;i<n;i++) {
+    const SymCtx *sc = &ctx[i];
+    FeatState st = sc->st;
+    st.rz_imb.buf = st.rz_mid.buf = NULL;
+    memcpy(p, sc->symbol, 32); p += 32;
+    memcpy(p, sc->book.bids, lv); p += lv;
+    memcpy(p, sc->book.asks, lv); p += lv;
+    memcpy(p, &st, sizeof(st)); p += sizeof(st);
+    memcpy(p, sc->st.rz_imb.buf, rw); p += rw;
+    memcpy(p, sc->st.rz_mid.buf, rw); p += rw;
+    memcpy(p, &sc->ctr, sizeof(sc->ctr)); p += sizeof(sc->ctr);
+    memcpy(p, &sc->seen_any, sizeof(int)); p += sizeof(int);
+  }
+  cst_save(zs, buf);
+}
+
+// Inverso do zstate_save (o tag já garantiu o layout)
+static void zstate_unpack(const unsigned char *buf, const Config *cfg, SymCtx *ctx, int n,
+                          long long *in_off, char *last_write_ts, int *last_sec_of_day) {
+  ZStateHead hd;
+  const unsigned char *p = buf;
+  memcpy(&hd, p, sizeof(hd)); p += sizeof(hd);
+  *in_off = hd.in_off;
+  memcpy(last_write_ts, hd.last_write_ts, sizeof(hd.last_write_ts));
+  *last_sec_of_day = hd.last_sec_of_day;
+  const size_t lv = (size_t)cfg->depth * sizeof(Level), rw = (size_t)cfg->zwin * sizeof(double);
+  for (int i=0;i<n;i++) {
+    SymCtx *sc = &ctx[i];
+    double *imb = sc->st.rz_imb.buf, *mid = sc->st.rz_mid.buf;
+    p += 32;
+    memcpy(sc->book.bids, p, lv); p += lv;
+    memcpy(sc->book.asks, p, lv); p += lv;
+    memcpy(&sc->st, p, sizeof(sc->st)); p += sizeof(sc->st);
+    sc->st.rz_imb.buf = imb;
+    sc->st.rz_mid.buf = mid;
+    memcpy(imb, p, rw); p += rw;
+    memcpy(mid, p, rw); p += rw;
+    memcpy(&sc->ctr, p, sizeof(sc->ctr)); p += sizeof(sc->ctr);
+    memcpy(&sc->seen_any, p, sizeof(int)); p += sizeof(int);
+  }
+}
+
 static void usage() {
   fprintf(stderr,
     "Uso: parser_Z --input-template <path|tmpl> (--out-csv <file> | --out-template <tmpl>) --state-dir <dir> --symbols <CSV> [opções]\n"
@@ -727,6 +910,11 @@ static void usage() {
     "  --zwin N (60)\n"
     "  --score-th X (1.2)\n"
     "  --require-sign (exige direção do mid junto)\n"
+    "  --journal (input é o journal binário {ymd}_raw.cj do leitorwebsocket)\n"
+    "  --shm NOME (lê do anel em memória do leitorwebsocket --shm NOME, sem input)\n"
+    "  --from HH:MM:SS --to HH:MM:SS (só esse trecho; implica --batch, sem offset salvo)\n"
+    "  --catchup-emit HH:MM:SS|live (linhas da recuperação antes disso, ou todas, não vão para o CSV)\n"
+    "  --kf-sec N (60)   (keyframe do book em <input>.Z.kf a cada N s; 0 desliga)\n"
   );
   exit(2);
 }
@@ -751,6 +939,10 @@ int main(int argc, char **argv) {
   cfg.flush_sec = 1;
   cfg.batch_mode = 0;
   cfg.reset_state = 0;
+  cfg.from_sec = -1;
+  cfg.to_sec = -1;
+  cfg.kf_sec = 60;
+  cfg.catchup_emit = -1;
 
   for (int i=1;i<argc;i++) {
     if (arg_eq(argv[i], "--input-template") && i+1<argc) strncpy(cfg.input_template, argv[++i], MAX_PATH-1);
@@ -763,6 +955,7 @@ int main(int argc, char **argv) {
     else if (arg_eq(argv[i], "--snapshot-sec") && i+1<argc) cfg.snapshot_sec = atoi(argv[++i]);
     else if (arg_eq(argv[i], "--poll-sec") && i+1<argc) cfg.poll_sec = atof(argv[++i]);
     else if (arg_eq(argv[i], "--ckpt-sec") && i+1<argc) cfg.ckpt_sec = atoi(argv[++i]);
+    else if (arg_eq(argv[i], "--kf-sec") && i+1<argc) cfg.kf_sec = atoi(argv[++i]);
     else if (arg_eq(argv[i], "--flush-sec") && i+1<argc) cfg.flush_sec = atoi(argv[++i]);
     else if (arg_eq(argv[i], "--batch")) cfg.batch_mode = 1;
     else if (arg_eq(argv[i], "--reset-state")) cfg.reset_state = 1;
@@ -774,6 +967,15 @@ int main(int argc, char **argv) {
     else if (arg_eq(argv[i], "--score-th") && i+1<argc) cfg.score_th = atof(argv[++i]);
     else if (arg_eq(argv[i], "--persist") && i+1<argc) cfg.persist_n = atoi(argv[++i]);
     else if (arg_eq(argv[i], "--require-sign")) cfg.require_sign = 1;
+    else if (arg_eq(argv[i], "--journal")) cfg.journal = 1;
+    else if (arg_eq(argv[i], "--shm") && i+1<argc) strncpy(cfg.shm, argv[++i], sizeof(cfg.shm)-1);
+    else if (arg_eq(argv[i], "--catchup-emit") && i+1<argc) {
+      if (!ccu_parse_emit(argv[++i], &cfg.catchup_emit)) die("--catchup-emit espera HH:MM:SS ou live");
+    }
+    else if ((arg_eq(argv[i], "--from") || arg_eq(argv[i], "--to")) && i+1<argc) {
+      int *dst = arg_eq(argv[i], "--from") ? &cfg.from_sec : &cfg.to_sec;
+      if (!ci_parse_hms(argv[++i], dst)) die("--from/--to esperam HH:MM:SS");
+    }
     else {
       usage();
       fprintf(stderr, "Arg desconhecido: %s\n", argv[i]);
@@ -781,11 +983,20 @@ int main(int argc, char **argv) {
     }
   }
 
-  if (cfg.input_template[0]==0) die("informe --input-template");
+  if (cfg.input_template[0]==0 && cfg.shm[0]==0) die("informe --input-template (ou --shm)");
   if (cfg.state_dir[0]==0) die("informe --state-dir");
   if (cfg.symbols_csv[0]==0) die("informe --symbols");
   if (cfg.out_csv[0]==0 && cfg.out_template[0]==0) die("informe --out-csv OU --out-template");
 
+  // Trecho do dia: reprocessa do início e não mexe no offset da coleta contínua
+  const int ranged = cfg.from_sec >= 0 || cfg.to_sec >= 0;
+  if (ranged) {
+    if (cfg.shm[0]) die("--from/--to não valem com --shm");
+    cfg.batch_mode = 1;
+    cfg.reset_state = 1;
+    cfg.start_at_end = 0;
+  }
+
   ensure_dir(cfg.state_dir);
 
   char syms[MAX_SYMS][32];
@@ -795,16 +1006,23 @@ int main(int argc, char **argv) {
   SymCtx ctx[MAX_SYMS];
   for (int i=0;i<n_syms;i++) sym_init(&ctx[i], syms[i], cfg.depth, cfg.zwin);
 
-  char cur_ymd[16];
+  // --shm sem --date: o dia vem dos registros (cshm_next_day) e o CSV só abre
+  // com o primeiro; no cedro_engine a entrada pode ser de outro dia
+  const int ymd_from_rec = cfg.shm[0] && !cfg.date_fixed[0];
+  char next_ymd[9] = {0};
+  char cur_ymd[16] = {0};
   if (cfg.date_fixed[0]) strncpy(cur_ymd, cfg.date_fixed, sizeof(cur_ymd)-1);
-  else today_ymd(cur_ymd);
+  else if (!ymd_from_rec) today_ymd(cur_ymd);
 
   char input_path[MAX_PATH], out_path[MAX_PATH], out_dir[MAX_PATH], state_path[MAX_PATH];
   format_template(cfg.input_template, cur_ymd, input_path);
+  if (cfg.shm[0]) snprintf(input_path, MAX_PATH, "shm:%s", cfg.shm);   // vai na coluna de origem do CSV
   if (cfg.out_template[0]) format_template(cfg.out_template, cur_ymd, out_path);
   else strncpy(out_path, cfg.out_csv, MAX_PATH-1);
-  dirname_of(out_path, out_dir);
-  ensure_dir(out_dir);
+  if (cur_ymd[0]) {
+    dirname_of(out_path, out_dir);
+    ensure_dir(out_dir);
+  }
 
   FILE *fin = NULL;
   FILE *fout = NULL;
@@ -814,15 +1032,49 @@ int main(int argc, char **argv) {
   time_t last_ckpt_t = 0;
   time_t last_flush_t = 0;
   long last_ckpt_off = -1;
+  static CjReader jr;
+  static CshmReader sr;
+  int shm_open_ok = 0;
+  CmtTail tail = {0};   // sidecar .tail do leitorwebsocket --writer mmap
+  CkfWriter kw;
+  memset(&kw, 0, sizeof(kw));
+  int kf_last = -1;
+  long long quiet_off = -1;   // até esse offset só refaz o book (retomada)
+  CcuState cu;                // recuperação até o primeiro EOF (zerado = ao vivo)
+  memset(&cu, 0, sizeof(cu));
+  int catchup_emit = cfg.catchup_emit;
+  CtlWatch cw;
+  memset(&cw, 0, sizeof(cw));
+  cw.fd = -1;
+  if (!cfg.shm[0] && !cfg.batch_mode) {
+    ctl_init(&cw);
+    ctl_follow(&cw, input_path);
+  }
+  const int poll_ms = (int)(cfg.poll_sec * 1000.0);
+  CstFile zs;
+  memset(&zs, 0, sizeof(zs));
+  zs.fd = -1;
+  unsigned char *zbuf = (unsigned char*)malloc(zstate_size(&cfg, n_syms));
+  if (!zbuf) die("sem memória para o estado");
 
   while (1) {
-    if (!cfg.date_fixed[0] && has_ymd_placeholder(cfg.input_template)) {
-      char ymd_now[16]; today_ymd(ymd_now);
+    if (!cfg.date_fixed[0] && (cfg.shm[0] || has_ymd_placeholder(cfg.input_template))) {
+      char ymd_now[16];
+      if (ymd_from_rec) snprintf(ymd_now, sizeof(ymd_now), "%s", next_ymd[0] ? next_ymd : cur_ymd);
+      else today_ymd(ymd_now);
       if (strcmp(ymd_now, cur_ymd) != 0) {
         strncpy(cur_ymd, ymd_now, sizeof(cur_ymd)-1);
         if (fin) { fclose(fin); fin = NULL; }
         if (fout) { fclose(fout); fout = NULL; }
+        cmt_detach(&tail);
+        ckf_writer_close(&kw);
+        cst_close(&zs);
+        kf_last = -1;
+        quiet_off = -1;              // o offset de retomada era do arquivo de ontem
+        memset(&cu, 0, sizeof(cu));
         format_template(cfg.input_template, cur_ymd, input_path);
+        if (cfg.shm[0]) snprintf(input_path, MAX_PATH, "shm:%s", cfg.shm);
+        else ctl_follow(&cw, input_path);
         if (cfg.out_template[0]) format_template(cfg.out_template, cur_ymd, out_path);
         else strncpy(out_path, cfg.out_csv, MAX_PATH-1);
         dirname_of(out_path, out_dir);
@@ -836,55 +1088,176 @@ int main(int argc, char **argv) {
       }
     }
 
-    if (!fin) {
-      if (!file_exists(input_path)) {
+    if (cfg.shm[0] && !shm_open_ok) {
+      // Espera o coletor criar o segmento
+      if (cshm_open(&sr, cfg.shm, 'Z') != 0) {
         usleep((useconds_t)(cfg.poll_sec * 1000000.0));
         continue;
       }
-      fin = fopen(input_path, "r");
+      shm_open_ok = 1;
+    }
+
+    if (!fin && !cfg.shm[0]) {
+      if (!cz_exists(input_path)) {
+        ctl_wait(&cw, poll_ms);
+        continue;
+      }
+      fin = cz_fopen(input_path, cfg.journal ? "rb" : "r");
       if (fin) setvbuf(fin, NULL, _IOFBF, 1<<20);
       if (!fin) { perror("fopen input"); usleep(200000); continue; }
 
-      state_path_for(&cfg, cur_ymd, state_path);
+      state_path_for(&cfg, cur_ymd, ".offset", state_path);
       long last_offset = read_offset(state_path);
       if (cfg.reset_state) last_offset = 0;
 
+      // Estado quente do último checkpoint
+      long long start = 0;
+      int warm = 0;
+      if (!ranged) {
+        char zs_path[MAX_PATH];
+        state_path_for(&cfg, cur_ymd, ".state", zs_path);
+        cst_close(&zs);
+        if (cst_open(&zs, zs_path, zstate_tag(&cfg, ctx, n_syms), zstate_size(&cfg, n_syms)) != 0) {
+          fprintf(stderr, "AVISO: sem checkpoint de estado em %s\n", zs_path);
+        } else if (cfg.reset_state) {
+          cst_clear(&zs);
+        } else if (cst_load(&zs, zbuf)) {
+          zstate_unpack(zbuf, &cfg, ctx, n_syms, &start, last_write_ts, &last_sec_of_day);
+          warm = 1;
+          fprintf(stderr, "[parser_Z] estado restaurado em %lld (%s)\n", start, last_write_ts);
+        }
+      }
+      cmt_detach(&tail);
+      cmt_attach(&tail, input_path);
+
+      // Ponto de retomada: offset salvo ou, com --start-at-end, o fim do input
+      quiet_off = -1;
+      long long resume = last_offset;
       if (cfg.start_at_end && last_offset == 0) {
-        fseek(fin, 0, SEEK_END);
-      } else {
-        if (last_offset > 0) fseek(fin, last_offset, SEEK_SET);
+        if (cfg.journal) {
+          // fseeko/ftello em vez de fstat: fin pode ser um .zst (sem fileno)
+          if (fseeko(fin, 0, SEEK_END) == 0) resume = (long long)ftello(fin);
+        } else {
+          cmt_seek_end(&tail, fin);
+          resume = (long long)ftello(fin);
+        }
+      }
+
+      // Sem estado, o book vem do keyframe mais próximo (ou do início do
+      // arquivo); até o ponto de retomada as linhas só refazem o book
+      if (warm) {
+        if (resume > start) quiet_off = resume;
+      } else if (ranged) {
+        if (cfg.from_sec >= 0) {
+          kf_restore(ctx, n_syms, cfg.depth, input_path, cfg.from_sec - Z_WARM_SEC, -1, &start);
+        }
+      } else if (resume > 0) {
+        if (kf_restore(ctx, n_syms, cfg.depth, input_path, -1, resume, &start)) {
+          fprintf(stderr, "[parser_Z] keyframe: book de %lld, retomando em %lld\n", start, resume);
+        }
+        quiet_off = resume;
+      }
+      char kf_path[MAX_PATH];
+      ckf_writer_open(&kw, cfg.kf_sec > 0 && ckf_path(input_path, 'Z', kf_path, sizeof(kf_path)) ? kf_path : NULL,
+                      'Z', (uint32_t)cfg.depth, 0, sizeof(Level));
+
+      if (cfg.journal) {
+        // cj_seek para na fronteira de registro e recarrega a tabela de símbolos
+        cj_free(&jr);
+        cj_init(&jr, fin);
+        cj_seek(&jr, start);
+      } else if (fseeko(fin, (off_t)start, SEEK_SET) != 0) {
+        rewind(fin);
       }
+      ccu_begin(&cu, "parser_Z", cfg.batch_mode ? -1 : catchup_emit);
+      catchup_emit = -1;   // --catchup-emit só vale na partida, não no arquivo do dia seguinte
     }
 
-    if (!fout) {
+    if (!fout && cur_ymd[0]) {
       int need_header = csv_needs_header(out_path);
       fout = fopen(out_path, "a");
       if (fout) setvbuf(fout, NULL, _IOFBF, 1<<20);
-      if (!fout) { perror("fopen out"); fclose(fin); fin=NULL; usleep(200000); continue; }
+      if (!fout) { perror("fopen out"); if (fin) fclose(fin); fin=NULL; usleep(200000); continue; }
       if (need_header) csv_write_header(fout);
     }
 
+    // Próximo evento: linha do _Z.txt ou registro 'Z' do journal
+    Event ev;
+    long file_off;
+    int sec_of_day = -1;
+    int at_eof = 0;
+
     // getline buffer reaproveitado (evita malloc/free por linha)
     static char *line = NULL;
     static size_t cap = 0;
-    ssize_t nread = getline(&line, &cap, fin);
-    if (nread < 0) {
-      long off = ftell(fin);
+
+    if (cfg.journal || cfg.shm[0]) {
+      CjRecord rec;
+      int r = cfg.shm[0] ? cshm_next_day(&sr, &rec, ymd_from_rec ? cur_ymd : NULL, next_ymd) : cj_next(&jr, &rec);
+      if (r < 0) {
+        fprintf(stderr, "ERRO: journal inválido: %s\n", input_path);
+        break;
+      }
+      if (r == 2) continue;   // registro de outro dia: troca no topo do laço
+      if (r == 0) {
+        at_eof = 1;
+      } else {
+        if (cu.active) {
+          const struct tm *tmc = cj_local_tm(&rec);
+          ccu_count(&cu, sizeof(rec.h) + rec.h.len, tmc->tm_hour*3600 + tmc->tm_min*60 + tmc->tm_sec);
+        }
+        if (rec.h.type == CJ_TYPE_GAP) {
+          for (int i = 0; i < n_syms; i++) {
+            if (cedro_gap_covers(rec.payload, ctx[i].symbol)) ob_reset(&ctx[i].book);
+          }
+          continue;
+        }
+        if (rec.h.type != 'Z') continue;
+        if (!parse_payload(rec.payload, &ev)) continue;
+        cj_write_ts(&rec, ev.write_ts);
+        const struct tm *tmr = cj_local_tm(&rec);
+        sec_of_day = tmr->tm_hour*3600 + tmr->tm_min*60 + tmr->tm_sec;
+      }
+      file_off = cfg.shm[0] ? 0 : (long)jr.offset;
+    } else {
+      ssize_t nread = cmt_at_limit(&tail, fin) ? -1 : getline(&line, &cap, fin);
+      if (nread < 0 || (!cfg.batch_mode && ctl_partial_line(fin, line, (size_t)nread))) at_eof = 1;
+      else ccu_count(&cu, (size_t)nread, ci_line_sec(line));
+      file_off = ftell(fin);
+    }
+
+    if (at_eof && cfg.shm[0]) {
+      if (fout) fflush(fout);
+      if (cshm_eof(&sr)) break;   // engine leu o raw até o fim
+      cshm_wait(&sr);
+      continue;
+    }
+
+    if (at_eof) {
+      long off = file_off;
       // checkpoint final antes de dormir/sair
-      if (off != last_ckpt_off) {
+      if (!ranged && off > quiet_off && off != last_ckpt_off) {
+        if (fout) fflush(fout);
+        zstate_save(&zs, zbuf, &cfg, ctx, n_syms, off, last_write_ts, last_sec_of_day);
         write_offset(state_path, off);
         last_ckpt_off = off;
       }
       if (fout) fflush(fout);
       clearerr(fin);
       if (cfg.batch_mode) break;
-      usleep((useconds_t)(cfg.poll_sec * 1000000.0));
+      ccu_live(&cu, fout);
+      ctl_wait(&cw, poll_ms);
       continue;
     }
-    long file_off = ftell(fin);
 
-    Event ev;
-    if (!parse_event(line, &ev)) { continue; }
+    if (!cfg.journal && !cfg.shm[0] && cedro_gap_line(line)) {
+      const char *gp = cedro_gap_payload(line);
+      for (int i = 0; i < n_syms; i++) {
+        if (cedro_gap_covers(gp, ctx[i].symbol)) ob_reset(&ctx[i].book);
+      }
+      continue;
+    }
+    if (!cfg.journal && !cfg.shm[0] && !parse_event(line, &ev)) { continue; }
 
     SymCtx *sc = find_sym(ctx, n_syms, ev.symbol);
     if (!sc) { continue; }
@@ -902,13 +1275,14 @@ int main(int argc, char **argv) {
       ob_apply(&sc->book, ev.op, ev.cancel_type, ev.side, ev.pos, ev.price, ev.qty, ev.n_orders);
     }
 
-    int sec_of_day;
-    if (!parse_write_ts_sec(ev.write_ts, &sec_of_day)) { continue; }
+    if (!cfg.journal && !parse_write_ts_sec(ev.write_ts, &sec_of_day)) { continue; }
 
     if (last_write_ts[0] == 0) {
       strncpy(last_write_ts, ev.write_ts, sizeof(last_write_ts)-1);
       last_sec_of_day = sec_of_day;
     } else if (strcmp(ev.write_ts, last_write_ts) != 0) {
+      int ckpt_due = 0;
+      time_t now_t;
       if (cfg.snapshot_sec <= 1 || ((last_sec_of_day % cfg.snapshot_sec) == 0)) {
         time_t dtw = parse_write_ts_time_t(last_write_ts);
         struct timeval tv; gettimeofday(&tv, NULL);
@@ -931,20 +1305,19 @@ int main(int argc, char **argv) {
             sg.mid_chg_3 = 0.0;
             sg.activity = 0;
           }
-          csv_write_row(fout, read_ts, last_write_ts, sci->symbol, &snap, &sg, &sci->ctr,
-                        delay_ms, file_off, input_path);
+          if (last_sec_of_day >= cfg.from_sec && file_off > quiet_off && ccu_emit(&cu, last_sec_of_day)) {
+            csv_write_row(fout, read_ts, last_write_ts, sci->symbol, &snap, &sg, &sci->ctr,
+                          delay_ms, file_off, input_path);
+          }
           reset_counters(sci);
         }
-        // checkpoint (offset) e flush em cadência (evita custo por linha)
-        time_t now_t = time(NULL);
+        // checkpoint (offset + estado) e flush em cadência (evita custo por linha)
+        now_t = time(NULL);
         if (cfg.ckpt_sec <= 0 || last_ckpt_t == 0 || (now_t - last_ckpt_t) >= cfg.ckpt_sec) {
-          if (file_off != last_ckpt_off) {
-            write_offset(state_path, file_off);
-            last_ckpt_off = file_off;
-          }
+          ckpt_due = !cfg.shm[0] && !ranged && file_off > quiet_off && file_off != last_ckpt_off;
           last_ckpt_t = now_t;
         }
-        if (cfg.flush_sec <= 0 || last_flush_t == 0 || (now_t - last_flush_t) >= cfg.flush_sec) {
+        if (!cu.active && (cfg.flush_sec <= 0 || last_flush_t == 0 || (now_t - last_flush_t) >= cfg.flush_sec)) {
           fflush(fout);
           last_flush_t = now_t;
         }
@@ -952,10 +1325,28 @@ int main(int argc, char **argv) {
 
       strncpy(last_write_ts, ev.write_ts, sizeof(last_write_ts)-1);
       last_sec_of_day = sec_of_day;
+      if (cfg.to_sec >= 0 && sec_of_day > cfg.to_sec) break;
+
+      // Depois de last_write_ts: o estado gravado continua exatamente daqui
+      if (ckpt_due) {
+        fflush(fout);
+        zstate_save(&zs, zbuf, &cfg, ctx, n_syms, file_off, last_write_ts, last_sec_of_day);
+        write_offset(state_path, file_off);
+        last_ckpt_off = file_off;
+      }
     }
 
+    if (!cfg.shm[0] && kf_due(&kf_last, sec_of_day, cfg.kf_sec)) kf_save(&kw, ctx, n_syms, file_off, sec_of_day);
+
   }
 
+  cj_free(&jr);
+  if (shm_open_ok) cshm_free(&sr);
+  cmt_detach(&tail);
+  ckf_writer_close(&kw);
+  cst_close(&zs);
+  ctl_close(&cw);
+  free(zbuf);
   for (int i=0;i<n_syms;i++) sym_free(&ctx[i]);
   return 0;
 }
@@ -17,32 +17,15 @@ PERSIST=3
 COOLDOWN=30
 CKPT=5
 FLUSH=5
+BAR_SECS="1,5,10,30,60,120,300,600,900"   # uma passada no input para todos
 
 START="20251216"
 END="20260106"
 
-# gera lista de datas (inclusive) sem depender do GNU date (mas ele normalmente existe no Ubuntu)
-d="$START"
-while [[ "$d" -le "$END" ]]; do
-  in_file="${IN_DIR}/${d}_B.txt"
-  out_file="${OUT_DIR}/${d}_b_5s.csv"
+# os dias rodam em paralelo no cedro_batch (JOBS processos; default = núcleos);
+# dia já processado com os mesmos argumentos é pulado (--force refaz)
+JOBS="${JOBS:-$(nproc)}"
 
-  if [[ ! -f "$in_file" ]]; then
-    echo "[SKIP] Não existe: $in_file"
-    d=$(date -d "${d:0:4}-${d:4:2}-${d:6:2} +1 day" +"%Y%m%d")
-    continue
-  fi
-
-  echo "[RUN] $d  input=$in_file  output=$out_file"
-
-  # limpa offset antigo desse dia pra não confundir (mesmo usando --reset-state)
-  rm -f "${STATE_DIR}/${d}_B.offset" 2>/dev/null || true
-
-  "$PARSER" \
-    --file "$in_file" \
-    --out "$out_file" \
-
-  d=$(date -d "${d:0:4}-${d:4:2}-${d:6:2} +1 day" +"%Y%m%d")
-done
-
-echo "OK. Finalizado."
+exec ./cedro_batch --from "$START" --to "$END" --pipelines B -j "$JOBS" \
+  --bin-dir "$(dirname "$PARSER")" --in-dir "$IN_DIR" --b-dir "$OUT_DIR" --state-dir "$STATE_DIR" \
+  --bar-sec "$BAR_SECS" "$@"
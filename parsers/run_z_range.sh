@@ -21,34 +21,14 @@ FLUSH=5
 START="20251201"
 END="20251227"
 
-# gera lista de datas (inclusive) sem depender do GNU date (mas ele normalmente existe no Ubuntu)
-d="$START"
-while [[ "$d" -le "$END" ]]; do
-  in_file="${IN_DIR}/${d}_Z.txt"
-  out_file="${OUT_DIR}/${d}_ztop_signal_1s.csv"
-
-  if [[ ! -f "$in_file" ]]; then
-    echo "[SKIP] Não existe: $in_file"
-    d=$(date -d "${d:0:4}-${d:4:2}-${d:6:2} +1 day" +"%Y%m%d")
-    continue
-  fi
-
-  echo "[RUN] $d  input=$in_file  output=$out_file"
-
-  # limpa offset antigo desse dia pra não confundir (mesmo usando --reset-state)
-  rm -f "${STATE_DIR}/${d}_Z.offset" 2>/dev/null || true
-
-  "$PARSER" \
-    --input-template "$in_file" \
-    --out-csv "$out_file" \
-    --state-dir "$STATE_DIR" \
-    --symbols "$SYMBOLS" \
-    --depth "$DEPTH" --topn "$TOPN" --snapshot-sec "$SNAP" \
-    --min-warmup "$MIN_WARMUP" --zwin "$ZWIN" \
-    --score-th "$SCORE_TH" --persist "$PERSIST" --cooldown-sec "$COOLDOWN" --require-sign \
-    --reset-state --batch --ckpt-sec "$CKPT" --flush-sec "$FLUSH"
-
-  d=$(date -d "${d:0:4}-${d:4:2}-${d:6:2} +1 day" +"%Y%m%d")
-done
-
-echo "OK. Finalizado."
+# os dias rodam em paralelo no cedro_batch (JOBS processos; default = núcleos);
+# os parâmetros de DEPTH a FLUSH vão no --z-args (cada dia com --date próprio,
+# para o estado de um dia não pisar no de outro)
+JOBS="${JOBS:-$(nproc)}"
+
+exec ./cedro_batch --from "$START" --to "$END" --pipelines Z -j "$JOBS" \
+  --bin-dir "$(dirname "$PARSER")" --in-dir "$IN_DIR" --z-dir "$OUT_DIR" --state-dir "$STATE_DIR" \
+  --symbols "$SYMBOLS" \
+  --z-args "--depth $DEPTH --topn $TOPN --snapshot-sec $SNAP --min-warmup $MIN_WARMUP --zwin $ZWIN \
+--score-th $SCORE_TH --persist $PERSIST --cooldown-sec $COOLDOWN --require-sign --reset-state --batch \
+--ckpt-sec $CKPT --flush-sec $FLUSH" "$@"